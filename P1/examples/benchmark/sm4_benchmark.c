@@ -50,6 +50,13 @@ static uint8_t gcm_plaintext[64];
 static uint8_t gcm_ciphertext[64];
 static uint8_t gcm_tag[16];
 
+/* 密钥敏捷测试：消息长度、密钥数和每个长度的采样数 */
+static const size_t agility_sizes[] = {16, 64, 256, 1500};
+#define AGILITY_KEYS 1024
+#define AGILITY_SAMPLES 20000
+#define AGILITY_WARMUP 1000
+#define AGILITY_MAX_LEN 1500
+
 /* 全局上下文 */
 static SM4_Context basic_encrypt_ctx;
 static SM4_Context basic_decrypt_ctx;
@@ -59,7 +66,6 @@ static SM4_Context aesni_encrypt_ctx;
 static SM4_Context aesni_decrypt_ctx;
 static SM4_Context modern_encrypt_ctx;
 static SM4_Context modern_decrypt_ctx;
-static SM4_GCM_Context gcm_ctx;
 
 /* 测试函数 - 基本实现 */
 static void test_basic_encrypt(void) {
@@ -107,14 +113,194 @@ static void test_gcm_encrypt(void) {
     );
 }
 
+/* 单调时钟（纳秒） */
+static double now_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    
+    return x < y ? -1 : x > y;
+}
+
+/* 百分位数（samples必须已排序） */
+static double percentile(const double *samples, size_t n, double p) {
+    size_t idx = (size_t)(p / 100.0 * (double)(n - 1) + 0.5);
+    
+    return samples[idx];
+}
+
+/* 一条消息：每次调用都使用新密钥，完整地做密钥扩展、H预计算、加密和认证 */
+static void agility_message_uncached(const uint8_t *k, const uint8_t *in, size_t len, uint8_t *out) {
+    uint8_t tag[16];
+    
+    sm4_gcm_encrypt_and_tag(k, iv, sizeof(iv), aad, sizeof(aad), in, len, out, tag, sizeof(tag));
+}
+
+/* 一条消息：密钥相关的预计算从缓存中取 */
+static void agility_message_cached(SM4_GCM_Key_Cache *cache, const uint8_t *k,
+                                   const uint8_t *in, size_t len, uint8_t *out) {
+    SM4_GCM_Context ctx;
+    uint8_t tag[16];
+    
+    sm4_gcm_init_cached(cache, &ctx, k, iv, sizeof(iv));
+    sm4_gcm_aad(&ctx, aad, sizeof(aad));
+    sm4_gcm_encrypt(&ctx, out, in, len);
+    sm4_gcm_finish(&ctx, tag, sizeof(tag));
+}
+
+/* 测量一种路径在一个长度上的单条消息延迟，输出p50和p99（纳秒） */
+static void agility_latency(SM4_GCM_Key_Cache *cache, const uint8_t *keys, size_t len,
+                            double *samples, double *p50, double *p99) {
+    static uint8_t in[AGILITY_MAX_LEN];
+    static uint8_t out[AGILITY_MAX_LEN];
+    double t0;
+    
+    for (size_t i = 0; i < len; i++) {
+        in[i] = (uint8_t)i;
+    }
+    
+    for (size_t i = 0; i < AGILITY_WARMUP + AGILITY_SAMPLES; i++) {
+        const uint8_t *k = keys + (i % AGILITY_KEYS) * 16;
+        
+        t0 = now_ns();
+        if (cache != NULL) {
+            agility_message_cached(cache, k, in, len, out);
+        } else {
+            agility_message_uncached(k, in, len, out);
+        }
+        if (i >= AGILITY_WARMUP) {
+            samples[i - AGILITY_WARMUP] = now_ns() - t0;
+        }
+    }
+    
+    qsort(samples, AGILITY_SAMPLES, sizeof(double), compare_double);
+    *p50 = percentile(samples, AGILITY_SAMPLES, 50);
+    *p99 = percentile(samples, AGILITY_SAMPLES, 99);
+}
+
+/* 密钥扩展速率（每秒密钥数），batch为0时逐个调用sm4_set_encrypt_key() */
+static double agility_keys_per_second(const uint8_t *keys, size_t batch) {
+    static SM4_Context ctx[16];
+    size_t count = 0;
+    double t0 = now_ns(), elapsed;
+    
+    do {
+        for (size_t i = 0; i < AGILITY_KEYS; i += 16) {
+            if (batch == 0) {
+                for (size_t j = 0; j < 16; j++) {
+                    sm4_set_encrypt_key(&ctx[j], keys + (i + j) * 16);
+                }
+            } else {
+                sm4_set_encrypt_keys_batch(ctx, keys + i * 16, 16);
+            }
+        }
+        count += AGILITY_KEYS;
+        elapsed = now_ns() - t0;
+    } while (elapsed < 2e8);
+    
+    return (double)count * 1e9 / elapsed;
+}
+
+/* GCM密钥准备速率（每秒密钥数）：cache为NULL时是sm4_gcm_init()，否则是命中缓存的sm4_gcm_init_cached() */
+static double agility_gcm_inits_per_second(SM4_GCM_Key_Cache *cache, const uint8_t *keys) {
+    SM4_GCM_Context ctx;
+    size_t count = 0;
+    double t0 = now_ns(), elapsed;
+    
+    do {
+        for (size_t i = 0; i < AGILITY_KEYS; i++) {
+            if (cache != NULL) {
+                sm4_gcm_init_cached(cache, &ctx, keys + i * 16, iv, sizeof(iv));
+            } else {
+                sm4_gcm_init(&ctx, keys + i * 16, iv, sizeof(iv));
+            }
+        }
+        count += AGILITY_KEYS;
+        elapsed = now_ns() - t0;
+    } while (elapsed < 2e8);
+    
+    return (double)count * 1e9 / elapsed;
+}
+
+/*
+ * 密钥敏捷/短消息延迟测试
+ *
+ * 模拟大量短消息、每条消息换密钥的流量：AGILITY_KEYS个密钥轮流使用，逐条计时，
+ * 报告sm4_gcm_encrypt_and_tag()的p50/p99延迟（包含密钥扩展和H预计算），
+ * 以及同一批密钥经过密钥缓存（全部命中）时的延迟，两者之差就是缓存每条消息省下的时间。
+ * 延迟包含一次clock_gettime()的开销。
+ */
+static int run_key_agility(void) {
+    static uint8_t keys[AGILITY_KEYS * 16];
+    static double samples[AGILITY_SAMPLES];
+    SM4_GCM_Key_Cache *cache;
+    double p50, p99, c50, c99;
+    uint64_t hits, misses;
+    
+    for (size_t i = 0; i < sizeof(keys); i++) {
+        keys[i] = (uint8_t)(i * 131 + (i >> 4) * 7 + 1);
+    }
+    
+    cache = sm4_gcm_key_cache_create(AGILITY_KEYS);
+    if (cache == NULL) {
+        printf("创建密钥缓存失败\n");
+        return 1;
+    }
+    sm4_gcm_key_cache_preload(cache, keys, AGILITY_KEYS);
+    
+    printf("SM4实现: %s，GHASH实现: %s\n", sm4_get_current_implementation(), sm4_gcm_get_ghash_implementation());
+    printf("密钥敏捷测试: %d个密钥轮流使用，每个长度%d条消息，AAD %zu字节\n\n",
+           AGILITY_KEYS, AGILITY_SAMPLES, sizeof(aad));
+    
+    printf("密钥扩展:\n");
+    printf("  sm4_set_encrypt_key:           %12.0f 密钥/秒\n", agility_keys_per_second(keys, 0));
+    printf("  sm4_set_encrypt_keys_batch:    %12.0f 密钥/秒\n", agility_keys_per_second(keys, 16));
+    printf("  sm4_gcm_init:                  %12.0f 密钥/秒\n", agility_gcm_inits_per_second(NULL, keys));
+    printf("  sm4_gcm_init_cached（命中）:   %12.0f 密钥/秒\n\n", agility_gcm_inits_per_second(cache, keys));
+    
+    printf("单条消息延迟（纳秒）:\n");
+    printf("  %6s  %10s %10s  %10s %10s\n", "长度", "每次换密钥p50", "p99", "缓存p50", "p99");
+    for (size_t i = 0; i < sizeof(agility_sizes) / sizeof(agility_sizes[0]); i++) {
+        agility_latency(NULL, keys, agility_sizes[i], samples, &p50, &p99);
+        agility_latency(cache, keys, agility_sizes[i], samples, &c50, &c99);
+        printf("  %6zu  %10.0f %10.0f  %10.0f %10.0f\n", agility_sizes[i], p50, p99, c50, c99);
+    }
+    
+    sm4_gcm_key_cache_stats(cache, &hits, &misses);
+    printf("\n密钥缓存: 命中%llu次，未命中%llu次\n", (unsigned long long)hits, (unsigned long long)misses);
+    
+    sm4_gcm_key_cache_destroy(cache);
+    return 0;
+}
+
+static void print_usage(const char *prog) {
+    printf("用法: %s [--key-agility]\n", prog);
+    printf("  （无参数）      各实现的单块吞吐量和64字节GCM吞吐量\n");
+    printf("  --key-agility   短消息、每条消息换密钥时的延迟（p50/p99）和密钥扩展速率\n");
+}
+
 int main(int argc, char *argv[]) {
     int iterations = 100000;
     int gcm_iterations = 10000;
     double time_used;
     SM4_CPU_Features features;
     
+    if (argc > 1) {
+        if (strcmp(argv[1], "--key-agility") == 0) {
+            return run_key_agility();
+        }
+        print_usage(argv[0]);
+        return strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0 ? 0 : 1;
+    }
+    
     /* 初始化测试数据 */
-    for (int i = 0; i < sizeof(gcm_plaintext); i++) {
+    for (size_t i = 0; i < sizeof(gcm_plaintext); i++) {
         gcm_plaintext[i] = (uint8_t)i;
     }
     
@@ -132,23 +318,13 @@ int main(int argc, char *argv[]) {
     
     printf("\n最佳SM4实现: %s\n\n", sm4_get_best_implementation());
     
-    /* 初始化上下文 */
-    sm4_set_encrypt_key(&basic_encrypt_ctx, key);
-    sm4_set_decrypt_key(&basic_decrypt_ctx, key);
-    
-    sm4_set_encrypt_key(&t_table_encrypt_ctx, key);
-    sm4_set_decrypt_key(&t_table_decrypt_ctx, key);
-    
-    sm4_set_encrypt_key(&aesni_encrypt_ctx, key);
-    sm4_set_decrypt_key(&aesni_decrypt_ctx, key);
-    
-    sm4_set_encrypt_key(&modern_encrypt_ctx, key);
-    sm4_set_decrypt_key(&modern_decrypt_ctx, key);
-    
     /* 性能测试 */
     printf("执行性能测试...\n\n");
     
     /* 基本实现 */
+    sm4_force_implementation("basic");
+    sm4_set_encrypt_key(&basic_encrypt_ctx, key);
+    sm4_set_decrypt_key(&basic_decrypt_ctx, key);
     printf("基本实现 (%d 次迭代):\n", iterations);
     
     time_used = measure_time(test_basic_encrypt, iterations);
@@ -162,6 +338,9 @@ int main(int argc, char *argv[]) {
            (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
     
     /* T表实现 */
+    sm4_force_implementation("t_table");
+    sm4_set_encrypt_key(&t_table_encrypt_ctx, key);
+    sm4_set_decrypt_key(&t_table_decrypt_ctx, key);
     printf("\nT表实现 (%d 次迭代):\n", iterations);
     
     time_used = measure_time(test_t_table_encrypt, iterations);
@@ -175,7 +354,9 @@ int main(int argc, char *argv[]) {
            (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
     
     /* AESNI实现 */
-    if (features.has_aesni) {
+    if (sm4_force_implementation("aesni") == 0) {
+        sm4_set_encrypt_key(&aesni_encrypt_ctx, key);
+        sm4_set_decrypt_key(&aesni_decrypt_ctx, key);
         printf("\nAESNI实现 (%d 次迭代):\n", iterations);
         
         time_used = measure_time(test_aesni_encrypt, iterations);
@@ -190,7 +371,9 @@ int main(int argc, char *argv[]) {
     }
     
     /* 现代指令集实现 */
-    if (features.has_gfni) {
+    if (sm4_force_implementation("gfni") == 0) {
+        sm4_set_encrypt_key(&modern_encrypt_ctx, key);
+        sm4_set_decrypt_key(&modern_decrypt_ctx, key);
         printf("\n现代指令集实现 (%d 次迭代):\n", iterations);
         
         time_used = measure_time(test_modern_encrypt, iterations);
@@ -204,7 +387,8 @@ int main(int argc, char *argv[]) {
                (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
     }
     
-    /* GCM模式 */
+    /* GCM模式（使用自动选择的实现） */
+    sm4_force_implementation(NULL);
     printf("\nGCM模式 (%d 次迭代):\n", gcm_iterations);
     
     time_used = measure_time(test_gcm_encrypt, gcm_iterations);
@@ -18,6 +18,15 @@ typedef struct {
     uint32_t rk[SM4_ROUNDS];  // 轮密钥
 } SM4_Context;
 
+/* SM4-CTR 流式上下文 */
+typedef struct {
+    SM4_Context cipher_ctx;             // SM4 上下文（加密轮密钥）
+    uint8_t iv[SM4_BLOCK_SIZE];         // 初始计数器块
+    uint8_t counter[SM4_BLOCK_SIZE];    // 下一个待加密的计数器块
+    uint8_t keystream[SM4_BLOCK_SIZE];  // 上次调用剩余的密钥流
+    size_t keystream_pos;               // keystream中已使用的字节数，16表示没有剩余
+} SM4_CTR_Context;
+
 /* 基本SM4函数 */
 
 /**
@@ -34,6 +43,18 @@ void sm4_set_encrypt_key(SM4_Context *ctx, const uint8_t *key);
  */
 void sm4_set_decrypt_key(SM4_Context *ctx, const uint8_t *key);
 
+/**
+ * @brief 批量初始化SM4加密上下文
+ *
+ * 结果与对每个密钥调用sm4_set_encrypt_key()相同。当前后端支持时多个密钥在SIMD通道中
+ * 同时扩展（gfni每组16个，aesni每组4个），其他后端逐个扩展。
+ *
+ * @param ctx count个SM4上下文
+ * @param keys count个16字节密钥，连续存放
+ * @param count 密钥数量
+ */
+void sm4_set_encrypt_keys_batch(SM4_Context *ctx, const uint8_t *keys, size_t count);
+
 /**
  * @brief 加密单个数据块
  * @param ctx SM4上下文
@@ -103,15 +124,76 @@ int sm4_cbc_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, siz
 
 /**
  * @brief SM4-CBC模式解密
- * @param ctx SM4上下文
- * @param out 输出明文
+ *
+ * 解密没有链式依赖，整批密文交给多块内核并行解密。
+ *
+ * @param ctx SM4上下文（解密轮密钥）
+ * @param out 输出明文（可以与in相同，不能部分重叠）
  * @param in 输入密文
  * @param len 密文长度（必须是16的倍数）
- * @param iv 初始化向量（16字节）
+ * @param iv 初始化向量（16字节），返回时更新为最后一块密文，便于继续解密
  * @return 0成功，非0失败
  */
 int sm4_cbc_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv);
 
+/**
+ * @brief 多流SM4-CBC加密
+ *
+ * 同一密钥下多个互不相关的CBC流交错加密：每一步各取一块拼成一次多块调用，
+ * 结果与对每个流分别调用sm4_cbc_encrypt()相同。各流长度可以不同。
+ *
+ * @param ctx SM4上下文（加密轮密钥）
+ * @param out 各流的输出密文（可以与对应的in相同）
+ * @param in 各流的输入明文
+ * @param len 各流的长度（都必须是16的倍数）
+ * @param iv 各流的初始化向量（16字节），返回时更新为各流最后一块密文
+ * @param streams 流的个数
+ * @return 0成功，非0失败
+ */
+int sm4_cbc_encrypt_multi(const SM4_Context *ctx, uint8_t *const *out, const uint8_t *const *in,
+                          const size_t *len, uint8_t *const *iv, size_t streams);
+
+/**
+ * @brief 初始化SM4-CTR上下文
+ * @param ctx CTR上下文
+ * @param key 16字节密钥
+ * @param iv 16字节初始计数器块，之后按128位大端整数递增
+ * @return 0成功，非0失败
+ */
+int sm4_ctr_init(SM4_CTR_Context *ctx, const uint8_t *key, const uint8_t *iv);
+
+/**
+ * @brief SM4-CTR模式加密（流式）
+ *
+ * 可以多次调用，长度任意；不足一块时剩余的密钥流保存在上下文中，
+ * 下次调用接着使用。
+ *
+ * @param ctx CTR上下文
+ * @param out 输出密文（可以与in相同）
+ * @param in 输入明文
+ * @param len 长度（字节）
+ * @return 0成功，非0失败
+ */
+int sm4_ctr_encrypt(SM4_CTR_Context *ctx, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * @brief SM4-CTR模式解密（与加密相同）
+ * @param ctx CTR上下文
+ * @param out 输出明文（可以与in相同）
+ * @param in 输入密文
+ * @param len 长度（字节）
+ * @return 0成功，非0失败
+ */
+int sm4_ctr_decrypt(SM4_CTR_Context *ctx, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * @brief 把CTR流定位到指定的字节偏移（相对初始计数器块），用于随机访问
+ * @param ctx CTR上下文
+ * @param offset 字节偏移
+ * @return 0成功，非0失败
+ */
+int sm4_ctr_seek(SM4_CTR_Context *ctx, uint64_t offset);
+
 #ifdef __cplusplus
 }
 #endif
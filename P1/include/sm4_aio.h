@@ -0,0 +1,112 @@
+#ifndef SM4_AIO_H
+#define SM4_AIO_H
+
+#include "sm4.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* sm4_aio_create()的标志：不使用io_uring，始终用pread/pwrite */
+#define SM4_AIO_FLAG_NO_URING 1u
+
+/* 请求的操作 */
+typedef enum {
+    SM4_AIO_GCM_ENCRYPT = 0,  // 读明文，sm4_gcm_encrypt_and_tag()，写密文，标签写入tag
+    SM4_AIO_GCM_DECRYPT,      // 读密文，sm4_gcm_decrypt_and_verify()，验证通过才写明文
+    SM4_AIO_CTR               // 读入，SM4-CTR加密/解密，写出
+} SM4_AIO_Op;
+
+/*
+ * 一个请求：从in_fd的in_off处读len字节，整条消息加密/解密后写到out_fd的out_off处。
+ * 请求结构和key、iv、aad指向的数据在请求完成并被sm4_aio_poll()取回之前必须保持有效。
+ * 文件描述符以O_DIRECT打开时，偏移和长度需要满足设备的对齐要求（缓冲区由引擎按4 KiB对齐分配）。
+ */
+typedef struct sm4_aio_request {
+    SM4_AIO_Op op;
+    const uint8_t *key;       // 16字节密钥
+    const uint8_t *iv;        // GCM：IV/Nonce；CTR：16字节初始计数器块
+    size_t iv_len;            // GCM的IV长度（通常为12），CTR忽略
+    const uint8_t *aad;       // GCM附加认证数据，可以为NULL
+    size_t aad_len;
+    int in_fd;
+    uint64_t in_off;
+    int out_fd;
+    uint64_t out_off;
+    size_t len;               // 消息长度（字节）
+    uint8_t tag[16];          // GCM：加密时输出的标签，解密时输入的标签
+    int result;               // 完成时设置：0成功，负值为-errno，验证失败为-EBADMSG
+    void *user_data;          // 调用者自用，引擎不访问
+
+    /* 以下字段由引擎内部使用 */
+    uint8_t *buf;
+    size_t buf_size;
+    size_t done;
+    int state;
+    struct sm4_aio_request *next;
+} SM4_AIO_Request;
+
+/* 异步加密引擎（不透明类型） */
+typedef struct sm4_aio_engine SM4_AIO_Engine;
+
+/**
+ * @brief 创建异步加密引擎
+ *
+ * Linux上优先使用io_uring：读和写以SQE批量提交，一次io_uring_enter()推进所有请求；
+ * 内核或编译环境不支持io_uring（或指定了SM4_AIO_FLAG_NO_URING）时退化为pread/pwrite，
+ * 接口和结果相同。读完的请求在sm4_aio_poll()中成批加密，多个请求时分给库内部的线程池。
+ *
+ * @param queue_depth 同时在途的请求数上限（1..4096）
+ * @param flags 0或SM4_AIO_FLAG_NO_URING
+ * @return 引擎，参数不合法、内存不足或平台不支持时返回NULL
+ */
+SM4_AIO_Engine *sm4_aio_create(unsigned int queue_depth, unsigned int flags);
+
+/**
+ * @brief 销毁引擎；必须在所有请求都已取回之后调用
+ * @param engine 引擎，可以为NULL
+ */
+void sm4_aio_destroy(SM4_AIO_Engine *engine);
+
+/**
+ * @brief 当前引擎使用的I/O后端
+ * @param engine 引擎
+ * @return "io_uring"或"pread"
+ */
+const char *sm4_aio_get_backend(const SM4_AIO_Engine *engine);
+
+/**
+ * @brief 提交一个请求，不阻塞
+ *
+ * 请求只进入引擎的队列，读请求在下一次sm4_aio_poll()时和其他请求一起提交给内核。
+ *
+ * @param engine 引擎
+ * @param req 请求
+ * @return 0成功；在途请求已达queue_depth时返回-EBUSY（先调用sm4_aio_poll()取回已完成的请求）；
+ *         参数不合法时返回-EINVAL（请求没有进入引擎）
+ */
+int sm4_aio_submit(SM4_AIO_Engine *engine, SM4_AIO_Request *req);
+
+/**
+ * @brief 推进所有在途请求并取回一个已完成的请求
+ *
+ * 收割完成的读写，加密读完的请求并提交它们的写，提交新请求的读。
+ *
+ * @param engine 引擎
+ * @param wait 非0时一直等到有请求完成（没有在途请求时立即返回NULL）
+ * @return 已完成的请求（result为结果），没有时返回NULL
+ */
+SM4_AIO_Request *sm4_aio_poll(SM4_AIO_Engine *engine, int wait);
+
+/**
+ * @brief 在途（已提交、尚未取回）的请求数
+ * @param engine 引擎
+ * @return 请求数
+ */
+size_t sm4_aio_inflight(const SM4_AIO_Engine *engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_AIO_H */
@@ -0,0 +1,121 @@
+#ifndef SM4_CCM_H
+#define SM4_CCM_H
+
+#include "sm4.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SM4-CCM 上下文结构（NIST SP 800-38C / RFC 3610），只保存密钥，可以被多个线程共享 */
+typedef struct {
+    SM4_Context cipher_ctx;  // SM4 上下文（加密轮密钥）
+} SM4_CCM_Context;
+
+/* 多消息接口中的一条消息 */
+typedef struct {
+    const uint8_t *nonce;  // 随机数（7..13字节）
+    size_t nonce_len;
+    const uint8_t *aad;    // 附加认证数据
+    size_t aad_len;
+    const uint8_t *in;     // 输入（明文或密文）
+    size_t len;
+    uint8_t *out;          // 输出（可以与in相同）
+    uint8_t *tag;          // 加密时输出标签，解密时输入待验证的标签
+    size_t tag_len;        // 标签长度（4..16中的偶数）
+} SM4_CCM_Message;
+
+/**
+ * @brief 设置SM4-CCM密钥
+ * @param ctx CCM上下文
+ * @param key 16字节密钥
+ * @return 0成功，非0失败
+ */
+int sm4_ccm_init(SM4_CCM_Context *ctx, const uint8_t *key);
+
+/**
+ * @brief SM4-CCM加密并生成标签
+ *
+ * 随机数长度n决定长度字段L = 15 - n，明文长度必须小于2^(8L)。
+ *
+ * @param ctx CCM上下文
+ * @param nonce 随机数
+ * @param nonce_len 随机数长度（7..13字节）
+ * @param aad 附加认证数据
+ * @param aad_len 附加认证数据长度
+ * @param in 明文
+ * @param len 明文长度
+ * @param out 输出密文（可以与in相同）
+ * @param tag 输出认证标签
+ * @param tag_len 标签长度（4..16中的偶数）
+ * @return 0成功，非0失败（参数不合法）
+ */
+int sm4_ccm_encrypt(const SM4_CCM_Context *ctx, const uint8_t *nonce, size_t nonce_len,
+                    const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                    uint8_t *out, uint8_t *tag, size_t tag_len);
+
+/**
+ * @brief SM4-CCM解密并验证标签，验证失败时输出被清零
+ * @param ctx CCM上下文
+ * @param nonce 随机数
+ * @param nonce_len 随机数长度（7..13字节）
+ * @param aad 附加认证数据
+ * @param aad_len 附加认证数据长度
+ * @param in 密文
+ * @param len 密文长度
+ * @param tag 认证标签
+ * @param tag_len 标签长度（4..16中的偶数）
+ * @param out 输出明文（可以与in相同）
+ * @return 0验证成功，非0验证失败或参数不合法
+ */
+int sm4_ccm_decrypt(const SM4_CCM_Context *ctx, const uint8_t *nonce, size_t nonce_len,
+                    const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                    const uint8_t *tag, size_t tag_len, uint8_t *out);
+
+/**
+ * @brief 一步完成SM4-CCM加密（参数同sm4_ccm_encrypt，用密钥代替上下文）
+ * @return 0成功，非0失败
+ */
+int sm4_ccm_encrypt_and_tag(const uint8_t *key, const uint8_t *nonce, size_t nonce_len,
+                            const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                            uint8_t *out, uint8_t *tag, size_t tag_len);
+
+/**
+ * @brief 一步完成SM4-CCM解密和验证（参数同sm4_ccm_decrypt，用密钥代替上下文）
+ * @return 0验证成功，非0失败
+ */
+int sm4_ccm_decrypt_and_verify(const uint8_t *key, const uint8_t *nonce, size_t nonce_len,
+                               const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                               const uint8_t *tag, size_t tag_len, uint8_t *out);
+
+/**
+ * @brief 同一密钥下批量加密多条消息
+ *
+ * 各消息的CBC-MAC链交错推进，每一步拼成一次多块调用（每组最多16条），
+ * 结果与逐条调用sm4_ccm_encrypt()相同。
+ *
+ * @param ctx CCM上下文
+ * @param msgs 消息数组
+ * @param count 消息条数
+ * @return 0成功；任何一条参数不合法时返回非0，不处理任何消息
+ */
+int sm4_ccm_encrypt_multi(const SM4_CCM_Context *ctx, const SM4_CCM_Message *msgs, size_t count);
+
+/**
+ * @brief 同一密钥下批量解密并验证多条消息（例如网关收到的一批帧）
+ *
+ * 验证失败的消息输出被清零，不影响其他消息。
+ *
+ * @param ctx CCM上下文
+ * @param msgs 消息数组
+ * @param count 消息条数
+ * @param results 可选，各消息的结果（0验证成功，-1失败）
+ * @return 全部验证成功返回0，否则非0；任何一条参数不合法时不处理任何消息
+ */
+int sm4_ccm_decrypt_multi(const SM4_CCM_Context *ctx, const SM4_CCM_Message *msgs, size_t count, int *results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_CCM_H */
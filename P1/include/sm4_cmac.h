@@ -0,0 +1,78 @@
+#ifndef SM4_CMAC_H
+#define SM4_CMAC_H
+
+#include "sm4.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SM4-CMAC 上下文结构（NIST SP 800-38B） */
+typedef struct {
+    SM4_Context cipher_ctx;         // SM4 上下文（加密轮密钥）
+    uint8_t k1[SM4_BLOCK_SIZE];     // 子密钥K1（最后一块完整时使用）
+    uint8_t k2[SM4_BLOCK_SIZE];     // 子密钥K2（最后一块需要填充时使用）
+    uint8_t state[SM4_BLOCK_SIZE];  // CBC-MAC链值
+    uint8_t buf[SM4_BLOCK_SIZE];    // 尚未处理的数据（最后一块要等到finish时才能确定）
+    size_t buf_len;                 // buf中的字节数
+} SM4_CMAC_Context;
+
+/**
+ * @brief 初始化SM4-CMAC上下文
+ * @param ctx CMAC上下文
+ * @param key 16字节密钥
+ * @return 0成功，非0失败
+ */
+int sm4_cmac_init(SM4_CMAC_Context *ctx, const uint8_t *key);
+
+/**
+ * @brief 输入消息数据（流式，可以多次调用，长度任意）
+ * @param ctx CMAC上下文
+ * @param data 数据
+ * @param len 长度（字节）
+ * @return 0成功，非0失败
+ */
+int sm4_cmac_update(SM4_CMAC_Context *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief 完成计算并输出MAC，之后上下文回到刚初始化的状态，可以计算下一条消息
+ * @param ctx CMAC上下文
+ * @param mac 输出MAC
+ * @param mac_len MAC长度（1..16字节）
+ * @return 0成功，非0失败
+ */
+int sm4_cmac_finish(SM4_CMAC_Context *ctx, uint8_t *mac, size_t mac_len);
+
+/**
+ * @brief 一步计算SM4-CMAC
+ * @param key 16字节密钥
+ * @param data 消息
+ * @param len 消息长度（字节）
+ * @param mac 输出MAC
+ * @param mac_len MAC长度（1..16字节）
+ * @return 0成功，非0失败
+ */
+int sm4_cmac(const uint8_t *key, const uint8_t *data, size_t len, uint8_t *mac, size_t mac_len);
+
+/**
+ * @brief 同一密钥下计算多条消息的CMAC
+ *
+ * 单条消息的CBC-MAC是串行的；多条消息的链彼此独立，每一步各取一块拼成一次多块调用，
+ * 宽向量内核的各通道分别处理不同的消息（每组最多16条）。结果与逐条调用sm4_cmac()相同。
+ *
+ * @param ctx 已初始化的CMAC上下文（只使用密钥部分，不会被修改）
+ * @param data 各消息
+ * @param len 各消息长度（字节，可以不同）
+ * @param mac 各消息的输出MAC
+ * @param mac_len MAC长度（1..16字节）
+ * @param count 消息条数
+ * @return 0成功，非0失败
+ */
+int sm4_cmac_multi(const SM4_CMAC_Context *ctx, const uint8_t *const *data, const size_t *len,
+                   uint8_t *const *mac, size_t mac_len, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_CMAC_H */
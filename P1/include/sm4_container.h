@@ -0,0 +1,103 @@
+#ifndef SM4_CONTAINER_H
+#define SM4_CONTAINER_H
+
+#include "sm4.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 分段认证容器格式（版本1），多字节整数均为大端序：
+ *
+ *   文件头（32字节）：
+ *     0   "SM4C"
+ *     4   版本（1）
+ *     5   算法（0 = SM4-GCM），6..7保留为0
+ *     8   分段长度（32位）
+ *     12  随机数前缀（8字节）
+ *     20  明文总长度（64位）
+ *     28  保留为0
+ *   密文：明文按分段长度切分后逐段GCM加密，依次存放，与明文逐字节对应
+ *   索引尾部：每段16字节标签，按段号顺序存放
+ *   结尾（16字节）："SM4I"、4字节保留为0、分段数（64位）
+ *
+ * 第i段的随机数是“随机数前缀 || i（32位）”，附加数据是整个文件头，
+ * 所以段不能被调换位置或移到别的容器中，文件头中的长度和分段长度也受每一段的标签保护。
+ * 空明文也有一个空段，它的标签认证文件头。
+ */
+
+#define SM4_CONTAINER_HEADER_SIZE 32
+#define SM4_CONTAINER_TRAILER_SIZE 16
+#define SM4_CONTAINER_TAG_SIZE 16
+
+/* 默认分段长度；分段长度必须是16的倍数，取值4 KiB..16 MiB */
+#define SM4_CONTAINER_DEFAULT_SEGMENT (64 * 1024)
+#define SM4_CONTAINER_MIN_SEGMENT (4 * 1024)
+#define SM4_CONTAINER_MAX_SEGMENT (16 * 1024 * 1024)
+
+/* 从文件头和结尾解析出的容器信息 */
+typedef struct {
+    uint32_t segment_size;       // 分段长度
+    uint8_t nonce_prefix[8];     // 随机数前缀
+    uint64_t plaintext_len;      // 明文总长度
+    uint64_t segment_count;      // 分段数
+    uint64_t container_len;      // 容器总长度
+} SM4_Container_Info;
+
+/**
+ * @brief 计算容器的总长度
+ * @param plaintext_len 明文长度
+ * @param segment_size 分段长度
+ * @return 容器长度（字节），参数不合法（分段长度不符合要求或分段数超过2^32 - 1）时返回0
+ */
+uint64_t sm4_container_size(uint64_t plaintext_len, uint32_t segment_size);
+
+/**
+ * @brief 把明文加密成容器
+ *
+ * 各段互不依赖，多于一段时分给库内部的线程池并行加密。
+ *
+ * @param key 16字节密钥
+ * @param nonce_prefix 8字节随机数前缀，同一密钥下每个容器必须不同
+ * @param segment_size 分段长度，通常为SM4_CONTAINER_DEFAULT_SEGMENT
+ * @param in 明文
+ * @param len 明文长度
+ * @param out 输出容器，长度为sm4_container_size(len, segment_size)，不能与in重叠
+ * @return 0成功，非0失败（参数不合法）
+ */
+int sm4_container_encrypt(const uint8_t *key, const uint8_t *nonce_prefix, uint32_t segment_size,
+                          const uint8_t *in, uint64_t len, uint8_t *out);
+
+/**
+ * @brief 读取并检查容器的文件头和结尾
+ *
+ * 只检查格式（魔数、版本、长度是否与文件一致），文件头的真实性在解密任何一段时由标签验证。
+ *
+ * @param fd 容器文件（需要支持pread）
+ * @param info 输出容器信息
+ * @return 0成功；-EINVAL格式不合法，-EIO文件比声明的短，其他负值为读失败的-errno
+ */
+int sm4_container_open(int fd, SM4_Container_Info *info);
+
+/**
+ * @brief 解密容器中明文[offset, offset + len)的部分
+ *
+ * 只读取覆盖这一范围的段和它们的标签，各段用sm4_gcm_decrypt_and_verify()验证并解密，
+ * 多于一段时分给库内部的线程池并行处理；中间的完整段直接读进out原地解密，不额外复制。
+ *
+ * @param fd 容器文件（需要支持pread，可以被多个线程同时读取）
+ * @param key 16字节密钥
+ * @param offset 明文偏移
+ * @param len 长度，offset + len不能超过明文总长度
+ * @param out 输出明文
+ * @return 0成功；-EBADMSG任何一段验证失败（out被清零）；-EINVAL参数或格式不合法；
+ *         -EIO文件被截断；-ENOMEM内存不足；其他负值为读失败的-errno
+ */
+int sm4_container_read_range(int fd, const uint8_t *key, uint64_t offset, size_t len, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_CONTAINER_H */
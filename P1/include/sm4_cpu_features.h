@@ -19,6 +19,9 @@ typedef struct {
     bool has_gfni;     // 支持GFNI指令集
     bool has_vaes;     // 支持向量化AES指令
     bool has_vpclmulqdq; // 支持向量化PCLMULQDQ指令
+    bool has_ssse3;    // 支持SSSE3指令集（pshufb）
+    bool has_avx512bw; // 支持AVX-512 Byte/Word（512位pshufb）
+    bool has_pclmulqdq; // 支持PCLMULQDQ指令（GHASH无进位乘法）
 } SM4_CPU_Features;
 
 /**
@@ -29,14 +32,21 @@ SM4_CPU_Features sm4_get_cpu_features(void);
 
 /**
  * @brief 获取最优的SM4实现方式
- * @return 实现类型的字符串描述
+ * @return 实现类型的字符串描述（加载时由调度层选定）
  */
 const char* sm4_get_best_implementation(void);
 
+/**
+ * @brief 获取公共API当前使用的SM4实现
+ * @return 实现类型的字符串描述
+ */
+const char* sm4_get_current_implementation(void);
+
 /**
  * @brief 强制使用特定的SM4实现
- * @param impl_name 实现名称，可以是"basic", "t_table", "aesni", "gfni"等
- * @return 0成功，非0失败
+ * @param impl_name 实现名称，可以是"basic", "t_table", "aesni", "gfni"等；NULL恢复自动选择
+ * @return 0成功，非0失败（未知实现、CPU不支持或未通过自检）
+ * @note 该函数修改全局调度状态，不能与其他线程中的加解密调用并发执行
  */
 int sm4_force_implementation(const char* impl_name);
 
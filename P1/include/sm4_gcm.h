@@ -7,16 +7,48 @@
 extern "C" {
 #endif
 
+/* GHASH预计算的H的幂的个数，也是无进位乘法内核一次约减聚合的块数 */
+#define SM4_GCM_H_POWERS 8
+
+/*
+ * 8位Shoup表（每个密钥4 KB）是可选的：构建时打开ENABLE_GHASH_TABLE8后，
+ * CMake会把SM4_GCM_GHASH_TABLE8传给库和所有链接它的目标，保证上下文布局一致。
+ */
+#ifndef SM4_GCM_GHASH_TABLE8
+#define SM4_GCM_GHASH_TABLE8 0
+#endif
+
+/* 单条消息的明文/密文上限：2^32 - 2个块（NIST SP 800-38D），32位计数器不会回绕到J0 */
+#define SM4_GCM_MAX_TEXT_LEN ((((uint64_t)1 << 32) - 2) * SM4_BLOCK_SIZE)
+
+struct sm4_ghash_impl;
+struct sm4_gcm_prefetch;
+
+/* GHASH预计算表，只有sm4_gcm_init时选中的GHASH后端使用的那一项有效 */
+typedef union {
+    uint8_t H_pow[SM4_GCM_H_POWERS][SM4_BLOCK_SIZE]; // H^1..H^8（字节逆序），无进位乘法后端使用
+    uint64_t M4[16][2];   // 4位Shoup表：M4[i] = i·H（高64位、低64位）
+#if SM4_GCM_GHASH_TABLE8
+    uint64_t M8[256][2];  // 8位Shoup表：M8[i] = i·H
+#endif
+} SM4_GHASH_Table;
+
 /* SM4-GCM 上下文结构 */
 typedef struct {
     SM4_Context cipher_ctx;  // SM4 上下文
     uint8_t H[SM4_BLOCK_SIZE];  // GHASH密钥
+    SM4_GHASH_Table table;   // GHASH预计算表，由sm4_gcm_init填充
+    const struct sm4_ghash_impl *ghash; // sm4_gcm_init时选中的GHASH后端（内部使用）
     uint8_t J0[SM4_BLOCK_SIZE]; // 初始计数器
+    uint8_t counter[SM4_BLOCK_SIZE];   // 下一个待加密的计数器块
+    uint8_t keystream[SM4_BLOCK_SIZE]; // 当前不完整块的密钥流
     uint64_t len_a;  // 附加数据长度
     uint64_t len_c;  // 密文长度
-    uint8_t buf[SM4_BLOCK_SIZE]; // 部分块缓冲区
-    size_t buf_len;  // 缓冲区中的字节数
-    uint8_t final_ghash[SM4_BLOCK_SIZE]; // 最终GHASH值
+    uint8_t buf[SM4_BLOCK_SIZE]; // 尚未吸收进GHASH的不完整块（AAD或密文）
+    size_t buf_len;  // 缓冲区中的字节数，加密/解密阶段也是keystream中已使用的字节数
+    int text_started; // 已开始加密/解密，AAD已经结束
+    uint8_t final_ghash[SM4_BLOCK_SIZE]; // GHASH状态
+    struct sm4_gcm_prefetch *prefetch; // 密钥流预取（sm4_gcm_prefetch_enable()），sm4_gcm_init时清空
 } SM4_GCM_Context;
 
 /**
@@ -31,30 +63,41 @@ int sm4_gcm_init(SM4_GCM_Context *ctx, const uint8_t *key, const uint8_t *iv, si
 
 /**
  * @brief 处理附加认证数据(AAD)
+ *
+ * 可以分多次调用，但必须都在第一次sm4_gcm_encrypt()/sm4_gcm_decrypt()之前。
+ *
  * @param ctx GCM上下文
  * @param aad 附加数据
  * @param aad_len 附加数据长度（字节）
- * @return 0成功，非0失败
+ * @return 0成功，非0失败（已经开始加密/解密）
  */
 int sm4_gcm_aad(SM4_GCM_Context *ctx, const uint8_t *aad, size_t aad_len);
 
 /**
  * @brief SM4-GCM加密
+ *
+ * 流式接口：一条消息可以分多次调用，每次长度任意，计数器和不完整块保存在上下文中，
+ * 结果与一次加密整条消息相同。
+ *
  * @param ctx GCM上下文
- * @param out 输出密文
+ * @param out 输出密文（可以与in相同）
  * @param in 输入明文
  * @param len 明文长度（字节）
- * @return 0成功，非0失败
+ * @return 0成功，非0失败（消息总长度超过SM4_GCM_MAX_TEXT_LEN）
  */
 int sm4_gcm_encrypt(SM4_GCM_Context *ctx, uint8_t *out, const uint8_t *in, size_t len);
 
 /**
  * @brief SM4-GCM解密
+ *
+ * 与sm4_gcm_encrypt()一样可以分多次调用。标签要到sm4_gcm_finish()才能得到，
+ * 在此之前输出的明文尚未经过认证。
+ *
  * @param ctx GCM上下文
- * @param out 输出明文
+ * @param out 输出明文（可以与in相同）
  * @param in 输入密文
  * @param len 密文长度（字节）
- * @return 0成功，非0失败
+ * @return 0成功，非0失败（消息总长度超过SM4_GCM_MAX_TEXT_LEN）
  */
 int sm4_gcm_decrypt(SM4_GCM_Context *ctx, uint8_t *out, const uint8_t *in, size_t len);
 
@@ -67,6 +110,24 @@ int sm4_gcm_decrypt(SM4_GCM_Context *ctx, uint8_t *out, const uint8_t *in, size_
  */
 int sm4_gcm_finish(SM4_GCM_Context *ctx, uint8_t *tag, size_t tag_len);
 
+/**
+ * @brief 获取GCM当前使用的GHASH实现
+ * @return 实现名称："vpclmul"、"pclmul"、"table8"、"table4"或"generic"
+ */
+const char *sm4_gcm_get_ghash_implementation(void);
+
+/**
+ * @brief 强制GCM使用特定的GHASH实现
+ *
+ * 只影响之后调用sm4_gcm_init()的上下文，已初始化的上下文继续使用原来的实现。
+ * 默认在没有PCLMULQDQ的主机上使用4位表；8位表需要构建时打开ENABLE_GHASH_TABLE8。
+ *
+ * @param name 实现名称，NULL恢复自动选择
+ * @return 0成功，非0失败（未知实现、CPU不支持、未编译或未通过自检）
+ * @note 该函数修改全局调度状态，不能与其他线程中的sm4_gcm_init()并发执行
+ */
+int sm4_gcm_force_ghash_implementation(const char *name);
+
 /**
  * @brief 一步完成SM4-GCM加密和认证
  * @param key 16字节密钥
@@ -106,6 +167,148 @@ int sm4_gcm_decrypt_and_verify(const uint8_t *key, const uint8_t *iv, size_t iv_
                               const uint8_t *tag, size_t tag_len,
                               uint8_t *out);
 
+/* GCM密钥缓存（不透明类型） */
+typedef struct sm4_gcm_key_cache SM4_GCM_Key_Cache;
+
+/**
+ * @brief 创建GCM密钥缓存
+ *
+ * 缓存把密钥映射到只依赖密钥的上下文模板（轮密钥、H和GHASH预计算表），
+ * 按最近最少使用淘汰。密钥频繁切换、消息很短时，省去每条消息的密钥扩展、
+ * E_K(0)和H的幂的预计算。缓存内部加锁，可以被多个线程共享。
+ *
+ * @param capacity 最多缓存的密钥数
+ * @return 缓存，capacity为0或内存不足时返回NULL
+ * @note 缓存中保存着密钥和轮密钥，淘汰和销毁时会清零
+ */
+SM4_GCM_Key_Cache *sm4_gcm_key_cache_create(size_t capacity);
+
+/**
+ * @brief 销毁GCM密钥缓存
+ * @param cache 缓存，可以为NULL
+ */
+void sm4_gcm_key_cache_destroy(SM4_GCM_Key_Cache *cache);
+
+/**
+ * @brief 通过密钥缓存初始化SM4-GCM上下文，结果与sm4_gcm_init()相同
+ * @param cache 缓存，NULL时等同于sm4_gcm_init()
+ * @param ctx GCM上下文
+ * @param key 16字节密钥
+ * @param iv IV/Nonce
+ * @param iv_len IV长度（字节）
+ * @return 0成功，非0失败
+ * @note 模板记录创建时选中的GHASH后端，之后调用sm4_gcm_force_ghash_implementation()不影响已缓存的密钥
+ */
+int sm4_gcm_init_cached(SM4_GCM_Key_Cache *cache, SM4_GCM_Context *ctx,
+                        const uint8_t *key, const uint8_t *iv, size_t iv_len);
+
+/**
+ * @brief 预先把一批密钥放入缓存，密钥扩展使用sm4_set_encrypt_keys_batch()
+ * @param cache 缓存
+ * @param keys count个16字节密钥，连续存放
+ * @param count 密钥数量（超过容量时只保留最后capacity个）
+ * @return 0成功，非0失败
+ */
+int sm4_gcm_key_cache_preload(SM4_GCM_Key_Cache *cache, const uint8_t *keys, size_t count);
+
+/**
+ * @brief 获取缓存的命中/未命中次数（只统计sm4_gcm_init_cached()）
+ * @param cache 缓存
+ * @param hits 输出命中次数，可以为NULL
+ * @param misses 输出未命中次数，可以为NULL
+ */
+void sm4_gcm_key_cache_stats(SM4_GCM_Key_Cache *cache, uint64_t *hits, uint64_t *misses);
+
+/**
+ * @brief 多线程SM4-GCM加密和认证，用于很大的单条消息
+ *
+ * 消息按块对齐分段，各段在库内部的线程池上从各自的计数器偏移开始加密，
+ * 并计算本段密文的部分GHASH；部分结果用H的幂按顺序合并（GHASH是线性的），
+ * 密文和标签与sm4_gcm_encrypt_and_tag()逐位相同。消息较短时直接单线程处理。
+ *
+ * @param key 16字节密钥
+ * @param iv IV/Nonce
+ * @param iv_len IV长度（字节）
+ * @param aad 附加数据
+ * @param aad_len 附加数据长度（字节）
+ * @param in 输入明文
+ * @param in_len 明文长度（字节）
+ * @param out 输出密文（可以与in相同）
+ * @param tag 输出认证标签
+ * @param tag_len 标签长度（字节），通常为16
+ * @param threads 最多使用的线程数（含调用者），0表示在线CPU数
+ * @return 0成功，非0失败
+ * @note 线程池同一时刻只运行一个作业，多个线程同时调用时依次执行
+ */
+int sm4_gcm_encrypt_parallel(const uint8_t *key, const uint8_t *iv, size_t iv_len,
+                             const uint8_t *aad, size_t aad_len,
+                             const uint8_t *in, size_t in_len,
+                             uint8_t *out, uint8_t *tag, size_t tag_len, size_t threads);
+
+/**
+ * @brief 多线程SM4-GCM解密和验证，与sm4_gcm_encrypt_parallel()对应
+ * @param key 16字节密钥
+ * @param iv IV/Nonce
+ * @param iv_len IV长度（字节）
+ * @param aad 附加数据
+ * @param aad_len 附加数据长度（字节）
+ * @param in 输入密文
+ * @param in_len 密文长度（字节）
+ * @param tag 输入认证标签
+ * @param tag_len 标签长度（字节），通常为16
+ * @param out 输出明文（可以与in相同），验证失败时清零
+ * @param threads 最多使用的线程数（含调用者），0表示在线CPU数
+ * @return 0成功（验证通过），非0失败（验证失败）
+ */
+int sm4_gcm_decrypt_parallel(const uint8_t *key, const uint8_t *iv, size_t iv_len,
+                             const uint8_t *aad, size_t aad_len,
+                             const uint8_t *in, size_t in_len,
+                             const uint8_t *tag, size_t tag_len,
+                             uint8_t *out, size_t threads);
+
+/**
+ * @brief 为上下文打开密钥流预取（随机数按序号递增、事先已知时使用）
+ *
+ * 第seq条消息的IV是iv_base的低8字节异或seq（大端序，与TLS 1.3的每记录随机数相同）。
+ * 后台线程在空闲时为之后的depth条消息预先计算E(J0)和前max_len字节的密钥流，
+ * 整批计数器一次交给多块内核；之后每条消息用sm4_gcm_prefetch_next()开始，
+ * sm4_gcm_encrypt()/sm4_gcm_decrypt()/sm4_gcm_finish()直接使用算好的密钥流，
+ * 调用路径上只剩异或和GHASH。预取没有跟上或消息超过max_len时，超出的部分照常现算，结果相同。
+ *
+ * @param ctx 已用sm4_gcm_init()设置好密钥的GCM上下文
+ * @param iv_base 12字节IV基值
+ * @param first_seq 第一条消息的序号
+ * @param max_len 每条消息预取的密钥流长度（字节，1..1 MiB）
+ * @param depth 预取的消息数（1..4096）
+ * @return 0成功，非0失败（参数不合法、内存不足、已经打开或平台不支持线程）
+ * @note 上下文在sm4_gcm_prefetch_disable()之前不能重新初始化，也不能被复制后继续使用
+ */
+int sm4_gcm_prefetch_enable(SM4_GCM_Context *ctx, const uint8_t *iv_base, uint64_t first_seq,
+                            size_t max_len, size_t depth);
+
+/**
+ * @brief 开始下一条消息：取下一个序号，设置IV，有预取好的密钥流时挂到上下文上
+ * @param ctx 已打开预取的GCM上下文
+ * @param iv 输出这条消息的12字节IV，可以为NULL
+ * @param seq 输出这条消息的序号，可以为NULL
+ * @return 0成功，非0失败（没有打开预取）
+ */
+int sm4_gcm_prefetch_next(SM4_GCM_Context *ctx, uint8_t *iv, uint64_t *seq);
+
+/**
+ * @brief 获取预取的命中/未命中次数（每次sm4_gcm_prefetch_next()计一次）
+ * @param ctx GCM上下文
+ * @param hits 输出命中次数，可以为NULL
+ * @param misses 输出未命中次数，可以为NULL
+ */
+void sm4_gcm_prefetch_stats(const SM4_GCM_Context *ctx, uint64_t *hits, uint64_t *misses);
+
+/**
+ * @brief 关闭密钥流预取：停止后台线程，清零并释放预取的密钥流
+ * @param ctx GCM上下文（没有打开预取时什么也不做）
+ */
+void sm4_gcm_prefetch_disable(SM4_GCM_Context *ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,108 @@
+#ifndef SM4_INTERNAL_H
+#define SM4_INTERNAL_H
+
+#include "sm4.h"
+#include "sm4_cpu_features.h"
+#include "sm4_mb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 内部接口，不对外安装。
+ *
+ * 每个后端（basic、t_table、aesni、vaes、gfni……）只导出带前缀的函数和一张
+ * SM4_Implementation 函数表，公共API（sm4.h）在 src/common/sm4_common.c
+ * 中通过当前选中的函数表转发。各后端共用 SM4_Context 的轮密钥布局，
+ * 因此任何后端生成的轮密钥都可以交给其他后端使用。
+ */
+
+/* 后端函数表 */
+typedef struct {
+    const char *name;  // 实现名称，与 sm4_force_implementation() 的参数一致
+
+    /**
+     * @brief 判断当前CPU（以及编译配置）是否可以运行该后端
+     * @param features CPU特性
+     * @return 非0可用，0不可用
+     */
+    int (*is_supported)(const SM4_CPU_Features *features);
+
+    void (*set_encrypt_key)(SM4_Context *ctx, const uint8_t *key);
+    void (*set_decrypt_key)(SM4_Context *ctx, const uint8_t *key);
+
+    /* 加密与解密共用轮函数，解密只是轮密钥顺序相反 */
+    void (*crypt_block)(const SM4_Context *ctx, uint8_t *out, const uint8_t *in);
+    void (*crypt_blocks)(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks);
+
+    /* 可选：把count个密钥（连续存放）同时扩展为加密轮密钥，NULL时逐个调用set_encrypt_key */
+    void (*set_encrypt_keys)(SM4_Context *ctx, const uint8_t *keys, size_t count);
+
+    /*
+     * 可选：SM4_MB_LANES个块各用自己的轮密钥并行加密/解密，第l块使用rk的第l列
+     * （rk[i][l]是第i轮的轮密钥）。NULL时逐通道调用crypt_block
+     */
+    void (*crypt_lanes)(const uint32_t rk[SM4_ROUNDS][SM4_MB_LANES], uint8_t *out, const uint8_t *in);
+} SM4_Implementation;
+
+/* 各后端的函数表 */
+extern const SM4_Implementation sm4_basic_impl;
+extern const SM4_Implementation sm4_t_table_impl;
+extern const SM4_Implementation sm4_bitslice_impl;
+extern const SM4_Implementation sm4_bitslice_avx2_impl;
+extern const SM4_Implementation sm4_aesni_impl;
+extern const SM4_Implementation sm4_vaes_impl;
+extern const SM4_Implementation sm4_vaes_avx512_impl;
+extern const SM4_Implementation sm4_gfni_impl;
+
+/**
+ * @brief 获取当前公共API使用的后端
+ * @return 后端函数表
+ */
+const SM4_Implementation *sm4_get_active_implementation(void);
+
+/**
+ * @brief 按名称查找后端（不检查CPU是否支持）
+ * @param name 实现名称
+ * @return 后端函数表，未找到返回NULL
+ */
+const SM4_Implementation *sm4_find_implementation(const char *name);
+
+/**
+ * @brief 多通道加密/解密：mask中每个置位的通道l用rk的第l列处理一块
+ *
+ * 当前后端提供crypt_lanes时一次处理全部通道（未置位通道的输出无意义），
+ * 否则只逐个处理置位的通道。
+ *
+ * @param rk 按列存放的轮密钥
+ * @param out 输出，SM4_MB_LANES块
+ * @param in 输入，SM4_MB_LANES块
+ * @param mask 需要结果的通道位图
+ */
+void sm4_crypt_lanes(const uint32_t rk[SM4_ROUNDS][SM4_MB_LANES], uint8_t *out, const uint8_t *in, unsigned int mask);
+
+/**
+ * @brief 在库内部的线程池上并行执行tasks个任务，全部完成后返回
+ *
+ * 调用者线程也领取任务。同一时刻只运行一个作业，并发的调用者依次等待。
+ * 没有POSIX线程的平台上在调用者线程中顺序执行。
+ *
+ * @param tasks 任务数量
+ * @param threads 最多使用的线程数（含调用者），0表示sm4_parallel_default_threads()
+ * @param fn 任务函数，index为0..tasks-1
+ * @param arg 传给fn的参数
+ */
+void sm4_parallel_run(size_t tasks, size_t threads, void (*fn)(void *arg, size_t index), void *arg);
+
+/**
+ * @brief 默认的并行线程数（在线CPU数）
+ * @return 线程数，至少为1
+ */
+size_t sm4_parallel_default_threads(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_INTERNAL_H */
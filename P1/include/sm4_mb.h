@@ -0,0 +1,97 @@
+#ifndef SM4_MB_H
+#define SM4_MB_H
+
+#include "sm4.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 多缓冲管理器的通道数：同时推进的作业数，每一步每个通道处理一块 */
+#define SM4_MB_LANES 16
+
+/* 作业的工作模式 */
+typedef enum {
+    SM4_MB_ECB = 0,      // 各块独立，加密或解密由轮密钥决定
+    SM4_MB_CBC_ENCRYPT,  // CBC加密
+    SM4_MB_CBC_DECRYPT,  // CBC解密
+    SM4_MB_CTR           // CTR加解密（计数器按128位大端整数递增）
+} SM4_MB_Mode;
+
+/* 作业状态 */
+typedef enum {
+    SM4_MB_STATUS_BEING_PROCESSED = 0,  // 已提交，尚未完成
+    SM4_MB_STATUS_COMPLETED,            // 已完成，输出可用
+    SM4_MB_STATUS_INVALID_ARGS          // 参数不合法，没有处理
+} SM4_MB_Status;
+
+/* 一个作业：一条独立的消息，可以有自己的密钥、IV和模式 */
+typedef struct {
+    SM4_MB_Mode mode;
+    const SM4_Context *key;  // 轮密钥：ECB加密、CBC加密和CTR用加密轮密钥，ECB/CBC解密用解密轮密钥
+    const uint8_t *iv;       // 16字节CBC初始化向量或CTR初始计数器块（ECB忽略）
+    const uint8_t *in;       // 输入
+    uint8_t *out;            // 输出（可以与in相同）
+    size_t len;              // 长度（字节）；ECB和CBC必须是16的倍数
+    SM4_MB_Status status;    // 由管理器设置
+    void *user_data;         // 调用者自用，管理器不访问
+} SM4_MB_Job;
+
+/*
+ * 多缓冲管理器（所有字段内部使用）。
+ *
+ * 每个通道的轮密钥按列存放：rk[i][l]是第l个通道第i轮的轮密钥，
+ * 宽向量内核每轮直接载入一行，各通道使用各自的密钥。
+ */
+typedef struct {
+    uint32_t rk[SM4_ROUNDS][SM4_MB_LANES];          // 各通道的轮密钥（按列存放）
+    SM4_MB_Job *lanes[SM4_MB_LANES];                // 各通道的作业，NULL表示空闲
+    uint8_t chain[SM4_MB_LANES][SM4_BLOCK_SIZE];    // CBC链值或CTR计数器
+    size_t pos[SM4_MB_LANES];                       // 各通道已处理的字节数
+    unsigned int busy;                              // 占用通道的位图
+    SM4_MB_Job *completed[SM4_MB_LANES];            // 已完成、等待取回的作业
+    size_t completed_head;
+    size_t completed_count;
+} SM4_MB_Mgr;
+
+/**
+ * @brief 初始化多缓冲管理器
+ * @param mgr 管理器
+ */
+void sm4_mb_mgr_init(SM4_MB_Mgr *mgr);
+
+/**
+ * @brief 提交一个作业
+ *
+ * 作业占用一个空闲通道；没有空闲通道时先推进所有通道，直到至少一个作业完成。
+ * 作业结构和输入输出缓冲区在作业完成并被取回之前必须保持有效。
+ * 参数不合法或长度为0的作业不进入通道，直接返回。
+ *
+ * @param mgr 管理器
+ * @param job 作业
+ * @return 一个已完成（或参数不合法）的作业，可能不是刚提交的这个；没有时返回NULL
+ */
+SM4_MB_Job *sm4_mb_submit(SM4_MB_Mgr *mgr, SM4_MB_Job *job);
+
+/**
+ * @brief 取回一个已完成的作业，不推进计算
+ * @param mgr 管理器
+ * @return 已完成的作业，没有时返回NULL
+ */
+SM4_MB_Job *sm4_mb_get_completed(SM4_MB_Mgr *mgr);
+
+/**
+ * @brief 在通道未满时也推进计算，直到至少一个作业完成
+ *
+ * 提交完一批作业后反复调用，直到返回NULL，即可取回所有作业。
+ *
+ * @param mgr 管理器
+ * @return 已完成的作业；管理器中没有作业时返回NULL
+ */
+SM4_MB_Job *sm4_mb_flush(SM4_MB_Mgr *mgr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_MB_H */
@@ -0,0 +1,90 @@
+#ifndef SM4_OCB_H
+#define SM4_OCB_H
+
+#include "sm4.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 偏移量表L_i的项数：单条消息（和AAD）最多2^SM4_OCB_L_COUNT - 1个整块 */
+#define SM4_OCB_L_COUNT 32
+
+/* 每批处理的块数，偏移量按批生成后整批交给多块内核 */
+#define SM4_OCB_BATCH_BLOCKS 32
+
+/* SM4-OCB 上下文结构（RFC 7253，OCB3），只保存密钥相关的数据，可以被多个线程共享 */
+typedef struct {
+    SM4_Context enc_ctx;                              // 加密轮密钥
+    SM4_Context dec_ctx;                              // 解密轮密钥
+    uint8_t l_star[SM4_BLOCK_SIZE];                   // L_* = E(0)
+    uint8_t l_dollar[SM4_BLOCK_SIZE];                 // L_$ = double(L_*)
+    uint8_t l[SM4_OCB_L_COUNT][SM4_BLOCK_SIZE];       // L_i = double^(i+1)(L_$)
+    uint8_t batch[SM4_OCB_BATCH_BLOCKS - 1][SM4_BLOCK_SIZE];  // 批内第j块相对批起点的偏移量
+} SM4_OCB_Context;
+
+/**
+ * @brief 设置SM4-OCB密钥并预计算偏移量表
+ * @param ctx OCB上下文
+ * @param key 16字节密钥
+ * @return 0成功，非0失败
+ */
+int sm4_ocb_init(SM4_OCB_Context *ctx, const uint8_t *key);
+
+/**
+ * @brief SM4-OCB加密并生成标签
+ * @param ctx OCB上下文
+ * @param nonce 随机数（同一密钥下不能重复）
+ * @param nonce_len 随机数长度（1..15字节，推荐12）
+ * @param aad 附加认证数据
+ * @param aad_len 附加认证数据长度
+ * @param in 明文
+ * @param len 明文长度
+ * @param out 输出密文（可以与in相同）
+ * @param tag 输出认证标签
+ * @param tag_len 标签长度（1..16字节）
+ * @return 0成功，非0失败（参数不合法）
+ */
+int sm4_ocb_encrypt(const SM4_OCB_Context *ctx, const uint8_t *nonce, size_t nonce_len,
+                    const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                    uint8_t *out, uint8_t *tag, size_t tag_len);
+
+/**
+ * @brief SM4-OCB解密并验证标签，验证失败时输出被清零
+ * @param ctx OCB上下文
+ * @param nonce 随机数
+ * @param nonce_len 随机数长度（1..15字节）
+ * @param aad 附加认证数据
+ * @param aad_len 附加认证数据长度
+ * @param in 密文
+ * @param len 密文长度
+ * @param tag 认证标签
+ * @param tag_len 标签长度（1..16字节，必须与加密时相同）
+ * @param out 输出明文（可以与in相同）
+ * @return 0验证成功，非0验证失败或参数不合法
+ */
+int sm4_ocb_decrypt(const SM4_OCB_Context *ctx, const uint8_t *nonce, size_t nonce_len,
+                    const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                    const uint8_t *tag, size_t tag_len, uint8_t *out);
+
+/**
+ * @brief 一步完成SM4-OCB加密（参数同sm4_ocb_encrypt，用密钥代替上下文）
+ * @return 0成功，非0失败
+ */
+int sm4_ocb_encrypt_and_tag(const uint8_t *key, const uint8_t *nonce, size_t nonce_len,
+                            const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                            uint8_t *out, uint8_t *tag, size_t tag_len);
+
+/**
+ * @brief 一步完成SM4-OCB解密和验证（参数同sm4_ocb_decrypt，用密钥代替上下文）
+ * @return 0验证成功，非0失败
+ */
+int sm4_ocb_decrypt_and_verify(const uint8_t *key, const uint8_t *nonce, size_t nonce_len,
+                               const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                               const uint8_t *tag, size_t tag_len, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_OCB_H */
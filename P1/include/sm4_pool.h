@@ -0,0 +1,85 @@
+#ifndef SM4_POOL_H
+#define SM4_POOL_H
+
+#include "sm4_gcm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 池中SM4上下文的方向 */
+typedef enum {
+    SM4_POOL_ENCRYPT = 0,  // sm4_set_encrypt_key()
+    SM4_POOL_DECRYPT       // sm4_set_decrypt_key()
+} SM4_Pool_Direction;
+
+/* 上下文池（不透明类型） */
+typedef struct sm4_ctx_pool SM4_Ctx_Pool;
+
+/* 上下文池统计 */
+typedef struct {
+    size_t capacity;     // 上下文总数
+    size_t in_use;       // 已取出、尚未归还的上下文数
+    uint64_t hits;       // 取出时复用了已有密钥材料的次数
+    uint64_t misses;     // 取出时重新扩展密钥（GCM还要预计算H）的次数
+    uint64_t steals;     // 当前线程的空闲链表为空、从其他分片取上下文的次数
+} SM4_Ctx_Pool_Stats;
+
+/**
+ * @brief 创建上下文池
+ *
+ * 所有上下文在一块按缓存行对齐的内存中一次分配，之后取出和归还都不再调用分配器。
+ * 空闲上下文分成若干分片，每个线程固定使用一个分片的空闲链表；归还的上下文保留密钥材料
+ * （轮密钥，GCM还有H和GHASH预计算表），再次用同一密钥取出时只需设置IV。
+ *
+ * @param capacity 上下文数量
+ * @return 上下文池，capacity为0或内存不足时返回NULL
+ * @note 空闲上下文中保留着轮密钥，被其他密钥复用和销毁池时才清零
+ */
+SM4_Ctx_Pool *sm4_ctx_pool_create(size_t capacity);
+
+/**
+ * @brief 销毁上下文池，清零所有上下文；必须在所有上下文都已归还之后调用
+ * @param pool 上下文池，可以为NULL
+ */
+void sm4_ctx_pool_destroy(SM4_Ctx_Pool *pool);
+
+/**
+ * @brief 取出一个已设置好密钥的SM4上下文
+ * @param pool 上下文池
+ * @param key 16字节密钥
+ * @param direction SM4_POOL_ENCRYPT或SM4_POOL_DECRYPT
+ * @return 按缓存行对齐的上下文，池已用尽时返回NULL
+ */
+SM4_Context *sm4_ctx_pool_acquire_sm4(SM4_Ctx_Pool *pool, const uint8_t *key, SM4_Pool_Direction direction);
+
+/**
+ * @brief 取出一个GCM上下文，结果与对它调用sm4_gcm_init()相同
+ * @param pool 上下文池
+ * @param key 16字节密钥
+ * @param iv IV/Nonce
+ * @param iv_len IV长度（字节）
+ * @return 按缓存行对齐的上下文，池已用尽或参数不合法时返回NULL
+ */
+SM4_GCM_Context *sm4_ctx_pool_acquire_gcm(SM4_Ctx_Pool *pool, const uint8_t *key,
+                                          const uint8_t *iv, size_t iv_len);
+
+/**
+ * @brief 归还上下文（SM4或GCM），放进当前线程的空闲链表
+ * @param pool 上下文池
+ * @param ctx 从同一个池取出的上下文，可以为NULL
+ */
+void sm4_ctx_pool_release(SM4_Ctx_Pool *pool, void *ctx);
+
+/**
+ * @brief 获取统计信息
+ * @param pool 上下文池
+ * @param stats 输出统计
+ */
+void sm4_ctx_pool_stats(SM4_Ctx_Pool *pool, SM4_Ctx_Pool_Stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_POOL_H */
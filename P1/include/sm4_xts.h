@@ -0,0 +1,100 @@
+#ifndef SM4_XTS_H
+#define SM4_XTS_H
+
+#include "sm4.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* XTS密钥长度：数据密钥和调整值密钥各16字节 */
+#define SM4_XTS_KEY_SIZE (2 * SM4_KEY_SIZE)
+
+/* SM4-XTS 上下文结构（IEEE P1619） */
+typedef struct {
+    SM4_Context enc_ctx;    // 数据密钥（加密轮密钥）
+    SM4_Context dec_ctx;    // 数据密钥（解密轮密钥）
+    SM4_Context tweak_ctx;  // 调整值密钥（加密轮密钥）
+} SM4_XTS_Context;
+
+/**
+ * @brief 初始化SM4-XTS上下文
+ *
+ * 同一个上下文既可以加密也可以解密。按NIST SP 800-38E的要求，
+ * 数据密钥和调整值密钥相同时返回错误。
+ *
+ * @param ctx XTS上下文
+ * @param key 32字节密钥：前16字节为数据密钥，后16字节为调整值密钥
+ * @return 0成功，非0失败
+ */
+int sm4_xts_init(SM4_XTS_Context *ctx, const uint8_t *key);
+
+/**
+ * @brief SM4-XTS加密一个数据单元
+ *
+ * 长度不是16的倍数时使用密文挪用（ciphertext stealing），密文与明文等长。
+ *
+ * @param ctx XTS上下文
+ * @param out 输出密文（可以与in相同）
+ * @param in 输入明文
+ * @param len 长度（字节，至少16）
+ * @param tweak 16字节调整值（数据单元序号，小端）
+ * @return 0成功，非0失败
+ */
+int sm4_xts_encrypt(const SM4_XTS_Context *ctx, uint8_t *out, const uint8_t *in, size_t len,
+                    const uint8_t *tweak);
+
+/**
+ * @brief SM4-XTS解密一个数据单元
+ * @param ctx XTS上下文
+ * @param out 输出明文（可以与in相同）
+ * @param in 输入密文
+ * @param len 长度（字节，至少16）
+ * @param tweak 16字节调整值（数据单元序号，小端）
+ * @return 0成功，非0失败
+ */
+int sm4_xts_decrypt(const SM4_XTS_Context *ctx, uint8_t *out, const uint8_t *in, size_t len,
+                    const uint8_t *tweak);
+
+/**
+ * @brief 批量加密连续的扇区
+ *
+ * 第i个扇区的调整值为扇区号first_sector + i（128位小端，与dm-crypt的plain64相同）。
+ * 所有扇区的初始调整值一起加密，扇区内按批交给多块内核，
+ * 结果与对每个扇区分别调用sm4_xts_encrypt()相同。
+ *
+ * @param ctx XTS上下文
+ * @param out 输出密文（可以与in相同）
+ * @param in 输入明文，sectors个扇区连续存放
+ * @param sector_size 扇区大小（字节，至少16，例如512或4096）
+ * @param sectors 扇区个数
+ * @param first_sector 第一个扇区的扇区号
+ * @return 0成功，非0失败
+ */
+int sm4_xts_encrypt_sectors(const SM4_XTS_Context *ctx, uint8_t *out, const uint8_t *in,
+                            size_t sector_size, size_t sectors, uint64_t first_sector);
+
+/**
+ * @brief 批量解密连续的扇区
+ * @param ctx XTS上下文
+ * @param out 输出明文（可以与in相同）
+ * @param in 输入密文，sectors个扇区连续存放
+ * @param sector_size 扇区大小（字节，至少16）
+ * @param sectors 扇区个数
+ * @param first_sector 第一个扇区的扇区号
+ * @return 0成功，非0失败
+ */
+int sm4_xts_decrypt_sectors(const SM4_XTS_Context *ctx, uint8_t *out, const uint8_t *in,
+                            size_t sector_size, size_t sectors, uint64_t first_sector);
+
+/**
+ * @brief 获取XTS当前使用的调整值生成实现
+ * @return 实现名称（"avx512"或"generic"）
+ */
+const char *sm4_xts_get_tweak_implementation(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_XTS_H */
@@ -1,9 +1,10 @@
-#include "sm4.h"
+#include "sm4_internal.h"
 #include <string.h>
 
 #if defined(HAVE_AESNI) && HAVE_AESNI
 #include <immintrin.h>
 #include <wmmintrin.h>
+#include <tmmintrin.h>
 #endif
 
 /* SM4 S盒 */
@@ -28,7 +29,7 @@ static const uint8_t SM4_SBOX[256] = {
 
 /* 系统参数 */
 static const uint32_t SYSTEM_PARAMETER[4] = {
-    0x00070e15, 0x1c232a31, 0x383f464d, 0x545b6269
+    0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc
 };
 
 /* 固定参数 */
@@ -43,10 +44,6 @@ static const uint32_t FIXED_PARAMETER[32] = {
     0x10171e25, 0x2c333a41, 0x484f565d, 0x646b7279
 };
 
-/* T表 - 预计算S盒和线性变换的组合 */
-static uint32_t T_TABLE[256];
-static int T_TABLE_INITIALIZED = 0;
-
 /* 循环左移 */
 static inline uint32_t rotl32(uint32_t x, int n) {
     return (x << n) | (x >> (32 - n));
@@ -65,46 +62,11 @@ static inline void store_u32_be(uint32_t v, uint8_t *b) {
     b[3] = (uint8_t)v;
 }
 
-/* 线性变换L */
-static uint32_t sm4_l_transform(uint32_t a) {
-    return a ^ rotl32(a, 2) ^ rotl32(a, 10) ^ rotl32(a, 18) ^ rotl32(a, 24);
-}
-
 /* 线性变换L' */
 static uint32_t sm4_l_prime_transform(uint32_t a) {
     return a ^ rotl32(a, 13) ^ rotl32(a, 23);
 }
 
-/* 初始化T表 */
-static void init_t_tables(void) {
-    int i;
-    uint32_t t;
-    
-    if (T_TABLE_INITIALIZED) {
-        return;
-    }
-    
-    for (i = 0; i < 256; i++) {
-        t = (uint32_t)SM4_SBOX[i] << 24;
-        T_TABLE[i] = sm4_l_transform(t);
-    }
-    
-    T_TABLE_INITIALIZED = 1;
-}
-
-/* 使用T表的合成变换T */
-static uint32_t sm4_t_transform_table(uint32_t a) {
-    uint8_t a0 = (uint8_t)(a >> 24);
-    uint8_t a1 = (uint8_t)(a >> 16);
-    uint8_t a2 = (uint8_t)(a >> 8);
-    uint8_t a3 = (uint8_t)a;
-    
-    return T_TABLE[a0] ^ 
-           rotl32(T_TABLE[a1], 8) ^ 
-           rotl32(T_TABLE[a2], 16) ^ 
-           rotl32(T_TABLE[a3], 24);
-}
-
 /* 合成变换T' */
 static uint32_t sm4_t_prime_transform(uint32_t a) {
     uint8_t a0 = (uint8_t)(a >> 24);
@@ -122,75 +84,224 @@ static uint32_t sm4_t_prime_transform(uint32_t a) {
 
 #if defined(HAVE_AESNI) && HAVE_AESNI
 
-/* AES-NI指令集优化的SM4 S盒替代 */
-static __m128i sm4_sbox_aesni(__m128i x) {
-    /* 
-     * 使用AES-NI指令集实现SM4 S盒
-     * 这里使用AES的SubBytes操作，然后通过查找表映射到SM4的S盒
-     * 注意：这是一个简化实现，实际上需要更复杂的映射
-     */
-    
-    /* AES S盒到SM4 S盒的映射表 */
-    static const uint8_t aes_to_sm4_map[256] = {
-        /* 这里应该是完整的映射表，为简化示例，使用部分映射 */
-        /* 实际实现需要完整的映射表 */
-        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
-        /* ... 其余映射 ... */
-    };
-    
-    /* 使用AES-NI的SubBytes操作 */
-    __m128i aes_sbox = _mm_aesenc_si128(x, _mm_setzero_si128());
-    
-    /* 将AES S盒结果映射到SM4 S盒 */
-    /* 这里需要更复杂的实现，简化示例仅作演示 */
-    
-    return aes_sbox; /* 简化实现，实际需要映射 */
-}
+/*
+ * SM4 S盒与AES S盒都是GF(2^8)求逆加仿射变换，只是域多项式和仿射变换不同：
+ *
+ *   S_sm4(x) = A(inv_sm4(A·x + 0xD3)) + 0xD3        (多项式 0x1F5)
+ *   S_aes(y) = A_aes·inv_aes(y) + 0x63              (多项式 0x11B)
+ *
+ * 取域同构 T: GF(2^8)/0x1F5 -> GF(2^8)/0x11B（x -> 0x23），有
+ * T(inv_sm4(z)) = inv_aes(T(z))，于是
+ *
+ *   S_sm4(x) = POST(S_aes(PRE(x)))
+ *   PRE(x)   = T(A·x + 0xD3)
+ *   POST(z)  = A·T^-1(A_aes^-1·(z + 0x63)) + 0xD3
+ *
+ * PRE和POST都是GF(2)上的仿射变换，拆成高低半字节两张16项表后用pshufb计算；
+ * S_aes由AESENCLAST（轮密钥为0）完成。AESENCLAST还会做一次ShiftRows，
+ * 这个字节置换被合并进线性变换L的字节移位表里。
+ */
+
+/* PRE变换（低/高半字节） */
+#define SM4_AESNI_PRE_LO  _mm_setr_epi8(0x3e, (char)0xb2, 0x0e, (char)0x82, (char)0xbb, 0x37, (char)0x8b, 0x07, \
+                                        (char)0xa1, 0x2d, (char)0x91, 0x1d, 0x24, (char)0xa8, 0x14, (char)0x98)
+#define SM4_AESNI_PRE_HI  _mm_setr_epi8(0x00, (char)0xdc, 0x2e, (char)0xf2, (char)0xc5, 0x19, (char)0xeb, 0x37, \
+                                        0x08, (char)0xd4, 0x26, (char)0xfa, (char)0xcd, 0x11, (char)0xe3, 0x3f)
+
+/* POST变换（低/高半字节），已包含AES仿射常数0x63和SM4仿射常数0xD3 */
+#define SM4_AESNI_POST_LO _mm_setr_epi8(0x6c, (char)0xd4, (char)0xa6, 0x1e, 0x52, (char)0xea, (char)0x98, 0x20, \
+                                        0x0b, (char)0xb3, (char)0xc1, 0x79, 0x35, (char)0x8d, (char)0xff, 0x47)
+#define SM4_AESNI_POST_HI _mm_setr_epi8(0x00, (char)0xe0, 0x50, (char)0xb0, (char)0x9d, 0x7d, (char)0xcd, 0x2d, \
+                                        (char)0xc0, 0x20, (char)0x90, 0x70, 0x5d, (char)0xbd, 0x0d, (char)0xed)
 
-/* AES-NI优化的SM4轮函数 */
-static __m128i sm4_round_aesni(__m128i x, __m128i rk) {
-    /* 
-     * 使用AES-NI指令集优化SM4轮函数
-     * 这是一个简化实现，实际需要更复杂的转换
-     */
+/* 逆ShiftRows，以及逆ShiftRows后再对每个32位字循环左移8/16/24位 */
+#define SM4_AESNI_INV_SR  _mm_setr_epi8(0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, \
+                                        0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03)
+#define SM4_AESNI_ROL8    _mm_setr_epi8(0x07, 0x00, 0x0d, 0x0a, 0x0b, 0x04, 0x01, 0x0e, \
+                                        0x0f, 0x08, 0x05, 0x02, 0x03, 0x0c, 0x09, 0x06)
+#define SM4_AESNI_ROL16   _mm_setr_epi8(0x0a, 0x07, 0x00, 0x0d, 0x0e, 0x0b, 0x04, 0x01, \
+                                        0x02, 0x0f, 0x08, 0x05, 0x06, 0x03, 0x0c, 0x09)
+#define SM4_AESNI_ROL24   _mm_setr_epi8(0x0d, 0x0a, 0x07, 0x00, 0x01, 0x0e, 0x0b, 0x04, \
+                                        0x05, 0x02, 0x0f, 0x08, 0x09, 0x06, 0x03, 0x0c)
+
+/* 每个32位字内字节反序（大端字与小端寄存器之间转换） */
+#define SM4_AESNI_BSWAP32 _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+
+/* 一个SSE寄存器并行处理的块数 */
+#define SM4_AESNI_LANES 4
+
+/* 用半字节查表计算GF(2)上的仿射变换 */
+static inline __m128i sm4_aesni_affine(__m128i x, __m128i lo_table, __m128i hi_table) {
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i lo = _mm_and_si128(x, mask);
+    __m128i hi = _mm_and_si128(_mm_srli_epi32(x, 4), mask);
     
-    /* 将输入与轮密钥异或 */
-    __m128i t = _mm_xor_si128(x, rk);
+    return _mm_xor_si128(_mm_shuffle_epi8(lo_table, lo), _mm_shuffle_epi8(hi_table, hi));
+}
+
+/*
+ * 合成变换T：16个字节同时过S盒，再做线性变换L
+ * L(y) = y ^ rol24(y) ^ rol2(y ^ rol8(y) ^ rol16(y))
+ */
+static inline __m128i sm4_aesni_t(__m128i x) {
+    __m128i y, t, r;
+    
+    /* 非线性变换τ */
+    x = sm4_aesni_affine(x, SM4_AESNI_PRE_LO, SM4_AESNI_PRE_HI);
+    x = _mm_aesenclast_si128(x, _mm_setzero_si128());
+    x = sm4_aesni_affine(x, SM4_AESNI_POST_LO, SM4_AESNI_POST_HI);
+    
+    /* 线性变换L，同时撤销ShiftRows */
+    y = _mm_shuffle_epi8(x, SM4_AESNI_INV_SR);
+    t = _mm_xor_si128(y, _mm_shuffle_epi8(x, SM4_AESNI_ROL8));
+    t = _mm_xor_si128(t, _mm_shuffle_epi8(x, SM4_AESNI_ROL16));
+    r = _mm_xor_si128(y, _mm_shuffle_epi8(x, SM4_AESNI_ROL24));
+    r = _mm_xor_si128(r, _mm_slli_epi32(t, 2));
+    return _mm_xor_si128(r, _mm_srli_epi32(t, 30));
+}
+
+/* 只做非线性变换τ（密钥扩展使用，线性部分是L'） */
+static inline __m128i sm4_aesni_tau(__m128i x) {
+    x = sm4_aesni_affine(x, SM4_AESNI_PRE_LO, SM4_AESNI_PRE_HI);
+    x = _mm_aesenclast_si128(x, _mm_setzero_si128());
+    x = sm4_aesni_affine(x, SM4_AESNI_POST_LO, SM4_AESNI_POST_HI);
+    return _mm_shuffle_epi8(x, SM4_AESNI_INV_SR);
+}
+
+/* 4x4的32位矩阵转置：4个块 <-> 4个字向量（自逆） */
+static inline void sm4_aesni_transpose(__m128i *x0, __m128i *x1, __m128i *x2, __m128i *x3) {
+    __m128i t0 = _mm_unpacklo_epi32(*x0, *x1);
+    __m128i t1 = _mm_unpacklo_epi32(*x2, *x3);
+    __m128i t2 = _mm_unpackhi_epi32(*x0, *x1);
+    __m128i t3 = _mm_unpackhi_epi32(*x2, *x3);
+    
+    *x0 = _mm_unpacklo_epi64(t0, t1);
+    *x1 = _mm_unpackhi_epi64(t0, t1);
+    *x2 = _mm_unpacklo_epi64(t2, t3);
+    *x3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+/* 载入4个块并转置，x[j]保存4个块的第j个字 */
+static inline void sm4_aesni_load4(__m128i x[4], const uint8_t *in) {
+    const __m128i bswap = SM4_AESNI_BSWAP32;
+    int j;
     
-    /* 应用S盒替代 */
-    t = sm4_sbox_aesni(t);
+    for (j = 0; j < 4; j++) {
+        x[j] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(in + j * SM4_BLOCK_SIZE)), bswap);
+    }
+    sm4_aesni_transpose(&x[0], &x[1], &x[2], &x[3]);
+}
+
+/* 反序变换后转置回4个块并写出 */
+static inline void sm4_aesni_store4(uint8_t *out, __m128i x[4]) {
+    const __m128i bswap = SM4_AESNI_BSWAP32;
+    int j;
+    
+    sm4_aesni_transpose(&x[3], &x[2], &x[1], &x[0]);
+    for (j = 0; j < 4; j++) {
+        _mm_storeu_si128((__m128i *)(out + j * SM4_BLOCK_SIZE), _mm_shuffle_epi8(x[3 - j], bswap));
+    }
+}
+
+/* 4个块并行加密/解密 */
+static void sm4_aesni_crypt4(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    __m128i x[4];
+    __m128i rk;
+    int i;
     
-    /* 应用线性变换（这里需要更复杂的实现） */
-    /* ... */
+    sm4_aesni_load4(x, in);
+    
+    /* 32轮迭代，每4轮寄存器角色轮换一圈 */
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        rk = _mm_set1_epi32((int)ctx->rk[i]);
+        x[0] = _mm_xor_si128(x[0], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[1], x[2]), _mm_xor_si128(x[3], rk))));
+        rk = _mm_set1_epi32((int)ctx->rk[i + 1]);
+        x[1] = _mm_xor_si128(x[1], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[2], x[3]), _mm_xor_si128(x[0], rk))));
+        rk = _mm_set1_epi32((int)ctx->rk[i + 2]);
+        x[2] = _mm_xor_si128(x[2], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[3], x[0]), _mm_xor_si128(x[1], rk))));
+        rk = _mm_set1_epi32((int)ctx->rk[i + 3]);
+        x[3] = _mm_xor_si128(x[3], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[0], x[1]), _mm_xor_si128(x[2], rk))));
+    }
     
-    return t;
+    sm4_aesni_store4(out, x);
 }
 
-/* AES-NI优化的SM4加密 */
-static void sm4_encrypt_block_aesni(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
-    __m128i x = _mm_loadu_si128((__m128i*)in);
-    __m128i rk[32];
+/* 8个块并行加密/解密：两组4块交错执行，掩盖AESENCLAST和pshufb的延迟 */
+static void sm4_aesni_crypt8(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    __m128i x[4], y[4];
+    __m128i rk;
     int i;
     
-    /* 加载轮密钥 */
-    for (i = 0; i < 32; i++) {
-        rk[i] = _mm_set1_epi32(ctx->rk[i]);
+    sm4_aesni_load4(x, in);
+    sm4_aesni_load4(y, in + SM4_AESNI_LANES * SM4_BLOCK_SIZE);
+    
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        rk = _mm_set1_epi32((int)ctx->rk[i]);
+        x[0] = _mm_xor_si128(x[0], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[1], x[2]), _mm_xor_si128(x[3], rk))));
+        y[0] = _mm_xor_si128(y[0], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(y[1], y[2]), _mm_xor_si128(y[3], rk))));
+        rk = _mm_set1_epi32((int)ctx->rk[i + 1]);
+        x[1] = _mm_xor_si128(x[1], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[2], x[3]), _mm_xor_si128(x[0], rk))));
+        y[1] = _mm_xor_si128(y[1], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(y[2], y[3]), _mm_xor_si128(y[0], rk))));
+        rk = _mm_set1_epi32((int)ctx->rk[i + 2]);
+        x[2] = _mm_xor_si128(x[2], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[3], x[0]), _mm_xor_si128(x[1], rk))));
+        y[2] = _mm_xor_si128(y[2], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(y[3], y[0]), _mm_xor_si128(y[1], rk))));
+        rk = _mm_set1_epi32((int)ctx->rk[i + 3]);
+        x[3] = _mm_xor_si128(x[3], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[0], x[1]), _mm_xor_si128(x[2], rk))));
+        y[3] = _mm_xor_si128(y[3], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(y[0], y[1]), _mm_xor_si128(y[2], rk))));
     }
     
-    /* 32轮加密 */
-    for (i = 0; i < 32; i++) {
-        x = sm4_round_aesni(x, rk[i]);
+    sm4_aesni_store4(out, x);
+    sm4_aesni_store4(out + SM4_AESNI_LANES * SM4_BLOCK_SIZE, y);
+}
+
+/* 8个块各用自己的轮密钥：4块一组，load4后第b个元素就是组内第b块，直接载入rk行中的4列 */
+static void sm4_aesni_crypt_lanes8(const uint32_t rk[SM4_ROUNDS][SM4_MB_LANES], size_t lane, uint8_t *out, const uint8_t *in) {
+    __m128i x[4], y[4];
+    __m128i kx, ky;
+    int i, j;
+    
+    sm4_aesni_load4(x, in);
+    sm4_aesni_load4(y, in + SM4_AESNI_LANES * SM4_BLOCK_SIZE);
+    
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        for (j = 0; j < 4; j++) {
+            kx = _mm_loadu_si128((const __m128i *)(rk[i + j] + lane));
+            ky = _mm_loadu_si128((const __m128i *)(rk[i + j] + lane + SM4_AESNI_LANES));
+            x[j] = _mm_xor_si128(x[j], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[(j + 1) & 3], x[(j + 2) & 3]),
+                                                                  _mm_xor_si128(x[(j + 3) & 3], kx))));
+            y[j] = _mm_xor_si128(y[j], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(y[(j + 1) & 3], y[(j + 2) & 3]),
+                                                                  _mm_xor_si128(y[(j + 3) & 3], ky))));
+        }
     }
     
-    /* 存储结果 */
-    _mm_storeu_si128((__m128i*)out, x);
+    sm4_aesni_store4(out, x);
+    sm4_aesni_store4(out + SM4_AESNI_LANES * SM4_BLOCK_SIZE, y);
 }
 
-/* 检测CPU是否支持AES-NI */
-static int has_aesni_support(void) {
-    /* 实际实现应该使用CPUID指令检测 */
-    /* 这里简化为编译时检测 */
-    return 1;
+/* 不足4块的尾部：补齐到4块后处理 */
+static void sm4_aesni_crypt_tail(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+    uint8_t buf[SM4_AESNI_LANES * SM4_BLOCK_SIZE] = {0};
+    
+    memcpy(buf, in, blocks * SM4_BLOCK_SIZE);
+    sm4_aesni_crypt4(ctx, buf, buf);
+    memcpy(out, buf, blocks * SM4_BLOCK_SIZE);
+}
+
+#else
+
+/* 线性变换L */
+static uint32_t sm4_l_transform(uint32_t a) {
+    return a ^ rotl32(a, 2) ^ rotl32(a, 10) ^ rotl32(a, 18) ^ rotl32(a, 24);
+}
+
+/* 合成变换T */
+static uint32_t sm4_t_transform(uint32_t a) {
+    uint8_t a0 = SM4_SBOX[(uint8_t)(a >> 24)];
+    uint8_t a1 = SM4_SBOX[(uint8_t)(a >> 16)];
+    uint8_t a2 = SM4_SBOX[(uint8_t)(a >> 8)];
+    uint8_t a3 = SM4_SBOX[(uint8_t)a];
+    
+    return sm4_l_transform((uint32_t)a0 << 24 | (uint32_t)a1 << 16 | (uint32_t)a2 << 8 | (uint32_t)a3);
 }
 
 #endif /* HAVE_AESNI */
@@ -201,9 +312,6 @@ static void sm4_set_key(SM4_Context *ctx, const uint8_t *key, int is_encrypt) {
     uint32_t K[36]; // 中间密钥
     int i;
     
-    /* 确保T表已初始化 */
-    init_t_tables();
-    
     /* 将密钥转换为字 */
     MK[0] = load_u32_be(key);
     MK[1] = load_u32_be(key + 4);
@@ -233,154 +341,175 @@ static void sm4_set_key(SM4_Context *ctx, const uint8_t *key, int is_encrypt) {
     }
 }
 
-void sm4_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
+static void sm4_aesni_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
     sm4_set_key(ctx, key, 1);
 }
 
-void sm4_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
-    sm4_set_key(ctx, key, 0);
+#if defined(HAVE_AESNI) && HAVE_AESNI
+
+/* 密钥扩展一轮：x[a] ^= L'(τ(x[b] ^ x[c] ^ x[d] ^ ck))，L'(y) = y ^ rol13(y) ^ rol23(y) */
+static inline __m128i sm4_aesni_key_round(__m128i a, __m128i b, __m128i c, __m128i d, uint32_t ck) {
+    __m128i y = sm4_aesni_tau(_mm_xor_si128(_mm_xor_si128(b, c), _mm_xor_si128(d, _mm_set1_epi32((int)ck))));
+    __m128i r13 = _mm_or_si128(_mm_slli_epi32(y, 13), _mm_srli_epi32(y, 19));
+    __m128i r23 = _mm_or_si128(_mm_slli_epi32(y, 23), _mm_srli_epi32(y, 9));
+    
+    return _mm_xor_si128(_mm_xor_si128(a, y), _mm_xor_si128(r13, r23));
 }
 
-/* 加密单个块 */
-void sm4_encrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
-#if defined(HAVE_AESNI) && HAVE_AESNI
-    /* 如果支持AES-NI，使用优化版本 */
-    if (has_aesni_support()) {
-        sm4_encrypt_block_aesni(ctx, out, in);
-        return;
+/* 最多4个密钥并行扩展：密钥按块的方式转置载入，x[j]的第b个元素是第b个密钥的第j个字 */
+static void sm4_aesni_set_keys4(SM4_Context *ctx, const uint8_t *keys, size_t count) {
+    uint8_t buf[SM4_AESNI_LANES * SM4_KEY_SIZE] = {0};
+    uint32_t rk[SM4_ROUNDS][SM4_AESNI_LANES];
+    __m128i k[4];
+    size_t b;
+    int i, j;
+    
+    memcpy(buf, keys, count * SM4_KEY_SIZE);
+    sm4_aesni_load4(k, buf);
+    for (j = 0; j < 4; j++) {
+        k[j] = _mm_xor_si128(k[j], _mm_set1_epi32((int)SYSTEM_PARAMETER[j]));
     }
-#endif
-    
-    /* 回退到T表实现 */
-    uint32_t X[4];
-    uint32_t temp;
-    int i;
-    
-    /* 确保T表已初始化 */
-    init_t_tables();
     
-    /* 将输入块转换为字 */
-    X[0] = load_u32_be(in);
-    X[1] = load_u32_be(in + 4);
-    X[2] = load_u32_be(in + 8);
-    X[3] = load_u32_be(in + 12);
-    
-    /* 32轮迭代 */
-    for (i = 0; i < 32; i++) {
-        temp = X[1] ^ X[2] ^ X[3] ^ ctx->rk[i];
-        temp = sm4_t_transform_table(temp);
-        X[0] ^= temp;
-        
-        /* 循环移位 */
-        temp = X[0];
-        X[0] = X[1];
-        X[1] = X[2];
-        X[2] = X[3];
-        X[3] = temp;
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        k[0] = sm4_aesni_key_round(k[0], k[1], k[2], k[3], FIXED_PARAMETER[i]);
+        _mm_storeu_si128((__m128i *)rk[i], k[0]);
+        k[1] = sm4_aesni_key_round(k[1], k[2], k[3], k[0], FIXED_PARAMETER[i + 1]);
+        _mm_storeu_si128((__m128i *)rk[i + 1], k[1]);
+        k[2] = sm4_aesni_key_round(k[2], k[3], k[0], k[1], FIXED_PARAMETER[i + 2]);
+        _mm_storeu_si128((__m128i *)rk[i + 2], k[2]);
+        k[3] = sm4_aesni_key_round(k[3], k[0], k[1], k[2], FIXED_PARAMETER[i + 3]);
+        _mm_storeu_si128((__m128i *)rk[i + 3], k[3]);
     }
     
-    /* 反序变换 */
-    store_u32_be(X[3], out);
-    store_u32_be(X[2], out + 4);
-    store_u32_be(X[1], out + 8);
-    store_u32_be(X[0], out + 12);
+    for (b = 0; b < count; b++) {
+        for (i = 0; i < SM4_ROUNDS; i++) {
+            ctx[b].rk[i] = rk[i][b];
+        }
+    }
+    memset(buf, 0, sizeof(buf));
 }
 
-/* 解密单个块（与加密相同，只是轮密钥顺序相反） */
-void sm4_decrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
-    sm4_encrypt_block(ctx, out, in);
-}
+#endif /* HAVE_AESNI */
 
-/* 加密多个块（ECB模式） */
-void sm4_encrypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
-    size_t i;
-    for (i = 0; i < blocks; i++) {
-        sm4_encrypt_block(ctx, out, in);
-        in += SM4_BLOCK_SIZE;
-        out += SM4_BLOCK_SIZE;
+/* 批量扩展加密密钥，每4个一组 */
+static void sm4_aesni_set_encrypt_keys(SM4_Context *ctx, const uint8_t *keys, size_t count) {
+#if defined(HAVE_AESNI) && HAVE_AESNI
+    while (count > 0) {
+        size_t n = count < SM4_AESNI_LANES ? count : SM4_AESNI_LANES;
+        
+        sm4_aesni_set_keys4(ctx, keys, n);
+        ctx += n;
+        keys += n * SM4_KEY_SIZE;
+        count -= n;
     }
-}
-
-/* 解密多个块（ECB模式） */
-void sm4_decrypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+#else
     size_t i;
-    for (i = 0; i < blocks; i++) {
-        sm4_decrypt_block(ctx, out, in);
-        in += SM4_BLOCK_SIZE;
-        out += SM4_BLOCK_SIZE;
+    
+    for (i = 0; i < count; i++) {
+        sm4_set_key(&ctx[i], keys + i * SM4_KEY_SIZE, 1);
     }
+#endif
 }
 
-/* ECB模式加密 */
-int sm4_ecb_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
-    
-    sm4_encrypt_blocks(ctx, out, in, len / SM4_BLOCK_SIZE);
-    return 0;
+static void sm4_aesni_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    sm4_set_key(ctx, key, 0);
 }
 
-/* ECB模式解密 */
-int sm4_ecb_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
+/* 加密/解密多个块（解密与加密相同，只是轮密钥顺序相反） */
+static void sm4_aesni_crypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+#if defined(HAVE_AESNI) && HAVE_AESNI
+    /* 调度层只在CPU支持时选择本后端 */
+    while (blocks >= 2 * SM4_AESNI_LANES) {
+        sm4_aesni_crypt8(ctx, out, in);
+        in += 2 * SM4_AESNI_LANES * SM4_BLOCK_SIZE;
+        out += 2 * SM4_AESNI_LANES * SM4_BLOCK_SIZE;
+        blocks -= 2 * SM4_AESNI_LANES;
     }
     
-    sm4_decrypt_blocks(ctx, out, in, len / SM4_BLOCK_SIZE);
-    return 0;
-}
-
-/* CBC模式加密 */
-int sm4_cbc_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv) {
-    size_t i, j;
-    uint8_t tmp[SM4_BLOCK_SIZE];
+    if (blocks >= SM4_AESNI_LANES) {
+        sm4_aesni_crypt4(ctx, out, in);
+        in += SM4_AESNI_LANES * SM4_BLOCK_SIZE;
+        out += SM4_AESNI_LANES * SM4_BLOCK_SIZE;
+        blocks -= SM4_AESNI_LANES;
+    }
     
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
+    if (blocks > 0) {
+        sm4_aesni_crypt_tail(ctx, out, in, blocks);
     }
+#else
+    /* 未编译AES-NI支持时本后端不会被选中，这里只保证结果正确 */
+    uint32_t X[4];
+    uint32_t temp;
+    size_t b;
+    int i;
     
-    for (i = 0; i < len; i += SM4_BLOCK_SIZE) {
-        /* 明文与IV异或 */
-        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
-            tmp[j] = in[i + j] ^ iv[j];
-        }
+    for (b = 0; b < blocks; b++) {
+        X[0] = load_u32_be(in);
+        X[1] = load_u32_be(in + 4);
+        X[2] = load_u32_be(in + 8);
+        X[3] = load_u32_be(in + 12);
         
-        /* 加密 */
-        sm4_encrypt_block(ctx, out + i, tmp);
+        for (i = 0; i < 32; i++) {
+            temp = X[0] ^ sm4_t_transform(X[1] ^ X[2] ^ X[3] ^ ctx->rk[i]);
+            X[0] = X[1];
+            X[1] = X[2];
+            X[2] = X[3];
+            X[3] = temp;
+        }
         
-        /* 更新IV */
-        memcpy(iv, out + i, SM4_BLOCK_SIZE);
+        store_u32_be(X[3], out);
+        store_u32_be(X[2], out + 4);
+        store_u32_be(X[1], out + 8);
+        store_u32_be(X[0], out + 12);
+        in += SM4_BLOCK_SIZE;
+        out += SM4_BLOCK_SIZE;
     }
-    
-    return 0;
+#endif
 }
 
-/* CBC模式解密 */
-int sm4_cbc_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv) {
-    size_t i, j;
-    uint8_t tmp[SM4_BLOCK_SIZE];
-    uint8_t next_iv[SM4_BLOCK_SIZE];
+/* 多通道加密/解密，每个通道一个密钥，8块一组 */
+static void sm4_aesni_crypt_lanes(const uint32_t rk[SM4_ROUNDS][SM4_MB_LANES], uint8_t *out, const uint8_t *in) {
+#if defined(HAVE_AESNI) && HAVE_AESNI
+    size_t l;
     
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
+    for (l = 0; l < SM4_MB_LANES; l += 2 * SM4_AESNI_LANES) {
+        sm4_aesni_crypt_lanes8(rk, l, out + l * SM4_BLOCK_SIZE, in + l * SM4_BLOCK_SIZE);
     }
+#else
+    SM4_Context ctx;
+    int l, i;
     
-    for (i = 0; i < len; i += SM4_BLOCK_SIZE) {
-        /* 保存下一个IV */
-        memcpy(next_iv, in + i, SM4_BLOCK_SIZE);
-        
-        /* 解密 */
-        sm4_decrypt_block(ctx, tmp, in + i);
-        
-        /* 与IV异或 */
-        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
-            out[i + j] = tmp[j] ^ iv[j];
+    for (l = 0; l < SM4_MB_LANES; l++) {
+        for (i = 0; i < SM4_ROUNDS; i++) {
+            ctx.rk[i] = rk[i][l];
         }
-        
-        /* 更新IV */
-        memcpy(iv, next_iv, SM4_BLOCK_SIZE);
+        sm4_aesni_crypt_blocks(&ctx, out + l * SM4_BLOCK_SIZE, in + l * SM4_BLOCK_SIZE, 1);
     }
-    
+#endif
+}
+
+/* 加密/解密单个块 */
+static void sm4_aesni_crypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    sm4_aesni_crypt_blocks(ctx, out, in, 1);
+}
+
+/* 需要编译期开启AES-NI且CPU支持AES-NI和SSSE3（pshufb） */
+static int sm4_aesni_is_supported(const SM4_CPU_Features *features) {
+#if defined(HAVE_AESNI) && HAVE_AESNI
+    return features->has_aesni && features->has_ssse3;
+#else
+    (void)features;
     return 0;
-}
\ No newline at end of file
+#endif
+}
+
+const SM4_Implementation sm4_aesni_impl = {
+    "aesni",
+    sm4_aesni_is_supported,
+    sm4_aesni_set_encrypt_key,
+    sm4_aesni_set_decrypt_key,
+    sm4_aesni_crypt_block,
+    sm4_aesni_crypt_blocks,
+    sm4_aesni_set_encrypt_keys,
+    sm4_aesni_crypt_lanes
+};
@@ -0,0 +1,585 @@
+#include "sm4_aio.h"
+#include "sm4_gcm.h"
+#include "sm4_internal.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * 异步批量加密引擎
+ *
+ * 存储节点同时处理很多个文件（对象），每个请求是一条完整的消息：读入、整条加密、写出。
+ * 引擎把所有在途请求的读和写交给io_uring批量提交，一次io_uring_enter()同时提交新的SQE
+ * 并收割完成的CQE，请求数可以达到NVMe的队列深度；读完的请求在sm4_aio_poll()中成批加密
+ * （请求多于一个时分给库内部的线程池），随即提交它们的写，调用者线程从不阻塞在单个I/O上。
+ *
+ * 每个请求在任一时刻最多有一个SQE在途（读或写，短读/短写时从断点重新提交），
+ * 所以提交队列的长度取queue_depth就不会溢出。没有io_uring时同样的状态机用pread/pwrite同步推进。
+ */
+
+#if !defined(_WIN32)
+
+#include <unistd.h>
+
+#if SM4_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+/* 缓冲区对齐（满足O_DIRECT） */
+#define SM4_AIO_ALIGN 4096
+
+/* 单个SQE的最大长度，更长的读写分多次提交 */
+#define SM4_AIO_MAX_IO ((size_t)1 << 30)
+
+/* 请求状态 */
+enum {
+    SM4_AIO_STATE_READ = 0,   // 等待提交（或正在进行）读
+    SM4_AIO_STATE_CRYPT,      // 已读完，等待加密
+    SM4_AIO_STATE_WRITE,      // 等待提交（或正在进行）写
+    SM4_AIO_STATE_DONE        // 已完成，等待取回
+};
+
+/* 请求的先进先出队列，通过req->next串联 */
+typedef struct {
+    SM4_AIO_Request *head;
+    SM4_AIO_Request *tail;
+} SM4_AIO_Queue;
+
+/* 完成的请求留下的缓冲区（已清零），供后续请求复用 */
+typedef struct {
+    uint8_t *ptr;
+    size_t size;
+} SM4_AIO_Buffer;
+
+struct sm4_aio_engine {
+    unsigned int depth;
+    size_t inflight;                // 已提交、尚未取回的请求数
+    SM4_AIO_Queue io_queue;         // 需要提交读或写的请求
+    SM4_AIO_Queue crypt_queue;      // 已读完、等待加密的请求
+    SM4_AIO_Queue done_queue;       // 已完成、等待取回的请求
+    SM4_AIO_Request **batch;        // 一次加密的请求，最多depth个
+    SM4_AIO_Buffer *spare;          // 空闲缓冲区，最多depth个
+    size_t spare_count;
+    int uring;                      // 是否使用io_uring
+
+#if SM4_HAVE_IO_URING
+    int ring_fd;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_len;
+    size_t cq_ring_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned int to_submit;         // 已填好、尚未交给内核的SQE数
+#endif
+};
+
+static void sm4_aio_push(SM4_AIO_Queue *q, SM4_AIO_Request *req) {
+    req->next = NULL;
+    if (q->tail != NULL) {
+        q->tail->next = req;
+    } else {
+        q->head = req;
+    }
+    q->tail = req;
+}
+
+static SM4_AIO_Request *sm4_aio_pop(SM4_AIO_Queue *q) {
+    SM4_AIO_Request *req = q->head;
+
+    if (req != NULL) {
+        q->head = req->next;
+        if (q->head == NULL) {
+            q->tail = NULL;
+        }
+        req->next = NULL;
+    }
+    return req;
+}
+
+/*
+ * 为请求准备size字节的缓冲区：优先复用空闲缓冲区。
+ * 每次新分配的大缓冲区都要经历缺页，复用后稳定负载下不再分配内存。
+ */
+static int sm4_aio_get_buffer(SM4_AIO_Engine *engine, SM4_AIO_Request *req, size_t size) {
+    size_t i;
+
+    for (i = 0; i < engine->spare_count; i++) {
+        if (engine->spare[i].size >= size) {
+            break;
+        }
+    }
+    if (i < engine->spare_count) {
+        req->buf = engine->spare[i].ptr;
+        req->buf_size = engine->spare[i].size;
+        engine->spare[i] = engine->spare[--engine->spare_count];
+        return 0;
+    }
+
+    /* 空闲缓冲区都太小：丢掉一个，保持缓冲区总数不超过depth */
+    if (engine->spare_count > 0) {
+        free(engine->spare[--engine->spare_count].ptr);
+    }
+    if (posix_memalign((void **)&req->buf, SM4_AIO_ALIGN, size) != 0) {
+        req->buf = NULL;
+        return -ENOMEM;
+    }
+    req->buf_size = size;
+    return 0;
+}
+
+/* 请求完成：清除缓冲区并放回空闲列表，请求进入完成队列 */
+static void sm4_aio_finish(SM4_AIO_Engine *engine, SM4_AIO_Request *req, int result) {
+    if (req->buf != NULL) {
+        memset(req->buf, 0, req->len);
+        if (engine->spare_count < engine->depth) {
+            engine->spare[engine->spare_count].ptr = req->buf;
+            engine->spare[engine->spare_count].size = req->buf_size;
+            engine->spare_count++;
+        } else {
+            free(req->buf);
+        }
+        req->buf = NULL;
+    }
+    req->result = result;
+    req->state = SM4_AIO_STATE_DONE;
+    sm4_aio_push(&engine->done_queue, req);
+}
+
+/* 一次读或写完成了res字节（负值为-errno），决定请求的下一步 */
+static void sm4_aio_io_done(SM4_AIO_Engine *engine, SM4_AIO_Request *req, long res) {
+    if (res == -EINTR || res == -EAGAIN) {
+        sm4_aio_push(&engine->io_queue, req);
+        return;
+    }
+    if (res < 0) {
+        sm4_aio_finish(engine, req, (int)res);
+        return;
+    }
+    if (res == 0) {
+        /* 读到文件末尾（输入比len短）或设备拒绝继续写 */
+        sm4_aio_finish(engine, req, -EIO);
+        return;
+    }
+
+    req->done += (size_t)res;
+    if (req->done < req->len) {
+        sm4_aio_push(&engine->io_queue, req);
+    } else if (req->state == SM4_AIO_STATE_READ) {
+        req->state = SM4_AIO_STATE_CRYPT;
+        sm4_aio_push(&engine->crypt_queue, req);
+    } else {
+        sm4_aio_finish(engine, req, 0);
+    }
+}
+
+/* 加密/解密一个已读完的请求（在线程池上执行，各请求互不相干） */
+static void sm4_aio_crypt_task(void *arg, size_t index) {
+    SM4_AIO_Request *req = ((SM4_AIO_Request **)arg)[index];
+    SM4_CTR_Context ctr;
+
+    switch (req->op) {
+    case SM4_AIO_GCM_ENCRYPT:
+        sm4_gcm_encrypt_and_tag(req->key, req->iv, req->iv_len, req->aad, req->aad_len,
+                                req->buf, req->len, req->buf, req->tag, sizeof(req->tag));
+        req->result = 0;
+        break;
+    case SM4_AIO_GCM_DECRYPT:
+        req->result = sm4_gcm_decrypt_and_verify(req->key, req->iv, req->iv_len, req->aad, req->aad_len,
+                                                 req->buf, req->len, req->tag, sizeof(req->tag),
+                                                 req->buf) == 0 ? 0 : -EBADMSG;
+        break;
+    default:
+        sm4_ctr_init(&ctr, req->key, req->iv);
+        sm4_ctr_encrypt(&ctr, req->buf, req->buf, req->len);
+        memset(&ctr, 0, sizeof(ctr));
+        req->result = 0;
+        break;
+    }
+}
+
+/* 加密所有已读完的请求，然后把它们排入写队列；返回处理的请求数 */
+static size_t sm4_aio_crypt(SM4_AIO_Engine *engine) {
+    SM4_AIO_Request *req;
+    size_t n = 0, i;
+
+    while (n < engine->depth && (req = sm4_aio_pop(&engine->crypt_queue)) != NULL) {
+        engine->batch[n++] = req;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    if (n == 1) {
+        sm4_aio_crypt_task(engine->batch, 0);
+    } else {
+        sm4_parallel_run(n, 0, sm4_aio_crypt_task, engine->batch);
+    }
+
+    for (i = 0; i < n; i++) {
+        req = engine->batch[i];
+        if (req->result != 0 || req->len == 0) {
+            sm4_aio_finish(engine, req, req->result);
+        } else {
+            req->state = SM4_AIO_STATE_WRITE;
+            req->done = 0;
+            sm4_aio_push(&engine->io_queue, req);
+        }
+    }
+    return n;
+}
+
+/* 没有io_uring时：用pread/pwrite完成队列中所有的读写；返回处理的请求数 */
+static size_t sm4_aio_sync_io(SM4_AIO_Engine *engine) {
+    SM4_AIO_Queue queue = engine->io_queue;
+    SM4_AIO_Request *req;
+    size_t n = 0, chunk;
+    ssize_t res;
+
+    engine->io_queue.head = NULL;
+    engine->io_queue.tail = NULL;
+
+    while ((req = sm4_aio_pop(&queue)) != NULL) {
+        chunk = req->len - req->done < SM4_AIO_MAX_IO ? req->len - req->done : SM4_AIO_MAX_IO;
+        if (req->state == SM4_AIO_STATE_READ) {
+            res = pread(req->in_fd, req->buf + req->done, chunk, (off_t)(req->in_off + req->done));
+        } else {
+            res = pwrite(req->out_fd, req->buf + req->done, chunk, (off_t)(req->out_off + req->done));
+        }
+        sm4_aio_io_done(engine, req, res < 0 ? -(long)errno : (long)res);
+        n++;
+    }
+    return n;
+}
+
+#if SM4_HAVE_IO_URING
+
+static int sm4_uring_setup(SM4_AIO_Engine *engine) {
+    struct io_uring_params params;
+    struct io_uring_probe *probe;
+    size_t probe_len = sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op);
+    int supported;
+
+    memset(&params, 0, sizeof(params));
+    engine->ring_fd = (int)syscall(__NR_io_uring_setup, engine->depth, &params);
+    if (engine->ring_fd < 0) {
+        return -1;
+    }
+
+    /* IORING_OP_READ/WRITE需要5.6以上的内核，用探测确认 */
+    probe = (struct io_uring_probe *)calloc(1, probe_len);
+    supported = probe != NULL &&
+                syscall(__NR_io_uring_register, engine->ring_fd, IORING_REGISTER_PROBE, probe, 256) >= 0 &&
+                probe->last_op >= IORING_OP_WRITE &&
+                (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+                (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    if (!supported) {
+        close(engine->ring_fd);
+        return -1;
+    }
+
+    engine->sq_ring_len = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    engine->cq_ring_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (engine->cq_ring_len > engine->sq_ring_len) {
+            engine->sq_ring_len = engine->cq_ring_len;
+        }
+        engine->cq_ring_len = engine->sq_ring_len;
+    }
+
+    engine->sq_ring = mmap(NULL, engine->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           engine->ring_fd, IORING_OFF_SQ_RING);
+    if (engine->sq_ring == MAP_FAILED) {
+        close(engine->ring_fd);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        engine->cq_ring = engine->sq_ring;
+    } else {
+        engine->cq_ring = mmap(NULL, engine->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                               engine->ring_fd, IORING_OFF_CQ_RING);
+        if (engine->cq_ring == MAP_FAILED) {
+            munmap(engine->sq_ring, engine->sq_ring_len);
+            close(engine->ring_fd);
+            return -1;
+        }
+    }
+    engine->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    engine->sqes = (struct io_uring_sqe *)mmap(NULL, engine->sqes_len, PROT_READ | PROT_WRITE,
+                                               MAP_SHARED | MAP_POPULATE, engine->ring_fd, IORING_OFF_SQES);
+    if (engine->sqes == MAP_FAILED) {
+        if (engine->cq_ring != engine->sq_ring) {
+            munmap(engine->cq_ring, engine->cq_ring_len);
+        }
+        munmap(engine->sq_ring, engine->sq_ring_len);
+        close(engine->ring_fd);
+        return -1;
+    }
+
+    engine->sq_tail = (unsigned int *)((uint8_t *)engine->sq_ring + params.sq_off.tail);
+    engine->sq_mask = (unsigned int *)((uint8_t *)engine->sq_ring + params.sq_off.ring_mask);
+    engine->sq_array = (unsigned int *)((uint8_t *)engine->sq_ring + params.sq_off.array);
+    engine->cq_head = (unsigned int *)((uint8_t *)engine->cq_ring + params.cq_off.head);
+    engine->cq_tail = (unsigned int *)((uint8_t *)engine->cq_ring + params.cq_off.tail);
+    engine->cq_mask = (unsigned int *)((uint8_t *)engine->cq_ring + params.cq_off.ring_mask);
+    engine->cqes = (struct io_uring_cqe *)((uint8_t *)engine->cq_ring + params.cq_off.cqes);
+    engine->to_submit = 0;
+    return 0;
+}
+
+static void sm4_uring_teardown(SM4_AIO_Engine *engine) {
+    munmap(engine->sqes, engine->sqes_len);
+    if (engine->cq_ring != engine->sq_ring) {
+        munmap(engine->cq_ring, engine->cq_ring_len);
+    }
+    munmap(engine->sq_ring, engine->sq_ring_len);
+    close(engine->ring_fd);
+}
+
+/* 把队列中的读写填成SQE（每个在途请求最多一个SQE，提交队列不会满） */
+static void sm4_uring_queue(SM4_AIO_Engine *engine) {
+    unsigned int tail = *engine->sq_tail;
+    unsigned int mask = *engine->sq_mask;
+    struct io_uring_sqe *sqe;
+    SM4_AIO_Request *req;
+    size_t chunk;
+
+    while ((req = sm4_aio_pop(&engine->io_queue)) != NULL) {
+        chunk = req->len - req->done < SM4_AIO_MAX_IO ? req->len - req->done : SM4_AIO_MAX_IO;
+        sqe = &engine->sqes[tail & mask];
+        memset(sqe, 0, sizeof(*sqe));
+        if (req->state == SM4_AIO_STATE_READ) {
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = req->in_fd;
+            sqe->off = req->in_off + req->done;
+        } else {
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = req->out_fd;
+            sqe->off = req->out_off + req->done;
+        }
+        sqe->addr = (uint64_t)(uintptr_t)(req->buf + req->done);
+        sqe->len = (uint32_t)chunk;
+        sqe->user_data = (uint64_t)(uintptr_t)req;
+        engine->sq_array[tail & mask] = tail & mask;
+        tail++;
+        engine->to_submit++;
+    }
+    __atomic_store_n(engine->sq_tail, tail, __ATOMIC_RELEASE);
+}
+
+/* 提交填好的SQE；wait非0时等待至少一个CQE */
+static void sm4_uring_enter(SM4_AIO_Engine *engine, int wait) {
+    long ret;
+
+    if (engine->to_submit == 0 && !wait) {
+        return;
+    }
+    ret = syscall(__NR_io_uring_enter, engine->ring_fd, engine->to_submit, wait ? 1 : 0,
+                  wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if (ret > 0) {
+        engine->to_submit -= (unsigned int)ret;
+    }
+}
+
+/* 收割所有CQE；返回处理的个数 */
+static size_t sm4_uring_reap(SM4_AIO_Engine *engine) {
+    unsigned int head = *engine->cq_head;
+    unsigned int tail = __atomic_load_n(engine->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned int mask = *engine->cq_mask;
+    struct io_uring_cqe *cqe;
+    size_t n = 0;
+
+    while (head != tail) {
+        cqe = &engine->cqes[head & mask];
+        sm4_aio_io_done(engine, (SM4_AIO_Request *)(uintptr_t)cqe->user_data, cqe->res);
+        head++;
+        n++;
+    }
+    __atomic_store_n(engine->cq_head, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+#endif /* SM4_HAVE_IO_URING */
+
+/* 创建异步加密引擎 */
+SM4_AIO_Engine *sm4_aio_create(unsigned int queue_depth, unsigned int flags) {
+    SM4_AIO_Engine *engine;
+
+    if (queue_depth == 0 || queue_depth > 4096) {
+        return NULL;
+    }
+    engine = (SM4_AIO_Engine *)calloc(1, sizeof(*engine));
+    if (engine == NULL) {
+        return NULL;
+    }
+    engine->depth = queue_depth;
+    engine->batch = (SM4_AIO_Request **)calloc(queue_depth, sizeof(*engine->batch));
+    engine->spare = (SM4_AIO_Buffer *)calloc(queue_depth, sizeof(*engine->spare));
+    if (engine->batch == NULL || engine->spare == NULL) {
+        free(engine->batch);
+        free(engine->spare);
+        free(engine);
+        return NULL;
+    }
+
+#if SM4_HAVE_IO_URING
+    if (!(flags & SM4_AIO_FLAG_NO_URING) && sm4_uring_setup(engine) == 0) {
+        engine->uring = 1;
+    }
+#else
+    (void)flags;
+#endif
+    return engine;
+}
+
+/* 销毁引擎 */
+void sm4_aio_destroy(SM4_AIO_Engine *engine) {
+    if (engine == NULL) {
+        return;
+    }
+#if SM4_HAVE_IO_URING
+    if (engine->uring) {
+        sm4_uring_teardown(engine);
+    }
+#endif
+    while (engine->spare_count > 0) {
+        free(engine->spare[--engine->spare_count].ptr);
+    }
+    free(engine->spare);
+    free(engine->batch);
+    free(engine);
+}
+
+/* 当前引擎使用的I/O后端 */
+const char *sm4_aio_get_backend(const SM4_AIO_Engine *engine) {
+    return engine->uring ? "io_uring" : "pread";
+}
+
+/* 提交一个请求 */
+int sm4_aio_submit(SM4_AIO_Engine *engine, SM4_AIO_Request *req) {
+    size_t alloc;
+
+    if (engine == NULL || req == NULL || req->key == NULL || req->iv == NULL ||
+        (req->op != SM4_AIO_GCM_ENCRYPT && req->op != SM4_AIO_GCM_DECRYPT && req->op != SM4_AIO_CTR) ||
+        (req->op != SM4_AIO_CTR && (req->iv_len == 0 || (uint64_t)req->len > SM4_GCM_MAX_TEXT_LEN)) ||
+        (req->aad == NULL && req->aad_len > 0) ||
+        (req->len > 0 && (req->in_fd < 0 || req->out_fd < 0))) {
+        return -EINVAL;
+    }
+    if (engine->inflight >= engine->depth) {
+        return -EBUSY;
+    }
+
+    alloc = (req->len + SM4_AIO_ALIGN - 1) / SM4_AIO_ALIGN * SM4_AIO_ALIGN;
+    if (sm4_aio_get_buffer(engine, req, alloc > 0 ? alloc : SM4_AIO_ALIGN) != 0) {
+        return -ENOMEM;
+    }
+
+    req->result = 0;
+    req->done = 0;
+    engine->inflight++;
+    if (req->len == 0) {
+        /* 空消息不需要读写，直接加密（GCM仍然生成/验证标签） */
+        req->state = SM4_AIO_STATE_CRYPT;
+        sm4_aio_push(&engine->crypt_queue, req);
+    } else {
+        req->state = SM4_AIO_STATE_READ;
+        sm4_aio_push(&engine->io_queue, req);
+    }
+    return 0;
+}
+
+/* 推进所有在途请求并取回一个已完成的请求 */
+SM4_AIO_Request *sm4_aio_poll(SM4_AIO_Engine *engine, int wait) {
+    SM4_AIO_Request *req;
+    size_t progress;
+
+    if (engine == NULL) {
+        return NULL;
+    }
+
+    for (;;) {
+        req = sm4_aio_pop(&engine->done_queue);
+        if (req != NULL) {
+            engine->inflight--;
+            return req;
+        }
+        if (engine->inflight == 0) {
+            return NULL;
+        }
+
+#if SM4_HAVE_IO_URING
+        if (engine->uring) {
+            progress = sm4_uring_reap(engine);
+            progress += sm4_aio_crypt(engine);
+            sm4_uring_queue(engine);
+            /* 这一轮没有任何进展时才阻塞等待CQE */
+            sm4_uring_enter(engine, wait && progress == 0 && engine->done_queue.head == NULL);
+            if (!wait && progress == 0 && engine->done_queue.head == NULL) {
+                /* 刚提交的I/O可能已经完成（例如命中页缓存），再收割一次 */
+                if (sm4_uring_reap(engine) == 0) {
+                    return NULL;
+                }
+            }
+            continue;
+        }
+#endif
+
+        progress = sm4_aio_sync_io(engine);
+        progress += sm4_aio_crypt(engine);
+        if (progress == 0 && engine->done_queue.head == NULL) {
+            return NULL;
+        }
+    }
+}
+
+/* 在途的请求数 */
+size_t sm4_aio_inflight(const SM4_AIO_Engine *engine) {
+    return engine->inflight;
+}
+
+#else /* _WIN32 */
+
+SM4_AIO_Engine *sm4_aio_create(unsigned int queue_depth, unsigned int flags) {
+    (void)queue_depth;
+    (void)flags;
+    return NULL;
+}
+
+void sm4_aio_destroy(SM4_AIO_Engine *engine) {
+    (void)engine;
+}
+
+const char *sm4_aio_get_backend(const SM4_AIO_Engine *engine) {
+    (void)engine;
+    return "none";
+}
+
+int sm4_aio_submit(SM4_AIO_Engine *engine, SM4_AIO_Request *req) {
+    (void)engine;
+    (void)req;
+    return -EINVAL;
+}
+
+SM4_AIO_Request *sm4_aio_poll(SM4_AIO_Engine *engine, int wait) {
+    (void)engine;
+    (void)wait;
+    return NULL;
+}
+
+size_t sm4_aio_inflight(const SM4_AIO_Engine *engine) {
+    (void)engine;
+    return 0;
+}
+
+#endif /* _WIN32 */
@@ -1,4 +1,4 @@
-#include "sm4.h"
+#include "sm4_internal.h"
 #include <string.h>
 
 /* SM4 S盒 */
@@ -23,7 +23,7 @@ static const uint8_t SM4_SBOX[256] = {
 
 /* 系统参数 */
 static const uint32_t SYSTEM_PARAMETER[4] = {
-    0x00070e15, 0x1c232a31, 0x383f464d, 0x545b6269
+    0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc
 };
 
 /* 固定参数 */
@@ -136,16 +136,16 @@ static void sm4_set_key(SM4_Context *ctx, const uint8_t *key, int is_encrypt) {
     }
 }
 
-void sm4_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
+static void sm4_basic_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
     sm4_set_key(ctx, key, 1);
 }
 
-void sm4_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
+static void sm4_basic_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
     sm4_set_key(ctx, key, 0);
 }
 
-/* 加密/解密单个块 */
-void sm4_encrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+/* 加密/解密单个块（解密与加密相同，只是轮密钥顺序相反） */
+static void sm4_basic_crypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
     uint32_t X[4];
     uint32_t temp;
     int i;
@@ -177,101 +177,29 @@ void sm4_encrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in)
     store_u32_be(X[0], out + 12);
 }
 
-/* 解密单个块（与加密相同，只是轮密钥顺序相反） */
-void sm4_decrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
-    sm4_encrypt_block(ctx, out, in);
-}
-
-/* 加密多个块（ECB模式） */
-void sm4_encrypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
-    size_t i;
-    for (i = 0; i < blocks; i++) {
-        sm4_encrypt_block(ctx, out, in);
-        in += SM4_BLOCK_SIZE;
-        out += SM4_BLOCK_SIZE;
-    }
-}
-
-/* 解密多个块（ECB模式） */
-void sm4_decrypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+/* 加密/解密多个块 */
+static void sm4_basic_crypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
     size_t i;
     for (i = 0; i < blocks; i++) {
-        sm4_decrypt_block(ctx, out, in);
+        sm4_basic_crypt_block(ctx, out, in);
         in += SM4_BLOCK_SIZE;
         out += SM4_BLOCK_SIZE;
     }
 }
 
-/* ECB模式加密 */
-int sm4_ecb_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
-    
-    sm4_encrypt_blocks(ctx, out, in, len / SM4_BLOCK_SIZE);
-    return 0;
+/* 基本实现不依赖任何扩展指令 */
+static int sm4_basic_is_supported(const SM4_CPU_Features *features) {
+    (void)features;
+    return 1;
 }
 
-/* ECB模式解密 */
-int sm4_ecb_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
-    
-    sm4_decrypt_blocks(ctx, out, in, len / SM4_BLOCK_SIZE);
-    return 0;
-}
-
-/* CBC模式加密 */
-int sm4_cbc_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv) {
-    size_t i, j;
-    uint8_t tmp[SM4_BLOCK_SIZE];
-    
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
-    
-    for (i = 0; i < len; i += SM4_BLOCK_SIZE) {
-        /* 明文与IV异或 */
-        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
-            tmp[j] = in[i + j] ^ iv[j];
-        }
-        
-        /* 加密 */
-        sm4_encrypt_block(ctx, out + i, tmp);
-        
-        /* 更新IV */
-        memcpy(iv, out + i, SM4_BLOCK_SIZE);
-    }
-    
-    return 0;
-}
-
-/* CBC模式解密 */
-int sm4_cbc_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv) {
-    size_t i, j;
-    uint8_t tmp[SM4_BLOCK_SIZE];
-    uint8_t next_iv[SM4_BLOCK_SIZE];
-    
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
-    
-    for (i = 0; i < len; i += SM4_BLOCK_SIZE) {
-        /* 保存下一个IV */
-        memcpy(next_iv, in + i, SM4_BLOCK_SIZE);
-        
-        /* 解密 */
-        sm4_decrypt_block(ctx, tmp, in + i);
-        
-        /* 与IV异或 */
-        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
-            out[i + j] = tmp[j] ^ iv[j];
-        }
-        
-        /* 更新IV */
-        memcpy(iv, next_iv, SM4_BLOCK_SIZE);
-    }
-    
-    return 0;
-}
\ No newline at end of file
+const SM4_Implementation sm4_basic_impl = {
+    "basic",
+    sm4_basic_is_supported,
+    sm4_basic_set_encrypt_key,
+    sm4_basic_set_decrypt_key,
+    sm4_basic_crypt_block,
+    sm4_basic_crypt_blocks,
+    NULL,
+    NULL
+};
@@ -0,0 +1,193 @@
+#include "sm4_internal.h"
+#include <string.h>
+
+/* 64位整数作为切片，一次处理64块 */
+#define BS_T            uint64_t
+#define BS_XOR(a, b)    ((a) ^ (b))
+#define BS_AND(a, b)    ((a) & (b))
+#define BS_NOT(a)       (~(a))
+#define BS_MASK(bit)    ((uint64_t)0 - (uint64_t)(bit))
+#define BS_SHL(a, n)    ((a) << (n))
+#define BS_SHR(a, n)    ((a) >> (n))
+#define BS_SET1(m)      ((uint64_t)(m))
+
+#include "sm4_bitslice_core.h"
+
+/* 一批处理的块数 */
+#define SM4_BITSLICE_LANES 64
+
+/* 不超过该块数时逐块处理，比补齐到一整批更快 */
+#define SM4_BITSLICE_SERIAL_MAX 4
+
+/* 系统参数 */
+static const uint32_t SYSTEM_PARAMETER[4] = {
+    0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc
+};
+
+/* 固定参数 */
+static const uint32_t FIXED_PARAMETER[32] = {
+    0x00070e15, 0x1c232a31, 0x383f464d, 0x545b6269,
+    0x70777e85, 0x8c939aa1, 0xa8afb6bd, 0xc4cbd2d9,
+    0xe0e7eef5, 0xfc030a11, 0x181f262d, 0x343b4249,
+    0x50575e65, 0x6c737a81, 0x888f969d, 0xa4abb2b9,
+    0xc0c7ced5, 0xdce3eaf1, 0xf8ff060d, 0x141b2229,
+    0x30373e45, 0x4c535a61, 0x686f767d, 0x848b9299,
+    0xa0a7aeb5, 0xbcc3cad1, 0xd8dfe6ed, 0xf4fb0209,
+    0x10171e25, 0x2c333a41, 0x484f565d, 0x646b7279
+};
+
+/* 循环左移 */
+static inline uint32_t rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+/* 字节转换为32位整数（大端序） */
+static inline uint32_t load_u32_be(const uint8_t *b) {
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | (uint32_t)b[3];
+}
+
+/* 32位整数转换为字节（大端序） */
+static inline void store_u32_be(uint32_t v, uint8_t *b) {
+    b[0] = (uint8_t)(v >> 24);
+    b[1] = (uint8_t)(v >> 16);
+    b[2] = (uint8_t)(v >> 8);
+    b[3] = (uint8_t)v;
+}
+
+/*
+ * 单个字的非线性变换τ，同样使用S盒电路：字的4个字节占切片的低4位，
+ * 一次电路求值完成4次S盒查找。用于密钥扩展和少量块的逐块处理，
+ * 保证整个后端（包括密钥扩展）都不查表。
+ */
+static uint32_t sm4_bitslice_tau(uint32_t a) {
+    uint64_t p[8];
+    uint32_t r = 0;
+    int i;
+    
+    for (i = 0; i < 8; i++) {
+        p[i] = ((a >> i) & 1) | ((a >> (i + 7)) & 2) | ((a >> (i + 14)) & 4) | ((a >> (i + 21)) & 8);
+    }
+    
+    sm4_bs_sbox(p);
+    
+    for (i = 0; i < 8; i++) {
+        r |= (uint32_t)((p[i] & 1) << i) | (uint32_t)((p[i] & 2) << (i + 7)) |
+             (uint32_t)((p[i] & 4) << (i + 14)) | (uint32_t)((p[i] & 8) << (i + 21));
+    }
+    
+    return r;
+}
+
+/* 密钥扩展 */
+static void sm4_set_key(SM4_Context *ctx, const uint8_t *key, int is_encrypt) {
+    uint32_t K[36]; // 中间密钥
+    uint32_t b;
+    int i;
+    
+    for (i = 0; i < 4; i++) {
+        K[i] = load_u32_be(key + 4 * i) ^ SYSTEM_PARAMETER[i];
+    }
+    
+    /* 生成轮密钥，合成变换T'中的线性变换为L' */
+    for (i = 0; i < 32; i++) {
+        b = sm4_bitslice_tau(K[i + 1] ^ K[i + 2] ^ K[i + 3] ^ FIXED_PARAMETER[i]);
+        K[i + 4] = K[i] ^ b ^ rotl32(b, 13) ^ rotl32(b, 23);
+        ctx->rk[i] = K[i + 4];
+    }
+    
+    /* 解密时轮密钥顺序相反 */
+    if (is_encrypt == 0) {
+        uint32_t temp;
+        for (i = 0; i < 16; i++) {
+            temp = ctx->rk[i];
+            ctx->rk[i] = ctx->rk[31 - i];
+            ctx->rk[31 - i] = temp;
+        }
+    }
+}
+
+static void sm4_bitslice_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    sm4_set_key(ctx, key, 1);
+}
+
+static void sm4_bitslice_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    sm4_set_key(ctx, key, 0);
+}
+
+/* 加密/解密单个块（逐块处理，不查表） */
+static void sm4_bitslice_crypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    uint32_t X[4];
+    uint32_t b;
+    int i;
+    
+    for (i = 0; i < 4; i++) {
+        X[i] = load_u32_be(in + 4 * i);
+    }
+    
+    for (i = 0; i < 32; i++) {
+        b = sm4_bitslice_tau(X[(i + 1) & 3] ^ X[(i + 2) & 3] ^ X[(i + 3) & 3] ^ ctx->rk[i]);
+        X[i & 3] ^= b ^ rotl32(b, 2) ^ rotl32(b, 10) ^ rotl32(b, 18) ^ rotl32(b, 24);
+    }
+    
+    /* 反序变换 */
+    for (i = 0; i < 4; i++) {
+        store_u32_be(X[3 - i], out + 4 * i);
+    }
+}
+
+/* 最多64个块的一批：转置为切片、32轮电路、转置回来。不足64块时其余行为0 */
+static void sm4_bitslice_crypt64(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+    uint64_t a[64] = {0}, b[64] = {0};
+    uint64_t x[4][32];
+    size_t k;
+    
+    for (k = 0; k < blocks; k++) {
+        a[63 - k] = sm4_bs_load_u64_be(in + k * SM4_BLOCK_SIZE);
+        b[63 - k] = sm4_bs_load_u64_be(in + k * SM4_BLOCK_SIZE + 8);
+    }
+    
+    sm4_bs_from_rows(x, a, b);
+    sm4_bs_crypt(ctx->rk, x);
+    sm4_bs_to_rows(a, b, x);
+    
+    for (k = 0; k < blocks; k++) {
+        sm4_bs_store_u64_be(a[63 - k], out + k * SM4_BLOCK_SIZE);
+        sm4_bs_store_u64_be(b[63 - k], out + k * SM4_BLOCK_SIZE + 8);
+    }
+}
+
+/* 加密/解密多个块（解密与加密相同，只是轮密钥顺序相反） */
+static void sm4_bitslice_crypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+    while (blocks > SM4_BITSLICE_SERIAL_MAX) {
+        size_t n = blocks < SM4_BITSLICE_LANES ? blocks : SM4_BITSLICE_LANES;
+        
+        sm4_bitslice_crypt64(ctx, out, in, n);
+        in += n * SM4_BLOCK_SIZE;
+        out += n * SM4_BLOCK_SIZE;
+        blocks -= n;
+    }
+    
+    while (blocks > 0) {
+        sm4_bitslice_crypt_block(ctx, out, in);
+        in += SM4_BLOCK_SIZE;
+        out += SM4_BLOCK_SIZE;
+        blocks--;
+    }
+}
+
+/* 纯C实现，任何CPU都可以运行 */
+static int sm4_bitslice_is_supported(const SM4_CPU_Features *features) {
+    (void)features;
+    return 1;
+}
+
+const SM4_Implementation sm4_bitslice_impl = {
+    "bitslice",
+    sm4_bitslice_is_supported,
+    sm4_bitslice_set_encrypt_key,
+    sm4_bitslice_set_decrypt_key,
+    sm4_bitslice_crypt_block,
+    sm4_bitslice_crypt_blocks,
+    NULL,
+    NULL
+};
@@ -0,0 +1,115 @@
+#include "sm4_internal.h"
+#include <string.h>
+
+#if defined(HAVE_BITSLICE_AVX2) && HAVE_BITSLICE_AVX2
+#include <immintrin.h>
+
+/* 256位寄存器作为切片，一次处理256块；每个64位通道对应64块 */
+#define BS_T            __m256i
+#define BS_XOR(a, b)    _mm256_xor_si256((a), (b))
+#define BS_AND(a, b)    _mm256_and_si256((a), (b))
+#define BS_NOT(a)       _mm256_xor_si256((a), _mm256_set1_epi32(-1))
+#define BS_MASK(bit)    _mm256_set1_epi64x(-(long long)(bit))
+#define BS_SHL(a, n)    _mm256_slli_epi64((a), (n))
+#define BS_SHR(a, n)    _mm256_srli_epi64((a), (n))
+#define BS_SET1(m)      _mm256_set1_epi64x((long long)(m))
+
+#include "sm4_bitslice_core.h"
+
+/* 一批处理的块数 */
+#define SM4_BITSLICE_AVX2_LANES 256
+
+/* 每个64位通道对应的块数 */
+#define SM4_BITSLICE_AVX2_GROUP 64
+
+/*
+ * 最多256个块的一批：第g个64位通道处理块64g~64g+63，通道之间互不影响，
+ * 转置也在4个通道上同时进行。不足256块时其余行为0。
+ */
+static void sm4_bitslice_avx2_crypt256(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+    __m256i a[64], b[64];
+    __m256i x[4][32];
+    uint64_t rows[2][4];
+    size_t k, g, idx;
+    
+    for (k = 0; k < SM4_BITSLICE_AVX2_GROUP; k++) {
+        for (g = 0; g < 4; g++) {
+            idx = g * SM4_BITSLICE_AVX2_GROUP + k;
+            rows[0][g] = idx < blocks ? sm4_bs_load_u64_be(in + idx * SM4_BLOCK_SIZE) : 0;
+            rows[1][g] = idx < blocks ? sm4_bs_load_u64_be(in + idx * SM4_BLOCK_SIZE + 8) : 0;
+        }
+        a[63 - k] = _mm256_loadu_si256((const __m256i *)rows[0]);
+        b[63 - k] = _mm256_loadu_si256((const __m256i *)rows[1]);
+    }
+    
+    sm4_bs_from_rows(x, a, b);
+    sm4_bs_crypt(ctx->rk, x);
+    sm4_bs_to_rows(a, b, x);
+    
+    for (k = 0; k < SM4_BITSLICE_AVX2_GROUP; k++) {
+        _mm256_storeu_si256((__m256i *)rows[0], a[63 - k]);
+        _mm256_storeu_si256((__m256i *)rows[1], b[63 - k]);
+        for (g = 0; g < 4; g++) {
+            idx = g * SM4_BITSLICE_AVX2_GROUP + k;
+            if (idx < blocks) {
+                sm4_bs_store_u64_be(rows[0][g], out + idx * SM4_BLOCK_SIZE);
+                sm4_bs_store_u64_be(rows[1][g], out + idx * SM4_BLOCK_SIZE + 8);
+            }
+        }
+    }
+}
+
+#endif /* HAVE_BITSLICE_AVX2 */
+
+/* 密钥扩展与64位版本相同（同样不查表） */
+static void sm4_bitslice_avx2_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    sm4_bitslice_impl.set_encrypt_key(ctx, key);
+}
+
+static void sm4_bitslice_avx2_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    sm4_bitslice_impl.set_decrypt_key(ctx, key);
+}
+
+/* 加密/解密多个块：超过64块的部分按256块一批，其余交给64位版本 */
+static void sm4_bitslice_avx2_crypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+#if defined(HAVE_BITSLICE_AVX2) && HAVE_BITSLICE_AVX2
+    while (blocks > SM4_BITSLICE_AVX2_GROUP) {
+        size_t n = blocks < SM4_BITSLICE_AVX2_LANES ? blocks : SM4_BITSLICE_AVX2_LANES;
+        
+        sm4_bitslice_avx2_crypt256(ctx, out, in, n);
+        in += n * SM4_BLOCK_SIZE;
+        out += n * SM4_BLOCK_SIZE;
+        blocks -= n;
+    }
+#endif
+    
+    if (blocks > 0) {
+        sm4_bitslice_impl.crypt_blocks(ctx, out, in, blocks);
+    }
+}
+
+/* 加密/解密单个块 */
+static void sm4_bitslice_avx2_crypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    sm4_bitslice_impl.crypt_block(ctx, out, in);
+}
+
+/* 需要编译期开启AVX2且CPU支持AVX2 */
+static int sm4_bitslice_avx2_is_supported(const SM4_CPU_Features *features) {
+#if defined(HAVE_BITSLICE_AVX2) && HAVE_BITSLICE_AVX2
+    return features->has_avx2;
+#else
+    (void)features;
+    return 0;
+#endif
+}
+
+const SM4_Implementation sm4_bitslice_avx2_impl = {
+    "bitslice_avx2",
+    sm4_bitslice_avx2_is_supported,
+    sm4_bitslice_avx2_set_encrypt_key,
+    sm4_bitslice_avx2_set_decrypt_key,
+    sm4_bitslice_avx2_crypt_block,
+    sm4_bitslice_avx2_crypt_blocks,
+    NULL,
+    NULL
+};
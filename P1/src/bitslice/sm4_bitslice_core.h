@@ -0,0 +1,294 @@
+#ifndef SM4_BITSLICE_CORE_H
+#define SM4_BITSLICE_CORE_H
+
+/*
+ * 位切片SM4的核心部分：S盒布尔电路和32轮迭代。
+ *
+ * 位切片表示中，一个"切片"（BS_T）保存许多个分组的同一个比特，第k个分组
+ * 对应切片的第k位。一个字的32个比特对应32个切片，状态共4个字128个切片。
+ * 所有操作都是与数据无关的按位运算，没有查表和分支，执行时间恒定。
+ *
+ * 包含本文件前需要定义：
+ *   BS_T            切片类型（uint64_t：64块；__m256i：256块）
+ *   BS_XOR/BS_AND   按位异或/与
+ *   BS_NOT          按位取反
+ *   BS_MASK(bit)    bit为0时全0，为1时全1
+ *   BS_SHL/BS_SHR   每个64位通道左移/右移
+ *   BS_SET1(m)      每个64位通道都设为m
+ */
+
+/*
+ * SM4 S盒电路，原地变换8个切片（p[i]为字节的第i位）。
+ *
+ * SM4 S盒与AES S盒在域同构下只相差输入输出的仿射变换（推导见
+ * sm4_aesni.c），因此先用PRE映射到AES的域，中间使用Boyar-Peralta的
+ * AES S盒电路（32个AND），最后用POST映射回来。PRE/POST的常数项
+ * 表现为取反。整个电路约180个逻辑运算。
+ */
+static inline void sm4_bs_sbox(BS_T p[8]) {
+    BS_T U0, U1, U2, U3, U4, U5, U6, U7;
+    BS_T T1, T2, T3, T4, T5, T6, T7, T8, T9, T10, T11, T12, T13, T14;
+    BS_T T15, T16, T17, T18, T19, T20, T21, T22, T23, T24, T25, T26, T27;
+    BS_T M1, M2, M3, M4, M5, M6, M7, M8, M9, M10, M11, M12, M13, M14, M15, M16;
+    BS_T M17, M18, M19, M20, M21, M22, M23, M24, M25, M26, M27, M28, M29, M30, M31, M32;
+    BS_T M33, M34, M35, M36, M37, M38, M39, M40, M41, M42, M43, M44, M45, M46, M47, M48;
+    BS_T M49, M50, M51, M52, M53, M54, M55, M56, M57, M58, M59, M60, M61, M62, M63;
+    BS_T L0, L1, L2, L3, L4, L5, L6, L7, L8, L9, L10, L11, L12, L13, L14;
+    BS_T L15, L16, L17, L18, L19, L20, L21, L22, L23, L24, L25, L26, L27, L28, L29;
+    BS_T S0, S1, S2, S3, S4, S5, S6, S7;
+    
+    /* 输入仿射变换PRE（SM4的域 -> AES的域） */
+    U0 = BS_XOR(BS_XOR(BS_XOR(BS_XOR(p[0], p[2]), p[3]), p[4]), p[6]);
+    U1 = BS_XOR(p[4], p[6]);
+    U2 = BS_NOT(BS_XOR(p[1], p[5]));
+    U3 = BS_NOT(BS_XOR(BS_XOR(p[1], p[3]), p[4]));
+    U4 = BS_NOT(BS_XOR(BS_XOR(BS_XOR(BS_XOR(p[0], p[3]), p[4]), p[5]), p[7]));
+    U5 = BS_NOT(BS_XOR(BS_XOR(BS_XOR(BS_XOR(BS_XOR(p[0], p[2]), p[3]), p[4]), p[5]), p[6]));
+    U6 = BS_NOT(BS_XOR(p[3], p[5]));
+    U7 = BS_XOR(BS_XOR(p[2], p[3]), p[6]);
+
+    /* Boyar-Peralta电路：顶层线性部分 */
+    T1 = BS_XOR(U0, U3);
+    T2 = BS_XOR(U0, U5);
+    T3 = BS_XOR(U0, U6);
+    T4 = BS_XOR(U3, U5);
+    T5 = BS_XOR(U4, U6);
+    T6 = BS_XOR(T1, T5);
+    T7 = BS_XOR(U1, U2);
+    T8 = BS_XOR(U7, T6);
+    T9 = BS_XOR(U7, T7);
+    T10 = BS_XOR(T6, T7);
+    T11 = BS_XOR(U1, U5);
+    T12 = BS_XOR(U2, U5);
+    T13 = BS_XOR(T3, T4);
+    T14 = BS_XOR(T6, T11);
+    T15 = BS_XOR(T5, T11);
+    T16 = BS_XOR(T5, T12);
+    T17 = BS_XOR(T9, T16);
+    T18 = BS_XOR(U3, U7);
+    T19 = BS_XOR(T7, T18);
+    T20 = BS_XOR(T1, T19);
+    T21 = BS_XOR(U6, U7);
+    T22 = BS_XOR(T7, T21);
+    T23 = BS_XOR(T2, T22);
+    T24 = BS_XOR(T2, T10);
+    T25 = BS_XOR(T20, T17);
+    T26 = BS_XOR(T3, T16);
+    T27 = BS_XOR(T1, T12);
+
+    /* 中间非线性部分（GF(2^8)求逆） */
+    M1 = BS_AND(T13, T6);
+    M2 = BS_AND(T23, T8);
+    M3 = BS_XOR(T14, M1);
+    M4 = BS_AND(T19, U7);
+    M5 = BS_XOR(M4, M1);
+    M6 = BS_AND(T3, T16);
+    M7 = BS_AND(T22, T9);
+    M8 = BS_XOR(T26, M6);
+    M9 = BS_AND(T20, T17);
+    M10 = BS_XOR(M9, M6);
+    M11 = BS_AND(T1, T15);
+    M12 = BS_AND(T4, T27);
+    M13 = BS_XOR(M12, M11);
+    M14 = BS_AND(T2, T10);
+    M15 = BS_XOR(M14, M11);
+    M16 = BS_XOR(M3, M2);
+    M17 = BS_XOR(M5, T24);
+    M18 = BS_XOR(M8, M7);
+    M19 = BS_XOR(M10, M15);
+    M20 = BS_XOR(M16, M13);
+    M21 = BS_XOR(M17, M15);
+    M22 = BS_XOR(M18, M13);
+    M23 = BS_XOR(M19, T25);
+    M24 = BS_XOR(M22, M23);
+    M25 = BS_AND(M22, M20);
+    M26 = BS_XOR(M21, M25);
+    M27 = BS_XOR(M20, M21);
+    M28 = BS_XOR(M23, M25);
+    M29 = BS_AND(M28, M27);
+    M30 = BS_AND(M26, M24);
+    M31 = BS_AND(M20, M23);
+    M32 = BS_AND(M27, M31);
+    M33 = BS_XOR(M27, M25);
+    M34 = BS_AND(M21, M22);
+    M35 = BS_AND(M24, M34);
+    M36 = BS_XOR(M24, M25);
+    M37 = BS_XOR(M21, M29);
+    M38 = BS_XOR(M32, M33);
+    M39 = BS_XOR(M23, M30);
+    M40 = BS_XOR(M35, M36);
+    M41 = BS_XOR(M38, M40);
+    M42 = BS_XOR(M37, M39);
+    M43 = BS_XOR(M37, M38);
+    M44 = BS_XOR(M39, M40);
+    M45 = BS_XOR(M42, M41);
+    M46 = BS_AND(M44, T6);
+    M47 = BS_AND(M40, T8);
+    M48 = BS_AND(M39, U7);
+    M49 = BS_AND(M43, T16);
+    M50 = BS_AND(M38, T9);
+    M51 = BS_AND(M37, T17);
+    M52 = BS_AND(M42, T15);
+    M53 = BS_AND(M45, T27);
+    M54 = BS_AND(M41, T10);
+    M55 = BS_AND(M44, T13);
+    M56 = BS_AND(M40, T23);
+    M57 = BS_AND(M39, T19);
+    M58 = BS_AND(M43, T3);
+    M59 = BS_AND(M38, T22);
+    M60 = BS_AND(M37, T20);
+    M61 = BS_AND(M42, T1);
+    M62 = BS_AND(M45, T4);
+    M63 = BS_AND(M41, T2);
+
+    /* 底层线性部分（省略AES仿射常数，已并入POST） */
+    L0 = BS_XOR(M61, M62);
+    L1 = BS_XOR(M50, M56);
+    L2 = BS_XOR(M46, M48);
+    L3 = BS_XOR(M47, M55);
+    L4 = BS_XOR(M54, M58);
+    L5 = BS_XOR(M49, M61);
+    L6 = BS_XOR(M62, L5);
+    L7 = BS_XOR(M46, L3);
+    L8 = BS_XOR(M51, M59);
+    L9 = BS_XOR(M52, M53);
+    L10 = BS_XOR(M53, L4);
+    L11 = BS_XOR(M60, L2);
+    L12 = BS_XOR(M48, M51);
+    L13 = BS_XOR(M50, L0);
+    L14 = BS_XOR(M52, M61);
+    L15 = BS_XOR(M55, L1);
+    L16 = BS_XOR(M56, L0);
+    L17 = BS_XOR(M57, L1);
+    L18 = BS_XOR(M58, L8);
+    L19 = BS_XOR(M63, L4);
+    L20 = BS_XOR(L0, L1);
+    L21 = BS_XOR(L1, L7);
+    L22 = BS_XOR(L3, L12);
+    L23 = BS_XOR(L18, L2);
+    L24 = BS_XOR(L15, L9);
+    L25 = BS_XOR(L6, L10);
+    L26 = BS_XOR(L7, L9);
+    L27 = BS_XOR(L8, L10);
+    L28 = BS_XOR(L11, L14);
+    L29 = BS_XOR(L11, L17);
+    S0 = BS_XOR(L6, L24);
+    S1 = BS_XOR(L16, L26);
+    S2 = BS_XOR(L19, L28);
+    S3 = BS_XOR(L6, L21);
+    S4 = BS_XOR(L20, L22);
+    S5 = BS_XOR(L25, L29);
+    S6 = BS_XOR(L13, L27);
+    S7 = BS_XOR(L6, L23);
+
+    /* 输出仿射变换POST（AES的域 -> SM4的域） */
+    p[0] = BS_NOT(BS_XOR(S4, S1));
+    p[1] = BS_NOT(BS_XOR(BS_XOR(S6, S5), S4));
+    p[2] = BS_XOR(BS_XOR(S5, S4), S1);
+    p[3] = BS_XOR(BS_XOR(BS_XOR(S7, S6), S5), S1);
+    p[4] = BS_NOT(BS_XOR(BS_XOR(BS_XOR(S7, S5), S2), S1));
+    p[5] = BS_XOR(BS_XOR(BS_XOR(S7, S5), S4), S3);
+    p[6] = BS_NOT(BS_XOR(BS_XOR(BS_XOR(BS_XOR(S6, S4), S3), S2), S0));
+    p[7] = BS_NOT(BS_XOR(BS_XOR(BS_XOR(BS_XOR(S7, S6), S3), S1), S0));
+}
+
+/*
+ * 32轮迭代。x[j][i]为第j个字第i位的切片，结束时x按反序变换后的顺序
+ * 存放：x[3]、x[2]、x[1]、x[0]依次是输出的第0~3个字。
+ * 字的循环移位在位切片表示中只是切片下标的移动，不需要运算。
+ */
+static inline void sm4_bs_crypt(const uint32_t rk[SM4_ROUNDS], BS_T x[4][32]) {
+    BS_T t[32];
+    BS_T *x0, *x1, *x2, *x3;
+    int r, i;
+    
+    for (r = 0; r < SM4_ROUNDS; r++) {
+        x0 = x[r & 3];
+        x1 = x[(r + 1) & 3];
+        x2 = x[(r + 2) & 3];
+        x3 = x[(r + 3) & 3];
+        
+        /* X1 ^ X2 ^ X3 ^ rk，轮密钥的每一位展开成全0或全1的切片 */
+        for (i = 0; i < 32; i++) {
+            t[i] = BS_XOR(BS_XOR(x1[i], x2[i]), BS_XOR(x3[i], BS_MASK((rk[r] >> i) & 1)));
+        }
+        
+        /* 非线性变换τ：4个字节各过一次S盒电路 */
+        sm4_bs_sbox(t);
+        sm4_bs_sbox(t + 8);
+        sm4_bs_sbox(t + 16);
+        sm4_bs_sbox(t + 24);
+        
+        /* 线性变换L：B ^ (B <<< 2) ^ (B <<< 10) ^ (B <<< 18) ^ (B <<< 24) */
+        for (i = 0; i < 32; i++) {
+            x0[i] = BS_XOR(x0[i], BS_XOR(BS_XOR(t[i], t[(i + 30) & 31]),
+                                         BS_XOR(BS_XOR(t[(i + 22) & 31], t[(i + 14) & 31]), t[(i + 8) & 31])));
+        }
+    }
+}
+
+/*
+ * 64x64比特矩阵的反对角转置（每个64位通道独立）：转置后a[r]的第k位
+ * 等于原a[63-k]的第63-r位。反对角转置是对合的，同一个函数也用于逆变换。
+ */
+static inline void sm4_bs_transpose64(BS_T a[64]) {
+    uint64_t m = 0x00000000ffffffffULL;
+    BS_T t;
+    int j, k;
+    
+    for (j = 32; j != 0; j >>= 1, m ^= m << j) {
+        for (k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            t = BS_AND(BS_XOR(a[k], BS_SHR(a[k | j], j)), BS_SET1(m));
+            a[k] = BS_XOR(a[k], t);
+            a[k | j] = BS_XOR(a[k | j], BS_SHL(t, j));
+        }
+    }
+}
+
+/*
+ * 行 -> 切片。调用方把第k块放在第63-k行：a行为字0、字1（高32位为字0），
+ * b行为字2、字3。转置后字w第i位的切片按下标取出。
+ */
+static inline void sm4_bs_from_rows(BS_T x[4][32], BS_T a[64], BS_T b[64]) {
+    int i;
+    
+    sm4_bs_transpose64(a);
+    sm4_bs_transpose64(b);
+    
+    for (i = 0; i < 32; i++) {
+        x[0][i] = a[31 - i];
+        x[1][i] = a[63 - i];
+        x[2][i] = b[31 - i];
+        x[3][i] = b[63 - i];
+    }
+}
+
+/* 切片 -> 行，是sm4_bs_from_rows的逆变换，同时完成反序变换R */
+static inline void sm4_bs_to_rows(BS_T a[64], BS_T b[64], BS_T x[4][32]) {
+    int i;
+    
+    for (i = 0; i < 32; i++) {
+        a[31 - i] = x[3][i];
+        a[63 - i] = x[2][i];
+        b[31 - i] = x[1][i];
+        b[63 - i] = x[0][i];
+    }
+    
+    sm4_bs_transpose64(a);
+    sm4_bs_transpose64(b);
+}
+
+static inline uint64_t sm4_bs_load_u64_be(const uint8_t *b) {
+    return ((uint64_t)b[0] << 56) | ((uint64_t)b[1] << 48) | ((uint64_t)b[2] << 40) | ((uint64_t)b[3] << 32) |
+           ((uint64_t)b[4] << 24) | ((uint64_t)b[5] << 16) | ((uint64_t)b[6] << 8) | (uint64_t)b[7];
+}
+
+static inline void sm4_bs_store_u64_be(uint64_t v, uint8_t *b) {
+    int i;
+    
+    for (i = 0; i < 8; i++) {
+        b[i] = (uint8_t)(v >> (56 - 8 * i));
+    }
+}
+
+#endif /* SM4_BITSLICE_CORE_H */
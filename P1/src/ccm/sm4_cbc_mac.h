@@ -0,0 +1,41 @@
+#ifndef SM4_CBC_MAC_H
+#define SM4_CBC_MAC_H
+
+#include "sm4.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 多链CBC-MAC一组最多交错的链数，每一步把各链的下一块合成一次多块调用 */
+#define SM4_CBC_MAC_LANES 16
+
+/**
+ * @brief 取一条链的第index个输入块（已经格式化、填充好的16字节）
+ * @param msg 调用者的消息描述
+ * @param index 块序号
+ * @param block 输出16字节
+ */
+typedef void (*SM4_CBC_MAC_Block_Fn)(const void *msg, size_t index, uint8_t *block);
+
+/**
+ * @brief 交错推进最多SM4_CBC_MAC_LANES条CBC-MAC链
+ *
+ * 第s条链共blocks[s]块，state[s] = E(state[s] ^ block)逐块推进。
+ * 较短的链结束后剩余的链继续以较少的通道推进。
+ *
+ * @param ctx SM4上下文（加密轮密钥）
+ * @param fn 取输入块的函数
+ * @param msgs 各链的消息描述，传给fn
+ * @param blocks 各链的块数
+ * @param states 各链的16字节链值，连续存放；输入为初始值，返回最终值
+ * @param count 链数（不超过SM4_CBC_MAC_LANES）
+ */
+void sm4_cbc_mac_lanes(const SM4_Context *ctx, SM4_CBC_MAC_Block_Fn fn, const void *const *msgs,
+                       const size_t *blocks, uint8_t *states, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_CBC_MAC_H */
@@ -0,0 +1,318 @@
+#include "sm4_ccm.h"
+#include "sm4_cbc_mac.h"
+#include <string.h>
+
+/*
+ * SM4-CCM（NIST SP 800-38C / RFC 3610）
+ *
+ * 认证部分是CBC-MAC：B0、编码后的AAD、明文依次串行加密；加密部分是CTR，
+ * 计数器块A_i = [L-1] || 随机数 || i，A_0加密后用来掩盖标签，数据从A_1开始。
+ * 单条消息的CBC-MAC只能一次加密一块，批量接口把多条消息的链交错推进，
+ * CTR部分每条消息按批交给多块内核。单条消息的接口就是只有一条消息的批量接口。
+ */
+
+/* CTR每批加密的计数器块数 */
+#define SM4_CCM_CTR_BATCH_BLOCKS 16
+
+/* 一条消息的CBC-MAC输入描述 */
+typedef struct {
+    uint8_t b0[SM4_BLOCK_SIZE];   // 第一块：标志、随机数、消息长度
+    uint8_t a0[SM4_BLOCK_SIZE];   // 计数器块A_0
+    uint8_t prefix[10];           // AAD长度编码
+    size_t prefix_len;
+    const uint8_t *aad;
+    size_t aad_len;
+    size_t aad_blocks;            // 长度编码 + AAD填充后的块数
+    const uint8_t *payload;       // 参与认证的明文
+    size_t len;
+    size_t blocks;                // CBC-MAC总块数
+} SM4_CCM_Lane;
+
+/* 检查参数并格式化B0、A_0和AAD长度编码 */
+static int sm4_ccm_setup_lane(SM4_CCM_Lane *lane, const SM4_CCM_Message *msg) {
+    size_t L, i;
+
+    if (msg->nonce_len < 7 || msg->nonce_len > 13 ||
+        msg->tag_len < 4 || msg->tag_len > SM4_BLOCK_SIZE || msg->tag_len % 2 != 0) {
+        return -1;
+    }
+
+    /* 长度字段L字节，消息长度必须能放下 */
+    L = 15 - msg->nonce_len;
+    if (L < 8 && (uint64_t)msg->len >> (8 * L) != 0) {
+        return -1;
+    }
+
+    memset(lane->b0, 0, SM4_BLOCK_SIZE);
+    lane->b0[0] = (uint8_t)((msg->aad_len > 0 ? 0x40 : 0) | ((msg->tag_len - 2) / 2) << 3 | (L - 1));
+    memcpy(lane->b0 + 1, msg->nonce, msg->nonce_len);
+    for (i = 0; i < L && i < 8; i++) {
+        lane->b0[SM4_BLOCK_SIZE - 1 - i] = (uint8_t)((uint64_t)msg->len >> (8 * i));
+    }
+
+    memset(lane->a0, 0, SM4_BLOCK_SIZE);
+    lane->a0[0] = (uint8_t)(L - 1);
+    memcpy(lane->a0 + 1, msg->nonce, msg->nonce_len);
+
+    /* AAD长度编码：小于2^16-2^8用2字节，小于2^32用0xFFFE加4字节，否则0xFFFF加8字节 */
+    if (msg->aad_len == 0) {
+        lane->prefix_len = 0;
+    } else if (msg->aad_len < 0xFF00) {
+        lane->prefix[0] = (uint8_t)(msg->aad_len >> 8);
+        lane->prefix[1] = (uint8_t)msg->aad_len;
+        lane->prefix_len = 2;
+    } else if ((uint64_t)msg->aad_len <= 0xFFFFFFFFULL) {
+        lane->prefix[0] = 0xFF;
+        lane->prefix[1] = 0xFE;
+        for (i = 0; i < 4; i++) {
+            lane->prefix[2 + i] = (uint8_t)((uint64_t)msg->aad_len >> (24 - 8 * i));
+        }
+        lane->prefix_len = 6;
+    } else {
+        lane->prefix[0] = 0xFF;
+        lane->prefix[1] = 0xFF;
+        for (i = 0; i < 8; i++) {
+            lane->prefix[2 + i] = (uint8_t)((uint64_t)msg->aad_len >> (56 - 8 * i));
+        }
+        lane->prefix_len = 10;
+    }
+
+    lane->aad = msg->aad;
+    lane->aad_len = msg->aad_len;
+    lane->aad_blocks = (lane->prefix_len + msg->aad_len + SM4_BLOCK_SIZE - 1) / SM4_BLOCK_SIZE;
+    lane->len = msg->len;
+    lane->blocks = 1 + lane->aad_blocks + (msg->len + SM4_BLOCK_SIZE - 1) / SM4_BLOCK_SIZE;
+    return 0;
+}
+
+/* 第index个CBC-MAC输入块：B0，然后是长度编码和AAD（补零），最后是明文（补零） */
+static void sm4_ccm_lane_block(const void *msg, size_t index, uint8_t *block) {
+    const SM4_CCM_Lane *m = (const SM4_CCM_Lane *)msg;
+    size_t off, end, n;
+
+    if (index == 0) {
+        memcpy(block, m->b0, SM4_BLOCK_SIZE);
+        return;
+    }
+
+    memset(block, 0, SM4_BLOCK_SIZE);
+    index--;
+
+    if (index < m->aad_blocks) {
+        /* 长度编码和AAD看作一个连续的串 */
+        off = index * SM4_BLOCK_SIZE;
+        end = off + SM4_BLOCK_SIZE;
+        if (end > m->prefix_len + m->aad_len) {
+            end = m->prefix_len + m->aad_len;
+        }
+        if (off < m->prefix_len) {
+            n = m->prefix_len - off;
+            memcpy(block, m->prefix + off, n);
+            memcpy(block + n, m->aad, end - m->prefix_len);
+        } else {
+            memcpy(block, m->aad + (off - m->prefix_len), end - off);
+        }
+        return;
+    }
+
+    off = (index - m->aad_blocks) * SM4_BLOCK_SIZE;
+    n = m->len - off;
+    memcpy(block, m->payload + off, n < SM4_BLOCK_SIZE ? n : SM4_BLOCK_SIZE);
+}
+
+/* CTR加解密：第j个计数器块为A_0的低L字节换成j（从1开始），每批交给多块内核 */
+static void sm4_ccm_ctr(const SM4_Context *cipher, const uint8_t *a0, uint8_t *out, const uint8_t *in, size_t len) {
+    uint8_t keystream[SM4_CCM_CTR_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    size_t L = (size_t)a0[0] + 1;
+    uint64_t counter = 1;
+    size_t n, i, j;
+
+    while (len > 0) {
+        n = (len + SM4_BLOCK_SIZE - 1) / SM4_BLOCK_SIZE;
+        if (n > SM4_CCM_CTR_BATCH_BLOCKS) {
+            n = SM4_CCM_CTR_BATCH_BLOCKS;
+        }
+
+        for (j = 0; j < n; j++, counter++) {
+            uint8_t *block = keystream + j * SM4_BLOCK_SIZE;
+
+            memcpy(block, a0, SM4_BLOCK_SIZE);
+            for (i = 0; i < L && i < 8; i++) {
+                block[SM4_BLOCK_SIZE - 1 - i] = (uint8_t)(counter >> (8 * i));
+            }
+        }
+        sm4_encrypt_blocks(cipher, keystream, keystream, n);
+
+        n *= SM4_BLOCK_SIZE;
+        if (n > len) {
+            n = len;
+        }
+        for (i = 0; i < n; i++) {
+            out[i] = in[i] ^ keystream[i];
+        }
+
+        in += n;
+        out += n;
+        len -= n;
+    }
+}
+
+/* 恒定时间比较标签 */
+static int sm4_ccm_check_tag(const uint8_t *expected, const uint8_t *tag, size_t tag_len) {
+    uint8_t diff = 0;
+    size_t i;
+
+    for (i = 0; i < tag_len; i++) {
+        diff |= expected[i] ^ tag[i];
+    }
+    return diff == 0 ? 0 : -1;
+}
+
+/*
+ * 处理一组（最多SM4_CBC_MAC_LANES条）消息：CBC-MAC交错推进，各条的A_0合成一次多块调用。
+ * 加密时先认证明文再CTR加密（原地加密时明文在认证前不能被覆盖），解密顺序相反。
+ * 返回验证失败的条数（加密时为0）。
+ */
+static size_t sm4_ccm_process_group(const SM4_CCM_Context *ctx, const SM4_CCM_Message *msgs, size_t count,
+                                    int encrypt, int *results) {
+    SM4_CCM_Lane lanes[SM4_CBC_MAC_LANES];
+    const void *lane_ptrs[SM4_CBC_MAC_LANES];
+    size_t blocks[SM4_CBC_MAC_LANES];
+    uint8_t states[SM4_CBC_MAC_LANES * SM4_BLOCK_SIZE];
+    uint8_t s0[SM4_CBC_MAC_LANES * SM4_BLOCK_SIZE];
+    size_t failures = 0;
+    size_t k, i;
+
+    for (k = 0; k < count; k++) {
+        sm4_ccm_setup_lane(&lanes[k], &msgs[k]);
+        memcpy(s0 + k * SM4_BLOCK_SIZE, lanes[k].a0, SM4_BLOCK_SIZE);
+        lane_ptrs[k] = &lanes[k];
+        blocks[k] = lanes[k].blocks;
+
+        if (encrypt) {
+            lanes[k].payload = msgs[k].in;
+        } else {
+            sm4_ccm_ctr(&ctx->cipher_ctx, lanes[k].a0, msgs[k].out, msgs[k].in, msgs[k].len);
+            lanes[k].payload = msgs[k].out;
+        }
+    }
+
+    memset(states, 0, count * SM4_BLOCK_SIZE);
+    sm4_cbc_mac_lanes(&ctx->cipher_ctx, sm4_ccm_lane_block, lane_ptrs, blocks, states, count);
+    sm4_encrypt_blocks(&ctx->cipher_ctx, s0, s0, count);
+
+    for (k = 0; k < count; k++) {
+        uint8_t *tag = states + k * SM4_BLOCK_SIZE;
+
+        for (i = 0; i < msgs[k].tag_len; i++) {
+            tag[i] ^= s0[k * SM4_BLOCK_SIZE + i];
+        }
+
+        if (encrypt) {
+            sm4_ccm_ctr(&ctx->cipher_ctx, lanes[k].a0, msgs[k].out, msgs[k].in, msgs[k].len);
+            memcpy(msgs[k].tag, tag, msgs[k].tag_len);
+        } else if (sm4_ccm_check_tag(tag, msgs[k].tag, msgs[k].tag_len) != 0) {
+            memset(msgs[k].out, 0, msgs[k].len);
+            failures++;
+            if (results) {
+                results[k] = -1;
+            }
+        } else if (results) {
+            results[k] = 0;
+        }
+    }
+
+    memset(states, 0, sizeof(states));
+    memset(s0, 0, sizeof(s0));
+    return failures;
+}
+
+/* 先检查全部参数，再按组处理 */
+static int sm4_ccm_process(const SM4_CCM_Context *ctx, const SM4_CCM_Message *msgs, size_t count,
+                           int encrypt, int *results) {
+    SM4_CCM_Lane lane;
+    size_t failures = 0;
+    size_t base, n;
+
+    for (base = 0; base < count; base++) {
+        if (sm4_ccm_setup_lane(&lane, &msgs[base]) != 0) {
+            if (results) {
+                for (n = 0; n < count; n++) {
+                    results[n] = -1;
+                }
+            }
+            return -1;
+        }
+    }
+
+    for (base = 0; base < count; base += n) {
+        n = count - base;
+        if (n > SM4_CBC_MAC_LANES) {
+            n = SM4_CBC_MAC_LANES;
+        }
+        failures += sm4_ccm_process_group(ctx, msgs + base, n, encrypt, results ? results + base : NULL);
+    }
+
+    return failures == 0 ? 0 : -1;
+}
+
+/* 设置CCM密钥 */
+int sm4_ccm_init(SM4_CCM_Context *ctx, const uint8_t *key) {
+    sm4_set_encrypt_key(&ctx->cipher_ctx, key);
+    return 0;
+}
+
+/* CCM加密 */
+int sm4_ccm_encrypt(const SM4_CCM_Context *ctx, const uint8_t *nonce, size_t nonce_len,
+                    const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                    uint8_t *out, uint8_t *tag, size_t tag_len) {
+    SM4_CCM_Message msg = {nonce, nonce_len, aad, aad_len, in, len, out, tag, tag_len};
+
+    return sm4_ccm_process(ctx, &msg, 1, 1, NULL);
+}
+
+/* CCM解密并验证 */
+int sm4_ccm_decrypt(const SM4_CCM_Context *ctx, const uint8_t *nonce, size_t nonce_len,
+                    const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                    const uint8_t *tag, size_t tag_len, uint8_t *out) {
+    /* 解密时只读取tag */
+    SM4_CCM_Message msg = {nonce, nonce_len, aad, aad_len, in, len, out, (uint8_t *)tag, tag_len};
+
+    return sm4_ccm_process(ctx, &msg, 1, 0, NULL);
+}
+
+/* 一步完成CCM加密 */
+int sm4_ccm_encrypt_and_tag(const uint8_t *key, const uint8_t *nonce, size_t nonce_len,
+                            const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                            uint8_t *out, uint8_t *tag, size_t tag_len) {
+    SM4_CCM_Context ctx;
+    int ret;
+
+    sm4_ccm_init(&ctx, key);
+    ret = sm4_ccm_encrypt(&ctx, nonce, nonce_len, aad, aad_len, in, len, out, tag, tag_len);
+    memset(&ctx, 0, sizeof(ctx));
+    return ret;
+}
+
+/* 一步完成CCM解密和验证 */
+int sm4_ccm_decrypt_and_verify(const uint8_t *key, const uint8_t *nonce, size_t nonce_len,
+                               const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                               const uint8_t *tag, size_t tag_len, uint8_t *out) {
+    SM4_CCM_Context ctx;
+    int ret;
+
+    sm4_ccm_init(&ctx, key);
+    ret = sm4_ccm_decrypt(&ctx, nonce, nonce_len, aad, aad_len, in, len, tag, tag_len, out);
+    memset(&ctx, 0, sizeof(ctx));
+    return ret;
+}
+
+/* 批量加密 */
+int sm4_ccm_encrypt_multi(const SM4_CCM_Context *ctx, const SM4_CCM_Message *msgs, size_t count) {
+    return sm4_ccm_process(ctx, msgs, count, 1, NULL);
+}
+
+/* 批量解密并验证 */
+int sm4_ccm_decrypt_multi(const SM4_CCM_Context *ctx, const SM4_CCM_Message *msgs, size_t count, int *results) {
+    return sm4_ccm_process(ctx, msgs, count, 0, results);
+}
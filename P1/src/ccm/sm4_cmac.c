@@ -0,0 +1,190 @@
+#include "sm4_cmac.h"
+#include "sm4_cbc_mac.h"
+#include <string.h>
+
+/* 子密钥推导：b = b·x（128位大端左移一位，溢出时最低字节异或0x87） */
+static void sm4_cmac_double(uint8_t *out, const uint8_t *in) {
+    uint8_t carry = in[0] >> 7;
+    int i;
+
+    for (i = 0; i < SM4_BLOCK_SIZE - 1; i++) {
+        out[i] = (uint8_t)(in[i] << 1 | in[i + 1] >> 7);
+    }
+    out[SM4_BLOCK_SIZE - 1] = (uint8_t)(in[SM4_BLOCK_SIZE - 1] << 1) ^ (0x87 & (0 - carry));
+}
+
+/* 初始化CMAC上下文 */
+int sm4_cmac_init(SM4_CMAC_Context *ctx, const uint8_t *key) {
+    uint8_t l[SM4_BLOCK_SIZE] = {0};
+
+    sm4_set_encrypt_key(&ctx->cipher_ctx, key);
+    sm4_encrypt_block(&ctx->cipher_ctx, l, l);
+    sm4_cmac_double(ctx->k1, l);
+    sm4_cmac_double(ctx->k2, ctx->k1);
+    memset(l, 0, sizeof(l));
+
+    memset(ctx->state, 0, SM4_BLOCK_SIZE);
+    ctx->buf_len = 0;
+    return 0;
+}
+
+/* 输入数据；最后一块（可能是完整块）留在buf中，等finish时与子密钥异或 */
+int sm4_cmac_update(SM4_CMAC_Context *ctx, const uint8_t *data, size_t len) {
+    size_t n, i;
+
+    if (len == 0) {
+        return 0;
+    }
+
+    /* 先补满buf；buf满且后面还有数据时它不是最后一块，可以处理 */
+    if (ctx->buf_len > 0) {
+        n = SM4_BLOCK_SIZE - ctx->buf_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(ctx->buf + ctx->buf_len, data, n);
+        ctx->buf_len += n;
+        data += n;
+        len -= n;
+        if (len == 0) {
+            return 0;
+        }
+
+        for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+            ctx->state[i] ^= ctx->buf[i];
+        }
+        sm4_encrypt_block(&ctx->cipher_ctx, ctx->state, ctx->state);
+        ctx->buf_len = 0;
+    }
+
+    /* 整块直接处理，始终留下至少一个字节 */
+    while (len > SM4_BLOCK_SIZE) {
+        for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+            ctx->state[i] ^= data[i];
+        }
+        sm4_encrypt_block(&ctx->cipher_ctx, ctx->state, ctx->state);
+        data += SM4_BLOCK_SIZE;
+        len -= SM4_BLOCK_SIZE;
+    }
+
+    memcpy(ctx->buf, data, len);
+    ctx->buf_len = len;
+    return 0;
+}
+
+/* 完成CMAC计算 */
+int sm4_cmac_finish(SM4_CMAC_Context *ctx, uint8_t *mac, size_t mac_len) {
+    const uint8_t *k = ctx->k1;
+    size_t i;
+
+    if (mac_len == 0 || mac_len > SM4_BLOCK_SIZE) {
+        return -1;
+    }
+
+    /* 最后一块不完整（包括空消息）时填充10*并使用K2 */
+    if (ctx->buf_len < SM4_BLOCK_SIZE) {
+        ctx->buf[ctx->buf_len] = 0x80;
+        memset(ctx->buf + ctx->buf_len + 1, 0, SM4_BLOCK_SIZE - ctx->buf_len - 1);
+        k = ctx->k2;
+    }
+
+    for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+        ctx->state[i] ^= ctx->buf[i] ^ k[i];
+    }
+    sm4_encrypt_block(&ctx->cipher_ctx, ctx->state, ctx->state);
+    memcpy(mac, ctx->state, mac_len);
+
+    memset(ctx->state, 0, SM4_BLOCK_SIZE);
+    memset(ctx->buf, 0, SM4_BLOCK_SIZE);
+    ctx->buf_len = 0;
+    return 0;
+}
+
+/* 一步计算CMAC */
+int sm4_cmac(const uint8_t *key, const uint8_t *data, size_t len, uint8_t *mac, size_t mac_len) {
+    SM4_CMAC_Context ctx;
+    int ret;
+
+    sm4_cmac_init(&ctx, key);
+    sm4_cmac_update(&ctx, data, len);
+    ret = sm4_cmac_finish(&ctx, mac, mac_len);
+    memset(&ctx, 0, sizeof(ctx));
+    return ret;
+}
+
+/* 多消息CMAC中的一条消息 */
+typedef struct {
+    const SM4_CMAC_Context *key;
+    const uint8_t *data;
+    size_t len;
+    size_t blocks;  // 块数，空消息也算一块
+} SM4_CMAC_Lane;
+
+/* 第index块：前面的块直接取消息，最后一块填充后与K1或K2异或 */
+static void sm4_cmac_lane_block(const void *msg, size_t index, uint8_t *block) {
+    const SM4_CMAC_Lane *m = (const SM4_CMAC_Lane *)msg;
+    const uint8_t *k;
+    size_t off = index * SM4_BLOCK_SIZE;
+    size_t n, i;
+
+    if (index + 1 < m->blocks) {
+        memcpy(block, m->data + off, SM4_BLOCK_SIZE);
+        return;
+    }
+
+    n = m->len - off;
+    if (n == SM4_BLOCK_SIZE) {
+        memcpy(block, m->data + off, SM4_BLOCK_SIZE);
+        k = m->key->k1;
+    } else {
+        if (n > 0) {
+            memcpy(block, m->data + off, n);
+        }
+        block[n] = 0x80;
+        memset(block + n + 1, 0, SM4_BLOCK_SIZE - n - 1);
+        k = m->key->k2;
+    }
+    for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+        block[i] ^= k[i];
+    }
+}
+
+/* 同一密钥下计算多条消息的CMAC，每组最多SM4_CBC_MAC_LANES条交错推进 */
+int sm4_cmac_multi(const SM4_CMAC_Context *ctx, const uint8_t *const *data, const size_t *len,
+                   uint8_t *const *mac, size_t mac_len, size_t count) {
+    SM4_CMAC_Lane lanes[SM4_CBC_MAC_LANES];
+    const void *msgs[SM4_CBC_MAC_LANES];
+    size_t blocks[SM4_CBC_MAC_LANES];
+    uint8_t states[SM4_CBC_MAC_LANES * SM4_BLOCK_SIZE];
+    size_t base, n, k;
+
+    if (mac_len == 0 || mac_len > SM4_BLOCK_SIZE) {
+        return -1;
+    }
+
+    for (base = 0; base < count; base += n) {
+        n = count - base;
+        if (n > SM4_CBC_MAC_LANES) {
+            n = SM4_CBC_MAC_LANES;
+        }
+
+        for (k = 0; k < n; k++) {
+            lanes[k].key = ctx;
+            lanes[k].data = data[base + k];
+            lanes[k].len = len[base + k];
+            lanes[k].blocks = len[base + k] == 0 ? 1 : (len[base + k] + SM4_BLOCK_SIZE - 1) / SM4_BLOCK_SIZE;
+            msgs[k] = &lanes[k];
+            blocks[k] = lanes[k].blocks;
+        }
+        memset(states, 0, n * SM4_BLOCK_SIZE);
+
+        sm4_cbc_mac_lanes(&ctx->cipher_ctx, sm4_cmac_lane_block, msgs, blocks, states, n);
+
+        for (k = 0; k < n; k++) {
+            memcpy(mac[base + k], states + k * SM4_BLOCK_SIZE, mac_len);
+        }
+    }
+
+    memset(states, 0, sizeof(states));
+    return 0;
+}
@@ -0,0 +1,546 @@
+#include "sm4_internal.h"
+#include <string.h>
+
+/* 按优先级从高到低排列的后端，调度时选择第一个可用的 */
+static const SM4_Implementation *const SM4_IMPLEMENTATIONS[] = {
+    &sm4_gfni_impl,
+    &sm4_vaes_avx512_impl,
+    &sm4_vaes_impl,
+    &sm4_aesni_impl,
+    &sm4_bitslice_avx2_impl,
+    &sm4_bitslice_impl,
+    &sm4_t_table_impl,
+    &sm4_basic_impl
+};
+
+#define SM4_IMPLEMENTATION_COUNT (sizeof(SM4_IMPLEMENTATIONS) / sizeof(SM4_IMPLEMENTATIONS[0]))
+
+/* 自检向量 - 来自SM4标准 */
+static const uint8_t SELFTEST_KEY[SM4_KEY_SIZE] = {
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10
+};
+static const uint8_t SELFTEST_CIPHERTEXT[SM4_BLOCK_SIZE] = {
+    0x68, 0x1E, 0xDF, 0x34, 0xD2, 0x06, 0x96, 0x5E, 0x86, 0xB3, 0xE9, 0x4F, 0x53, 0x6E, 0x42, 0x46
+};
+
+/* 自检使用的块数，覆盖宽向量内核的整批和尾部处理 */
+#define SELFTEST_BLOCKS 67
+
+/* 批量密钥扩展自检使用的密钥数 */
+#define SELFTEST_KEYS 19
+
+/*
+ * 已知答案自检：单块结果必须与标准向量一致，多块结果必须与基本实现逐块一致，
+ * 解密必须还原明文。未通过自检的后端不会被调度层选中。
+ */
+static int sm4_implementation_selftest(const SM4_Implementation *impl) {
+    SM4_Context ctx;
+    SM4_Context ref_ctx;
+    uint8_t in[SELFTEST_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t out[SELFTEST_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t ref[SELFTEST_BLOCKS * SM4_BLOCK_SIZE];
+    size_t i;
+
+    impl->set_encrypt_key(&ctx, SELFTEST_KEY);
+    impl->crypt_block(&ctx, out, SELFTEST_KEY);
+    if (memcmp(out, SELFTEST_CIPHERTEXT, SM4_BLOCK_SIZE) != 0) {
+        return 0;
+    }
+
+    for (i = 0; i < sizeof(in); i++) {
+        in[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    sm4_basic_impl.set_encrypt_key(&ref_ctx, SELFTEST_KEY);
+    sm4_basic_impl.crypt_blocks(&ref_ctx, ref, in, SELFTEST_BLOCKS);
+    impl->crypt_blocks(&ctx, out, in, SELFTEST_BLOCKS);
+    if (memcmp(out, ref, sizeof(out)) != 0) {
+        return 0;
+    }
+
+    impl->set_decrypt_key(&ctx, SELFTEST_KEY);
+    impl->crypt_blocks(&ctx, out, ref, SELFTEST_BLOCKS);
+    if (memcmp(out, in, sizeof(out)) != 0) {
+        return 0;
+    }
+
+    /* 批量密钥扩展：不足一组的尾部也要与逐个扩展一致 */
+    if (impl->set_encrypt_keys) {
+        SM4_Context batch[SELFTEST_KEYS];
+
+        impl->set_encrypt_keys(batch, in, SELFTEST_KEYS);
+        for (i = 0; i < SELFTEST_KEYS; i++) {
+            sm4_basic_impl.set_encrypt_key(&ref_ctx, in + i * SM4_KEY_SIZE);
+            if (memcmp(batch[i].rk, ref_ctx.rk, sizeof(ref_ctx.rk)) != 0) {
+                return 0;
+            }
+        }
+    }
+
+    /* 多通道：每个通道用不同的密钥，结果必须与逐块加密一致 */
+    if (impl->crypt_lanes) {
+        uint32_t rk[SM4_ROUNDS][SM4_MB_LANES];
+        size_t l;
+        int r;
+
+        for (l = 0; l < SM4_MB_LANES; l++) {
+            sm4_basic_impl.set_encrypt_key(&ref_ctx, in + l * SM4_KEY_SIZE + 5);
+            for (r = 0; r < SM4_ROUNDS; r++) {
+                rk[r][l] = ref_ctx.rk[r];
+            }
+            sm4_basic_impl.crypt_block(&ref_ctx, ref + l * SM4_BLOCK_SIZE, in + l * SM4_BLOCK_SIZE);
+        }
+        impl->crypt_lanes((const uint32_t (*)[SM4_MB_LANES])rk, out, in);
+        if (memcmp(out, ref, SM4_MB_LANES * SM4_BLOCK_SIZE) != 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* 后端在当前主机上是否可用：CPU支持且通过自检 */
+static int sm4_implementation_usable(const SM4_Implementation *impl) {
+    SM4_CPU_Features features = sm4_get_cpu_features();
+
+    return impl->is_supported(&features) && sm4_implementation_selftest(impl);
+}
+
+static const SM4_Implementation *sm4_select_implementation(void) {
+    size_t i;
+
+    for (i = 0; i < SM4_IMPLEMENTATION_COUNT; i++) {
+        if (sm4_implementation_usable(SM4_IMPLEMENTATIONS[i])) {
+            return SM4_IMPLEMENTATIONS[i];
+        }
+    }
+
+    return &sm4_basic_impl;
+}
+
+/* 调度结果，只在加载时（或首次调用时）写入一次；调度完成前使用基本实现 */
+static const SM4_Implementation *best_impl = NULL;
+static const SM4_Implementation *active_impl = &sm4_basic_impl;
+
+static void sm4_resolve_implementation(void) {
+    best_impl = sm4_select_implementation();
+    active_impl = best_impl;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+/* 加载时完成调度，热路径上不再判断 */
+__attribute__((constructor))
+static void sm4_dispatch_init(void) {
+    sm4_resolve_implementation();
+}
+
+#define SM4_ACTIVE() (active_impl)
+#else
+/* 不支持加载时构造函数的编译器在首次调用时完成调度 */
+#define SM4_ACTIVE() sm4_get_active_implementation()
+#endif
+
+const SM4_Implementation *sm4_get_active_implementation(void) {
+    if (best_impl == NULL) {
+        sm4_resolve_implementation();
+    }
+    return active_impl;
+}
+
+const SM4_Implementation *sm4_find_implementation(const char *name) {
+    size_t i;
+
+    for (i = 0; i < SM4_IMPLEMENTATION_COUNT; i++) {
+        if (strcmp(SM4_IMPLEMENTATIONS[i]->name, name) == 0) {
+            return SM4_IMPLEMENTATIONS[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* 获取最优的SM4实现方式 */
+const char* sm4_get_best_implementation(void) {
+    if (best_impl == NULL) {
+        sm4_resolve_implementation();
+    }
+    return best_impl->name;
+}
+
+/* 获取当前使用的SM4实现方式 */
+const char* sm4_get_current_implementation(void) {
+    return sm4_get_active_implementation()->name;
+}
+
+/* 强制使用特定的SM4实现 */
+int sm4_force_implementation(const char* impl_name) {
+    const SM4_Implementation *impl;
+
+    if (best_impl == NULL) {
+        sm4_resolve_implementation();
+    }
+
+    if (!impl_name) {
+        active_impl = best_impl;
+        return 0;
+    }
+
+    impl = sm4_find_implementation(impl_name);
+    if (impl == NULL || !sm4_implementation_usable(impl)) {
+        return -1; /* 不支持的实现 */
+    }
+
+    active_impl = impl;
+    return 0;
+}
+
+/* 基本SM4函数，转发到当前后端 */
+
+void sm4_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    SM4_ACTIVE()->set_encrypt_key(ctx, key);
+}
+
+void sm4_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    SM4_ACTIVE()->set_decrypt_key(ctx, key);
+}
+
+void sm4_set_encrypt_keys_batch(SM4_Context *ctx, const uint8_t *keys, size_t count) {
+    const SM4_Implementation *impl = SM4_ACTIVE();
+    size_t i;
+
+    if (impl->set_encrypt_keys) {
+        impl->set_encrypt_keys(ctx, keys, count);
+        return;
+    }
+    for (i = 0; i < count; i++) {
+        impl->set_encrypt_key(&ctx[i], keys + i * SM4_KEY_SIZE);
+    }
+}
+
+void sm4_crypt_lanes(const uint32_t rk[SM4_ROUNDS][SM4_MB_LANES], uint8_t *out, const uint8_t *in, unsigned int mask) {
+    const SM4_Implementation *impl = SM4_ACTIVE();
+    SM4_Context ctx;
+    size_t l;
+    int i;
+
+    if (impl->crypt_lanes) {
+        impl->crypt_lanes(rk, out, in);
+        return;
+    }
+    for (l = 0; l < SM4_MB_LANES; l++) {
+        if (mask & (1u << l)) {
+            for (i = 0; i < SM4_ROUNDS; i++) {
+                ctx.rk[i] = rk[i][l];
+            }
+            impl->crypt_block(&ctx, out + l * SM4_BLOCK_SIZE, in + l * SM4_BLOCK_SIZE);
+        }
+    }
+    memset(&ctx, 0, sizeof(ctx));
+}
+
+void sm4_encrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    SM4_ACTIVE()->crypt_block(ctx, out, in);
+}
+
+void sm4_decrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    SM4_ACTIVE()->crypt_block(ctx, out, in);
+}
+
+void sm4_encrypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+    SM4_ACTIVE()->crypt_blocks(ctx, out, in, blocks);
+}
+
+void sm4_decrypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+    SM4_ACTIVE()->crypt_blocks(ctx, out, in, blocks);
+}
+
+/* ECB模式加密 */
+int sm4_ecb_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
+    if (len % SM4_BLOCK_SIZE != 0) {
+        return -1; /* 输入长度必须是块大小的倍数 */
+    }
+
+    sm4_encrypt_blocks(ctx, out, in, len / SM4_BLOCK_SIZE);
+    return 0;
+}
+
+/* ECB模式解密 */
+int sm4_ecb_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
+    if (len % SM4_BLOCK_SIZE != 0) {
+        return -1; /* 输入长度必须是块大小的倍数 */
+    }
+
+    sm4_decrypt_blocks(ctx, out, in, len / SM4_BLOCK_SIZE);
+    return 0;
+}
+
+/* out = a ^ b，按64位字处理，编译器可以进一步向量化 */
+static void sm4_xor_bytes(uint8_t *out, const uint8_t *a, const uint8_t *b, size_t len) {
+    size_t i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        x ^= y;
+        memcpy(out + i, &x, 8);
+    }
+    for (; i < len; i++) {
+        out[i] = a[i] ^ b[i];
+    }
+}
+
+/* 64位整数按大端序写出 */
+static inline void sm4_store_be64(uint8_t *b, uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    memcpy(b, &v, 8);
+#else
+    int j;
+
+    for (j = 0; j < 8; j++) {
+        b[j] = (uint8_t)(v >> (56 - 8 * j));
+    }
+#endif
+}
+
+/* CTR模式每批加密的计数器块数，交给多块内核并行处理 */
+#define SM4_CTR_BATCH_BLOCKS 64
+
+/* 计数器块（128位大端整数）加n */
+static void sm4_ctr_add(uint8_t *counter, uint64_t n) {
+    unsigned int carry = 0;
+    int i;
+
+    for (i = SM4_BLOCK_SIZE - 1; i >= 0; i--) {
+        carry += counter[i] + (unsigned int)(n & 0xff);
+        counter[i] = (uint8_t)carry;
+        carry >>= 8;
+        n >>= 8;
+        if (n == 0 && carry == 0) {
+            break;
+        }
+    }
+}
+
+/* 生成blocks块密钥流并前进计数器 */
+static void sm4_ctr_keystream(SM4_CTR_Context *ctx, uint8_t *keystream, size_t blocks) {
+    uint64_t hi = 0, lo = 0;
+    size_t i;
+    int j;
+
+    for (j = 0; j < 8; j++) {
+        hi = hi << 8 | ctx->counter[j];
+        lo = lo << 8 | ctx->counter[8 + j];
+    }
+
+    for (i = 0; i < blocks; i++) {
+        sm4_store_be64(keystream + i * SM4_BLOCK_SIZE, hi);
+        sm4_store_be64(keystream + i * SM4_BLOCK_SIZE + 8, lo);
+        if (++lo == 0) {
+            hi++;
+        }
+    }
+
+    for (j = 0; j < 8; j++) {
+        ctx->counter[j] = (uint8_t)(hi >> (56 - 8 * j));
+        ctx->counter[8 + j] = (uint8_t)(lo >> (56 - 8 * j));
+    }
+
+    sm4_encrypt_blocks(&ctx->cipher_ctx, keystream, keystream, blocks);
+}
+
+/* 初始化CTR上下文 */
+int sm4_ctr_init(SM4_CTR_Context *ctx, const uint8_t *key, const uint8_t *iv) {
+    sm4_set_encrypt_key(&ctx->cipher_ctx, key);
+    memcpy(ctx->iv, iv, SM4_BLOCK_SIZE);
+    memcpy(ctx->counter, iv, SM4_BLOCK_SIZE);
+    ctx->keystream_pos = SM4_BLOCK_SIZE;
+    return 0;
+}
+
+/* CTR模式加密 */
+int sm4_ctr_encrypt(SM4_CTR_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
+    uint8_t keystream[SM4_CTR_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    size_t i, n;
+
+    /* 先用完上次剩余的密钥流 */
+    while (len > 0 && ctx->keystream_pos < SM4_BLOCK_SIZE) {
+        *out++ = *in++ ^ ctx->keystream[ctx->keystream_pos++];
+        len--;
+    }
+
+    /* 整块部分按批处理 */
+    while (len >= SM4_BLOCK_SIZE) {
+        n = len / SM4_BLOCK_SIZE;
+        if (n > SM4_CTR_BATCH_BLOCKS) {
+            n = SM4_CTR_BATCH_BLOCKS;
+        }
+
+        sm4_ctr_keystream(ctx, keystream, n);
+        sm4_xor_bytes(out, in, keystream, n * SM4_BLOCK_SIZE);
+
+        in += n * SM4_BLOCK_SIZE;
+        out += n * SM4_BLOCK_SIZE;
+        len -= n * SM4_BLOCK_SIZE;
+    }
+
+    /* 不足一块的尾部，剩余密钥流留给下次调用 */
+    if (len > 0) {
+        sm4_ctr_keystream(ctx, ctx->keystream, 1);
+        for (i = 0; i < len; i++) {
+            out[i] = in[i] ^ ctx->keystream[i];
+        }
+        ctx->keystream_pos = len;
+    }
+
+    return 0;
+}
+
+/* CTR模式解密 */
+int sm4_ctr_decrypt(SM4_CTR_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
+    return sm4_ctr_encrypt(ctx, out, in, len);
+}
+
+/* 定位到指定字节偏移 */
+int sm4_ctr_seek(SM4_CTR_Context *ctx, uint64_t offset) {
+    memcpy(ctx->counter, ctx->iv, SM4_BLOCK_SIZE);
+    sm4_ctr_add(ctx->counter, offset / SM4_BLOCK_SIZE);
+    ctx->keystream_pos = SM4_BLOCK_SIZE;
+
+    /* 偏移落在块中间时，先生成这一块的密钥流并跳过前面的字节 */
+    if (offset % SM4_BLOCK_SIZE != 0) {
+        sm4_ctr_keystream(ctx, ctx->keystream, 1);
+        ctx->keystream_pos = (size_t)(offset % SM4_BLOCK_SIZE);
+    }
+
+    return 0;
+}
+
+/* CBC解密每批交给多块内核的块数 */
+#define SM4_CBC_BATCH_BLOCKS 16
+
+/* 多流CBC加密每组交错的流数，每一步把各流的下一块合成一次多块调用 */
+#define SM4_CBC_MULTI_LANES 16
+
+/* CBC模式加密 */
+int sm4_cbc_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv) {
+    size_t i, j;
+    uint8_t tmp[SM4_BLOCK_SIZE];
+
+    if (len % SM4_BLOCK_SIZE != 0) {
+        return -1; /* 输入长度必须是块大小的倍数 */
+    }
+
+    for (i = 0; i < len; i += SM4_BLOCK_SIZE) {
+        /* 明文与IV异或 */
+        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
+            tmp[j] = in[i + j] ^ iv[j];
+        }
+
+        /* 加密 */
+        sm4_encrypt_block(ctx, out + i, tmp);
+
+        /* 更新IV */
+        memcpy(iv, out + i, SM4_BLOCK_SIZE);
+    }
+
+    return 0;
+}
+
+/*
+ * CBC模式解密
+ *
+ * 解密没有链式依赖：P[i] = D(C[i]) ^ C[i-1]。每批先把整批密文交给多块内核解密，
+ * 再与错开一块的密文整体异或。异或从批尾向批首进行，这样原地解密（out == in）时
+ * 用到的前一块密文还没有被覆盖。
+ */
+int sm4_cbc_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv) {
+    uint8_t tmp[SM4_CBC_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t next_iv[SM4_BLOCK_SIZE];
+    size_t n, i;
+
+    if (len % SM4_BLOCK_SIZE != 0) {
+        return -1; /* 输入长度必须是块大小的倍数 */
+    }
+
+    while (len > 0) {
+        n = len / SM4_BLOCK_SIZE;
+        if (n > SM4_CBC_BATCH_BLOCKS) {
+            n = SM4_CBC_BATCH_BLOCKS;
+        }
+
+        /* 保存下一批的IV，原地解密时它会被覆盖 */
+        memcpy(next_iv, in + (n - 1) * SM4_BLOCK_SIZE, SM4_BLOCK_SIZE);
+
+        sm4_decrypt_blocks(ctx, tmp, in, n);
+
+        /* 第2..n块与前一块密文异或，第1块与IV异或 */
+        for (i = n - 1; i > 0; i--) {
+            sm4_xor_bytes(out + i * SM4_BLOCK_SIZE, tmp + i * SM4_BLOCK_SIZE,
+                          in + (i - 1) * SM4_BLOCK_SIZE, SM4_BLOCK_SIZE);
+        }
+        sm4_xor_bytes(out, tmp, iv, SM4_BLOCK_SIZE);
+
+        memcpy(iv, next_iv, SM4_BLOCK_SIZE);
+        in += n * SM4_BLOCK_SIZE;
+        out += n * SM4_BLOCK_SIZE;
+        len -= n * SM4_BLOCK_SIZE;
+    }
+
+    return 0;
+}
+
+/*
+ * 多流CBC加密
+ *
+ * 单个流的CBC加密必须串行，但互不相关的流可以交错：每一步取各流的下一块，
+ * 与各自的IV异或后拼成一次多块调用，宽向量内核的各通道分别处理不同的流。
+ * 长度不同的流在较短的流结束后继续以较少的通道推进。
+ */
+int sm4_cbc_encrypt_multi(const SM4_Context *ctx, uint8_t *const *out, const uint8_t *const *in,
+                          const size_t *len, uint8_t *const *iv, size_t streams) {
+    uint8_t buf[SM4_CBC_MULTI_LANES * SM4_BLOCK_SIZE];
+    size_t lane[SM4_CBC_MULTI_LANES];
+    size_t base, count, active, pos, k, s;
+
+    for (s = 0; s < streams; s++) {
+        if (len[s] % SM4_BLOCK_SIZE != 0) {
+            return -1; /* 每个流的长度都必须是块大小的倍数 */
+        }
+    }
+
+    for (base = 0; base < streams; base += SM4_CBC_MULTI_LANES) {
+        count = streams - base;
+        if (count > SM4_CBC_MULTI_LANES) {
+            count = SM4_CBC_MULTI_LANES;
+        }
+
+        for (pos = 0;; pos += SM4_BLOCK_SIZE) {
+            /* 收集这一步仍有数据的流 */
+            active = 0;
+            for (k = 0; k < count; k++) {
+                s = base + k;
+                if (pos < len[s]) {
+                    sm4_xor_bytes(buf + active * SM4_BLOCK_SIZE, in[s] + pos, iv[s], SM4_BLOCK_SIZE);
+                    lane[active++] = s;
+                }
+            }
+            if (active == 0) {
+                break;
+            }
+
+            sm4_encrypt_blocks(ctx, buf, buf, active);
+
+            for (k = 0; k < active; k++) {
+                s = lane[k];
+                memcpy(out[s] + pos, buf + k * SM4_BLOCK_SIZE, SM4_BLOCK_SIZE);
+                memcpy(iv[s], buf + k * SM4_BLOCK_SIZE, SM4_BLOCK_SIZE);
+            }
+        }
+    }
+
+    return 0;
+}
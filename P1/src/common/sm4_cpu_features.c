@@ -1,4 +1,5 @@
 #include "sm4_cpu_features.h"
+#include <stddef.h>
 
 #if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
 #if defined(_MSC_VER)
@@ -6,6 +7,17 @@
 #else
 #include <cpuid.h>
 #endif
+
+/* 读取XCR0，判断操作系统是否保存了AVX/AVX-512寄存器状态 */
+static unsigned long long read_xcr0(void) {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
 #endif
 
 /* 检测CPU支持的指令集特性 */
@@ -14,7 +26,9 @@ SM4_CPU_Features sm4_get_cpu_features(void) {
 
 #if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
     /* x86/x64架构 */
-    unsigned int eax, ebx, ecx, edx;
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    int osxsave;
+    unsigned long long xcr0 = 0;
     
 #if defined(_MSC_VER)
     /* MSVC编译器 */
@@ -27,17 +41,22 @@ SM4_CPU_Features sm4_get_cpu_features(void) {
     
     features.has_sse2 = (edx >> 26) & 1;
     features.has_aesni = (ecx >> 25) & 1;
+    features.has_ssse3 = (ecx >> 9) & 1;
+    features.has_pclmulqdq = (ecx >> 1) & 1;
     
     /* 检查AVX特性 */
     features.has_avx = (ecx >> 28) & 1;
+    osxsave = (ecx >> 27) & 1;
     
     /* 检查AVX2特性 */
-    __cpuid(cpu_info, 7);
+    __cpuidex(cpu_info, 7, 0);
     ebx = cpu_info[1];
+    ecx = cpu_info[2];
     features.has_avx2 = (ebx >> 5) & 1;
     
     /* 检查AVX-512特性 */
     features.has_avx512f = (ebx >> 16) & 1;
+    features.has_avx512bw = (ebx >> 30) & 1;
     
     /* 检查GFNI特性 */
     features.has_gfni = (ecx >> 8) & 1;
@@ -56,7 +75,10 @@ SM4_CPU_Features sm4_get_cpu_features(void) {
     
     features.has_sse2 = (edx >> 26) & 1;
     features.has_aesni = (ecx >> 25) & 1;
+    features.has_ssse3 = (ecx >> 9) & 1;
+    features.has_pclmulqdq = (ecx >> 1) & 1;
     features.has_avx = (ecx >> 28) & 1;
+    osxsave = (ecx >> 27) & 1;
     
     /* 检查扩展特性 */
     if (__get_cpuid_max(0, NULL) >= 7) {
@@ -64,21 +86,43 @@ SM4_CPU_Features sm4_get_cpu_features(void) {
         
         features.has_avx2 = (ebx >> 5) & 1;
         features.has_avx512f = (ebx >> 16) & 1;
+        features.has_avx512bw = (ebx >> 30) & 1;
         features.has_gfni = (ecx >> 8) & 1;
         features.has_vaes = (ecx >> 9) & 1;
         features.has_vpclmulqdq = (ecx >> 10) & 1;
     }
 #endif
 
+    /*
+     * CPU支持还不够，操作系统必须在上下文切换时保存YMM/ZMM寄存器，
+     * 否则调度层选中的宽向量后端会触发非法指令
+     */
+    if (osxsave) {
+        xcr0 = read_xcr0();
+    }
+    if ((xcr0 & 0x06) != 0x06) {
+        features.has_avx = 0;
+        features.has_avx2 = 0;
+        features.has_vaes = 0;
+        features.has_vpclmulqdq = 0;
+    }
+    if ((xcr0 & 0xe6) != 0xe6) {
+        features.has_avx512f = 0;
+        features.has_avx512bw = 0;
+    }
+
 #elif defined(__aarch64__) || defined(_M_ARM64)
     /* ARM64架构 */
     /* 在ARM上检测特性需要使用特定的方法 */
     /* 这里简化处理 */
     features.has_sse2 = 0;
     features.has_aesni = 0;
+    features.has_ssse3 = 0;
+    features.has_pclmulqdq = 0;
     features.has_avx = 0;
     features.has_avx2 = 0;
     features.has_avx512f = 0;
+    features.has_avx512bw = 0;
     features.has_gfni = 0;
     features.has_vaes = 0;
     features.has_vpclmulqdq = 0;
@@ -86,39 +130,3 @@ SM4_CPU_Features sm4_get_cpu_features(void) {
 
     return features;
 }
-
-/* 获取最优的SM4实现方式 */
-const char* sm4_get_best_implementation(void) {
-    SM4_CPU_Features features = sm4_get_cpu_features();
-    
-    if (features.has_gfni && features.has_avx512f) {
-        return "gfni";
-    } else if (features.has_vaes && features.has_avx2) {
-        return "vaes";
-    } else if (features.has_aesni) {
-        return "aesni";
-    } else {
-        return "t_table";
-    }
-}
-
-/* 当前强制使用的实现 */
-static const char* forced_impl = NULL;
-
-/* 强制使用特定的SM4实现 */
-int sm4_force_implementation(const char* impl_name) {
-    if (!impl_name) {
-        forced_impl = NULL;
-        return 0;
-    }
-    
-    if (strcmp(impl_name, "basic") == 0 ||
-        strcmp(impl_name, "t_table") == 0 ||
-        strcmp(impl_name, "aesni") == 0 ||
-        strcmp(impl_name, "gfni") == 0) {
-        forced_impl = impl_name;
-        return 0;
-    }
-    
-    return -1; /* 不支持的实现 */
-}
\ No newline at end of file
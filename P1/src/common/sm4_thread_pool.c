@@ -0,0 +1,148 @@
+#include "sm4_internal.h"
+
+/*
+ * 库内部的线程池：工作线程在第一次需要时创建，之后常驻并在条件变量上等待，
+ * 大消息的并行接口不必每次调用都创建线程。一次只运行一个作业（并发调用者排队），
+ * 作业由若干粗粒度任务组成，调用者线程同样领取任务，全部完成后才返回。
+ *
+ * 没有POSIX线程的平台上退化为在调用者线程中顺序执行。
+ */
+
+#if !defined(_WIN32)
+
+#include <pthread.h>
+#include <unistd.h>
+
+/* 线程池最多常驻的工作线程数 */
+#define SM4_THREAD_POOL_MAX 64
+
+/* 当前作业，所有字段由pool_lock保护 */
+typedef struct {
+    void (*fn)(void *arg, size_t index);
+    void *arg;
+    size_t tasks;     // 任务总数
+    size_t next;      // 下一个待领取的任务
+    size_t done;      // 已完成的任务数
+    size_t slots;     // 还可以加入的工作线程数（调用者之外）
+} SM4_Pool_Job;
+
+static pthread_mutex_t pool_run_lock = PTHREAD_MUTEX_INITIALIZER;  // 保证一次只有一个作业
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;        // 有新作业
+static pthread_cond_t pool_finished = PTHREAD_COND_INITIALIZER;    // 作业全部完成
+static SM4_Pool_Job pool_job;
+static unsigned long pool_generation = 0;  // 每发布一个作业加一
+static size_t pool_workers = 0;            // 已创建的工作线程数
+
+/* 领取并执行任务，直到没有剩余任务；调用时持有pool_lock */
+static void sm4_pool_drain(void) {
+    size_t index;
+
+    while (pool_job.next < pool_job.tasks) {
+        index = pool_job.next++;
+        pthread_mutex_unlock(&pool_lock);
+        pool_job.fn(pool_job.arg, index);
+        pthread_mutex_lock(&pool_lock);
+        if (++pool_job.done == pool_job.tasks) {
+            pthread_cond_signal(&pool_finished);
+        }
+    }
+}
+
+static void *sm4_pool_worker(void *unused) {
+    unsigned long seen = 0;
+
+    (void)unused;
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        while (pool_generation == seen) {
+            pthread_cond_wait(&pool_wake, &pool_lock);
+        }
+        seen = pool_generation;
+
+        if (pool_job.slots > 0) {
+            pool_job.slots--;
+            sm4_pool_drain();
+        }
+    }
+    return NULL;
+}
+
+size_t sm4_parallel_default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n < 1) {
+        return 1;
+    }
+    return (size_t)n < SM4_THREAD_POOL_MAX + 1 ? (size_t)n : SM4_THREAD_POOL_MAX + 1;
+}
+
+void sm4_parallel_run(size_t tasks, size_t threads, void (*fn)(void *arg, size_t index), void *arg) {
+    pthread_t tid;
+    size_t helpers;
+
+    if (tasks == 0) {
+        return;
+    }
+    if (threads == 0) {
+        threads = sm4_parallel_default_threads();
+    }
+
+    /* 调用者自己也执行任务，最多再叫醒tasks - 1个工作线程 */
+    helpers = threads - 1;
+    if (helpers > tasks - 1) {
+        helpers = tasks - 1;
+    }
+    if (helpers > SM4_THREAD_POOL_MAX) {
+        helpers = SM4_THREAD_POOL_MAX;
+    }
+
+    pthread_mutex_lock(&pool_run_lock);
+    pthread_mutex_lock(&pool_lock);
+
+    /* 按需补足工作线程；创建失败时用已有的线程继续 */
+    while (pool_workers < helpers) {
+        if (pthread_create(&tid, NULL, sm4_pool_worker, NULL) != 0) {
+            break;
+        }
+        pthread_detach(tid);
+        pool_workers++;
+    }
+
+    pool_job.fn = fn;
+    pool_job.arg = arg;
+    pool_job.tasks = tasks;
+    pool_job.next = 0;
+    pool_job.done = 0;
+    pool_job.slots = helpers;
+    if (helpers > 0) {
+        pool_generation++;
+        pthread_cond_broadcast(&pool_wake);
+    }
+
+    sm4_pool_drain();
+    while (pool_job.done < pool_job.tasks) {
+        pthread_cond_wait(&pool_finished, &pool_lock);
+    }
+    pool_job.slots = 0;
+
+    pthread_mutex_unlock(&pool_lock);
+    pthread_mutex_unlock(&pool_run_lock);
+}
+
+#else
+
+size_t sm4_parallel_default_threads(void) {
+    return 1;
+}
+
+void sm4_parallel_run(size_t tasks, size_t threads, void (*fn)(void *arg, size_t index), void *arg) {
+    size_t i;
+
+    (void)threads;
+    for (i = 0; i < tasks; i++) {
+        fn(arg, i);
+    }
+}
+
+#endif
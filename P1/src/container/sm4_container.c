@@ -0,0 +1,383 @@
+#include "sm4_container.h"
+#include "sm4_gcm.h"
+#include "sm4_internal.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * 分段认证容器
+ *
+ * 整个文件一条GCM消息时，读取任何一段明文都必须处理整个文件才能验证标签。
+ * 容器把明文切成固定长度的段，每段是一条独立的GCM消息（随机数由前缀和段号派生），
+ * 标签集中放在尾部的索引中；因为段长固定，明文偏移直接换算成密文偏移，
+ * 读取一个范围只需要读覆盖它的段和对应的标签。
+ */
+
+static const uint8_t sm4_container_magic[4] = {'S', 'M', '4', 'C'};
+static const uint8_t sm4_container_index_magic[4] = {'S', 'M', '4', 'I'};
+
+#define SM4_CONTAINER_VERSION 1
+#define SM4_CONTAINER_ALG_GCM 0
+
+/* 随机数长度：8字节前缀 + 32位段号 */
+#define SM4_CONTAINER_NONCE_SIZE 12
+
+static void sm4_container_store_be32(uint8_t *b, uint32_t v) {
+    b[0] = (uint8_t)(v >> 24);
+    b[1] = (uint8_t)(v >> 16);
+    b[2] = (uint8_t)(v >> 8);
+    b[3] = (uint8_t)v;
+}
+
+static void sm4_container_store_be64(uint8_t *b, uint64_t v) {
+    sm4_container_store_be32(b, (uint32_t)(v >> 32));
+    sm4_container_store_be32(b + 4, (uint32_t)v);
+}
+
+static uint32_t sm4_container_load_be32(const uint8_t *b) {
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+static uint64_t sm4_container_load_be64(const uint8_t *b) {
+    return ((uint64_t)sm4_container_load_be32(b) << 32) | sm4_container_load_be32(b + 4);
+}
+
+/* 分段数，参数不合法时返回0 */
+static uint64_t sm4_container_segments(uint64_t plaintext_len, uint32_t segment_size) {
+    uint64_t count;
+
+    if (segment_size < SM4_CONTAINER_MIN_SEGMENT || segment_size > SM4_CONTAINER_MAX_SEGMENT ||
+        segment_size % SM4_BLOCK_SIZE != 0) {
+        return 0;
+    }
+    count = plaintext_len == 0 ? 1 : (plaintext_len - 1) / segment_size + 1;
+    return count <= 0xFFFFFFFFu ? count : 0;
+}
+
+/* 容器长度 */
+uint64_t sm4_container_size(uint64_t plaintext_len, uint32_t segment_size) {
+    uint64_t count = sm4_container_segments(plaintext_len, segment_size);
+
+    if (count == 0) {
+        return 0;
+    }
+    return SM4_CONTAINER_HEADER_SIZE + plaintext_len + count * SM4_CONTAINER_TAG_SIZE +
+           SM4_CONTAINER_TRAILER_SIZE;
+}
+
+/* 标签索引在容器中的偏移 */
+static uint64_t sm4_container_index_offset(const SM4_Container_Info *info) {
+    return SM4_CONTAINER_HEADER_SIZE + info->plaintext_len;
+}
+
+/* 第index段的随机数 */
+static void sm4_container_nonce(uint8_t *nonce, const uint8_t *prefix, uint64_t index) {
+    memcpy(nonce, prefix, 8);
+    sm4_container_store_be32(nonce + 8, (uint32_t)index);
+}
+
+/* 第index段的明文长度 */
+static size_t sm4_container_segment_len(const SM4_Container_Info *info, uint64_t index) {
+    uint64_t start = index * info->segment_size;
+    uint64_t rest = info->plaintext_len - start;
+
+    return rest < info->segment_size ? (size_t)rest : info->segment_size;
+}
+
+/* 加密时所有段共用的参数 */
+typedef struct {
+    const uint8_t *key;
+    const uint8_t *header;
+    const uint8_t *in;
+    uint8_t *out;
+    SM4_Container_Info info;
+} SM4_Container_Encrypt_Job;
+
+/* 加密一段（在线程池上执行） */
+static void sm4_container_encrypt_task(void *arg, size_t index) {
+    const SM4_Container_Encrypt_Job *job = (const SM4_Container_Encrypt_Job *)arg;
+    uint64_t start = (uint64_t)index * job->info.segment_size;
+    uint8_t nonce[SM4_CONTAINER_NONCE_SIZE];
+
+    sm4_container_nonce(nonce, job->info.nonce_prefix, index);
+    sm4_gcm_encrypt_and_tag(job->key, nonce, sizeof(nonce), job->header, SM4_CONTAINER_HEADER_SIZE,
+                            job->in + start, sm4_container_segment_len(&job->info, index),
+                            job->out + SM4_CONTAINER_HEADER_SIZE + start,
+                            job->out + sm4_container_index_offset(&job->info) +
+                                (uint64_t)index * SM4_CONTAINER_TAG_SIZE,
+                            SM4_CONTAINER_TAG_SIZE);
+}
+
+/* 加密成容器 */
+int sm4_container_encrypt(const uint8_t *key, const uint8_t *nonce_prefix, uint32_t segment_size,
+                          const uint8_t *in, uint64_t len, uint8_t *out) {
+    SM4_Container_Encrypt_Job job;
+    uint8_t *trailer;
+    uint64_t count = sm4_container_segments(len, segment_size);
+
+    if (key == NULL || nonce_prefix == NULL || out == NULL || (in == NULL && len > 0) || count == 0 ||
+        (uint64_t)(size_t)len != len) {
+        return -1;
+    }
+
+    memset(out, 0, SM4_CONTAINER_HEADER_SIZE);
+    memcpy(out, sm4_container_magic, sizeof(sm4_container_magic));
+    out[4] = SM4_CONTAINER_VERSION;
+    out[5] = SM4_CONTAINER_ALG_GCM;
+    sm4_container_store_be32(out + 8, segment_size);
+    memcpy(out + 12, nonce_prefix, 8);
+    sm4_container_store_be64(out + 20, len);
+
+    job.key = key;
+    job.header = out;
+    job.in = in;
+    job.out = out;
+    job.info.segment_size = segment_size;
+    memcpy(job.info.nonce_prefix, nonce_prefix, 8);
+    job.info.plaintext_len = len;
+    job.info.segment_count = count;
+    job.info.container_len = sm4_container_size(len, segment_size);
+
+    if (count == 1) {
+        sm4_container_encrypt_task(&job, 0);
+    } else {
+        sm4_parallel_run((size_t)count, 0, sm4_container_encrypt_task, &job);
+    }
+
+    trailer = out + job.info.container_len - SM4_CONTAINER_TRAILER_SIZE;
+    memset(trailer, 0, SM4_CONTAINER_TRAILER_SIZE);
+    memcpy(trailer, sm4_container_index_magic, sizeof(sm4_container_index_magic));
+    sm4_container_store_be64(trailer + 8, count);
+    return 0;
+}
+
+#if !defined(_WIN32)
+
+#include <unistd.h>
+
+/* 解析文件头 */
+static int sm4_container_parse_header(const uint8_t *header, SM4_Container_Info *info) {
+    if (memcmp(header, sm4_container_magic, sizeof(sm4_container_magic)) != 0 ||
+        header[4] != SM4_CONTAINER_VERSION || header[5] != SM4_CONTAINER_ALG_GCM ||
+        header[6] != 0 || header[7] != 0 || sm4_container_load_be32(header + 28) != 0) {
+        return -EINVAL;
+    }
+    info->segment_size = sm4_container_load_be32(header + 8);
+    memcpy(info->nonce_prefix, header + 12, 8);
+    info->plaintext_len = sm4_container_load_be64(header + 20);
+    info->segment_count = sm4_container_segments(info->plaintext_len, info->segment_size);
+    info->container_len = sm4_container_size(info->plaintext_len, info->segment_size);
+    return info->segment_count != 0 ? 0 : -EINVAL;
+}
+
+/* 从offset处读满len字节：0成功，-EIO文件不够长，其他为-errno */
+static int sm4_container_pread(int fd, uint8_t *buf, size_t len, uint64_t offset) {
+    ssize_t res;
+
+    while (len > 0) {
+        res = pread(fd, buf, len, (off_t)offset);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (res == 0) {
+            return -EIO;
+        }
+        buf += res;
+        len -= (size_t)res;
+        offset += (uint64_t)res;
+    }
+    return 0;
+}
+
+/* 读取文件头和结尾 */
+static int sm4_container_read_header(int fd, uint8_t *header, SM4_Container_Info *info) {
+    uint8_t trailer[SM4_CONTAINER_TRAILER_SIZE];
+    int ret;
+
+    ret = sm4_container_pread(fd, header, SM4_CONTAINER_HEADER_SIZE, 0);
+    if (ret == -EIO) {
+        return -EINVAL;
+    }
+    if (ret == 0) {
+        ret = sm4_container_parse_header(header, info);
+    }
+    if (ret == 0) {
+        ret = sm4_container_pread(fd, trailer, sizeof(trailer),
+                                  info->container_len - SM4_CONTAINER_TRAILER_SIZE);
+    }
+    if (ret == 0 &&
+        (memcmp(trailer, sm4_container_index_magic, sizeof(sm4_container_index_magic)) != 0 ||
+         sm4_container_load_be32(trailer + 4) != 0 ||
+         sm4_container_load_be64(trailer + 8) != info->segment_count)) {
+        ret = -EINVAL;
+    }
+    return ret;
+}
+
+/* 读取并检查文件头和结尾 */
+int sm4_container_open(int fd, SM4_Container_Info *info) {
+    uint8_t header[SM4_CONTAINER_HEADER_SIZE];
+
+    if (fd < 0 || info == NULL) {
+        return -EINVAL;
+    }
+    return sm4_container_read_header(fd, header, info);
+}
+
+/* 解密一个范围时所有段共用的参数 */
+typedef struct {
+    int fd;
+    const uint8_t *key;
+    const uint8_t *header;
+    SM4_Container_Info info;
+    uint64_t offset;       // 请求范围的明文起点
+    uint64_t end;          // 请求范围的明文终点
+    uint64_t first;        // 第一段的段号
+    size_t count;          // 段数
+    const uint8_t *tags;   // 这些段的标签
+    uint8_t *bounce[2];    // 首段、尾段只用到一部分时的中转缓冲区
+    int *status;           // 每段的结果
+    uint8_t *out;
+} SM4_Container_Read_Job;
+
+/* 读取、验证并解密一段（在线程池上执行） */
+static void sm4_container_read_task(void *arg, size_t index) {
+    SM4_Container_Read_Job *job = (SM4_Container_Read_Job *)arg;
+    uint64_t segment = job->first + index;
+    uint64_t start = segment * job->info.segment_size;
+    size_t seg_len = sm4_container_segment_len(&job->info, segment);
+    uint64_t lo = job->offset > start ? job->offset - start : 0;
+    uint64_t hi = job->end < start + seg_len ? job->end - start : seg_len;
+    uint8_t nonce[SM4_CONTAINER_NONCE_SIZE];
+    uint8_t *buf;
+    int ret;
+
+    /* 整段都在范围内时直接读进输出缓冲区原地解密，否则经过中转缓冲区 */
+    if (lo == 0 && hi == seg_len) {
+        buf = job->out + (start - job->offset);
+    } else {
+        buf = job->bounce[index == 0 ? 0 : 1];
+    }
+
+    ret = sm4_container_pread(job->fd, buf, seg_len, SM4_CONTAINER_HEADER_SIZE + start);
+    if (ret == 0) {
+        sm4_container_nonce(nonce, job->info.nonce_prefix, segment);
+        if (sm4_gcm_decrypt_and_verify(job->key, nonce, sizeof(nonce),
+                                       job->header, SM4_CONTAINER_HEADER_SIZE, buf, seg_len,
+                                       job->tags + index * SM4_CONTAINER_TAG_SIZE,
+                                       SM4_CONTAINER_TAG_SIZE, buf) != 0) {
+            ret = -EBADMSG;
+        }
+    }
+    if (ret == 0 && buf != job->out + (start - job->offset)) {
+        memcpy(job->out + (start + lo - job->offset), buf + lo, (size_t)(hi - lo));
+    }
+    job->status[index] = ret;
+}
+
+/* 解密明文[offset, offset + len) */
+int sm4_container_read_range(int fd, const uint8_t *key, uint64_t offset, size_t len, uint8_t *out) {
+    SM4_Container_Read_Job job;
+    uint8_t header[SM4_CONTAINER_HEADER_SIZE];
+    uint8_t *tags = NULL;
+    uint64_t last;
+    size_t i, bounce_len = 0;
+    int ret;
+
+    if (fd < 0 || key == NULL || (out == NULL && len > 0)) {
+        return -EINVAL;
+    }
+    memset(&job, 0, sizeof(job));
+    ret = sm4_container_read_header(fd, header, &job.info);
+    if (ret != 0) {
+        return ret;
+    }
+    if (offset > job.info.plaintext_len || len > job.info.plaintext_len - offset) {
+        return -EINVAL;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    job.fd = fd;
+    job.key = key;
+    job.header = header;
+    job.offset = offset;
+    job.end = offset + len;
+    job.first = offset / job.info.segment_size;
+    last = (job.end - 1) / job.info.segment_size;
+    job.count = (size_t)(last - job.first + 1);
+    job.out = out;
+
+    /* 只有首段和尾段可能只用到一部分 */
+    if (offset % job.info.segment_size != 0 ||
+        job.end < job.first * job.info.segment_size + sm4_container_segment_len(&job.info, job.first)) {
+        bounce_len += job.info.segment_size;
+    }
+    if (job.count > 1 && job.end < last * job.info.segment_size + sm4_container_segment_len(&job.info, last)) {
+        bounce_len += job.info.segment_size;
+    }
+
+    tags = (uint8_t *)malloc(job.count * SM4_CONTAINER_TAG_SIZE + bounce_len);
+    job.status = (int *)calloc(job.count, sizeof(*job.status));
+    if (tags == NULL || job.status == NULL) {
+        free(tags);
+        free(job.status);
+        return -ENOMEM;
+    }
+    job.tags = tags;
+    job.bounce[0] = tags + job.count * SM4_CONTAINER_TAG_SIZE;
+    job.bounce[1] = bounce_len > job.info.segment_size ? job.bounce[0] + job.info.segment_size : job.bounce[0];
+
+    /* 这些段的标签在索引中是连续的，一次读出 */
+    ret = sm4_container_pread(fd, tags, job.count * SM4_CONTAINER_TAG_SIZE,
+                              sm4_container_index_offset(&job.info) + job.first * SM4_CONTAINER_TAG_SIZE);
+    if (ret == 0) {
+        if (job.count == 1) {
+            sm4_container_read_task(&job, 0);
+        } else {
+            sm4_parallel_run(job.count, 0, sm4_container_read_task, &job);
+        }
+        /* 验证失败优先报告，其次是第一个读错误 */
+        for (i = 0; i < job.count; i++) {
+            if (job.status[i] == -EBADMSG) {
+                ret = -EBADMSG;
+                break;
+            }
+            if (ret == 0) {
+                ret = job.status[i];
+            }
+        }
+    }
+    if (ret != 0) {
+        memset(out, 0, len);
+    }
+
+    memset(job.bounce[0], 0, bounce_len);
+    free(tags);
+    free(job.status);
+    return ret;
+}
+
+#else /* _WIN32 */
+
+int sm4_container_open(int fd, SM4_Container_Info *info) {
+    (void)fd;
+    (void)info;
+    return -EINVAL;
+}
+
+int sm4_container_read_range(int fd, const uint8_t *key, uint64_t offset, size_t len, uint8_t *out) {
+    (void)fd;
+    (void)key;
+    (void)offset;
+    (void)len;
+    (void)out;
+    return -EINVAL;
+}
+
+#endif /* _WIN32 */
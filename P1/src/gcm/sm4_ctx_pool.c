@@ -0,0 +1,428 @@
+#include "sm4_pool.h"
+#include "sm4_gcm_internal.h"
+#include "sm4_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#define SM4_POOL_LOCKED 1
+#else
+#include <malloc.h>
+#define SM4_POOL_LOCKED 0
+#endif
+
+#if defined(_MSC_VER)
+#define SM4_POOL_THREAD_LOCAL __declspec(thread)
+#else
+#define SM4_POOL_THREAD_LOCAL __thread
+#endif
+
+/*
+ * 上下文池：所有槽位在一块按缓存行对齐的内存（arena）中一次分配。
+ *
+ * 每个槽位的上下文从缓存行边界开始，GHASH表和轮密钥的SIMD载入不会跨行；槽位头部
+ * （密钥、链表指针）放在上下文之前单独的缓存行里。空闲槽位分布在若干分片中，
+ * 每个分片有自己的锁、按最近归还排序的链表和按密钥指纹的哈希桶；线程第一次使用时
+ * 固定分到一个分片，分片数不少于CPU数，线程之间基本不竞争同一把锁。
+ *
+ * 取出时先在本分片中按密钥查找保留着同一密钥材料的槽位（命中只需设置IV），
+ * 没有时取最久未用的空闲槽位重新扩展密钥；本分片为空时依次从其他分片取。
+ */
+
+#define SM4_POOL_CACHE_LINE 64
+
+/* 最多的分片数 */
+#define SM4_POOL_MAX_SHARDS 64
+
+/* 槽位中上下文的种类 */
+enum {
+    SM4_POOL_KIND_EMPTY = 0,    // 还没有设置过密钥
+    SM4_POOL_KIND_SM4_ENC,
+    SM4_POOL_KIND_SM4_DEC,
+    SM4_POOL_KIND_GCM
+};
+
+typedef struct sm4_pool_slot {
+    /* 槽位头部，独占一个缓存行 */
+    uint8_t key[SM4_KEY_SIZE];
+    uint64_t fingerprint;
+    int kind;
+    int in_use;
+    struct sm4_pool_slot *prev;       // 空闲链表，靠近表头的是最近归还的
+    struct sm4_pool_slot *next;
+    struct sm4_pool_slot *hash_prev;  // 同一个桶中的空闲槽位
+    struct sm4_pool_slot *hash_next;
+
+    /* 上下文，从缓存行边界开始 */
+    union {
+        SM4_Context sm4;
+        SM4_GCM_Context gcm;
+    } ctx __attribute__((aligned(SM4_POOL_CACHE_LINE)));
+} SM4_Pool_Slot;
+
+/* 分片：空闲槽位的链表和哈希桶，按缓存行对齐，相邻分片的锁不共享缓存行 */
+typedef struct {
+#if SM4_POOL_LOCKED
+    pthread_mutex_t lock;
+#endif
+    SM4_Pool_Slot *head;          // 最近归还
+    SM4_Pool_Slot *tail;          // 最久未用
+    SM4_Pool_Slot **buckets;      // bucket_mask + 1个桶
+    size_t free_count;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t steals;
+} __attribute__((aligned(SM4_POOL_CACHE_LINE))) SM4_Pool_Shard;
+
+struct sm4_ctx_pool {
+    SM4_Pool_Slot *slots;         // capacity个槽位（arena）
+    size_t capacity;
+    SM4_Pool_Shard *shards;
+    size_t shard_count;
+    size_t bucket_mask;
+    SM4_Pool_Slot **bucket_arena; // 所有分片的哈希桶
+};
+
+#if SM4_POOL_LOCKED
+#define SM4_POOL_LOCK(s) pthread_mutex_lock(&(s)->lock)
+#define SM4_POOL_UNLOCK(s) pthread_mutex_unlock(&(s)->lock)
+#else
+#define SM4_POOL_LOCK(s) ((void)0)
+#define SM4_POOL_UNLOCK(s) ((void)0)
+#endif
+
+/* 线程的分片序号：第一次使用时依次分配，之后固定不变 */
+static SM4_POOL_THREAD_LOCAL unsigned int sm4_pool_thread_id;
+static unsigned int sm4_pool_next_thread_id;
+
+static size_t sm4_pool_home_shard(const SM4_Ctx_Pool *pool) {
+    if (sm4_pool_thread_id == 0) {
+        sm4_pool_thread_id = __atomic_add_fetch(&sm4_pool_next_thread_id, 1, __ATOMIC_RELAXED);
+    }
+    return (sm4_pool_thread_id - 1) % pool->shard_count;
+}
+
+static void *sm4_pool_aligned_alloc(size_t size) {
+#if defined(_WIN32)
+    return _aligned_malloc(size, SM4_POOL_CACHE_LINE);
+#else
+    void *p;
+
+    return posix_memalign(&p, SM4_POOL_CACHE_LINE, size) == 0 ? p : NULL;
+#endif
+}
+
+static void sm4_pool_aligned_free(void *p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+/* 密钥指纹，与GCM密钥缓存相同的混合函数（只用于分桶，命中时比较完整密钥） */
+static uint64_t sm4_pool_fingerprint(const uint8_t *key, int kind) {
+    uint64_t a, b;
+
+    memcpy(&a, key, 8);
+    memcpy(&b, key + 8, 8);
+    a ^= b * 0x9e3779b97f4a7c15ULL + (uint64_t)kind;
+    a ^= a >> 33;
+    a *= 0xff51afd7ed558ccdULL;
+    a ^= a >> 33;
+    a *= 0xc4ceb9fe1a85ec53ULL;
+    return a ^ (a >> 33);
+}
+
+/* 把空闲槽位从分片的链表和桶中摘下 */
+static void sm4_pool_unlink(const SM4_Ctx_Pool *pool, SM4_Pool_Shard *shard, SM4_Pool_Slot *slot) {
+    if (slot->prev) {
+        slot->prev->next = slot->next;
+    } else {
+        shard->head = slot->next;
+    }
+    if (slot->next) {
+        slot->next->prev = slot->prev;
+    } else {
+        shard->tail = slot->prev;
+    }
+
+    if (slot->hash_prev) {
+        slot->hash_prev->hash_next = slot->hash_next;
+    } else if (slot->kind != SM4_POOL_KIND_EMPTY) {
+        shard->buckets[slot->fingerprint & pool->bucket_mask] = slot->hash_next;
+    }
+    if (slot->hash_next) {
+        slot->hash_next->hash_prev = slot->hash_prev;
+    }
+    slot->prev = slot->next = slot->hash_prev = slot->hash_next = NULL;
+    shard->free_count--;
+}
+
+/* 空闲槽位放到分片链表的表头；空槽位放到表尾，优先于保留着密钥材料的槽位被重新使用 */
+static void sm4_pool_link(const SM4_Ctx_Pool *pool, SM4_Pool_Shard *shard, SM4_Pool_Slot *slot) {
+    SM4_Pool_Slot **bucket;
+
+    if (slot->kind == SM4_POOL_KIND_EMPTY) {
+        slot->next = NULL;
+        slot->prev = shard->tail;
+        if (shard->tail) {
+            shard->tail->next = slot;
+        } else {
+            shard->head = slot;
+        }
+        shard->tail = slot;
+    } else {
+        slot->prev = NULL;
+        slot->next = shard->head;
+        if (shard->head) {
+            shard->head->prev = slot;
+        } else {
+            shard->tail = slot;
+        }
+        shard->head = slot;
+
+        bucket = &shard->buckets[slot->fingerprint & pool->bucket_mask];
+        slot->hash_prev = NULL;
+        slot->hash_next = *bucket;
+        if (*bucket) {
+            (*bucket)->hash_prev = slot;
+        }
+        *bucket = slot;
+    }
+    shard->free_count++;
+}
+
+/* 在分片中找保留着同一密钥材料的空闲槽位 */
+static SM4_Pool_Slot *sm4_pool_find(const SM4_Ctx_Pool *pool, SM4_Pool_Shard *shard,
+                                    const uint8_t *key, int kind, uint64_t fp) {
+    SM4_Pool_Slot *slot = shard->buckets[fp & pool->bucket_mask];
+
+    while (slot) {
+        if (slot->fingerprint == fp && slot->kind == kind && memcmp(slot->key, key, SM4_KEY_SIZE) == 0) {
+            return slot;
+        }
+        slot = slot->hash_next;
+    }
+    return NULL;
+}
+
+/*
+ * 取出一个槽位：返回1表示密钥材料可以直接使用，0表示已经清零、需要重新设置，
+ * *out为NULL表示池已用尽
+ */
+static int sm4_pool_take(SM4_Ctx_Pool *pool, const uint8_t *key, int kind, SM4_Pool_Slot **out) {
+    uint64_t fp = sm4_pool_fingerprint(key, kind);
+    size_t home = sm4_pool_home_shard(pool);
+    SM4_Pool_Shard *shard = &pool->shards[home];
+    SM4_Pool_Slot *slot;
+    size_t i;
+
+    SM4_POOL_LOCK(shard);
+    slot = sm4_pool_find(pool, shard, key, kind, fp);
+    if (slot) {
+        sm4_pool_unlink(pool, shard, slot);
+        shard->hits++;
+        slot->in_use = 1;
+        SM4_POOL_UNLOCK(shard);
+        *out = slot;
+        return 1;
+    }
+    shard->misses++;
+    slot = shard->tail;
+    if (slot) {
+        sm4_pool_unlink(pool, shard, slot);
+    } else {
+        shard->steals++;
+    }
+    SM4_POOL_UNLOCK(shard);
+
+    /* 本分片为空：从其他分片取最久未用的槽位 */
+    for (i = 1; slot == NULL && i < pool->shard_count; i++) {
+        shard = &pool->shards[(home + i) % pool->shard_count];
+        SM4_POOL_LOCK(shard);
+        slot = shard->tail;
+        if (slot) {
+            sm4_pool_unlink(pool, shard, slot);
+        }
+        SM4_POOL_UNLOCK(shard);
+    }
+
+    *out = slot;
+    if (slot) {
+        memset(&slot->ctx, 0, sizeof(slot->ctx));
+        memcpy(slot->key, key, SM4_KEY_SIZE);
+        slot->fingerprint = fp;
+        slot->kind = kind;
+        slot->in_use = 1;
+    }
+    return 0;
+}
+
+/* 创建上下文池 */
+SM4_Ctx_Pool *sm4_ctx_pool_create(size_t capacity) {
+    SM4_Ctx_Pool *pool;
+    size_t shards, per_shard, buckets = 1, i;
+
+    if (capacity == 0 || capacity > SIZE_MAX / sizeof(SM4_Pool_Slot)) {
+        return NULL;
+    }
+
+    /* 分片数取CPU数的2倍（至少覆盖常驻线程数），但每个分片至少有4个槽位 */
+    shards = 2 * sm4_parallel_default_threads();
+    if (shards > SM4_POOL_MAX_SHARDS) {
+        shards = SM4_POOL_MAX_SHARDS;
+    }
+    if (shards > (capacity + 3) / 4) {
+        shards = (capacity + 3) / 4;
+    }
+    per_shard = (capacity + shards - 1) / shards;
+    while (buckets < 2 * per_shard) {
+        buckets <<= 1;
+    }
+
+    pool = (SM4_Ctx_Pool *)calloc(1, sizeof(*pool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->slots = (SM4_Pool_Slot *)sm4_pool_aligned_alloc(capacity * sizeof(SM4_Pool_Slot));
+    pool->shards = (SM4_Pool_Shard *)sm4_pool_aligned_alloc(shards * sizeof(SM4_Pool_Shard));
+    pool->bucket_arena = (SM4_Pool_Slot **)calloc(shards * buckets, sizeof(SM4_Pool_Slot *));
+    if (!pool->slots || !pool->shards || !pool->bucket_arena) {
+        sm4_pool_aligned_free(pool->slots);
+        sm4_pool_aligned_free(pool->shards);
+        free(pool->bucket_arena);
+        free(pool);
+        return NULL;
+    }
+    memset(pool->slots, 0, capacity * sizeof(SM4_Pool_Slot));
+    memset(pool->shards, 0, shards * sizeof(SM4_Pool_Shard));
+    pool->capacity = capacity;
+    pool->shard_count = shards;
+    pool->bucket_mask = buckets - 1;
+
+    for (i = 0; i < shards; i++) {
+        pool->shards[i].buckets = pool->bucket_arena + i * buckets;
+#if SM4_POOL_LOCKED
+        pthread_mutex_init(&pool->shards[i].lock, NULL);
+#endif
+    }
+    for (i = 0; i < capacity; i++) {
+        sm4_pool_link(pool, &pool->shards[i % shards], &pool->slots[i]);
+    }
+    return pool;
+}
+
+/* 销毁上下文池 */
+void sm4_ctx_pool_destroy(SM4_Ctx_Pool *pool) {
+    size_t i;
+
+    if (!pool) {
+        return;
+    }
+
+    memset(pool->slots, 0, pool->capacity * sizeof(SM4_Pool_Slot));
+    sm4_pool_aligned_free(pool->slots);
+#if SM4_POOL_LOCKED
+    for (i = 0; i < pool->shard_count; i++) {
+        pthread_mutex_destroy(&pool->shards[i].lock);
+    }
+#else
+    (void)i;
+#endif
+    sm4_pool_aligned_free(pool->shards);
+    free(pool->bucket_arena);
+    free(pool);
+}
+
+/* 取出SM4上下文 */
+SM4_Context *sm4_ctx_pool_acquire_sm4(SM4_Ctx_Pool *pool, const uint8_t *key, SM4_Pool_Direction direction) {
+    SM4_Pool_Slot *slot;
+    int kind = direction == SM4_POOL_DECRYPT ? SM4_POOL_KIND_SM4_DEC : SM4_POOL_KIND_SM4_ENC;
+
+    if (!pool || !key) {
+        return NULL;
+    }
+    if (sm4_pool_take(pool, key, kind, &slot) == 0 && slot) {
+        if (kind == SM4_POOL_KIND_SM4_DEC) {
+            sm4_set_decrypt_key(&slot->ctx.sm4, key);
+        } else {
+            sm4_set_encrypt_key(&slot->ctx.sm4, key);
+        }
+    }
+    return slot ? &slot->ctx.sm4 : NULL;
+}
+
+/* 取出GCM上下文 */
+SM4_GCM_Context *sm4_ctx_pool_acquire_gcm(SM4_Ctx_Pool *pool, const uint8_t *key,
+                                          const uint8_t *iv, size_t iv_len) {
+    SM4_Pool_Slot *slot;
+
+    if (!pool || !key || !iv || iv_len == 0) {
+        return NULL;
+    }
+    if (sm4_pool_take(pool, key, SM4_POOL_KIND_GCM, &slot) == 0 && slot) {
+        sm4_set_encrypt_key(&slot->ctx.gcm.cipher_ctx, key);
+        sm4_gcm_setup_hash_key(&slot->ctx.gcm);
+    }
+    if (!slot) {
+        return NULL;
+    }
+    sm4_gcm_setup_iv(&slot->ctx.gcm, iv, iv_len);
+    return &slot->ctx.gcm;
+}
+
+/* 归还上下文 */
+void sm4_ctx_pool_release(SM4_Ctx_Pool *pool, void *ctx) {
+    SM4_Pool_Slot *slot;
+    SM4_Pool_Shard *shard;
+    uintptr_t offset;
+
+    if (!pool || !ctx) {
+        return;
+    }
+    /* 只接受本池中正在使用的槽位的上下文 */
+    offset = (uintptr_t)ctx - (uintptr_t)pool->slots - offsetof(SM4_Pool_Slot, ctx);
+    if ((uintptr_t)ctx < (uintptr_t)pool->slots + offsetof(SM4_Pool_Slot, ctx) ||
+        offset % sizeof(SM4_Pool_Slot) != 0 || offset / sizeof(SM4_Pool_Slot) >= pool->capacity) {
+        return;
+    }
+    slot = &pool->slots[offset / sizeof(SM4_Pool_Slot)];
+    if (!slot->in_use) {
+        return;
+    }
+
+    /* GCM上下文中剩余的密钥流和GHASH状态与消息有关，归还时清除；密钥材料保留 */
+    if (slot->kind == SM4_POOL_KIND_GCM) {
+        memset(slot->ctx.gcm.keystream, 0, sizeof(slot->ctx.gcm.keystream));
+        memset(slot->ctx.gcm.buf, 0, sizeof(slot->ctx.gcm.buf));
+        memset(slot->ctx.gcm.final_ghash, 0, sizeof(slot->ctx.gcm.final_ghash));
+    }
+    slot->in_use = 0;
+
+    shard = &pool->shards[sm4_pool_home_shard(pool)];
+    SM4_POOL_LOCK(shard);
+    sm4_pool_link(pool, shard, slot);
+    SM4_POOL_UNLOCK(shard);
+}
+
+/* 统计信息 */
+void sm4_ctx_pool_stats(SM4_Ctx_Pool *pool, SM4_Ctx_Pool_Stats *stats) {
+    size_t i, free_count = 0;
+
+    if (!pool || !stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < pool->shard_count; i++) {
+        SM4_POOL_LOCK(&pool->shards[i]);
+        free_count += pool->shards[i].free_count;
+        stats->hits += pool->shards[i].hits;
+        stats->misses += pool->shards[i].misses;
+        stats->steals += pool->shards[i].steals;
+        SM4_POOL_UNLOCK(&pool->shards[i]);
+    }
+    stats->capacity = pool->capacity;
+    stats->in_use = pool->capacity - free_count;
+}
@@ -1,83 +1,172 @@
 #include "sm4_gcm.h"
+#include "sm4_ghash.h"
+#include "sm4_gcm_stitch.h"
+#include "sm4_gcm_internal.h"
+#include "sm4_internal.h"
 #include <string.h>
 
-/* GF(2^128)上的乘法 */
-static void gf128_mul(uint8_t *r, const uint8_t *x, const uint8_t *y) {
-    uint8_t z[16] = {0};
-    uint8_t v[16];
-    uint8_t mask;
-    int i, j;
-    
-    memcpy(v, y, 16);
-    
-    for (i = 0; i < 16; i++) {
-        for (j = 7; j >= 0; j--) {
-            mask = (x[i] >> j) & 1;
-            
-            if (mask) {
-                for (int k = 0; k < 16; k++) {
-                    z[k] ^= v[k];
-                }
-            }
-            
-            /* 右移一位，如果最低位为1，则异或上多项式 */
-            mask = v[15] & 1;
-            for (int k = 15; k > 0; k--) {
-                v[k] = (v[k] >> 1) | ((v[k-1] & 1) << 7);
-            }
-            v[0] >>= 1;
-            
-            /* 如果最低位为1，异或上多项式 x^128 + x^7 + x^2 + x + 1 */
-            if (mask) {
-                v[0] ^= 0xe1; /* 0b11100001 */
-            }
+/* GHASH函数：len必须是16的倍数，由初始化时选中的GHASH后端计算 */
+static void ghash(const SM4_GCM_Context *ctx, uint8_t *output, const uint8_t *input, size_t len) {
+    ctx->ghash->update(ctx, output, input, len / SM4_BLOCK_SIZE);
+}
+
+/* 增加计数器 */
+static void increment_counter(uint8_t *counter) {
+    int i;
+    
+    for (i = 15; i >= 12; i--) {
+        if (++counter[i] != 0) {
+            break;
         }
     }
-    
-    memcpy(r, z, 16);
 }
 
-/* GHASH函数 */
-static void ghash(uint8_t *output, const uint8_t *h, const uint8_t *input, size_t len) {
-    uint8_t tmp[16];
+/* 每批生成的密钥流块数，足够让宽向量后端（zmm两组交错为32块）吃满 */
+#define SM4_GCM_BATCH_BLOCKS 32
+
+/*
+ * 生成blocks块CTR密钥流：先铺开计数器，再一次交给sm4_encrypt_blocks()，
+ * 这样调度层选中的多块内核可以并行加密整批计数器。counter随之前进。
+ */
+static void gcm_ctr_keystream(const SM4_Context *ctx, uint8_t *counter, uint8_t *keystream, size_t blocks) {
     size_t i;
     
-    memcpy(tmp, output, 16);
-    
-    for (i = 0; i < len; i += 16) {
-        /* 异或输入 */
-        for (int j = 0; j < 16; j++) {
-            tmp[j] ^= input[i + j];
-        }
-        
-        /* GF(2^128)上的乘法 */
-        gf128_mul(tmp, tmp, h);
+    for (i = 0; i < blocks; i++) {
+        memcpy(keystream + i * SM4_BLOCK_SIZE, counter, SM4_BLOCK_SIZE);
+        increment_counter(counter);
     }
     
-    memcpy(output, tmp, 16);
+    sm4_encrypt_blocks(ctx, keystream, keystream, blocks);
 }
 
-/* 增加计数器 */
-static void increment_counter(uint8_t *counter) {
-    int i;
-    
-    for (i = 15; i >= 12; i--) {
-        if (++counter[i] != 0) {
-            break;
+/* 缝合内核自检使用的块数：三步，覆盖加密流水线的首尾 */
+#define GCM_STITCH_SELFTEST_BLOCKS 96
+
+/*
+ * 已知答案自检：缝合内核的输出、GHASH状态和计数器必须与逐块的参考实现
+ * （basic后端 + 逐位GHASH）一致。计数器从低32位即将回绕处开始，覆盖inc32的回绕。
+ */
+static int gcm_stitch_selftest(const SM4_GCM_Stitch_Implementation *stitch) {
+    SM4_GCM_Context ctx;
+    uint8_t key[SM4_KEY_SIZE];
+    uint8_t in[GCM_STITCH_SELFTEST_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t out[GCM_STITCH_SELFTEST_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t ref[GCM_STITCH_SELFTEST_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t counter[SM4_BLOCK_SIZE], ref_counter[SM4_BLOCK_SIZE];
+    uint8_t state[SM4_BLOCK_SIZE], ref_state[SM4_BLOCK_SIZE];
+    size_t i, j;
+
+    for (i = 0; i < SM4_KEY_SIZE; i++) {
+        key[i] = (uint8_t)(i * 29 + 7);
+    }
+    for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+        ctx.H[i] = (uint8_t)(i * 37 + 11);
+        state[i] = (uint8_t)(i * 5 + 3);
+        counter[i] = (uint8_t)(i * 17 + 1);
+    }
+    counter[12] = 0xff;
+    counter[13] = 0xff;
+    counter[14] = 0xff;
+    counter[15] = 0xf8;
+    for (i = 0; i < sizeof(in); i++) {
+        in[i] = (uint8_t)(i * 13 + 1);
+    }
+    sm4_basic_impl.set_encrypt_key(&ctx.cipher_ctx, key);
+    stitch->ghash->init(&ctx);
+
+    /* 参考：逐块CTR加密，再对密文做GHASH */
+    memcpy(ref_counter, counter, SM4_BLOCK_SIZE);
+    memcpy(ref_state, state, SM4_BLOCK_SIZE);
+    for (i = 0; i < GCM_STITCH_SELFTEST_BLOCKS; i++) {
+        sm4_basic_impl.crypt_block(&ctx.cipher_ctx, ref + i * SM4_BLOCK_SIZE, ref_counter);
+        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
+            ref[i * SM4_BLOCK_SIZE + j] ^= in[i * SM4_BLOCK_SIZE + j];
         }
+        increment_counter(ref_counter);
+    }
+    sm4_ghash_generic_impl.update(&ctx, ref_state, ref, GCM_STITCH_SELFTEST_BLOCKS);
+
+    stitch->encrypt(&ctx, counter, state, out, in, GCM_STITCH_SELFTEST_BLOCKS);
+    if (memcmp(out, ref, sizeof(out)) != 0 || memcmp(state, ref_state, SM4_BLOCK_SIZE) != 0 ||
+        memcmp(counter, ref_counter, SM4_BLOCK_SIZE) != 0) {
+        return 0;
     }
+
+    /* 原地解密：吸收同一段密文，恢复明文 */
+    counter[12] = 0xff;
+    counter[13] = 0xff;
+    counter[14] = 0xff;
+    counter[15] = 0xf8;
+    for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+        state[i] = (uint8_t)(i * 5 + 3);
+    }
+    stitch->decrypt(&ctx, counter, state, out, out, GCM_STITCH_SELFTEST_BLOCKS);
+    return memcmp(out, in, sizeof(in)) == 0 && memcmp(state, ref_state, SM4_BLOCK_SIZE) == 0 &&
+           memcmp(counter, ref_counter, SM4_BLOCK_SIZE) == 0;
 }
 
-/* 初始化SM4-GCM上下文 */
-int sm4_gcm_init(SM4_GCM_Context *ctx, const uint8_t *key, const uint8_t *iv, size_t iv_len) {
+/* 当前主机上可用（CPU支持且通过自检）的缝合内核，只在加载时（或首次调用时）写入一次 */
+static const SM4_GCM_Stitch_Implementation *gcm_stitch = NULL;
+static int gcm_stitch_resolved = 0;
+
+static void gcm_stitch_resolve(void) {
+    SM4_CPU_Features features = sm4_get_cpu_features();
+
+    if (sm4_gcm_stitch_gfni_impl.is_supported(&features) && gcm_stitch_selftest(&sm4_gcm_stitch_gfni_impl)) {
+        gcm_stitch = &sm4_gcm_stitch_gfni_impl;
+    }
+    gcm_stitch_resolved = 1;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((constructor))
+static void gcm_stitch_init(void) {
+    gcm_stitch_resolve();
+}
+#endif
+
+/*
+ * 该上下文能否使用缝合内核：缝合内核直接实现了某个SM4后端和某个GHASH后端，
+ * 只有调度层当前的SM4后端和上下文初始化时选中的GHASH后端都与之相同时才替换，
+ * 这样强制指定后端（测试、对比）时结果仍然来自被指定的实现。
+ */
+static const SM4_GCM_Stitch_Implementation *gcm_get_stitch(const SM4_GCM_Context *ctx) {
+    if (!gcm_stitch_resolved) {
+        gcm_stitch_resolve();
+    }
+    if (gcm_stitch && ctx->ghash == gcm_stitch->ghash && sm4_get_active_implementation() == gcm_stitch->cipher) {
+        return gcm_stitch;
+    }
+    return NULL;
+}
+
+/* 只依赖密钥的部分：计算H并预计算GHASH表（轮密钥已在ctx->cipher_ctx中） */
+void sm4_gcm_setup_hash_key(SM4_GCM_Context *ctx) {
     uint8_t zero[SM4_BLOCK_SIZE] = {0};
     
-    /* 初始化SM4上下文 */
-    sm4_set_encrypt_key(&ctx->cipher_ctx, key);
-    
     /* 计算GHASH密钥H = E_K(0) */
     sm4_encrypt_block(&ctx->cipher_ctx, ctx->H, zero);
     
+    /* 选定GHASH后端并预计算它的表，之后的GHASH（包括非96位IV的处理）都依赖它 */
+    ctx->ghash = sm4_ghash_get_implementation();
+    ctx->ghash->init(ctx);
+    
+    /* 新设置的密钥没有预取 */
+    ctx->prefetch = NULL;
+}
+
+/* 初始化SM4-GCM上下文 */
+int sm4_gcm_init(SM4_GCM_Context *ctx, const uint8_t *key, const uint8_t *iv, size_t iv_len) {
+    /* 初始化SM4上下文 */
+    sm4_set_encrypt_key(&ctx->cipher_ctx, key);
+    sm4_gcm_setup_hash_key(ctx);
+    sm4_gcm_setup_iv(ctx, iv, iv_len);
+    
+    return 0;
+}
+
+/* 依赖IV的部分：J0、计数器，并清空上一条消息的状态 */
+void sm4_gcm_setup_iv(SM4_GCM_Context *ctx, const uint8_t *iv, size_t iv_len) {
     /* 初始化计数器 */
     if (iv_len == 12) {
         /* 96位IV */
@@ -94,14 +183,14 @@ int sm4_gcm_init(SM4_GCM_Context *ctx, const uint8_t *key, const uint8_t *iv, si
         
         /* 处理完整块 */
         for (size_t i = 0; i < full_blocks; i++) {
-            ghash(tmp, ctx->H, iv + i * 16, 16);
+            ghash(ctx, tmp, iv + i * 16, 16);
         }
         
         /* 处理剩余字节 */
         if (remainder) {
             uint8_t last_block[16] = {0};
             memcpy(last_block, iv + full_blocks * 16, remainder);
-            ghash(tmp, ctx->H, last_block, 16);
+            ghash(ctx, tmp, last_block, 16);
         }
         
         /* 添加长度信息 */
@@ -116,145 +205,237 @@ int sm4_gcm_init(SM4_GCM_Context *ctx, const uint8_t *key, const uint8_t *iv, si
         len_block[14] = (uint8_t)(bit_len >> 8);
         len_block[15] = (uint8_t)bit_len;
         
-        ghash(tmp, ctx->H, len_block, 16);
+        ghash(ctx, tmp, len_block, 16);
         memcpy(ctx->J0, tmp, 16);
     }
     
+    /* 第一个密文块使用J0 + 1 */
+    memcpy(ctx->counter, ctx->J0, SM4_BLOCK_SIZE);
+    increment_counter(ctx->counter);
+    
     /* 初始化其他字段 */
     ctx->len_a = 0;
     ctx->len_c = 0;
     ctx->buf_len = 0;
+    ctx->text_started = 0;
     memset(ctx->final_ghash, 0, SM4_BLOCK_SIZE);
-    
-    return 0;
+}
+
+/* 把缓冲区中不完整的块补零后吸收进GHASH */
+static void gcm_flush_buf(SM4_GCM_Context *ctx) {
+    if (ctx->buf_len > 0) {
+        memset(ctx->buf + ctx->buf_len, 0, SM4_BLOCK_SIZE - ctx->buf_len);
+        ghash(ctx, ctx->final_ghash, ctx->buf, SM4_BLOCK_SIZE);
+        ctx->buf_len = 0;
+    }
 }
 
 /* 处理附加认证数据 */
 int sm4_gcm_aad(SM4_GCM_Context *ctx, const uint8_t *aad, size_t aad_len) {
-    size_t full_blocks = aad_len / 16;
-    size_t remainder = aad_len % 16;
+    size_t n;
     
-    /* 处理完整块 */
-    if (full_blocks > 0) {
-        ghash(ctx->final_ghash, ctx->H, aad, full_blocks * 16);
+    /* AAD必须全部在密文之前 */
+    if (ctx->text_started) {
+        return -1;
     }
     
-    /* 处理剩余字节 */
-    if (remainder) {
-        uint8_t last_block[16] = {0};
-        memcpy(last_block, aad + full_blocks * 16, remainder);
-        ghash(ctx->final_ghash, ctx->H, last_block, 16);
+    ctx->len_a += aad_len;
+    
+    /* 先补满上次留下的不完整块 */
+    if (ctx->buf_len > 0) {
+        n = SM4_BLOCK_SIZE - ctx->buf_len;
+        if (n > aad_len) {
+            n = aad_len;
+        }
+        memcpy(ctx->buf + ctx->buf_len, aad, n);
+        ctx->buf_len += n;
+        aad += n;
+        aad_len -= n;
+        
+        if (ctx->buf_len < SM4_BLOCK_SIZE) {
+            return 0;
+        }
+        ghash(ctx, ctx->final_ghash, ctx->buf, SM4_BLOCK_SIZE);
+        ctx->buf_len = 0;
     }
     
-    ctx->len_a += aad_len;
+    /* 处理完整块 */
+    n = aad_len - aad_len % SM4_BLOCK_SIZE;
+    if (n > 0) {
+        ghash(ctx, ctx->final_ghash, aad, n);
+    }
+    
+    /* 剩余字节留到下次调用（或开始加密时补零） */
+    memcpy(ctx->buf, aad + n, aad_len - n);
+    ctx->buf_len = aad_len - n;
     
     return 0;
 }
 
-/* SM4-GCM加密 */
-int sm4_gcm_encrypt(SM4_GCM_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
-    uint8_t counter[SM4_BLOCK_SIZE];
-    uint8_t encrypted_counter[SM4_BLOCK_SIZE];
-    size_t i, j;
-    
-    /* 复制初始计数器 */
-    memcpy(counter, ctx->J0, SM4_BLOCK_SIZE);
-    increment_counter(counter); /* 从1开始 */
+/* 计数器的低32位加上n（模2^32），与逐块increment_counter()一致 */
+static void gcm_counter_add(uint8_t *counter, uint64_t n) {
+    uint32_t c = ((uint32_t)counter[12] << 24) | ((uint32_t)counter[13] << 16) |
+                 ((uint32_t)counter[14] << 8) | (uint32_t)counter[15];
+    
+    c += (uint32_t)n;
+    counter[12] = (uint8_t)(c >> 24);
+    counter[13] = (uint8_t)(c >> 16);
+    counter[14] = (uint8_t)(c >> 8);
+    counter[15] = (uint8_t)c;
+}
+
+/*
+ * 用预取好的密钥流处理从块边界开始的len字节，调用路径上只有异或和GHASH。
+ * 尾部不完整块的密钥流复制到ctx->keystream，和现算时一样留给下次调用或sm4_gcm_finish()。
+ */
+static void gcm_crypt_prefetched(SM4_GCM_Context *ctx, uint8_t *out, const uint8_t *in, size_t len,
+                                 const uint8_t *keystream, int encrypt) {
+    size_t full = len - len % SM4_BLOCK_SIZE;
+    size_t i;
     
-    /* 处理完整块 */
-    for (i = 0; i + SM4_BLOCK_SIZE <= len; i += SM4_BLOCK_SIZE) {
-        /* 加密计数器 */
-        sm4_encrypt_block(&ctx->cipher_ctx, encrypted_counter, counter);
-        
-        /* 异或明文得到密文 */
-        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
-            out[i + j] = in[i + j] ^ encrypted_counter[j];
+    if (full > 0) {
+        if (!encrypt) {
+            ghash(ctx, ctx->final_ghash, in, full);
+        }
+        for (i = 0; i < full; i++) {
+            out[i] = in[i] ^ keystream[i];
+        }
+        if (encrypt) {
+            ghash(ctx, ctx->final_ghash, out, full);
         }
-        
-        /* 更新GHASH */
-        ghash(ctx->final_ghash, ctx->H, out + i, SM4_BLOCK_SIZE);
-        
-        /* 增加计数器 */
-        increment_counter(counter);
     }
     
-    /* 处理最后一个不完整块 */
-    if (i < len) {
-        size_t remainder = len - i;
-        
-        /* 加密计数器 */
-        sm4_encrypt_block(&ctx->cipher_ctx, encrypted_counter, counter);
-        
-        /* 异或明文得到密文 */
-        for (j = 0; j < remainder; j++) {
-            out[i + j] = in[i + j] ^ encrypted_counter[j];
+    if (len > full) {
+        memcpy(ctx->keystream, keystream + full, SM4_BLOCK_SIZE);
+        for (i = 0; i < len - full; i++) {
+            ctx->buf[i] = encrypt ? (uint8_t)(in[full + i] ^ ctx->keystream[i]) : in[full + i];
+            out[full + i] = in[full + i] ^ ctx->keystream[i];
         }
-        
-        /* 更新GHASH */
-        uint8_t last_block[SM4_BLOCK_SIZE] = {0};
-        memcpy(last_block, out + i, remainder);
-        ghash(ctx->final_ghash, ctx->H, last_block, SM4_BLOCK_SIZE);
+        ctx->buf_len = len - full;
     }
     
-    ctx->len_c += len;
-    
-    return 0;
+    /* 计数器照样前进，超出预取长度的部分接着现算 */
+    gcm_counter_add(ctx->counter, (len + SM4_BLOCK_SIZE - 1) / SM4_BLOCK_SIZE);
 }
 
-/* SM4-GCM解密 */
-int sm4_gcm_decrypt(SM4_GCM_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
-    uint8_t counter[SM4_BLOCK_SIZE];
-    uint8_t encrypted_counter[SM4_BLOCK_SIZE];
-    size_t i, j;
+/*
+ * GCM加密/解密的公共部分。计数器、不完整块的密钥流和尚未吸收的密文都保存在
+ * 上下文中，一条消息可以分任意多次调用处理，结果与一次处理整条消息相同。
+ * 解密时GHASH吸收的是输入，先于写出读取，允许原地操作。
+ */
+static int gcm_crypt(SM4_GCM_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, int encrypt) {
+    uint8_t keystream[SM4_GCM_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    const SM4_GCM_Stitch_Implementation *stitch;
+    const uint8_t *prefetched;
+    size_t i, n;
+    uint8_t x;
+    
+    /* 32位计数器决定了单条消息的上限 */
+    if (len > SM4_GCM_MAX_TEXT_LEN - ctx->len_c) {
+        return -1;
+    }
+    ctx->len_c += len;
     
-    /* 复制初始计数器 */
-    memcpy(counter, ctx->J0, SM4_BLOCK_SIZE);
-    increment_counter(counter); /* 从1开始 */
+    /* 第一次加密/解密时结束AAD，其不完整块补零 */
+    if (!ctx->text_started) {
+        gcm_flush_buf(ctx);
+        ctx->text_started = 1;
+    }
     
-    /* 处理完整块 */
-    for (i = 0; i + SM4_BLOCK_SIZE <= len; i += SM4_BLOCK_SIZE) {
-        /* 更新GHASH */
-        ghash(ctx->final_ghash, ctx->H, in + i, SM4_BLOCK_SIZE);
-        
-        /* 加密计数器 */
-        sm4_encrypt_block(&ctx->cipher_ctx, encrypted_counter, counter);
+    /* 先用完上次剩余的密钥流，凑满的密文块吸收进GHASH */
+    while (len > 0 && ctx->buf_len > 0) {
+        x = *in++;
+        *out = x ^ ctx->keystream[ctx->buf_len];
+        ctx->buf[ctx->buf_len++] = encrypt ? *out : x;
+        out++;
+        len--;
         
-        /* 异或密文得到明文 */
-        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
-            out[i + j] = in[i + j] ^ encrypted_counter[j];
+        if (ctx->buf_len == SM4_BLOCK_SIZE) {
+            ghash(ctx, ctx->final_ghash, ctx->buf, SM4_BLOCK_SIZE);
+            ctx->buf_len = 0;
         }
-        
-        /* 增加计数器 */
-        increment_counter(counter);
     }
     
-    /* 处理最后一个不完整块 */
-    if (i < len) {
-        size_t remainder = len - i;
-        
-        /* 更新GHASH */
-        uint8_t last_block[SM4_BLOCK_SIZE] = {0};
-        memcpy(last_block, in + i, remainder);
-        ghash(ctx->final_ghash, ctx->H, last_block, SM4_BLOCK_SIZE);
-        
-        /* 加密计数器 */
-        sm4_encrypt_block(&ctx->cipher_ctx, encrypted_counter, counter);
+    /* 这一段的密钥流已经预取好时不再加密计数器 */
+    if (len > 0 && ctx->prefetch != NULL) {
+        prefetched = sm4_gcm_prefetch_keystream(ctx, ctx->len_c - len, len);
+        if (prefetched != NULL) {
+            gcm_crypt_prefetched(ctx, out, in, len, prefetched, encrypt);
+            return 0;
+        }
+    }
+    
+    /* 整步的部分交给缝合内核 */
+    stitch = gcm_get_stitch(ctx);
+    if (stitch) {
+        n = len / (stitch->step * SM4_BLOCK_SIZE) * stitch->step;
+        if (n > 0) {
+            if (encrypt) {
+                stitch->encrypt(ctx, ctx->counter, ctx->final_ghash, out, in, n);
+            } else {
+                stitch->decrypt(ctx, ctx->counter, ctx->final_ghash, out, in, n);
+            }
+            in += n * SM4_BLOCK_SIZE;
+            out += n * SM4_BLOCK_SIZE;
+            len -= n * SM4_BLOCK_SIZE;
+        }
+    }
+    
+    /* 其余整块按批处理 */
+    while (len >= SM4_BLOCK_SIZE) {
+        n = len / SM4_BLOCK_SIZE;
+        if (n > SM4_GCM_BATCH_BLOCKS) {
+            n = SM4_GCM_BATCH_BLOCKS;
+        }
         
-        /* 异或密文得到明文 */
-        for (j = 0; j < remainder; j++) {
-            out[i + j] = in[i + j] ^ encrypted_counter[j];
+        if (!encrypt) {
+            ghash(ctx, ctx->final_ghash, in, n * SM4_BLOCK_SIZE);
+        }
+        gcm_ctr_keystream(&ctx->cipher_ctx, ctx->counter, keystream, n);
+        for (i = 0; i < n * SM4_BLOCK_SIZE; i++) {
+            out[i] = in[i] ^ keystream[i];
         }
+        if (encrypt) {
+            ghash(ctx, ctx->final_ghash, out, n * SM4_BLOCK_SIZE);
+        }
+        
+        in += n * SM4_BLOCK_SIZE;
+        out += n * SM4_BLOCK_SIZE;
+        len -= n * SM4_BLOCK_SIZE;
     }
     
-    ctx->len_c += len;
+    /* 不足一块的尾部：剩余密钥流和已有的密文留给下次调用或sm4_gcm_finish() */
+    if (len > 0) {
+        gcm_ctr_keystream(&ctx->cipher_ctx, ctx->counter, ctx->keystream, 1);
+        for (i = 0; i < len; i++) {
+            x = in[i];
+            out[i] = x ^ ctx->keystream[i];
+            ctx->buf[i] = encrypt ? out[i] : x;
+        }
+        ctx->buf_len = len;
+    }
     
     return 0;
 }
 
+/* SM4-GCM加密 */
+int sm4_gcm_encrypt(SM4_GCM_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
+    return gcm_crypt(ctx, out, in, len, 1);
+}
+
+/* SM4-GCM解密 */
+int sm4_gcm_decrypt(SM4_GCM_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
+    return gcm_crypt(ctx, out, in, len, 0);
+}
+
 /* 完成SM4-GCM操作并生成认证标签 */
 int sm4_gcm_finish(SM4_GCM_Context *ctx, uint8_t *tag, size_t tag_len) {
     uint8_t len_block[SM4_BLOCK_SIZE];
     uint8_t auth_tag[SM4_BLOCK_SIZE];
+    const uint8_t *tag_mask;
+    
+    /* 最后一个不完整块（没有密文时是AAD的不完整块）补零 */
+    gcm_flush_buf(ctx);
     
     /* 添加长度信息 */
     uint64_t bit_len_a = ctx->len_a * 8;
@@ -278,10 +459,15 @@ int sm4_gcm_finish(SM4_GCM_Context *ctx, uint8_t *tag, size_t tag_len) {
     len_block[14] = (uint8_t)(bit_len_c >> 8);
     len_block[15] = (uint8_t)bit_len_c;
     
-    ghash(ctx->final_ghash, ctx->H, len_block, SM4_BLOCK_SIZE);
+    ghash(ctx, ctx->final_ghash, len_block, SM4_BLOCK_SIZE);
     
-    /* 加密初始计数器 */
-    sm4_encrypt_block(&ctx->cipher_ctx, auth_tag, ctx->J0);
+    /* 加密初始计数器（已经预取时直接使用） */
+    tag_mask = ctx->prefetch != NULL ? sm4_gcm_prefetch_tag_mask(ctx) : NULL;
+    if (tag_mask != NULL) {
+        memcpy(auth_tag, tag_mask, SM4_BLOCK_SIZE);
+    } else {
+        sm4_encrypt_block(&ctx->cipher_ctx, auth_tag, ctx->J0);
+    }
     
     /* 异或GHASH结果得到认证标签 */
     for (size_t i = 0; i < SM4_BLOCK_SIZE; i++) {
@@ -294,6 +480,21 @@ int sm4_gcm_finish(SM4_GCM_Context *ctx, uint8_t *tag, size_t tag_len) {
     return 0;
 }
 
+/* 比较标签，不因第一个不同的字节提前返回；tag_len必须在1..16之间 */
+static int gcm_check_tag(const uint8_t *expected, const uint8_t *tag, size_t tag_len) {
+    uint8_t diff = 0;
+    size_t i;
+    
+    if (tag_len == 0 || tag_len > SM4_BLOCK_SIZE) {
+        return -1;
+    }
+    for (i = 0; i < tag_len; i++) {
+        diff |= expected[i] ^ tag[i];
+    }
+    
+    return diff == 0 ? 0 : -1;
+}
+
 /* 一步完成SM4-GCM加密和认证 */
 int sm4_gcm_encrypt_and_tag(const uint8_t *key, const uint8_t *iv, size_t iv_len,
                            const uint8_t *aad, size_t aad_len,
@@ -310,7 +511,9 @@ int sm4_gcm_encrypt_and_tag(const uint8_t *key, const uint8_t *iv, size_t iv_len
     }
     
     /* 加密 */
-    sm4_gcm_encrypt(&ctx, out, in, in_len);
+    if (sm4_gcm_encrypt(&ctx, out, in, in_len) != 0) {
+        return -1;
+    }
     
     /* 生成标签 */
     sm4_gcm_finish(&ctx, tag, tag_len);
@@ -337,18 +540,15 @@ int sm4_gcm_decrypt_and_verify(const uint8_t *key, const uint8_t *iv, size_t iv_
     }
     
     /* 解密 */
-    sm4_gcm_decrypt(&ctx, out, in, in_len);
+    if (sm4_gcm_decrypt(&ctx, out, in, in_len) != 0) {
+        return -1;
+    }
     
     /* 生成标签 */
     sm4_gcm_finish(&ctx, calculated_tag, SM4_BLOCK_SIZE);
     
     /* 验证标签 */
-    for (size_t i = 0; i < tag_len; i++) {
-        if (calculated_tag[i] != tag[i]) {
-            result = -1;
-            break;
-        }
-    }
+    result = gcm_check_tag(calculated_tag, tag, tag_len);
     
     /* 如果验证失败，清除输出 */
     if (result != 0) {
@@ -356,4 +556,159 @@ int sm4_gcm_decrypt_and_verify(const uint8_t *key, const uint8_t *iv, size_t iv_
     }
     
     return result;
+}
+
+/* 并行GCM每段至少处理的数据量，更小的分段不值得交给其他线程 */
+#define SM4_GCM_PARALLEL_MIN_SEGMENT (256 * 1024)
+
+/* 并行GCM最多的分段数 */
+#define SM4_GCM_PARALLEL_MAX_SEGMENTS 64
+
+/* 并行GCM作业：每段从自己的计数器偏移开始CTR，并计算该段密文的部分GHASH */
+typedef struct {
+    const SM4_GCM_Context *ctx;  // 已处理完AAD的上下文，各段只读
+    uint8_t *out;
+    const uint8_t *in;
+    size_t len;
+    size_t segment;              // 每段字节数（16的倍数），最后一段可能更短
+    int encrypt;
+    uint8_t partial[SM4_GCM_PARALLEL_MAX_SEGMENTS][SM4_BLOCK_SIZE]; // 各段从0开始的GHASH
+} GCM_Parallel_Job;
+
+/* 处理一段：复制上下文，定位计数器，GHASH状态清零后走普通的流式路径 */
+static void gcm_parallel_task(void *arg, size_t index) {
+    GCM_Parallel_Job *job = (GCM_Parallel_Job *)arg;
+    SM4_GCM_Context local = *job->ctx;
+    size_t off = index * job->segment;
+    size_t n = job->len - off < job->segment ? job->len - off : job->segment;
+    
+    gcm_counter_add(local.counter, off / SM4_BLOCK_SIZE);
+    memset(local.final_ghash, 0, SM4_BLOCK_SIZE);
+    
+    gcm_crypt(&local, job->out + off, job->in + off, n, job->encrypt);
+    gcm_flush_buf(&local);
+    memcpy(job->partial[index], local.final_ghash, SM4_BLOCK_SIZE);
+}
+
+/* r = H^e（e >= 1），平方-乘 */
+static void gcm_h_pow(uint8_t *r, const uint8_t *h, uint64_t e) {
+    int bit = 63;
+    
+    while (!((e >> bit) & 1)) {
+        bit--;
+    }
+    memcpy(r, h, SM4_BLOCK_SIZE);
+    for (bit--; bit >= 0; bit--) {
+        sm4_ghash_mul(r, r, r);
+        if ((e >> bit) & 1) {
+            sm4_ghash_mul(r, r, h);
+        }
+    }
+}
+
+/*
+ * GHASH是线性的：从状态Y出发吸收k个块，等于Y·H^k再异或上从0出发吸收这k个块的结果。
+ * 因此各段的部分GHASH按顺序合并：Y = Y·H^k_i ^ P_i，结果与单线程逐块计算完全相同。
+ */
+static void gcm_parallel_combine(SM4_GCM_Context *ctx, const GCM_Parallel_Job *job, size_t segments) {
+    uint8_t h_seg[SM4_BLOCK_SIZE];
+    uint8_t h_last[SM4_BLOCK_SIZE];
+    size_t i, j, last_len = job->len - (segments - 1) * job->segment;
+    
+    gcm_h_pow(h_seg, ctx->H, job->segment / SM4_BLOCK_SIZE);
+    gcm_h_pow(h_last, ctx->H, (last_len + SM4_BLOCK_SIZE - 1) / SM4_BLOCK_SIZE);
+    
+    for (i = 0; i < segments; i++) {
+        sm4_ghash_mul(ctx->final_ghash, ctx->final_ghash, i + 1 < segments ? h_seg : h_last);
+        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
+            ctx->final_ghash[j] ^= job->partial[i][j];
+        }
+    }
+}
+
+/* 并行加密/解密整条消息，完成后ctx处于可以sm4_gcm_finish()的状态 */
+static int gcm_crypt_parallel(SM4_GCM_Context *ctx, uint8_t *out, const uint8_t *in, size_t len,
+                              size_t threads, int encrypt) {
+    GCM_Parallel_Job job;
+    size_t segments, segment;
+    
+    if (threads == 0) {
+        threads = sm4_parallel_default_threads();
+    }
+    if (threads > SM4_GCM_PARALLEL_MAX_SEGMENTS) {
+        threads = SM4_GCM_PARALLEL_MAX_SEGMENTS;
+    }
+    
+    /* 每个线程一段，段长按块对齐且不小于SM4_GCM_PARALLEL_MIN_SEGMENT */
+    segment = (len / threads + SM4_BLOCK_SIZE - 1) / SM4_BLOCK_SIZE * SM4_BLOCK_SIZE;
+    if (segment < SM4_GCM_PARALLEL_MIN_SEGMENT) {
+        segment = SM4_GCM_PARALLEL_MIN_SEGMENT;
+    }
+    segments = (len + segment - 1) / segment;
+    
+    if (segments <= 1 || len > SM4_GCM_MAX_TEXT_LEN) {
+        return gcm_crypt(ctx, out, in, len, encrypt);
+    }
+    
+    /* 结束AAD，之后各段从J0 + 1 + 段内首块序号开始 */
+    gcm_flush_buf(ctx);
+    ctx->text_started = 1;
+    
+    job.ctx = ctx;
+    job.out = out;
+    job.in = in;
+    job.len = len;
+    job.segment = segment;
+    job.encrypt = encrypt;
+    sm4_parallel_run(segments, threads, gcm_parallel_task, &job);
+    
+    gcm_parallel_combine(ctx, &job, segments);
+    ctx->len_c = len;
+    return 0;
+}
+
+/* 多线程SM4-GCM加密和认证 */
+int sm4_gcm_encrypt_parallel(const uint8_t *key, const uint8_t *iv, size_t iv_len,
+                             const uint8_t *aad, size_t aad_len,
+                             const uint8_t *in, size_t in_len,
+                             uint8_t *out, uint8_t *tag, size_t tag_len, size_t threads) {
+    SM4_GCM_Context ctx;
+    
+    sm4_gcm_init(&ctx, key, iv, iv_len);
+    if (aad_len > 0) {
+        sm4_gcm_aad(&ctx, aad, aad_len);
+    }
+    
+    if (gcm_crypt_parallel(&ctx, out, in, in_len, threads, 1) != 0) {
+        return -1;
+    }
+    
+    return sm4_gcm_finish(&ctx, tag, tag_len);
+}
+
+/* 多线程SM4-GCM解密和验证 */
+int sm4_gcm_decrypt_parallel(const uint8_t *key, const uint8_t *iv, size_t iv_len,
+                             const uint8_t *aad, size_t aad_len,
+                             const uint8_t *in, size_t in_len,
+                             const uint8_t *tag, size_t tag_len,
+                             uint8_t *out, size_t threads) {
+    SM4_GCM_Context ctx;
+    uint8_t calculated_tag[SM4_BLOCK_SIZE];
+    
+    sm4_gcm_init(&ctx, key, iv, iv_len);
+    if (aad_len > 0) {
+        sm4_gcm_aad(&ctx, aad, aad_len);
+    }
+    
+    if (gcm_crypt_parallel(&ctx, out, in, in_len, threads, 0) != 0) {
+        return -1;
+    }
+    
+    sm4_gcm_finish(&ctx, calculated_tag, SM4_BLOCK_SIZE);
+    if (gcm_check_tag(calculated_tag, tag, tag_len) != 0) {
+        memset(out, 0, in_len);
+        return -1;
+    }
+    
+    return 0;
 }
\ No newline at end of file
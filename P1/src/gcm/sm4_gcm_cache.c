@@ -0,0 +1,266 @@
+#include "sm4_gcm_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#define SM4_GCM_CACHE_LOCKED 1
+#else
+#define SM4_GCM_CACHE_LOCKED 0
+#endif
+
+/*
+ * GCM密钥缓存：密钥指纹 -> 只依赖密钥的上下文模板（轮密钥、H、GHASH预计算表）。
+ *
+ * 指纹只用来选哈希桶，命中时还要比较完整密钥。所有条目在创建时一次分配，
+ * 用双向链表维护最近使用顺序，满了以后复用链表尾部（最久未用）的条目。
+ * 被淘汰和销毁的条目会清零，不在内存中残留密钥材料。
+ */
+
+typedef struct sm4_gcm_cache_entry {
+    uint8_t key[SM4_KEY_SIZE];
+    SM4_GCM_Context tmpl;                   // sm4_gcm_setup_hash_key()之后的上下文
+    uint64_t fingerprint;
+    struct sm4_gcm_cache_entry *hash_next;  // 同一个桶中的下一项
+    struct sm4_gcm_cache_entry *prev;       // LRU链表，靠近表头的更新
+    struct sm4_gcm_cache_entry *next;
+} SM4_GCM_Cache_Entry;
+
+struct sm4_gcm_key_cache {
+    SM4_GCM_Cache_Entry *entries;   // capacity个条目
+    SM4_GCM_Cache_Entry **buckets;  // bucket_mask + 1个桶
+    size_t capacity;
+    size_t count;                   // 已使用的条目数
+    size_t bucket_mask;
+    SM4_GCM_Cache_Entry *head;      // 最近使用
+    SM4_GCM_Cache_Entry *tail;      // 最久未用
+    uint64_t hits;
+    uint64_t misses;
+#if SM4_GCM_CACHE_LOCKED
+    pthread_mutex_t lock;
+#endif
+};
+
+#if SM4_GCM_CACHE_LOCKED
+#define SM4_GCM_CACHE_LOCK(c) pthread_mutex_lock(&(c)->lock)
+#define SM4_GCM_CACHE_UNLOCK(c) pthread_mutex_unlock(&(c)->lock)
+#else
+#define SM4_GCM_CACHE_LOCK(c) ((void)0)
+#define SM4_GCM_CACHE_UNLOCK(c) ((void)0)
+#endif
+
+/* 密钥指纹：两个64位字各自混合后合并（只用于分桶，不是密码学摘要） */
+static uint64_t sm4_gcm_key_fingerprint(const uint8_t *key) {
+    uint64_t a, b;
+
+    memcpy(&a, key, 8);
+    memcpy(&b, key + 8, 8);
+    a ^= b * 0x9e3779b97f4a7c15ULL;
+    a ^= a >> 33;
+    a *= 0xff51afd7ed558ccdULL;
+    a ^= a >> 33;
+    a *= 0xc4ceb9fe1a85ec53ULL;
+    return a ^ (a >> 33);
+}
+
+static void sm4_gcm_cache_unlink(SM4_GCM_Key_Cache *cache, SM4_GCM_Cache_Entry *e) {
+    if (e->prev) {
+        e->prev->next = e->next;
+    } else {
+        cache->head = e->next;
+    }
+    if (e->next) {
+        e->next->prev = e->prev;
+    } else {
+        cache->tail = e->prev;
+    }
+}
+
+static void sm4_gcm_cache_push_front(SM4_GCM_Key_Cache *cache, SM4_GCM_Cache_Entry *e) {
+    e->prev = NULL;
+    e->next = cache->head;
+    if (cache->head) {
+        cache->head->prev = e;
+    } else {
+        cache->tail = e;
+    }
+    cache->head = e;
+}
+
+static SM4_GCM_Cache_Entry *sm4_gcm_cache_find(SM4_GCM_Key_Cache *cache, const uint8_t *key, uint64_t fp) {
+    SM4_GCM_Cache_Entry *e;
+
+    for (e = cache->buckets[fp & cache->bucket_mask]; e; e = e->hash_next) {
+        if (e->fingerprint == fp && memcmp(e->key, key, SM4_KEY_SIZE) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* 从哈希桶中摘除条目 */
+static void sm4_gcm_cache_unhash(SM4_GCM_Key_Cache *cache, SM4_GCM_Cache_Entry *e) {
+    SM4_GCM_Cache_Entry **p = &cache->buckets[e->fingerprint & cache->bucket_mask];
+
+    while (*p != e) {
+        p = &(*p)->hash_next;
+    }
+    *p = e->hash_next;
+}
+
+/* 插入模板（调用时持有锁）；同一密钥已被其他线程插入时只更新顺序 */
+static void sm4_gcm_cache_insert(SM4_GCM_Key_Cache *cache, const uint8_t *key, uint64_t fp,
+                                 const SM4_GCM_Context *tmpl) {
+    SM4_GCM_Cache_Entry *e = sm4_gcm_cache_find(cache, key, fp);
+
+    if (e) {
+        sm4_gcm_cache_unlink(cache, e);
+        sm4_gcm_cache_push_front(cache, e);
+        return;
+    }
+
+    if (cache->count < cache->capacity) {
+        e = &cache->entries[cache->count++];
+    } else {
+        /* 淘汰最久未用的条目 */
+        e = cache->tail;
+        sm4_gcm_cache_unlink(cache, e);
+        sm4_gcm_cache_unhash(cache, e);
+        memset(e, 0, sizeof(*e));
+    }
+
+    memcpy(e->key, key, SM4_KEY_SIZE);
+    e->tmpl = *tmpl;
+    e->fingerprint = fp;
+    e->hash_next = cache->buckets[fp & cache->bucket_mask];
+    cache->buckets[fp & cache->bucket_mask] = e;
+    sm4_gcm_cache_push_front(cache, e);
+}
+
+SM4_GCM_Key_Cache *sm4_gcm_key_cache_create(size_t capacity) {
+    SM4_GCM_Key_Cache *cache;
+    size_t buckets = 1;
+
+    if (capacity == 0) {
+        return NULL;
+    }
+
+    /* 桶数取不小于2倍容量的2的幂，链表平均长度不超过0.5 */
+    while (buckets < 2 * capacity) {
+        buckets <<= 1;
+    }
+
+    cache = (SM4_GCM_Key_Cache *)calloc(1, sizeof(*cache));
+    if (!cache) {
+        return NULL;
+    }
+    cache->entries = (SM4_GCM_Cache_Entry *)calloc(capacity, sizeof(SM4_GCM_Cache_Entry));
+    cache->buckets = (SM4_GCM_Cache_Entry **)calloc(buckets, sizeof(SM4_GCM_Cache_Entry *));
+    if (!cache->entries || !cache->buckets) {
+        free(cache->entries);
+        free(cache->buckets);
+        free(cache);
+        return NULL;
+    }
+    cache->capacity = capacity;
+    cache->bucket_mask = buckets - 1;
+#if SM4_GCM_CACHE_LOCKED
+    pthread_mutex_init(&cache->lock, NULL);
+#endif
+
+    return cache;
+}
+
+void sm4_gcm_key_cache_destroy(SM4_GCM_Key_Cache *cache) {
+    if (!cache) {
+        return;
+    }
+
+    memset(cache->entries, 0, cache->capacity * sizeof(SM4_GCM_Cache_Entry));
+    free(cache->entries);
+    free(cache->buckets);
+#if SM4_GCM_CACHE_LOCKED
+    pthread_mutex_destroy(&cache->lock);
+#endif
+    free(cache);
+}
+
+/* 用缓存的模板初始化GCM上下文 */
+int sm4_gcm_init_cached(SM4_GCM_Key_Cache *cache, SM4_GCM_Context *ctx,
+                        const uint8_t *key, const uint8_t *iv, size_t iv_len) {
+    SM4_GCM_Cache_Entry *e;
+    uint64_t fp;
+
+    if (!cache) {
+        return sm4_gcm_init(ctx, key, iv, iv_len);
+    }
+
+    fp = sm4_gcm_key_fingerprint(key);
+
+    SM4_GCM_CACHE_LOCK(cache);
+    e = sm4_gcm_cache_find(cache, key, fp);
+    if (e) {
+        sm4_gcm_cache_unlink(cache, e);
+        sm4_gcm_cache_push_front(cache, e);
+        *ctx = e->tmpl;
+        cache->hits++;
+        SM4_GCM_CACHE_UNLOCK(cache);
+    } else {
+        cache->misses++;
+        SM4_GCM_CACHE_UNLOCK(cache);
+
+        /* 未命中：在锁外完成密钥扩展和H的预计算，再插入 */
+        sm4_set_encrypt_key(&ctx->cipher_ctx, key);
+        sm4_gcm_setup_hash_key(ctx);
+
+        SM4_GCM_CACHE_LOCK(cache);
+        sm4_gcm_cache_insert(cache, key, fp, ctx);
+        SM4_GCM_CACHE_UNLOCK(cache);
+    }
+
+    sm4_gcm_setup_iv(ctx, iv, iv_len);
+    return 0;
+}
+
+/* 批量预热：每批16个密钥一起扩展，再逐个计算H并插入 */
+int sm4_gcm_key_cache_preload(SM4_GCM_Key_Cache *cache, const uint8_t *keys, size_t count) {
+    SM4_Context rks[16];
+    SM4_GCM_Context tmpl;
+    size_t i, n;
+
+    if (!cache) {
+        return -1;
+    }
+
+    while (count > 0) {
+        n = count < 16 ? count : 16;
+        sm4_set_encrypt_keys_batch(rks, keys, n);
+
+        for (i = 0; i < n; i++) {
+            tmpl.cipher_ctx = rks[i];
+            sm4_gcm_setup_hash_key(&tmpl);
+
+            SM4_GCM_CACHE_LOCK(cache);
+            sm4_gcm_cache_insert(cache, keys + i * SM4_KEY_SIZE, sm4_gcm_key_fingerprint(keys + i * SM4_KEY_SIZE), &tmpl);
+            SM4_GCM_CACHE_UNLOCK(cache);
+        }
+
+        keys += n * SM4_KEY_SIZE;
+        count -= n;
+    }
+
+    memset(rks, 0, sizeof(rks));
+    memset(&tmpl, 0, sizeof(tmpl));
+    return 0;
+}
+
+void sm4_gcm_key_cache_stats(SM4_GCM_Key_Cache *cache, uint64_t *hits, uint64_t *misses) {
+    SM4_GCM_CACHE_LOCK(cache);
+    if (hits) {
+        *hits = cache->hits;
+    }
+    if (misses) {
+        *misses = cache->misses;
+    }
+    SM4_GCM_CACHE_UNLOCK(cache);
+}
@@ -0,0 +1,206 @@
+#include "sm4_gcm_stitch.h"
+
+#if defined(HAVE_GCM_STITCH_GFNI) && HAVE_GCM_STITCH_GFNI
+
+#include "sm4_gfni_kernel.h"
+#include "sm4_ghash_clmul.h"
+
+/*
+ * 每步32个计数器块，与GFNI后端的crypt32一样分成两组zmm交错执行轮函数，
+ * 掩盖单组轮函数的依赖延迟；GHASH部分是四次8块聚合。
+ *
+ * 计数器块直接以转置后的形式生成：前三个字对所有块相同，第四个字是
+ * 计数器加上各通道的块序号，省掉了载入和输入转置。
+ *
+ * GHASH与32轮交错，每4轮之后插入一个阶段：偶数阶段累加8个块的部分积，
+ * 奇数阶段把上一个Y乘H^8并入后约减得到新的Y，四次聚合串成一条链。
+ * 加密时GHASH处理上一步的32个密文块；解密时处理的就是这一步的输入密文，
+ * 在写出明文之前就已全部载入，允许原地解密。
+ */
+#define SM4_GCM_GFNI_STEP (2 * SM4_GFNI_LANES)
+
+/* 两组寄存器交错执行连续4轮 */
+#define SM4_GCM_GFNI_4ROUNDS(x, y, rk, i) do { \
+        __m512i k_; \
+        k_ = _mm512_set1_epi32((int)(rk)[(i)]); \
+        SM4_GFNI_ROUND(x, 0, 1, 2, 3, k_); \
+        SM4_GFNI_ROUND(y, 0, 1, 2, 3, k_); \
+        k_ = _mm512_set1_epi32((int)(rk)[(i) + 1]); \
+        SM4_GFNI_ROUND(x, 1, 2, 3, 0, k_); \
+        SM4_GFNI_ROUND(y, 1, 2, 3, 0, k_); \
+        k_ = _mm512_set1_epi32((int)(rk)[(i) + 2]); \
+        SM4_GFNI_ROUND(x, 2, 3, 0, 1, k_); \
+        SM4_GFNI_ROUND(y, 2, 3, 0, 1, k_); \
+        k_ = _mm512_set1_epi32((int)(rk)[(i) + 3]); \
+        SM4_GFNI_ROUND(x, 3, 0, 1, 2, k_); \
+        SM4_GFNI_ROUND(y, 3, 0, 1, 2, k_); \
+    } while (0)
+
+/* 偶数阶段：累加第8k+1到8k+8块的部分积 */
+#define SM4_GCM_GFNI_GHASH_ACC(k) do { \
+        lo = mid = hi = _mm512_setzero_si512(); \
+        sm4_ghash_clmul_acc512(d[2 * (k)], d[2 * (k) + 1], h_hi, h_lo, &lo, &mid, &hi); \
+    } while (0)
+
+/* 奇数阶段：并入上一个Y·H^8（第一次聚合的Y已经异或进首块）后约减 */
+#define SM4_GCM_GFNI_GHASH_REDUCE(k) do { \
+        __m128i l_ = sm4_ghash_fold512(lo), m_ = sm4_ghash_fold512(mid), h_ = sm4_ghash_fold512(hi); \
+        if ((k) > 0) { \
+            sm4_ghash_clmul_acc(*y, h8, &l_, &m_, &h_); \
+        } \
+        *y = sm4_ghash_reduce(l_, m_, h_); \
+    } while (0)
+
+static inline uint32_t sm4_gcm_gfni_load_u32_be(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/* 反序变换后把一组寄存器转置回16个块，与输入异或后写出 */
+static inline void sm4_gcm_gfni_xor_store16(uint8_t *out, const uint8_t *in, __m512i x[4]) {
+    const __m512i word_bswap = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)SM4_GFNI_BSWAP32));
+    int j;
+
+    sm4_gfni_transpose(&x[3], &x[2], &x[1], &x[0]);
+    for (j = 0; j < 4; j++) {
+        __m512i ks = _mm512_shuffle_epi8(x[3 - j], word_bswap);
+        _mm512_storeu_si512((void *)(out + j * 64),
+                            _mm512_xor_si512(ks, _mm512_loadu_si512((const void *)(in + j * 64))));
+    }
+}
+
+/*
+ * 一步：加密32个计数器块，与in异或后写到out；ghash_src非NULL时同时把
+ * ghash_src处的32个密文块吸收进GHASH状态y。
+ */
+static inline void sm4_gcm_gfni_step(const SM4_GCM_Context *ctx, const uint32_t ctr[4], uint8_t *out,
+                                     const uint8_t *in, const uint8_t *ghash_src, __m128i *y,
+                                     __m512i h_hi, __m512i h_lo, __m128i h8) {
+    /* 元素e = 4k + p（第k个128位通道的第p个字）对应第4p + k块 */
+    const __m512i lane_index = _mm512_set_epi32(15, 11, 7, 3, 14, 10, 6, 2, 13, 9, 5, 1, 12, 8, 4, 0);
+    const __m512i block_bswap = _mm512_broadcast_i32x4(SM4_GHASH_BSWAP_MASK);
+    const uint32_t *rk = ctx->cipher_ctx.rk;
+    __m512i x[4], z[4], d[8];
+    __m512i lo, mid, hi;
+    int j;
+
+    x[0] = z[0] = _mm512_set1_epi32((int)ctr[0]);
+    x[1] = z[1] = _mm512_set1_epi32((int)ctr[1]);
+    x[2] = z[2] = _mm512_set1_epi32((int)ctr[2]);
+    x[3] = _mm512_add_epi32(_mm512_set1_epi32((int)ctr[3]), lane_index);
+    z[3] = _mm512_add_epi32(_mm512_set1_epi32((int)(ctr[3] + SM4_GFNI_LANES)), lane_index);
+
+    if (ghash_src) {
+        for (j = 0; j < 8; j++) {
+            d[j] = _mm512_shuffle_epi8(_mm512_loadu_si512((const void *)(ghash_src + j * 64)), block_bswap);
+        }
+        d[0] = _mm512_xor_si512(d[0], _mm512_inserti32x4(_mm512_setzero_si512(), *y, 0));
+    }
+
+    SM4_GCM_GFNI_4ROUNDS(x, z, rk, 0);
+    if (ghash_src) SM4_GCM_GFNI_GHASH_ACC(0);
+    SM4_GCM_GFNI_4ROUNDS(x, z, rk, 4);
+    if (ghash_src) SM4_GCM_GFNI_GHASH_REDUCE(0);
+    SM4_GCM_GFNI_4ROUNDS(x, z, rk, 8);
+    if (ghash_src) SM4_GCM_GFNI_GHASH_ACC(1);
+    SM4_GCM_GFNI_4ROUNDS(x, z, rk, 12);
+    if (ghash_src) SM4_GCM_GFNI_GHASH_REDUCE(1);
+    SM4_GCM_GFNI_4ROUNDS(x, z, rk, 16);
+    if (ghash_src) SM4_GCM_GFNI_GHASH_ACC(2);
+    SM4_GCM_GFNI_4ROUNDS(x, z, rk, 20);
+    if (ghash_src) SM4_GCM_GFNI_GHASH_REDUCE(2);
+    SM4_GCM_GFNI_4ROUNDS(x, z, rk, 24);
+    if (ghash_src) SM4_GCM_GFNI_GHASH_ACC(3);
+    SM4_GCM_GFNI_4ROUNDS(x, z, rk, 28);
+    if (ghash_src) SM4_GCM_GFNI_GHASH_REDUCE(3);
+
+    sm4_gcm_gfni_xor_store16(out, in, x);
+    sm4_gcm_gfni_xor_store16(out + SM4_GFNI_LANES * SM4_BLOCK_SIZE, in + SM4_GFNI_LANES * SM4_BLOCK_SIZE, z);
+}
+
+static void sm4_gcm_gfni_crypt(const SM4_GCM_Context *ctx, uint8_t *counter, uint8_t *state,
+                               uint8_t *out, const uint8_t *in, size_t blocks, int encrypt) {
+    __m128i y = sm4_ghash_load(state);
+    __m512i h_hi, h_lo;
+    __m128i h8 = _mm_loadu_si128((const __m128i *)ctx->table.H_pow[SM4_GCM_H_POWERS - 1]);
+    uint32_t ctr[4];
+    int j;
+
+    for (j = 0; j < 4; j++) {
+        ctr[j] = sm4_gcm_gfni_load_u32_be(counter + 4 * j);
+    }
+    sm4_ghash_load_hpow512(ctx, &h_hi, &h_lo);
+
+    if (encrypt) {
+        /* 第一步没有上一步的密文，只加密；最后一步的密文在循环结束后单独吸收 */
+        sm4_gcm_gfni_step(ctx, ctr, out, in, NULL, &y, h_hi, h_lo, h8);
+        ctr[3] += SM4_GCM_GFNI_STEP;
+        for (blocks -= SM4_GCM_GFNI_STEP; blocks > 0; blocks -= SM4_GCM_GFNI_STEP) {
+            sm4_gcm_gfni_step(ctx, ctr, out + SM4_GCM_GFNI_STEP * SM4_BLOCK_SIZE,
+                              in + SM4_GCM_GFNI_STEP * SM4_BLOCK_SIZE, out, &y, h_hi, h_lo, h8);
+            ctr[3] += SM4_GCM_GFNI_STEP;
+            in += SM4_GCM_GFNI_STEP * SM4_BLOCK_SIZE;
+            out += SM4_GCM_GFNI_STEP * SM4_BLOCK_SIZE;
+        }
+        sm4_ghash_store(state, y);
+        sm4_ghash_vpclmul_impl.update(ctx, state, out, SM4_GCM_GFNI_STEP);
+    } else {
+        for (; blocks > 0; blocks -= SM4_GCM_GFNI_STEP) {
+            sm4_gcm_gfni_step(ctx, ctr, out, in, in, &y, h_hi, h_lo, h8);
+            ctr[3] += SM4_GCM_GFNI_STEP;
+            in += SM4_GCM_GFNI_STEP * SM4_BLOCK_SIZE;
+            out += SM4_GCM_GFNI_STEP * SM4_BLOCK_SIZE;
+        }
+        sm4_ghash_store(state, y);
+    }
+
+    for (j = 0; j < 4; j++) {
+        counter[12 + j] = (uint8_t)(ctr[3] >> (24 - 8 * j));
+    }
+}
+
+static void sm4_gcm_gfni_encrypt(const SM4_GCM_Context *ctx, uint8_t *counter, uint8_t *state,
+                                 uint8_t *out, const uint8_t *in, size_t blocks) {
+    sm4_gcm_gfni_crypt(ctx, counter, state, out, in, blocks, 1);
+}
+
+static void sm4_gcm_gfni_decrypt(const SM4_GCM_Context *ctx, uint8_t *counter, uint8_t *state,
+                                 uint8_t *out, const uint8_t *in, size_t blocks) {
+    sm4_gcm_gfni_crypt(ctx, counter, state, out, in, blocks, 0);
+}
+
+#else
+
+#define SM4_GCM_GFNI_STEP 32
+
+/* 未编译缝合内核时不会被选中（is_supported返回0） */
+static void sm4_gcm_gfni_encrypt(const SM4_GCM_Context *ctx, uint8_t *counter, uint8_t *state,
+                                 uint8_t *out, const uint8_t *in, size_t blocks) {
+    (void)ctx; (void)counter; (void)state; (void)out; (void)in; (void)blocks;
+}
+
+static void sm4_gcm_gfni_decrypt(const SM4_GCM_Context *ctx, uint8_t *counter, uint8_t *state,
+                                 uint8_t *out, const uint8_t *in, size_t blocks) {
+    (void)ctx; (void)counter; (void)state; (void)out; (void)in; (void)blocks;
+}
+
+#endif /* HAVE_GCM_STITCH_GFNI */
+
+/* 需要GFNI后端和VPCLMULQDQ GHASH都可用 */
+static int sm4_gcm_gfni_is_supported(const SM4_CPU_Features *features) {
+#if defined(HAVE_GCM_STITCH_GFNI) && HAVE_GCM_STITCH_GFNI
+    return sm4_gfni_impl.is_supported(features) && sm4_ghash_vpclmul_impl.is_supported(features);
+#else
+    (void)features;
+    return 0;
+#endif
+}
+
+const SM4_GCM_Stitch_Implementation sm4_gcm_stitch_gfni_impl = {
+    "gfni_vpclmul",
+    sm4_gcm_gfni_is_supported,
+    &sm4_gfni_impl,
+    &sm4_ghash_vpclmul_impl,
+    SM4_GCM_GFNI_STEP,
+    sm4_gcm_gfni_encrypt,
+    sm4_gcm_gfni_decrypt
+};
@@ -0,0 +1,49 @@
+#ifndef SM4_GCM_INTERNAL_H
+#define SM4_GCM_INTERNAL_H
+
+#include "sm4_gcm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * sm4_gcm_init()拆成只依赖密钥和只依赖IV的两部分，供密钥缓存
+ * （sm4_gcm_cache.c）复用：缓存保存前者的结果，每条消息只做后者。
+ */
+
+/**
+ * @brief 计算H = E_K(0)，选定GHASH后端并预计算它的表
+ * @param ctx GCM上下文，cipher_ctx中已有加密轮密钥
+ */
+void sm4_gcm_setup_hash_key(SM4_GCM_Context *ctx);
+
+/**
+ * @brief 根据IV计算J0和第一个计数器块，清空AAD/密文长度、缓冲区和GHASH状态
+ * @param ctx 已完成sm4_gcm_setup_hash_key()的GCM上下文
+ * @param iv IV/Nonce
+ * @param iv_len IV长度（字节）
+ */
+void sm4_gcm_setup_iv(SM4_GCM_Context *ctx, const uint8_t *iv, size_t iv_len);
+
+/**
+ * @brief 当前消息预取好的密钥流（sm4_gcm_prefetch.c）
+ * @param ctx GCM上下文
+ * @param offset 密文偏移（16的倍数）
+ * @param len 需要的字节数
+ * @return 覆盖[offset, offset + len)（按块向上取整）的密钥流，没有时返回NULL
+ */
+const uint8_t *sm4_gcm_prefetch_keystream(const SM4_GCM_Context *ctx, uint64_t offset, size_t len);
+
+/**
+ * @brief 当前消息预取好的E(J0)
+ * @param ctx GCM上下文
+ * @return 16字节E(J0)，没有时返回NULL
+ */
+const uint8_t *sm4_gcm_prefetch_tag_mask(const SM4_GCM_Context *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_GCM_INTERNAL_H */
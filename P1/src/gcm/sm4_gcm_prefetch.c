@@ -0,0 +1,316 @@
+#include "sm4_gcm_internal.h"
+#include "sm4_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * GCM密钥流预取
+ *
+ * 随机数按序号递增时，之后每条消息的J0和计数器块都是事先已知的，E(J0)和密钥流
+ * 可以在消息到来之前算好。每个打开预取的上下文有一个环形缓冲区和一个后台线程：
+ * 第seq条消息占用第seq % slots个槽位，槽位中依次是E(J0)和前max_len字节的密钥流。
+ * 后台线程把一批槽位的计数器块铺开后一次交给sm4_encrypt_blocks()，走调度层选中的多块内核。
+ *
+ * 序号的推进：next是下一条要交出的消息，base是调用者正在使用（或下一条要使用）的消息，
+ * [某个不大于base的序号, ready)的槽位已经算好。后台线程只写序号小于base + slots的槽位，
+ * 调用者正在使用的槽位不会被覆盖；调用者跳过了还没算好的消息时，后台线程从base重新开始。
+ */
+
+#if !defined(_WIN32)
+
+#include <pthread.h>
+
+/* 每批最多计算的块数，算完一批就发布，调用者不用等整个环形缓冲区 */
+#define SM4_GCM_PREFETCH_BATCH_BLOCKS 4096
+
+/* 每条消息预取长度和消息数的上限 */
+#define SM4_GCM_PREFETCH_MAX_LEN (1024 * 1024)
+#define SM4_GCM_PREFETCH_MAX_DEPTH 4096
+
+struct sm4_gcm_prefetch {
+    SM4_Context cipher_ctx;       // 轮密钥的副本，后台线程使用
+    uint8_t iv_base[12];
+    size_t max_len;               // 每条消息的密钥流长度（向上取整到块）
+    size_t slot_blocks;           // 每个槽位的块数：E(J0)加max_len / 16块密钥流
+    size_t slots;                 // 槽位数：depth + 1（包括调用者正在使用的一个）
+    uint8_t *ring;                // slots * slot_blocks块
+
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint64_t next;                // 下一条要交出的消息的序号
+    uint64_t base;                // 调用者正在使用的消息的序号
+    uint64_t ready;               // 序号小于ready的槽位已经算好
+    int waiting;                  // 后台线程正在等待空闲槽位
+    int stop;
+
+    const uint8_t *current;       // 当前消息的槽位，没有预取到时为NULL（只由调用者线程访问）
+    uint64_t hits;
+    uint64_t misses;
+};
+
+/* 第seq条消息的IV：基值的低8字节异或序号 */
+static void sm4_gcm_prefetch_iv(const struct sm4_gcm_prefetch *pf, uint8_t *iv, uint64_t seq) {
+    int i;
+
+    memcpy(iv, pf->iv_base, 12);
+    for (i = 0; i < 8; i++) {
+        iv[11 - i] ^= (uint8_t)(seq >> (8 * i));
+    }
+}
+
+/* 计算从start开始的n条消息的槽位（在环形缓冲区中连续） */
+static void sm4_gcm_prefetch_fill(struct sm4_gcm_prefetch *pf, uint64_t start, size_t n) {
+    uint8_t *slot = pf->ring + (size_t)(start % pf->slots) * pf->slot_blocks * SM4_BLOCK_SIZE;
+    uint8_t *block;
+    uint32_t c;
+    size_t i, j;
+
+    for (i = 0; i < n; i++) {
+        block = slot + i * pf->slot_blocks * SM4_BLOCK_SIZE;
+        sm4_gcm_prefetch_iv(pf, block, start + i);
+        block[12] = 0;
+        block[13] = 0;
+        block[14] = 0;
+        block[15] = 1;
+        /* J0, J0 + 1, ...：max_len不超过1 MiB，低32位不会回绕 */
+        for (j = 1; j < pf->slot_blocks; j++) {
+            memcpy(block + j * SM4_BLOCK_SIZE, block, 12);
+            c = (uint32_t)j + 1;
+            block[j * SM4_BLOCK_SIZE + 12] = (uint8_t)(c >> 24);
+            block[j * SM4_BLOCK_SIZE + 13] = (uint8_t)(c >> 16);
+            block[j * SM4_BLOCK_SIZE + 14] = (uint8_t)(c >> 8);
+            block[j * SM4_BLOCK_SIZE + 15] = (uint8_t)c;
+        }
+    }
+
+    sm4_encrypt_blocks(&pf->cipher_ctx, slot, slot, n * pf->slot_blocks);
+}
+
+/* 后台线程：有空闲槽位就成批计算，没有就等待 */
+static void *sm4_gcm_prefetch_worker(void *arg) {
+    struct sm4_gcm_prefetch *pf = (struct sm4_gcm_prefetch *)arg;
+    uint64_t start;
+    size_t n, limit;
+
+    pthread_mutex_lock(&pf->lock);
+    for (;;) {
+        while (!pf->stop && pf->ready >= pf->base + pf->slots) {
+            pf->waiting = 1;
+            pthread_cond_wait(&pf->cond, &pf->lock);
+            pf->waiting = 0;
+        }
+        if (pf->stop) {
+            break;
+        }
+
+        /* 调用者已经跳过的消息不再计算 */
+        if (pf->ready < pf->base) {
+            pf->ready = pf->base;
+        }
+        start = pf->ready;
+        n = (size_t)(pf->base + pf->slots - start);
+        limit = pf->slots - (size_t)(start % pf->slots);
+        if (n > limit) {
+            n = limit;
+        }
+        limit = SM4_GCM_PREFETCH_BATCH_BLOCKS / pf->slot_blocks;
+        if (limit == 0) {
+            limit = 1;
+        }
+        if (n > limit) {
+            n = limit;
+        }
+        pthread_mutex_unlock(&pf->lock);
+
+        sm4_gcm_prefetch_fill(pf, start, n);
+
+        pthread_mutex_lock(&pf->lock);
+        pf->ready = start + n;
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return NULL;
+}
+
+/* 打开密钥流预取 */
+int sm4_gcm_prefetch_enable(SM4_GCM_Context *ctx, const uint8_t *iv_base, uint64_t first_seq,
+                            size_t max_len, size_t depth) {
+    struct sm4_gcm_prefetch *pf;
+    size_t ring_len;
+
+    if (ctx == NULL || iv_base == NULL || ctx->prefetch != NULL || max_len == 0 ||
+        max_len > SM4_GCM_PREFETCH_MAX_LEN || depth == 0 || depth > SM4_GCM_PREFETCH_MAX_DEPTH) {
+        return -1;
+    }
+
+    pf = (struct sm4_gcm_prefetch *)calloc(1, sizeof(*pf));
+    if (pf == NULL) {
+        return -1;
+    }
+    pf->cipher_ctx = ctx->cipher_ctx;
+    memcpy(pf->iv_base, iv_base, 12);
+    pf->max_len = (max_len + SM4_BLOCK_SIZE - 1) / SM4_BLOCK_SIZE * SM4_BLOCK_SIZE;
+    pf->slot_blocks = 1 + pf->max_len / SM4_BLOCK_SIZE;
+    pf->slots = depth + 1;
+    pf->next = first_seq;
+    pf->base = first_seq;
+    pf->ready = first_seq;
+
+    ring_len = pf->slots * pf->slot_blocks * SM4_BLOCK_SIZE;
+    if (posix_memalign((void **)&pf->ring, 64, ring_len) != 0) {
+        free(pf);
+        return -1;
+    }
+    pthread_mutex_init(&pf->lock, NULL);
+    pthread_cond_init(&pf->cond, NULL);
+    if (pthread_create(&pf->worker, NULL, sm4_gcm_prefetch_worker, pf) != 0) {
+        pthread_mutex_destroy(&pf->lock);
+        pthread_cond_destroy(&pf->cond);
+        free(pf->ring);
+        free(pf);
+        return -1;
+    }
+
+    ctx->prefetch = pf;
+    return 0;
+}
+
+/* 开始下一条消息 */
+int sm4_gcm_prefetch_next(SM4_GCM_Context *ctx, uint8_t *iv, uint64_t *seq) {
+    struct sm4_gcm_prefetch *pf;
+    uint8_t nonce[12];
+    uint64_t s;
+    int ready;
+
+    if (ctx == NULL || ctx->prefetch == NULL) {
+        return -1;
+    }
+    pf = ctx->prefetch;
+
+    pthread_mutex_lock(&pf->lock);
+    s = pf->next++;
+    pf->base = s;
+    ready = s < pf->ready;
+    /* 空出一半槽位再叫醒后台线程，一次唤醒分摊到多条消息上 */
+    if (pf->waiting && pf->base + pf->slots - pf->ready >= (pf->slots + 1) / 2) {
+        pthread_cond_signal(&pf->cond);
+    }
+    pthread_mutex_unlock(&pf->lock);
+
+    if (ready) {
+        pf->current = pf->ring + (size_t)(s % pf->slots) * pf->slot_blocks * SM4_BLOCK_SIZE;
+        pf->hits++;
+    } else {
+        pf->current = NULL;
+        pf->misses++;
+    }
+
+    sm4_gcm_prefetch_iv(pf, nonce, s);
+    sm4_gcm_setup_iv(ctx, nonce, sizeof(nonce));
+    if (iv != NULL) {
+        memcpy(iv, nonce, sizeof(nonce));
+    }
+    if (seq != NULL) {
+        *seq = s;
+    }
+    return 0;
+}
+
+/* 当前消息预取好的密钥流 */
+const uint8_t *sm4_gcm_prefetch_keystream(const SM4_GCM_Context *ctx, uint64_t offset, size_t len) {
+    const struct sm4_gcm_prefetch *pf = ctx->prefetch;
+    uint64_t end = offset + (len + SM4_BLOCK_SIZE - 1) / SM4_BLOCK_SIZE * SM4_BLOCK_SIZE;
+
+    if (pf == NULL || pf->current == NULL || end > pf->max_len || end < offset) {
+        return NULL;
+    }
+    return pf->current + SM4_BLOCK_SIZE + offset;
+}
+
+/* 当前消息预取好的E(J0) */
+const uint8_t *sm4_gcm_prefetch_tag_mask(const SM4_GCM_Context *ctx) {
+    return ctx->prefetch != NULL ? ctx->prefetch->current : NULL;
+}
+
+/* 命中/未命中次数 */
+void sm4_gcm_prefetch_stats(const SM4_GCM_Context *ctx, uint64_t *hits, uint64_t *misses) {
+    const struct sm4_gcm_prefetch *pf = ctx != NULL ? ctx->prefetch : NULL;
+
+    if (hits != NULL) {
+        *hits = pf != NULL ? pf->hits : 0;
+    }
+    if (misses != NULL) {
+        *misses = pf != NULL ? pf->misses : 0;
+    }
+}
+
+/* 关闭密钥流预取 */
+void sm4_gcm_prefetch_disable(SM4_GCM_Context *ctx) {
+    struct sm4_gcm_prefetch *pf;
+
+    if (ctx == NULL || ctx->prefetch == NULL) {
+        return;
+    }
+    pf = ctx->prefetch;
+
+    pthread_mutex_lock(&pf->lock);
+    pf->stop = 1;
+    pthread_cond_signal(&pf->cond);
+    pthread_mutex_unlock(&pf->lock);
+    pthread_join(pf->worker, NULL);
+
+    pthread_mutex_destroy(&pf->lock);
+    pthread_cond_destroy(&pf->cond);
+    memset(pf->ring, 0, pf->slots * pf->slot_blocks * SM4_BLOCK_SIZE);
+    free(pf->ring);
+    memset(pf, 0, sizeof(*pf));
+    free(pf);
+    ctx->prefetch = NULL;
+}
+
+#else /* _WIN32 */
+
+int sm4_gcm_prefetch_enable(SM4_GCM_Context *ctx, const uint8_t *iv_base, uint64_t first_seq,
+                            size_t max_len, size_t depth) {
+    (void)ctx;
+    (void)iv_base;
+    (void)first_seq;
+    (void)max_len;
+    (void)depth;
+    return -1;
+}
+
+int sm4_gcm_prefetch_next(SM4_GCM_Context *ctx, uint8_t *iv, uint64_t *seq) {
+    (void)ctx;
+    (void)iv;
+    (void)seq;
+    return -1;
+}
+
+const uint8_t *sm4_gcm_prefetch_keystream(const SM4_GCM_Context *ctx, uint64_t offset, size_t len) {
+    (void)ctx;
+    (void)offset;
+    (void)len;
+    return NULL;
+}
+
+const uint8_t *sm4_gcm_prefetch_tag_mask(const SM4_GCM_Context *ctx) {
+    (void)ctx;
+    return NULL;
+}
+
+void sm4_gcm_prefetch_stats(const SM4_GCM_Context *ctx, uint64_t *hits, uint64_t *misses) {
+    (void)ctx;
+    if (hits != NULL) {
+        *hits = 0;
+    }
+    if (misses != NULL) {
+        *misses = 0;
+    }
+}
+
+void sm4_gcm_prefetch_disable(SM4_GCM_Context *ctx) {
+    (void)ctx;
+}
+
+#endif /* _WIN32 */
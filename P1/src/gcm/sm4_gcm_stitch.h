@@ -0,0 +1,66 @@
+#ifndef SM4_GCM_STITCH_H
+#define SM4_GCM_STITCH_H
+
+#include "sm4_internal.h"
+#include "sm4_ghash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * GCM缝合内核：把CTR的计数器加密和GHASH写进同一个循环，SM4轮函数之间穿插
+ * 无进位乘法，让分组加密和GF(2^128)乘法的执行单元同时工作。
+ *
+ * 缝合内核只在调度层当前的SM4后端和上下文的GHASH后端都与它匹配时使用，
+ * 其余情况下GCM仍然走"批量生成密钥流 + GHASH"的通用路径。
+ */
+
+/* 缝合内核函数表 */
+typedef struct {
+    const char *name;  // 实现名称
+
+    /**
+     * @brief 判断当前CPU（以及编译配置）是否可以运行该内核
+     * @param features CPU特性
+     * @return 非0可用，0不可用
+     */
+    int (*is_supported)(const SM4_CPU_Features *features);
+
+    const SM4_Implementation *cipher;       // 要求的SM4后端
+    const SM4_GHASH_Implementation *ghash;  // 要求的GHASH后端
+    size_t step;                            // 每步处理的块数，blocks必须是它的倍数
+
+    /**
+     * @brief CTR加密blocks个块并把密文吸收进GHASH状态
+     * @param ctx GCM上下文（轮密钥和GHASH预计算表）
+     * @param counter 16字节计数器块，返回时前进blocks（低32位递增）
+     * @param state 16字节GHASH状态
+     * @param out 输出密文（可以与in相同）
+     * @param in 输入明文
+     * @param blocks 块数量
+     */
+    void (*encrypt)(const SM4_GCM_Context *ctx, uint8_t *counter, uint8_t *state,
+                    uint8_t *out, const uint8_t *in, size_t blocks);
+
+    /**
+     * @brief 把密文吸收进GHASH状态并CTR解密blocks个块
+     * @param ctx GCM上下文（轮密钥和GHASH预计算表）
+     * @param counter 16字节计数器块，返回时前进blocks（低32位递增）
+     * @param state 16字节GHASH状态
+     * @param out 输出明文（可以与in相同）
+     * @param in 输入密文
+     * @param blocks 块数量
+     */
+    void (*decrypt)(const SM4_GCM_Context *ctx, uint8_t *counter, uint8_t *state,
+                    uint8_t *out, const uint8_t *in, size_t blocks);
+} SM4_GCM_Stitch_Implementation;
+
+/* GFNI（SM4）+ VPCLMULQDQ（GHASH）缝合内核 */
+extern const SM4_GCM_Stitch_Implementation sm4_gcm_stitch_gfni_impl;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_GCM_STITCH_H */
@@ -0,0 +1,195 @@
+#include "sm4_ghash.h"
+#include <string.h>
+
+/*
+ * 按优先级从高到低排列的GHASH后端，自动选择时取第一个可用的。
+ * 8位表每个密钥占4 KB，只在显式指定时使用，不参与自动选择。
+ */
+static const SM4_GHASH_Implementation *const SM4_GHASH_IMPLEMENTATIONS[] = {
+    &sm4_ghash_vpclmul_impl,
+    &sm4_ghash_pclmul_impl,
+    &sm4_ghash_table4_impl,
+    &sm4_ghash_generic_impl
+};
+
+/* 所有可以按名称指定的GHASH后端 */
+static const SM4_GHASH_Implementation *const SM4_GHASH_ALL[] = {
+    &sm4_ghash_vpclmul_impl,
+    &sm4_ghash_pclmul_impl,
+    &sm4_ghash_table8_impl,
+    &sm4_ghash_table4_impl,
+    &sm4_ghash_generic_impl
+};
+
+#define SM4_GHASH_IMPLEMENTATION_COUNT (sizeof(SM4_GHASH_IMPLEMENTATIONS) / sizeof(SM4_GHASH_IMPLEMENTATIONS[0]))
+#define SM4_GHASH_ALL_COUNT (sizeof(SM4_GHASH_ALL) / sizeof(SM4_GHASH_ALL[0]))
+
+/* GF(2^128)上的乘法（逐位实现） */
+static void gf128_mul(uint8_t *r, const uint8_t *x, const uint8_t *y) {
+    uint8_t z[16] = {0};
+    uint8_t v[16];
+    uint8_t mask;
+    int i, j;
+
+    memcpy(v, y, 16);
+
+    for (i = 0; i < 16; i++) {
+        for (j = 7; j >= 0; j--) {
+            mask = (x[i] >> j) & 1;
+
+            if (mask) {
+                for (int k = 0; k < 16; k++) {
+                    z[k] ^= v[k];
+                }
+            }
+
+            /* 右移一位，如果最低位为1，则异或上多项式 */
+            mask = v[15] & 1;
+            for (int k = 15; k > 0; k--) {
+                v[k] = (v[k] >> 1) | ((v[k-1] & 1) << 7);
+            }
+            v[0] >>= 1;
+
+            /* 如果最低位为1，异或上多项式 x^128 + x^7 + x^2 + x + 1 */
+            if (mask) {
+                v[0] ^= 0xe1; /* 0b11100001 */
+            }
+        }
+    }
+
+    memcpy(r, z, 16);
+}
+
+/* 供GCM模块组合部分GHASH等少量乘法使用 */
+void sm4_ghash_mul(uint8_t *r, const uint8_t *x, const uint8_t *y) {
+    gf128_mul(r, x, y);
+}
+
+/* 通用实现直接使用H，不需要预计算 */
+static void sm4_ghash_generic_init(SM4_GCM_Context *ctx) {
+    (void)ctx;
+}
+
+/* 通用实现：每块一次乘法 */
+static void sm4_ghash_generic_update(const SM4_GCM_Context *ctx, uint8_t *state, const uint8_t *in, size_t blocks) {
+    size_t i;
+    int j;
+
+    for (i = 0; i < blocks; i++) {
+        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
+            state[j] ^= in[i * SM4_BLOCK_SIZE + j];
+        }
+        gf128_mul(state, state, ctx->H);
+    }
+}
+
+static int sm4_ghash_generic_is_supported(const SM4_CPU_Features *features) {
+    (void)features;
+    return 1;
+}
+
+const SM4_GHASH_Implementation sm4_ghash_generic_impl = {
+    "generic",
+    sm4_ghash_generic_is_supported,
+    sm4_ghash_generic_init,
+    sm4_ghash_generic_update
+};
+
+/* 自检使用的块数，覆盖8块聚合和尾部处理 */
+#define GHASH_SELFTEST_BLOCKS 19
+
+/* 已知答案自检：GHASH结果必须与逐位实现一致 */
+static int sm4_ghash_selftest(const SM4_GHASH_Implementation *impl) {
+    SM4_GCM_Context ctx;
+    uint8_t in[GHASH_SELFTEST_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t state[SM4_BLOCK_SIZE];
+    uint8_t ref_state[SM4_BLOCK_SIZE];
+    size_t i;
+
+    for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+        ctx.H[i] = (uint8_t)(i * 37 + 11);
+        state[i] = (uint8_t)(i * 5 + 3);
+    }
+    for (i = 0; i < sizeof(in); i++) {
+        in[i] = (uint8_t)(i * 13 + 1);
+    }
+    memcpy(ref_state, state, SM4_BLOCK_SIZE);
+
+    sm4_ghash_generic_impl.update(&ctx, ref_state, in, GHASH_SELFTEST_BLOCKS);
+    impl->init(&ctx);
+    impl->update(&ctx, state, in, GHASH_SELFTEST_BLOCKS);
+    return memcmp(state, ref_state, SM4_BLOCK_SIZE) == 0;
+}
+
+/* 后端在当前主机上是否可用：CPU支持（且已编译）并通过自检 */
+static int sm4_ghash_usable(const SM4_GHASH_Implementation *impl) {
+    SM4_CPU_Features features = sm4_get_cpu_features();
+
+    return impl->is_supported(&features) && sm4_ghash_selftest(impl);
+}
+
+static const SM4_GHASH_Implementation *sm4_ghash_select_implementation(void) {
+    size_t i;
+
+    for (i = 0; i < SM4_GHASH_IMPLEMENTATION_COUNT; i++) {
+        if (sm4_ghash_usable(SM4_GHASH_IMPLEMENTATIONS[i])) {
+            return SM4_GHASH_IMPLEMENTATIONS[i];
+        }
+    }
+
+    return &sm4_ghash_generic_impl;
+}
+
+/* 调度结果，只在加载时（或首次调用时）写入一次；可以用sm4_gcm_force_ghash_implementation切换 */
+static const SM4_GHASH_Implementation *best_ghash = NULL;
+static const SM4_GHASH_Implementation *active_ghash = &sm4_ghash_generic_impl;
+
+static void sm4_ghash_resolve_implementation(void) {
+    best_ghash = sm4_ghash_select_implementation();
+    active_ghash = best_ghash;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((constructor))
+static void sm4_ghash_dispatch_init(void) {
+    sm4_ghash_resolve_implementation();
+}
+#endif
+
+const SM4_GHASH_Implementation *sm4_ghash_get_implementation(void) {
+    if (best_ghash == NULL) {
+        sm4_ghash_resolve_implementation();
+    }
+    return active_ghash;
+}
+
+/* 获取GCM当前使用的GHASH实现 */
+const char *sm4_gcm_get_ghash_implementation(void) {
+    return sm4_ghash_get_implementation()->name;
+}
+
+/* 强制GCM使用特定的GHASH实现 */
+int sm4_gcm_force_ghash_implementation(const char *name) {
+    size_t i;
+
+    if (best_ghash == NULL) {
+        sm4_ghash_resolve_implementation();
+    }
+
+    if (!name) {
+        active_ghash = best_ghash;
+        return 0;
+    }
+
+    for (i = 0; i < SM4_GHASH_ALL_COUNT; i++) {
+        if (strcmp(SM4_GHASH_ALL[i]->name, name) == 0) {
+            if (!sm4_ghash_usable(SM4_GHASH_ALL[i])) {
+                return -1; /* CPU不支持、未编译或未通过自检 */
+            }
+            active_ghash = SM4_GHASH_ALL[i];
+            return 0;
+        }
+    }
+
+    return -1; /* 未知实现 */
+}
@@ -0,0 +1,70 @@
+#ifndef SM4_GHASH_H
+#define SM4_GHASH_H
+
+#include "sm4_gcm.h"
+#include "sm4_cpu_features.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * GCM模块内部的GHASH后端接口，与SM4_Implementation的组织方式相同：
+ * 每个后端导出一张函数表。sm4_gcm_init()把当前选中的函数表记录在上下文中，
+ * 并由它填充上下文里的预计算表（H的幂或Shoup表，见SM4_GHASH_Table），
+ * 之后该上下文始终使用同一个后端，切换GHASH实现不影响已初始化的上下文。
+ */
+
+/* GHASH后端函数表 */
+typedef struct sm4_ghash_impl {
+    const char *name;  // 实现名称
+
+    /**
+     * @brief 判断当前CPU（以及编译配置）是否可以运行该后端
+     * @param features CPU特性
+     * @return 非0可用，0不可用
+     */
+    int (*is_supported)(const SM4_CPU_Features *features);
+
+    /**
+     * @brief 根据ctx->H预计算该后端需要的表
+     * @param ctx GCM上下文
+     */
+    void (*init)(SM4_GCM_Context *ctx);
+
+    /**
+     * @brief 把blocks个完整块吸收进GHASH状态：state = (state ^ X[i]) * H
+     * @param ctx GCM上下文（只读取预计算表）
+     * @param state 16字节GHASH状态
+     * @param in 输入数据
+     * @param blocks 块数量
+     */
+    void (*update)(const SM4_GCM_Context *ctx, uint8_t *state, const uint8_t *in, size_t blocks);
+} SM4_GHASH_Implementation;
+
+/* 各GHASH后端的函数表 */
+extern const SM4_GHASH_Implementation sm4_ghash_generic_impl;
+extern const SM4_GHASH_Implementation sm4_ghash_table4_impl;
+extern const SM4_GHASH_Implementation sm4_ghash_table8_impl;
+extern const SM4_GHASH_Implementation sm4_ghash_pclmul_impl;
+extern const SM4_GHASH_Implementation sm4_ghash_vpclmul_impl;
+
+/**
+ * @brief GF(2^128)上的乘法r = x·y（GCM的比特序，逐位实现，用于少量非热点乘法）
+ * @param r 16字节结果（可以与x或y相同）
+ * @param x 16字节乘数
+ * @param y 16字节乘数
+ */
+void sm4_ghash_mul(uint8_t *r, const uint8_t *x, const uint8_t *y);
+
+/**
+ * @brief 获取GCM当前使用的GHASH后端
+ * @return GHASH函数表
+ */
+const SM4_GHASH_Implementation *sm4_ghash_get_implementation(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_GHASH_H */
@@ -0,0 +1,149 @@
+#ifndef SM4_GHASH_CLMUL_H
+#define SM4_GHASH_CLMUL_H
+
+/*
+ * PCLMULQDQ与VPCLMULQDQ两个GHASH后端共用的内联函数，只能在用-mpclmul -mssse3
+ * （或更高）编译的源文件中包含。
+ *
+ * GCM的比特序是反射的：块的第0字节最高位是x^0的系数。按字节逆序载入后，整块
+ * 变成一个128位的反射多项式，两个这样的值做无进位乘法得到的256位积左移一位，
+ * 就是反射后的真实乘积，再对x^128 + x^7 + x^2 + x + 1做一次约减。
+ * 乘积与移位、约减都是线性的，所以8块的部分积可以先异或在一起，只约减一次：
+ *   Y' = (Y ^ X1)·H^8 ^ X2·H^7 ^ ... ^ X8·H^1
+ */
+
+#include "sm4_ghash.h"
+#include <immintrin.h>
+
+/* 块内字节逆序的pshufb控制字 */
+#define SM4_GHASH_BSWAP_MASK _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+
+/* 一次约减聚合的块数，等于上下文中预计算的H的幂的个数 */
+#define SM4_GHASH_AGGREGATE SM4_GCM_H_POWERS
+
+/* 载入一个数据块并转为反射表示 */
+static inline __m128i sm4_ghash_load(const uint8_t *p) {
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)p), SM4_GHASH_BSWAP_MASK);
+}
+
+static inline void sm4_ghash_store(uint8_t *p, __m128i x) {
+    _mm_storeu_si128((__m128i *)p, _mm_shuffle_epi8(x, SM4_GHASH_BSWAP_MASK));
+}
+
+/* 累加a·b的四个64位部分积：lo = a0·b0，hi = a1·b1，mid = a0·b1 ^ a1·b0 */
+static inline void sm4_ghash_clmul_acc(__m128i a, __m128i b, __m128i *lo, __m128i *mid, __m128i *hi) {
+    *lo = _mm_xor_si128(*lo, _mm_clmulepi64_si128(a, b, 0x00));
+    *hi = _mm_xor_si128(*hi, _mm_clmulepi64_si128(a, b, 0x11));
+    *mid = _mm_xor_si128(*mid, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10),
+                                             _mm_clmulepi64_si128(a, b, 0x01)));
+}
+
+/* 合并部分积为256位积，左移一位后约减到128位（Intel CLMUL白皮书算法5） */
+static inline __m128i sm4_ghash_reduce(__m128i lo, __m128i mid, __m128i hi) {
+    __m128i t1, t2, t3;
+
+    lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+    /* <hi:lo>整体左移一位 */
+    t1 = _mm_srli_epi32(lo, 31);
+    t2 = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    t3 = _mm_srli_si128(t1, 12);
+    t2 = _mm_slli_si128(t2, 4);
+    t1 = _mm_slli_si128(t1, 4);
+    lo = _mm_or_si128(lo, t1);
+    hi = _mm_or_si128(hi, t2);
+    hi = _mm_or_si128(hi, t3);
+
+    /* 第一阶段：低128位乘以x^127 + x^126 + x^121 */
+    t1 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)), _mm_slli_epi32(lo, 25));
+    t2 = _mm_srli_si128(t1, 4);
+    t1 = _mm_slli_si128(t1, 12);
+    lo = _mm_xor_si128(lo, t1);
+
+    /* 第二阶段 */
+    t3 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2)), _mm_srli_epi32(lo, 7));
+    t3 = _mm_xor_si128(t3, t2);
+    lo = _mm_xor_si128(lo, t3);
+    return _mm_xor_si128(hi, lo);
+}
+
+/* 反射表示下的GF(2^128)乘法 */
+static inline __m128i sm4_ghash_clmul_mul(__m128i a, __m128i b) {
+    __m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+
+    sm4_ghash_clmul_acc(a, b, &lo, &mid, &hi);
+    return sm4_ghash_reduce(lo, mid, hi);
+}
+
+/* 预计算H^1..H^8（反射表示，即字节逆序） */
+static inline void sm4_ghash_clmul_init(SM4_GCM_Context *ctx) {
+    __m128i h = sm4_ghash_load(ctx->H);
+    __m128i p = h;
+    int i;
+
+    _mm_storeu_si128((__m128i *)ctx->table.H_pow[0], h);
+    for (i = 1; i < SM4_GCM_H_POWERS; i++) {
+        p = sm4_ghash_clmul_mul(p, h);
+        _mm_storeu_si128((__m128i *)ctx->table.H_pow[i], p);
+    }
+}
+
+/* 吸收n（1..8）个块，只约减一次：第i块乘以H^(n-i) */
+static inline __m128i sm4_ghash_clmul_blocks(const SM4_GCM_Context *ctx, __m128i x, const uint8_t *in, size_t n) {
+    __m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+    __m128i d;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        d = sm4_ghash_load(in + i * SM4_BLOCK_SIZE);
+        if (i == 0) {
+            d = _mm_xor_si128(d, x);
+        }
+        sm4_ghash_clmul_acc(d, _mm_loadu_si128((const __m128i *)ctx->table.H_pow[n - 1 - i]), &lo, &mid, &hi);
+    }
+
+    return sm4_ghash_reduce(lo, mid, hi);
+}
+
+#if defined(__AVX512F__) && defined(__VPCLMULQDQ__)
+/* 以下为zmm版本，供VPCLMULQDQ内核使用 */
+
+/* 把zmm的四个128位通道异或到一起 */
+static inline __m128i sm4_ghash_fold512(__m512i v) {
+    __m256i t = _mm256_xor_si256(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v, 1));
+
+    return _mm_xor_si128(_mm256_castsi256_si128(t), _mm256_extracti128_si256(t, 1));
+}
+
+/* 载入8块聚合用的H的幂：h_hi = [H^8 H^7 H^6 H^5]，h_lo = [H^4 H^3 H^2 H^1] */
+static inline void sm4_ghash_load_hpow512(const SM4_GCM_Context *ctx, __m512i *h_hi, __m512i *h_lo) {
+    int i;
+
+    *h_hi = _mm512_setzero_si512();
+    *h_lo = _mm512_setzero_si512();
+    for (i = 0; i < 4; i++) {
+        *h_hi = _mm512_mask_broadcast_i32x4(*h_hi, (__mmask16)(0xf << (4 * i)),
+                                            _mm_loadu_si128((const __m128i *)ctx->table.H_pow[7 - i]));
+        *h_lo = _mm512_mask_broadcast_i32x4(*h_lo, (__mmask16)(0xf << (4 * i)),
+                                            _mm_loadu_si128((const __m128i *)ctx->table.H_pow[3 - i]));
+    }
+}
+
+/* 8块（两个zmm）与[H^8..H^5]、[H^4..H^1]的部分积累加到lo/mid/hi */
+static inline void sm4_ghash_clmul_acc512(__m512i d0, __m512i d1, __m512i h_hi, __m512i h_lo,
+                                          __m512i *lo, __m512i *mid, __m512i *hi) {
+    *lo = _mm512_ternarylogic_epi64(*lo, _mm512_clmulepi64_epi128(d0, h_hi, 0x00),
+                                    _mm512_clmulepi64_epi128(d1, h_lo, 0x00), 0x96);
+    *hi = _mm512_ternarylogic_epi64(*hi, _mm512_clmulepi64_epi128(d0, h_hi, 0x11),
+                                    _mm512_clmulepi64_epi128(d1, h_lo, 0x11), 0x96);
+    *mid = _mm512_ternarylogic_epi64(*mid, _mm512_clmulepi64_epi128(d0, h_hi, 0x10),
+                                     _mm512_clmulepi64_epi128(d0, h_hi, 0x01), 0x96);
+    *mid = _mm512_ternarylogic_epi64(*mid, _mm512_clmulepi64_epi128(d1, h_lo, 0x10),
+                                     _mm512_clmulepi64_epi128(d1, h_lo, 0x01), 0x96);
+}
+#endif
+
+#endif /* SM4_GHASH_CLMUL_H */
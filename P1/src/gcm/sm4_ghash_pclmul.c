@@ -0,0 +1,55 @@
+#include "sm4_ghash.h"
+
+#if defined(HAVE_PCLMUL) && HAVE_PCLMUL
+
+#include "sm4_ghash_clmul.h"
+
+static void sm4_ghash_pclmul_init(SM4_GCM_Context *ctx) {
+    sm4_ghash_clmul_init(ctx);
+}
+
+/* 每8块聚合一次约减，尾部不足8块时同样只约减一次 */
+static void sm4_ghash_pclmul_update(const SM4_GCM_Context *ctx, uint8_t *state, const uint8_t *in, size_t blocks) {
+    __m128i x = sm4_ghash_load(state);
+
+    while (blocks >= SM4_GHASH_AGGREGATE) {
+        x = sm4_ghash_clmul_blocks(ctx, x, in, SM4_GHASH_AGGREGATE);
+        in += SM4_GHASH_AGGREGATE * SM4_BLOCK_SIZE;
+        blocks -= SM4_GHASH_AGGREGATE;
+    }
+
+    if (blocks > 0) {
+        x = sm4_ghash_clmul_blocks(ctx, x, in, blocks);
+    }
+
+    sm4_ghash_store(state, x);
+}
+
+#else
+
+/* 编译器不支持PCLMULQDQ时转发到通用实现（is_supported返回0，不会被选中） */
+static void sm4_ghash_pclmul_init(SM4_GCM_Context *ctx) {
+    sm4_ghash_generic_impl.init(ctx);
+}
+
+static void sm4_ghash_pclmul_update(const SM4_GCM_Context *ctx, uint8_t *state, const uint8_t *in, size_t blocks) {
+    sm4_ghash_generic_impl.update(ctx, state, in, blocks);
+}
+
+#endif /* HAVE_PCLMUL */
+
+static int sm4_ghash_pclmul_is_supported(const SM4_CPU_Features *features) {
+#if defined(HAVE_PCLMUL) && HAVE_PCLMUL
+    return features->has_pclmulqdq && features->has_ssse3;
+#else
+    (void)features;
+    return 0;
+#endif
+}
+
+const SM4_GHASH_Implementation sm4_ghash_pclmul_impl = {
+    "pclmul",
+    sm4_ghash_pclmul_is_supported,
+    sm4_ghash_pclmul_init,
+    sm4_ghash_pclmul_update
+};
@@ -0,0 +1,232 @@
+#include "sm4_ghash.h"
+
+/*
+ * Shoup查表法GHASH，不依赖任何指令集扩展，给没有PCLMULQDQ的主机使用。
+ *
+ * 反射比特序下，把状态Z按半字节（或字节）从最后一个开始处理：每步Z右移4（8）位，
+ * 移出的低位经预先算好的约减表折回高位，再异或上 M[半字节]·H 的预计算值。
+ * 表项以两个64位整数（大端含义的高、低半）保存。
+ *
+ * 注意：查表地址依赖于数据和H，与T表后端一样不是恒定时间的。
+ */
+
+/* 右移4位时移出的半字节对应的约减值（放在高64位的最高16位） */
+static const uint16_t SM4_GHASH_REM4[16] = {
+    0x0000, 0x1C20, 0x3840, 0x2460, 0x7080, 0x6CA0, 0x48C0, 0x54E0,
+    0xE100, 0xFD20, 0xD940, 0xC560, 0x9180, 0x8DA0, 0xA9C0, 0xB5E0
+};
+
+static inline uint64_t sm4_ghash_load_u64_be(const uint8_t *p) {
+    return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+           ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) | ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+}
+
+static inline void sm4_ghash_store_u64_be(uint8_t *p, uint64_t v) {
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (56 - 8 * i));
+    }
+}
+
+/*
+ * 构造bits位Shoup表：M[2^(bits-1)] = H，M[2^(k-1)] = M[2^k]·x，其余表项由线性组合得到。
+ * 反射比特序下半字节（字节）的最高位对应x^0。
+ */
+static void sm4_ghash_build_table(uint64_t (*m)[2], const uint8_t *h, int bits) {
+    size_t size = (size_t)1 << bits;
+    uint64_t hi = sm4_ghash_load_u64_be(h);
+    uint64_t lo = sm4_ghash_load_u64_be(h + 8);
+    size_t i, j;
+
+    m[0][0] = 0;
+    m[0][1] = 0;
+    m[size >> 1][0] = hi;
+    m[size >> 1][1] = lo;
+
+    /* 乘以x：右移一位，移出的位按x^128 = x^7 + x^2 + x + 1折回 */
+    for (i = size >> 2; i > 0; i >>= 1) {
+        uint64_t carry = lo & 1;
+        lo = (lo >> 1) | (hi << 63);
+        hi = (hi >> 1) ^ (carry ? 0xe100000000000000ULL : 0);
+        m[i][0] = hi;
+        m[i][1] = lo;
+    }
+
+    for (i = 2; i < size; i <<= 1) {
+        for (j = 1; j < i; j++) {
+            m[i + j][0] = m[i][0] ^ m[j][0];
+            m[i + j][1] = m[i][1] ^ m[j][1];
+        }
+    }
+}
+
+/* 4位表：每块32次查表，表大小256字节 */
+static void sm4_ghash_table4_init(SM4_GCM_Context *ctx) {
+    sm4_ghash_build_table(ctx->table.M4, ctx->H, 4);
+}
+
+static void sm4_ghash_table4_update(const SM4_GCM_Context *ctx, uint8_t *state, const uint8_t *in, size_t blocks) {
+    const uint64_t (*m)[2] = (const uint64_t (*)[2])ctx->table.M4;
+    uint8_t x[SM4_BLOCK_SIZE];
+    uint64_t zh, zl;
+    unsigned int rem, nib;
+    size_t b;
+    int i, j;
+
+    for (j = 0; j < SM4_BLOCK_SIZE; j++) {
+        x[j] = state[j];
+    }
+
+    for (b = 0; b < blocks; b++) {
+        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
+            x[j] ^= in[b * SM4_BLOCK_SIZE + j];
+        }
+
+        nib = x[15] & 0x0f;
+        zh = m[nib][0];
+        zl = m[nib][1];
+
+        for (i = 15; i >= 0; i--) {
+            if (i != 15) {
+                nib = x[i] & 0x0f;
+                rem = (unsigned int)zl & 0x0f;
+                zl = (zh << 60) | (zl >> 4);
+                zh = (zh >> 4) ^ ((uint64_t)SM4_GHASH_REM4[rem] << 48);
+                zh ^= m[nib][0];
+                zl ^= m[nib][1];
+            }
+
+            nib = x[i] >> 4;
+            rem = (unsigned int)zl & 0x0f;
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ ((uint64_t)SM4_GHASH_REM4[rem] << 48);
+            zh ^= m[nib][0];
+            zl ^= m[nib][1];
+        }
+
+        sm4_ghash_store_u64_be(x, zh);
+        sm4_ghash_store_u64_be(x + 8, zl);
+    }
+
+    for (j = 0; j < SM4_BLOCK_SIZE; j++) {
+        state[j] = x[j];
+    }
+}
+
+static int sm4_ghash_table4_is_supported(const SM4_CPU_Features *features) {
+    (void)features;
+    return 1;
+}
+
+const SM4_GHASH_Implementation sm4_ghash_table4_impl = {
+    "table4",
+    sm4_ghash_table4_is_supported,
+    sm4_ghash_table4_init,
+    sm4_ghash_table4_update
+};
+
+#if SM4_GCM_GHASH_TABLE8
+
+/* 右移8位时移出的字节对应的约减值（放在高64位的最高16位） */
+static const uint16_t SM4_GHASH_REM8[256] = {
+    0x0000, 0x01C2, 0x0384, 0x0246, 0x0708, 0x06CA, 0x048C, 0x054E,
+    0x0E10, 0x0FD2, 0x0D94, 0x0C56, 0x0918, 0x08DA, 0x0A9C, 0x0B5E,
+    0x1C20, 0x1DE2, 0x1FA4, 0x1E66, 0x1B28, 0x1AEA, 0x18AC, 0x196E,
+    0x1230, 0x13F2, 0x11B4, 0x1076, 0x1538, 0x14FA, 0x16BC, 0x177E,
+    0x3840, 0x3982, 0x3BC4, 0x3A06, 0x3F48, 0x3E8A, 0x3CCC, 0x3D0E,
+    0x3650, 0x3792, 0x35D4, 0x3416, 0x3158, 0x309A, 0x32DC, 0x331E,
+    0x2460, 0x25A2, 0x27E4, 0x2626, 0x2368, 0x22AA, 0x20EC, 0x212E,
+    0x2A70, 0x2BB2, 0x29F4, 0x2836, 0x2D78, 0x2CBA, 0x2EFC, 0x2F3E,
+    0x7080, 0x7142, 0x7304, 0x72C6, 0x7788, 0x764A, 0x740C, 0x75CE,
+    0x7E90, 0x7F52, 0x7D14, 0x7CD6, 0x7998, 0x785A, 0x7A1C, 0x7BDE,
+    0x6CA0, 0x6D62, 0x6F24, 0x6EE6, 0x6BA8, 0x6A6A, 0x682C, 0x69EE,
+    0x62B0, 0x6372, 0x6134, 0x60F6, 0x65B8, 0x647A, 0x663C, 0x67FE,
+    0x48C0, 0x4902, 0x4B44, 0x4A86, 0x4FC8, 0x4E0A, 0x4C4C, 0x4D8E,
+    0x46D0, 0x4712, 0x4554, 0x4496, 0x41D8, 0x401A, 0x425C, 0x439E,
+    0x54E0, 0x5522, 0x5764, 0x56A6, 0x53E8, 0x522A, 0x506C, 0x51AE,
+    0x5AF0, 0x5B32, 0x5974, 0x58B6, 0x5DF8, 0x5C3A, 0x5E7C, 0x5FBE,
+    0xE100, 0xE0C2, 0xE284, 0xE346, 0xE608, 0xE7CA, 0xE58C, 0xE44E,
+    0xEF10, 0xEED2, 0xEC94, 0xED56, 0xE818, 0xE9DA, 0xEB9C, 0xEA5E,
+    0xFD20, 0xFCE2, 0xFEA4, 0xFF66, 0xFA28, 0xFBEA, 0xF9AC, 0xF86E,
+    0xF330, 0xF2F2, 0xF0B4, 0xF176, 0xF438, 0xF5FA, 0xF7BC, 0xF67E,
+    0xD940, 0xD882, 0xDAC4, 0xDB06, 0xDE48, 0xDF8A, 0xDDCC, 0xDC0E,
+    0xD750, 0xD692, 0xD4D4, 0xD516, 0xD058, 0xD19A, 0xD3DC, 0xD21E,
+    0xC560, 0xC4A2, 0xC6E4, 0xC726, 0xC268, 0xC3AA, 0xC1EC, 0xC02E,
+    0xCB70, 0xCAB2, 0xC8F4, 0xC936, 0xCC78, 0xCDBA, 0xCFFC, 0xCE3E,
+    0x9180, 0x9042, 0x9204, 0x93C6, 0x9688, 0x974A, 0x950C, 0x94CE,
+    0x9F90, 0x9E52, 0x9C14, 0x9DD6, 0x9898, 0x995A, 0x9B1C, 0x9ADE,
+    0x8DA0, 0x8C62, 0x8E24, 0x8FE6, 0x8AA8, 0x8B6A, 0x892C, 0x88EE,
+    0x83B0, 0x8272, 0x8034, 0x81F6, 0x84B8, 0x857A, 0x873C, 0x86FE,
+    0xA9C0, 0xA802, 0xAA44, 0xAB86, 0xAEC8, 0xAF0A, 0xAD4C, 0xAC8E,
+    0xA7D0, 0xA612, 0xA454, 0xA596, 0xA0D8, 0xA11A, 0xA35C, 0xA29E,
+    0xB5E0, 0xB422, 0xB664, 0xB7A6, 0xB2E8, 0xB32A, 0xB16C, 0xB0AE,
+    0xBBF0, 0xBA32, 0xB874, 0xB9B6, 0xBCF8, 0xBD3A, 0xBF7C, 0xBEBE
+};
+
+/* 8位表：每块16次查表，表大小4 KB */
+static void sm4_ghash_table8_init(SM4_GCM_Context *ctx) {
+    sm4_ghash_build_table(ctx->table.M8, ctx->H, 8);
+}
+
+static void sm4_ghash_table8_update(const SM4_GCM_Context *ctx, uint8_t *state, const uint8_t *in, size_t blocks) {
+    const uint64_t (*m)[2] = (const uint64_t (*)[2])ctx->table.M8;
+    uint8_t x[SM4_BLOCK_SIZE];
+    uint64_t zh, zl;
+    unsigned int rem;
+    size_t b;
+    int i, j;
+
+    for (j = 0; j < SM4_BLOCK_SIZE; j++) {
+        x[j] = state[j];
+    }
+
+    for (b = 0; b < blocks; b++) {
+        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
+            x[j] ^= in[b * SM4_BLOCK_SIZE + j];
+        }
+
+        zh = m[x[15]][0];
+        zl = m[x[15]][1];
+
+        for (i = 14; i >= 0; i--) {
+            rem = (unsigned int)zl & 0xff;
+            zl = (zh << 56) | (zl >> 8);
+            zh = (zh >> 8) ^ ((uint64_t)SM4_GHASH_REM8[rem] << 48);
+            zh ^= m[x[i]][0];
+            zl ^= m[x[i]][1];
+        }
+
+        sm4_ghash_store_u64_be(x, zh);
+        sm4_ghash_store_u64_be(x + 8, zl);
+    }
+
+    for (j = 0; j < SM4_BLOCK_SIZE; j++) {
+        state[j] = x[j];
+    }
+}
+
+#else
+
+/* 未启用ENABLE_GHASH_TABLE8时上下文中没有8位表，转发到4位表（is_supported返回0，不会被选中） */
+static void sm4_ghash_table8_init(SM4_GCM_Context *ctx) {
+    sm4_ghash_table4_init(ctx);
+}
+
+static void sm4_ghash_table8_update(const SM4_GCM_Context *ctx, uint8_t *state, const uint8_t *in, size_t blocks) {
+    sm4_ghash_table4_update(ctx, state, in, blocks);
+}
+
+#endif /* SM4_GCM_GHASH_TABLE8 */
+
+static int sm4_ghash_table8_is_supported(const SM4_CPU_Features *features) {
+    (void)features;
+    return SM4_GCM_GHASH_TABLE8;
+}
+
+const SM4_GHASH_Implementation sm4_ghash_table8_impl = {
+    "table8",
+    sm4_ghash_table8_is_supported,
+    sm4_ghash_table8_init,
+    sm4_ghash_table8_update
+};
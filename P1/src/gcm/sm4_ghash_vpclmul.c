@@ -0,0 +1,73 @@
+#include "sm4_ghash.h"
+
+#if defined(HAVE_VPCLMULQDQ) && HAVE_VPCLMULQDQ
+
+#include "sm4_ghash_clmul.h"
+
+static void sm4_ghash_vpclmul_init(SM4_GCM_Context *ctx) {
+    sm4_ghash_clmul_init(ctx);
+}
+
+/*
+ * 每次8块放进两个zmm，分别与[H^8 H^7 H^6 H^5]、[H^4 H^3 H^2 H^1]做无进位乘法，
+ * 四个通道的部分积异或到一起后只约减一次。不足8块的尾部交给128位内核。
+ */
+static void sm4_ghash_vpclmul_update(const SM4_GCM_Context *ctx, uint8_t *state, const uint8_t *in, size_t blocks) {
+    const __m512i bswap = _mm512_broadcast_i32x4(SM4_GHASH_BSWAP_MASK);
+    __m128i x = sm4_ghash_load(state);
+    __m512i h_hi, h_lo, d0, d1, lo, mid, hi;
+
+    if (blocks >= SM4_GHASH_AGGREGATE) {
+        sm4_ghash_load_hpow512(ctx, &h_hi, &h_lo);
+
+        while (blocks >= SM4_GHASH_AGGREGATE) {
+            d0 = _mm512_shuffle_epi8(_mm512_loadu_si512((const void *)in), bswap);
+            d1 = _mm512_shuffle_epi8(_mm512_loadu_si512((const void *)(in + 64)), bswap);
+            d0 = _mm512_xor_si512(d0, _mm512_inserti32x4(_mm512_setzero_si512(), x, 0));
+
+            lo = mid = hi = _mm512_setzero_si512();
+            sm4_ghash_clmul_acc512(d0, d1, h_hi, h_lo, &lo, &mid, &hi);
+
+            x = sm4_ghash_reduce(sm4_ghash_fold512(lo), sm4_ghash_fold512(mid), sm4_ghash_fold512(hi));
+
+            in += SM4_GHASH_AGGREGATE * SM4_BLOCK_SIZE;
+            blocks -= SM4_GHASH_AGGREGATE;
+        }
+    }
+
+    if (blocks > 0) {
+        x = sm4_ghash_clmul_blocks(ctx, x, in, blocks);
+    }
+
+    sm4_ghash_store(state, x);
+}
+
+#else
+
+/* 编译器不支持VPCLMULQDQ时转发到通用实现（is_supported返回0，不会被选中） */
+static void sm4_ghash_vpclmul_init(SM4_GCM_Context *ctx) {
+    sm4_ghash_generic_impl.init(ctx);
+}
+
+static void sm4_ghash_vpclmul_update(const SM4_GCM_Context *ctx, uint8_t *state, const uint8_t *in, size_t blocks) {
+    sm4_ghash_generic_impl.update(ctx, state, in, blocks);
+}
+
+#endif /* HAVE_VPCLMULQDQ */
+
+static int sm4_ghash_vpclmul_is_supported(const SM4_CPU_Features *features) {
+#if defined(HAVE_VPCLMULQDQ) && HAVE_VPCLMULQDQ
+    return features->has_vpclmulqdq && features->has_pclmulqdq &&
+           features->has_avx512f && features->has_avx512bw;
+#else
+    (void)features;
+    return 0;
+#endif
+}
+
+const SM4_GHASH_Implementation sm4_ghash_vpclmul_impl = {
+    "vpclmul",
+    sm4_ghash_vpclmul_is_supported,
+    sm4_ghash_vpclmul_init,
+    sm4_ghash_vpclmul_update
+};
@@ -0,0 +1,237 @@
+#include "sm4_mb.h"
+#include "sm4_internal.h"
+#include <string.h>
+
+/*
+ * 多缓冲作业管理器
+ *
+ * 大量短消息各自有密钥和IV时，单条消息内部的并行度很低（CBC加密完全串行，
+ * 64字节的CTR只有4块），多块内核填不满。管理器把最多SM4_MB_LANES个作业放进
+ * 通道，每一步从每个占用的通道各取一块，连同各自的轮密钥交给多通道内核，
+ * 一次调用推进所有作业。作业完成后通道立即空出，新作业随时补进来。
+ *
+ * 轮密钥沿用SM4_Context的布局，作业进入通道时复制到按列存放的表中，
+ * 宽向量内核每轮直接载入一行，不需要在热路径上重新排列。
+ */
+
+/* 作业参数检查 */
+static int sm4_mb_job_valid(const SM4_MB_Job *job) {
+    if (job->key == NULL) {
+        return 0;
+    }
+    if (job->len > 0 && (job->in == NULL || job->out == NULL)) {
+        return 0;
+    }
+
+    switch (job->mode) {
+    case SM4_MB_ECB:
+        return job->len % SM4_BLOCK_SIZE == 0;
+    case SM4_MB_CBC_ENCRYPT:
+    case SM4_MB_CBC_DECRYPT:
+        return job->len % SM4_BLOCK_SIZE == 0 && job->iv != NULL;
+    case SM4_MB_CTR:
+        return job->iv != NULL;
+    default:
+        return 0;
+    }
+}
+
+/* 计数器块（128位大端整数）加1 */
+static void sm4_mb_ctr_inc(uint8_t *counter) {
+    int i;
+
+    for (i = SM4_BLOCK_SIZE - 1; i >= 0; i--) {
+        if (++counter[i] != 0) {
+            break;
+        }
+    }
+}
+
+/* 已完成的作业入队；队列长度不超过空闲通道数，不会溢出 */
+static void sm4_mb_push_completed(SM4_MB_Mgr *mgr, SM4_MB_Job *job) {
+    size_t tail = (mgr->completed_head + mgr->completed_count) % SM4_MB_LANES;
+
+    mgr->completed[tail] = job;
+    mgr->completed_count++;
+}
+
+/* 取出一个已完成的作业 */
+static SM4_MB_Job *sm4_mb_pop_completed(SM4_MB_Mgr *mgr) {
+    SM4_MB_Job *job;
+
+    if (mgr->completed_count == 0) {
+        return NULL;
+    }
+    job = mgr->completed[mgr->completed_head];
+    mgr->completed_head = (mgr->completed_head + 1) % SM4_MB_LANES;
+    mgr->completed_count--;
+    return job;
+}
+
+/* 作业进入通道l：复制轮密钥列和IV */
+static void sm4_mb_load_lane(SM4_MB_Mgr *mgr, unsigned int l, SM4_MB_Job *job) {
+    int i;
+
+    for (i = 0; i < SM4_ROUNDS; i++) {
+        mgr->rk[i][l] = job->key->rk[i];
+    }
+    if (job->mode != SM4_MB_ECB) {
+        memcpy(mgr->chain[l], job->iv, SM4_BLOCK_SIZE);
+    }
+    mgr->lanes[l] = job;
+    mgr->pos[l] = 0;
+    mgr->busy |= 1u << l;
+}
+
+/* 作业完成：清除通道中的密钥材料后释放通道 */
+static void sm4_mb_release_lane(SM4_MB_Mgr *mgr, unsigned int l) {
+    int i;
+
+    for (i = 0; i < SM4_ROUNDS; i++) {
+        mgr->rk[i][l] = 0;
+    }
+    memset(mgr->chain[l], 0, SM4_BLOCK_SIZE);
+    mgr->lanes[l]->status = SM4_MB_STATUS_COMPLETED;
+    sm4_mb_push_completed(mgr, mgr->lanes[l]);
+    mgr->lanes[l] = NULL;
+    mgr->busy &= ~(1u << l);
+}
+
+/*
+ * 推进所有通道，直到至少一个作业完成。每一步每个占用的通道处理一块：
+ * 先按模式准备内核输入，再一次多通道调用，最后按模式写出并更新链值。
+ */
+static void sm4_mb_run(SM4_MB_Mgr *mgr) {
+    uint8_t in[SM4_MB_LANES * SM4_BLOCK_SIZE];
+    uint8_t out[SM4_MB_LANES * SM4_BLOCK_SIZE];
+    const uint32_t (*rk)[SM4_MB_LANES] = (const uint32_t (*)[SM4_MB_LANES])mgr->rk;
+    SM4_MB_Job *job;
+    uint8_t *x, *y;
+    size_t n;
+    unsigned int l;
+    int done = 0, i;
+
+    while (!done && mgr->busy != 0) {
+        for (l = 0; l < SM4_MB_LANES; l++) {
+            job = mgr->lanes[l];
+            if (job == NULL) {
+                continue;
+            }
+            x = in + l * SM4_BLOCK_SIZE;
+            switch (job->mode) {
+            case SM4_MB_CBC_ENCRYPT:
+                for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+                    x[i] = job->in[mgr->pos[l] + i] ^ mgr->chain[l][i];
+                }
+                break;
+            case SM4_MB_CTR:
+                memcpy(x, mgr->chain[l], SM4_BLOCK_SIZE);
+                break;
+            default:
+                /* ECB和CBC解密；输入块留在in中，原地解密时仍可作为下一块的链值 */
+                memcpy(x, job->in + mgr->pos[l], SM4_BLOCK_SIZE);
+                break;
+            }
+        }
+
+        sm4_crypt_lanes(rk, out, in, mgr->busy);
+
+        for (l = 0; l < SM4_MB_LANES; l++) {
+            job = mgr->lanes[l];
+            if (job == NULL) {
+                continue;
+            }
+            x = in + l * SM4_BLOCK_SIZE;
+            y = out + l * SM4_BLOCK_SIZE;
+            n = SM4_BLOCK_SIZE;
+            switch (job->mode) {
+            case SM4_MB_CBC_ENCRYPT:
+                memcpy(mgr->chain[l], y, SM4_BLOCK_SIZE);
+                memcpy(job->out + mgr->pos[l], y, SM4_BLOCK_SIZE);
+                break;
+            case SM4_MB_CBC_DECRYPT:
+                for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+                    job->out[mgr->pos[l] + i] = y[i] ^ mgr->chain[l][i];
+                }
+                memcpy(mgr->chain[l], x, SM4_BLOCK_SIZE);
+                break;
+            case SM4_MB_CTR:
+                if (job->len - mgr->pos[l] < n) {
+                    n = job->len - mgr->pos[l];
+                }
+                for (i = 0; i < (int)n; i++) {
+                    job->out[mgr->pos[l] + i] = job->in[mgr->pos[l] + i] ^ y[i];
+                }
+                sm4_mb_ctr_inc(mgr->chain[l]);
+                break;
+            default:
+                memcpy(job->out + mgr->pos[l], y, SM4_BLOCK_SIZE);
+                break;
+            }
+
+            mgr->pos[l] += n;
+            if (mgr->pos[l] == job->len) {
+                sm4_mb_release_lane(mgr, l);
+                done = 1;
+            }
+        }
+    }
+
+    memset(in, 0, sizeof(in));
+    memset(out, 0, sizeof(out));
+}
+
+/* 初始化多缓冲管理器 */
+void sm4_mb_mgr_init(SM4_MB_Mgr *mgr) {
+    memset(mgr, 0, sizeof(*mgr));
+}
+
+/* 提交一个作业 */
+SM4_MB_Job *sm4_mb_submit(SM4_MB_Mgr *mgr, SM4_MB_Job *job) {
+    unsigned int l;
+
+    if (mgr == NULL || job == NULL) {
+        return NULL;
+    }
+
+    if (!sm4_mb_job_valid(job)) {
+        job->status = SM4_MB_STATUS_INVALID_ARGS;
+        return job;
+    }
+    if (job->len == 0) {
+        job->status = SM4_MB_STATUS_COMPLETED;
+        return job;
+    }
+
+    job->status = SM4_MB_STATUS_BEING_PROCESSED;
+    if (mgr->busy == (1u << SM4_MB_LANES) - 1) {
+        sm4_mb_run(mgr);
+    }
+    for (l = 0; l < SM4_MB_LANES; l++) {
+        if (mgr->lanes[l] == NULL) {
+            sm4_mb_load_lane(mgr, l, job);
+            break;
+        }
+    }
+
+    return sm4_mb_pop_completed(mgr);
+}
+
+/* 取回一个已完成的作业 */
+SM4_MB_Job *sm4_mb_get_completed(SM4_MB_Mgr *mgr) {
+    if (mgr == NULL) {
+        return NULL;
+    }
+    return sm4_mb_pop_completed(mgr);
+}
+
+/* 推进未满的通道，直到至少一个作业完成 */
+SM4_MB_Job *sm4_mb_flush(SM4_MB_Mgr *mgr) {
+    if (mgr == NULL) {
+        return NULL;
+    }
+    if (mgr->completed_count == 0) {
+        sm4_mb_run(mgr);
+    }
+    return sm4_mb_pop_completed(mgr);
+}
@@ -0,0 +1,106 @@
+#ifndef SM4_GFNI_KERNEL_H
+#define SM4_GFNI_KERNEL_H
+
+/*
+ * GFNI后端的zmm内核原语：S盒、合成变换T、16块转置载入/写出和轮函数。
+ * 供GFNI后端（sm4_modern_inst.c）和GCM的缝合内核（src/gcm/sm4_gcm_gfni.c）共用，
+ * 只能在用-mgfni -mavx512f -mavx512bw（或更高）编译的源文件中包含。
+ */
+
+#include "sm4.h"
+#include <stddef.h>
+#include <immintrin.h>
+
+/*
+ * SM4 S盒可以写成 S(x) = A·inv(A·x + 0xD3) + 0xD3，其中inv是多项式0x1F5
+ * 定义的GF(2^8)上的求逆，A是8x8循环矩阵。GFNI的求逆固定使用AES的多项式
+ * 0x11B，取域同构T（0x1F5 -> 0x11B，x -> 0x23），有
+ *
+ *   S(x) = (A·T^-1)·inv_aes(T·A·x + T·0xD3) + 0xD3
+ *
+ * 第一步用gf2p8affineqb计算 T·A·x + T·0xD3，
+ * 第二步用gf2p8affineinvqb计算 (A·T^-1)·inv_aes(y) + 0xD3。
+ * 矩阵按指令的约定编码：第7-i个字节是输出第i位对应的行。
+ */
+#define SM4_GFNI_PRE_MATRIX   0x4c287db91a22505dULL  // T·A
+#define SM4_GFNI_PRE_CONST    0x3e                   // T·0xD3
+#define SM4_GFNI_POST_MATRIX  0xf3ab34a974a6b589ULL  // A·T^-1
+#define SM4_GFNI_POST_CONST   0xd3
+
+/* 一个zmm寄存器并行处理的块数 */
+#define SM4_GFNI_LANES 16
+
+/* 每个32位字内字节反序（大端字与小端寄存器之间转换） */
+static const uint8_t SM4_GFNI_BSWAP32[16] = {
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+
+/* GFNI实现的SM4 S盒，64个字节同时查表 */
+static inline __m512i sm4_sbox_gfni(__m512i x) {
+    const __m512i pre = _mm512_set1_epi64((long long)SM4_GFNI_PRE_MATRIX);
+    const __m512i post = _mm512_set1_epi64((long long)SM4_GFNI_POST_MATRIX);
+    
+    x = _mm512_gf2p8affine_epi64_epi8(x, pre, SM4_GFNI_PRE_CONST);
+    return _mm512_gf2p8affineinv_epi64_epi8(x, post, SM4_GFNI_POST_CONST);
+}
+
+/* 合成变换T：S盒后用VPROLD做线性变换L，五路异或用两条VPTERNLOGD */
+static inline __m512i sm4_t_gfni(__m512i x) {
+    __m512i t;
+    
+    x = sm4_sbox_gfni(x);
+    t = _mm512_ternarylogic_epi32(x, _mm512_rol_epi32(x, 2), _mm512_rol_epi32(x, 10), 0x96);
+    return _mm512_ternarylogic_epi32(t, _mm512_rol_epi32(x, 18), _mm512_rol_epi32(x, 24), 0x96);
+}
+
+/* 每个128位通道内的4x4的32位矩阵转置（自逆） */
+static inline void sm4_gfni_transpose(__m512i *x0, __m512i *x1, __m512i *x2, __m512i *x3) {
+    __m512i t0 = _mm512_unpacklo_epi32(*x0, *x1);
+    __m512i t1 = _mm512_unpacklo_epi32(*x2, *x3);
+    __m512i t2 = _mm512_unpackhi_epi32(*x0, *x1);
+    __m512i t3 = _mm512_unpackhi_epi32(*x2, *x3);
+    
+    *x0 = _mm512_unpacklo_epi64(t0, t1);
+    *x1 = _mm512_unpackhi_epi64(t0, t1);
+    *x2 = _mm512_unpacklo_epi64(t2, t3);
+    *x3 = _mm512_unpackhi_epi64(t2, t3);
+}
+
+/*
+ * 载入最多16个块并转置，x[j]保存各块的第j个字。第j次载入块4j~4j+3，
+ * 各占一个128位通道；通道内转置后第k个通道保存块k、4+k、8+k、12+k。
+ * 不足16块时用掩码载入，不会越界读。
+ */
+static inline void sm4_gfni_load16(__m512i x[4], const uint8_t *in, size_t blocks) {
+    const __m512i bswap = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)SM4_GFNI_BSWAP32));
+    __mmask16 mask;
+    size_t j, n;
+    
+    for (j = 0; j < 4; j++) {
+        n = blocks > 4 * j ? blocks - 4 * j : 0;
+        mask = n >= 4 ? (__mmask16)0xffff : (__mmask16)((1u << (4 * n)) - 1);
+        x[j] = _mm512_maskz_loadu_epi32(mask, in + j * 4 * SM4_BLOCK_SIZE);
+        x[j] = _mm512_shuffle_epi8(x[j], bswap);
+    }
+    sm4_gfni_transpose(&x[0], &x[1], &x[2], &x[3]);
+}
+
+/* 反序变换后转置回块并写出，不足16块时用掩码写出 */
+static inline void sm4_gfni_store16(uint8_t *out, __m512i x[4], size_t blocks) {
+    const __m512i bswap = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)SM4_GFNI_BSWAP32));
+    __mmask16 mask;
+    size_t j, n;
+    
+    sm4_gfni_transpose(&x[3], &x[2], &x[1], &x[0]);
+    for (j = 0; j < 4; j++) {
+        n = blocks > 4 * j ? blocks - 4 * j : 0;
+        mask = n >= 4 ? (__mmask16)0xffff : (__mmask16)((1u << (4 * n)) - 1);
+        _mm512_mask_storeu_epi32(out + j * 4 * SM4_BLOCK_SIZE, mask, _mm512_shuffle_epi8(x[3 - j], bswap));
+    }
+}
+
+/* 一轮：x[a] ^= T(x[b] ^ x[c] ^ x[d] ^ rk) */
+#define SM4_GFNI_ROUND(x, a, b, c, d, rk) \
+    (x)[a] = _mm512_xor_si512((x)[a], sm4_t_gfni(_mm512_xor_si512(_mm512_ternarylogic_epi32((x)[b], (x)[c], (x)[d], 0x96), (rk))))
+
+#endif /* SM4_GFNI_KERNEL_H */
@@ -1,8 +1,8 @@
-#include "sm4.h"
+#include "sm4_internal.h"
 #include <string.h>
 
 #if defined(HAVE_GFNI) && HAVE_GFNI
-#include <immintrin.h>
+#include "sm4_gfni_kernel.h"
 #endif
 
 /* SM4 S盒 */
@@ -27,7 +27,7 @@ static const uint8_t SM4_SBOX[256] = {
 
 /* 系统参数 */
 static const uint32_t SYSTEM_PARAMETER[4] = {
-    0x00070e15, 0x1c232a31, 0x383f464d, 0x545b6269
+    0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc
 };
 
 /* 固定参数 */
@@ -43,9 +43,6 @@ static const uint32_t FIXED_PARAMETER[32] = {
 };
 
 /* T表 - 预计算S盒和线性变换的组合 */
-static uint32_t T_TABLE[256];
-static int T_TABLE_INITIALIZED = 0;
-
 /* 循环左移 */
 static inline uint32_t rotl32(uint32_t x, int n) {
     return (x << n) | (x >> (32 - n));
@@ -56,54 +53,11 @@ static inline uint32_t load_u32_be(const uint8_t *b) {
     return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | (uint32_t)b[3];
 }
 
-/* 32位整数转换为字节（大端序） */
-static inline void store_u32_be(uint32_t v, uint8_t *b) {
-    b[0] = (uint8_t)(v >> 24);
-    b[1] = (uint8_t)(v >> 16);
-    b[2] = (uint8_t)(v >> 8);
-    b[3] = (uint8_t)v;
-}
-
-/* 线性变换L */
-static uint32_t sm4_l_transform(uint32_t a) {
-    return a ^ rotl32(a, 2) ^ rotl32(a, 10) ^ rotl32(a, 18) ^ rotl32(a, 24);
-}
-
 /* 线性变换L' */
 static uint32_t sm4_l_prime_transform(uint32_t a) {
     return a ^ rotl32(a, 13) ^ rotl32(a, 23);
 }
 
-/* 初始化T表 */
-static void init_t_tables(void) {
-    int i;
-    uint32_t t;
-    
-    if (T_TABLE_INITIALIZED) {
-        return;
-    }
-    
-    for (i = 0; i < 256; i++) {
-        t = (uint32_t)SM4_SBOX[i] << 24;
-        T_TABLE[i] = sm4_l_transform(t);
-    }
-    
-    T_TABLE_INITIALIZED = 1;
-}
-
-/* 使用T表的合成变换T */
-static uint32_t sm4_t_transform_table(uint32_t a) {
-    uint8_t a0 = (uint8_t)(a >> 24);
-    uint8_t a1 = (uint8_t)(a >> 16);
-    uint8_t a2 = (uint8_t)(a >> 8);
-    uint8_t a3 = (uint8_t)a;
-    
-    return T_TABLE[a0] ^ 
-           rotl32(T_TABLE[a1], 8) ^ 
-           rotl32(T_TABLE[a2], 16) ^ 
-           rotl32(T_TABLE[a3], 24);
-}
-
 /* 合成变换T' */
 static uint32_t sm4_t_prime_transform(uint32_t a) {
     uint8_t a0 = (uint8_t)(a >> 24);
@@ -121,82 +75,75 @@ static uint32_t sm4_t_prime_transform(uint32_t a) {
 
 #if defined(HAVE_GFNI) && HAVE_GFNI
 
-/* GFNI指令集优化的SM4 S盒 */
-static __m128i sm4_sbox_gfni(__m128i x) {
-    /* 
-     * 使用GFNI指令集实现SM4 S盒
-     * GFNI (Galois Field New Instructions)允许高效实现有限域上的操作
-     * 这对于实现S盒非常有用
-     */
-    
-    /* 
-     * 这里需要使用_mm_gf2p8affine_epi64_epi8指令
-     * 该指令可以实现任意8位S盒的查找
-     * 需要提供适当的仿射变换矩阵
-     */
+/* 最多16个块并行加密/解密，寄存器角色每轮轮换，4轮一圈，不需要搬移数据 */
+static void sm4_gfni_crypt16(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+    __m512i x[4];
+    __m512i rk;
+    int i;
     
-    /* SM4 S盒的GFNI实现参数 */
-    static const __m128i affine_matrix = _mm_set_epi64x(
-        0x0123456789ABCDEFULL, 0xFEDCBA9876543210ULL); /* 示例值，实际需要计算 */
-    static const uint8_t affine_constant = 0x63; /* 示例值，实际需要计算 */
+    sm4_gfni_load16(x, in, blocks);
+    
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        rk = _mm512_set1_epi32((int)ctx->rk[i]);
+        SM4_GFNI_ROUND(x, 0, 1, 2, 3, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 1]);
+        SM4_GFNI_ROUND(x, 1, 2, 3, 0, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 2]);
+        SM4_GFNI_ROUND(x, 2, 3, 0, 1, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 3]);
+        SM4_GFNI_ROUND(x, 3, 0, 1, 2, rk);
+    }
     
-    /* 应用GFNI指令 */
-    return _mm_gf2p8affine_epi64_epi8(x, affine_matrix, affine_constant);
-}
-
-/* VPROLD指令优化的循环左移 */
-static __m128i sm4_rotl_gfni(__m128i x, int n) {
-    /* 使用AVX-512的VPROLD指令进行循环左移 */
-    return _mm_rol_epi32(x, n);
+    sm4_gfni_store16(out, x, blocks);
 }
 
-/* GFNI优化的SM4轮函数 */
-static __m128i sm4_round_gfni(__m128i x, __m128i rk) {
-    /* 
-     * 使用GFNI和其他现代指令集优化SM4轮函数
-     */
-    
-    /* 将输入与轮密钥异或 */
-    __m128i t = _mm_xor_si128(x, rk);
-    
-    /* 应用S盒替代 */
-    t = sm4_sbox_gfni(t);
+/* 32个块并行加密/解密：两组16块交错执行，掩盖GFNI指令的延迟 */
+static void sm4_gfni_crypt32(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    __m512i x[4], y[4];
+    __m512i rk;
+    int i;
     
-    /* 应用线性变换 */
-    __m128i t2 = t;
-    __m128i t10 = sm4_rotl_gfni(t, 2);
-    __m128i t18 = sm4_rotl_gfni(t, 10);
-    __m128i t24 = sm4_rotl_gfni(t, 18);
-    __m128i t26 = sm4_rotl_gfni(t, 24);
+    sm4_gfni_load16(x, in, SM4_GFNI_LANES);
+    sm4_gfni_load16(y, in + SM4_GFNI_LANES * SM4_BLOCK_SIZE, SM4_GFNI_LANES);
+    
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        rk = _mm512_set1_epi32((int)ctx->rk[i]);
+        SM4_GFNI_ROUND(x, 0, 1, 2, 3, rk);
+        SM4_GFNI_ROUND(y, 0, 1, 2, 3, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 1]);
+        SM4_GFNI_ROUND(x, 1, 2, 3, 0, rk);
+        SM4_GFNI_ROUND(y, 1, 2, 3, 0, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 2]);
+        SM4_GFNI_ROUND(x, 2, 3, 0, 1, rk);
+        SM4_GFNI_ROUND(y, 2, 3, 0, 1, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 3]);
+        SM4_GFNI_ROUND(x, 3, 0, 1, 2, rk);
+        SM4_GFNI_ROUND(y, 3, 0, 1, 2, rk);
+    }
     
-    return _mm_xor_si128(_mm_xor_si128(_mm_xor_si128(_mm_xor_si128(t2, t10), t18), t24), t26);
+    sm4_gfni_store16(out, x, SM4_GFNI_LANES);
+    sm4_gfni_store16(out + SM4_GFNI_LANES * SM4_BLOCK_SIZE, y, SM4_GFNI_LANES);
 }
 
-/* GFNI优化的SM4加密 */
-static void sm4_encrypt_block_gfni(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
-    __m128i x = _mm_loadu_si128((__m128i*)in);
-    __m128i rk[32];
+/*
+ * 16个块各用自己的轮密钥：转置载入后第e个元素是块4(e%4) + e/4，
+ * 每轮把rk的一行按同样的顺序置换到元素上
+ */
+static void sm4_gfni_crypt_lanes16(const uint32_t rk[SM4_ROUNDS][SM4_MB_LANES], uint8_t *out, const uint8_t *in) {
+    const __m512i idx = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    __m512i x[4];
     int i;
     
-    /* 加载轮密钥 */
-    for (i = 0; i < 32; i++) {
-        rk[i] = _mm_set1_epi32(ctx->rk[i]);
-    }
+    sm4_gfni_load16(x, in, SM4_GFNI_LANES);
     
-    /* 32轮加密 */
-    for (i = 0; i < 32; i++) {
-        x = sm4_round_gfni(x, rk[i]);
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        SM4_GFNI_ROUND(x, 0, 1, 2, 3, _mm512_permutexvar_epi32(idx, _mm512_loadu_si512((const void *)rk[i])));
+        SM4_GFNI_ROUND(x, 1, 2, 3, 0, _mm512_permutexvar_epi32(idx, _mm512_loadu_si512((const void *)rk[i + 1])));
+        SM4_GFNI_ROUND(x, 2, 3, 0, 1, _mm512_permutexvar_epi32(idx, _mm512_loadu_si512((const void *)rk[i + 2])));
+        SM4_GFNI_ROUND(x, 3, 0, 1, 2, _mm512_permutexvar_epi32(idx, _mm512_loadu_si512((const void *)rk[i + 3])));
     }
     
-    /* 存储结果 */
-    _mm_storeu_si128((__m128i*)out, x);
-}
-
-/* 检测CPU是否支持GFNI */
-static int has_gfni_support(void) {
-    /* 实际实现应该使用CPUID指令检测 */
-    /* 这里简化为编译时检测 */
-    return 1;
+    sm4_gfni_store16(out, x, SM4_GFNI_LANES);
 }
 
 #endif /* HAVE_GFNI */
@@ -207,9 +154,6 @@ static void sm4_set_key(SM4_Context *ctx, const uint8_t *key, int is_encrypt) {
     uint32_t K[36]; // 中间密钥
     int i;
     
-    /* 确保T表已初始化 */
-    init_t_tables();
-    
     /* 将密钥转换为字 */
     MK[0] = load_u32_be(key);
     MK[1] = load_u32_be(key + 4);
@@ -239,154 +183,144 @@ static void sm4_set_key(SM4_Context *ctx, const uint8_t *key, int is_encrypt) {
     }
 }
 
-void sm4_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
+static void sm4_gfni_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
     sm4_set_key(ctx, key, 1);
 }
 
-void sm4_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
+static void sm4_gfni_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
     sm4_set_key(ctx, key, 0);
 }
 
-/* 加密单个块 */
-void sm4_encrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
 #if defined(HAVE_GFNI) && HAVE_GFNI
-    /* 如果支持GFNI，使用优化版本 */
-    if (has_gfni_support()) {
-        sm4_encrypt_block_gfni(ctx, out, in);
-        return;
+
+/* 密钥扩展一轮：x[a] ^= T'(x[b] ^ x[c] ^ x[d] ^ ck)，T'的线性部分L'(y) = y ^ rol13(y) ^ rol23(y) */
+#define SM4_GFNI_KEY_ROUND(x, a, b, c, d, ck) do { \
+        __m512i s_ = sm4_sbox_gfni(_mm512_xor_si512(_mm512_ternarylogic_epi32((x)[b], (x)[c], (x)[d], 0x96), (ck))); \
+        (x)[a] = _mm512_ternarylogic_epi32((x)[a], s_, \
+                                           _mm512_xor_si512(_mm512_rol_epi32(s_, 13), _mm512_rol_epi32(s_, 23)), 0x96); \
+    } while (0)
+
+/*
+ * 最多16个密钥并行扩展：密钥按块的方式转置载入，每个元素是一个密钥的一个字，
+ * 轮函数与加密相同，只是线性变换换成L'、轮密钥换成CK。元素e = 4k + p对应第4p + k个密钥。
+ */
+static void sm4_gfni_set_keys16(SM4_Context *ctx, const uint8_t *keys, size_t count) {
+    uint32_t rk[SM4_ROUNDS][SM4_GFNI_LANES];
+    __m512i k[4];
+    size_t b;
+    int i, j;
+    
+    sm4_gfni_load16(k, keys, count);
+    for (j = 0; j < 4; j++) {
+        k[j] = _mm512_xor_si512(k[j], _mm512_set1_epi32((int)SYSTEM_PARAMETER[j]));
     }
-#endif
     
-    /* 回退到T表实现 */
-    uint32_t X[4];
-    uint32_t temp;
-    int i;
-    
-    /* 确保T表已初始化 */
-    init_t_tables();
-    
-    /* 将输入块转换为字 */
-    X[0] = load_u32_be(in);
-    X[1] = load_u32_be(in + 4);
-    X[2] = load_u32_be(in + 8);
-    X[3] = load_u32_be(in + 12);
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        SM4_GFNI_KEY_ROUND(k, 0, 1, 2, 3, _mm512_set1_epi32((int)FIXED_PARAMETER[i]));
+        _mm512_storeu_si512((void *)rk[i], k[0]);
+        SM4_GFNI_KEY_ROUND(k, 1, 2, 3, 0, _mm512_set1_epi32((int)FIXED_PARAMETER[i + 1]));
+        _mm512_storeu_si512((void *)rk[i + 1], k[1]);
+        SM4_GFNI_KEY_ROUND(k, 2, 3, 0, 1, _mm512_set1_epi32((int)FIXED_PARAMETER[i + 2]));
+        _mm512_storeu_si512((void *)rk[i + 2], k[2]);
+        SM4_GFNI_KEY_ROUND(k, 3, 0, 1, 2, _mm512_set1_epi32((int)FIXED_PARAMETER[i + 3]));
+        _mm512_storeu_si512((void *)rk[i + 3], k[3]);
+    }
     
-    /* 32轮迭代 */
-    for (i = 0; i < 32; i++) {
-        temp = X[1] ^ X[2] ^ X[3] ^ ctx->rk[i];
-        temp = sm4_t_transform_table(temp);
-        X[0] ^= temp;
+    for (b = 0; b < count; b++) {
+        size_t e = 4 * (b % 4) + b / 4;
         
-        /* 循环移位 */
-        temp = X[0];
-        X[0] = X[1];
-        X[1] = X[2];
-        X[2] = X[3];
-        X[3] = temp;
+        for (i = 0; i < SM4_ROUNDS; i++) {
+            ctx[b].rk[i] = rk[i][e];
+        }
     }
-    
-    /* 反序变换 */
-    store_u32_be(X[3], out);
-    store_u32_be(X[2], out + 4);
-    store_u32_be(X[1], out + 8);
-    store_u32_be(X[0], out + 12);
 }
 
-/* 解密单个块（与加密相同，只是轮密钥顺序相反） */
-void sm4_decrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
-    sm4_encrypt_block(ctx, out, in);
-}
+#endif /* HAVE_GFNI */
 
-/* 加密多个块（ECB模式） */
-void sm4_encrypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
-    size_t i;
-    for (i = 0; i < blocks; i++) {
-        sm4_encrypt_block(ctx, out, in);
-        in += SM4_BLOCK_SIZE;
-        out += SM4_BLOCK_SIZE;
+/* 批量扩展加密密钥，每16个一组 */
+static void sm4_gfni_set_encrypt_keys(SM4_Context *ctx, const uint8_t *keys, size_t count) {
+#if defined(HAVE_GFNI) && HAVE_GFNI
+    while (count > 0) {
+        size_t n = count < SM4_GFNI_LANES ? count : SM4_GFNI_LANES;
+        
+        sm4_gfni_set_keys16(ctx, keys, n);
+        ctx += n;
+        keys += n * SM4_KEY_SIZE;
+        count -= n;
     }
-}
-
-/* 解密多个块（ECB模式） */
-void sm4_decrypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+#else
     size_t i;
-    for (i = 0; i < blocks; i++) {
-        sm4_decrypt_block(ctx, out, in);
-        in += SM4_BLOCK_SIZE;
-        out += SM4_BLOCK_SIZE;
-    }
-}
-
-/* ECB模式加密 */
-int sm4_ecb_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
     
-    sm4_encrypt_blocks(ctx, out, in, len / SM4_BLOCK_SIZE);
-    return 0;
-}
-
-/* ECB模式解密 */
-int sm4_ecb_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
+    for (i = 0; i < count; i++) {
+        sm4_set_key(&ctx[i], keys + i * SM4_KEY_SIZE, 1);
     }
-    
-    sm4_decrypt_blocks(ctx, out, in, len / SM4_BLOCK_SIZE);
-    return 0;
+#endif
 }
 
-/* CBC模式加密 */
-int sm4_cbc_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv) {
-    size_t i, j;
-    uint8_t tmp[SM4_BLOCK_SIZE];
-    
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
+/* 加密/解密多个块（解密与加密相同，只是轮密钥顺序相反） */
+static void sm4_gfni_crypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+#if defined(HAVE_GFNI) && HAVE_GFNI
+    /* 调度层只在CPU支持时选择本后端 */
+    while (blocks >= 2 * SM4_GFNI_LANES) {
+        sm4_gfni_crypt32(ctx, out, in);
+        in += 2 * SM4_GFNI_LANES * SM4_BLOCK_SIZE;
+        out += 2 * SM4_GFNI_LANES * SM4_BLOCK_SIZE;
+        blocks -= 2 * SM4_GFNI_LANES;
     }
     
-    for (i = 0; i < len; i += SM4_BLOCK_SIZE) {
-        /* 明文与IV异或 */
-        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
-            tmp[j] = in[i + j] ^ iv[j];
-        }
-        
-        /* 加密 */
-        sm4_encrypt_block(ctx, out + i, tmp);
+    while (blocks > 0) {
+        size_t n = blocks < SM4_GFNI_LANES ? blocks : SM4_GFNI_LANES;
         
-        /* 更新IV */
-        memcpy(iv, out + i, SM4_BLOCK_SIZE);
+        sm4_gfni_crypt16(ctx, out, in, n);
+        in += n * SM4_BLOCK_SIZE;
+        out += n * SM4_BLOCK_SIZE;
+        blocks -= n;
     }
-    
-    return 0;
+#else
+    /* 未编译GFNI支持时本后端不会被选中 */
+    sm4_t_table_impl.crypt_blocks(ctx, out, in, blocks);
+#endif
 }
 
-/* CBC模式解密 */
-int sm4_cbc_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv) {
-    size_t i, j;
-    uint8_t tmp[SM4_BLOCK_SIZE];
-    uint8_t next_iv[SM4_BLOCK_SIZE];
-    
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
-    
-    for (i = 0; i < len; i += SM4_BLOCK_SIZE) {
-        /* 保存下一个IV */
-        memcpy(next_iv, in + i, SM4_BLOCK_SIZE);
-        
-        /* 解密 */
-        sm4_decrypt_block(ctx, tmp, in + i);
-        
-        /* 与IV异或 */
-        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
-            out[i + j] = tmp[j] ^ iv[j];
+/* 多通道加密/解密，每个通道一个密钥 */
+static void sm4_gfni_crypt_lanes(const uint32_t rk[SM4_ROUNDS][SM4_MB_LANES], uint8_t *out, const uint8_t *in) {
+#if defined(HAVE_GFNI) && HAVE_GFNI
+    sm4_gfni_crypt_lanes16(rk, out, in);
+#else
+    SM4_Context ctx;
+    int l, i;
+    
+    for (l = 0; l < SM4_MB_LANES; l++) {
+        for (i = 0; i < SM4_ROUNDS; i++) {
+            ctx.rk[i] = rk[i][l];
         }
-        
-        /* 更新IV */
-        memcpy(iv, next_iv, SM4_BLOCK_SIZE);
+        sm4_t_table_impl.crypt_block(&ctx, out + l * SM4_BLOCK_SIZE, in + l * SM4_BLOCK_SIZE);
     }
-    
+#endif
+}
+
+/* 加密/解密单个块 */
+static void sm4_gfni_crypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    sm4_gfni_crypt_blocks(ctx, out, in, 1);
+}
+
+/* 需要编译期开启GFNI且CPU支持GFNI、AVX-512F和AVX-512BW */
+static int sm4_gfni_is_supported(const SM4_CPU_Features *features) {
+#if defined(HAVE_GFNI) && HAVE_GFNI
+    return features->has_gfni && features->has_avx512f && features->has_avx512bw;
+#else
+    (void)features;
     return 0;
-}
\ No newline at end of file
+#endif
+}
+
+const SM4_Implementation sm4_gfni_impl = {
+    "gfni",
+    sm4_gfni_is_supported,
+    sm4_gfni_set_encrypt_key,
+    sm4_gfni_set_decrypt_key,
+    sm4_gfni_crypt_block,
+    sm4_gfni_crypt_blocks,
+    sm4_gfni_set_encrypt_keys,
+    sm4_gfni_crypt_lanes
+};
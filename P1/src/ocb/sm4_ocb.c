@@ -0,0 +1,343 @@
+#include "sm4_ocb.h"
+#include <string.h>
+
+/*
+ * SM4-OCB（RFC 7253，OCB3）
+ *
+ * 第i块 C_i = Offset_i ^ E(P_i ^ Offset_i)，Offset_i = Offset_{i-1} ^ L_{ntz(i)}，
+ * 校验和是明文的异或，标签 = E(校验和 ^ Offset ^ L_$) ^ HASH(AAD)。
+ * 每块只需一次SM4和几次异或，块与块之间没有链式依赖，也没有GHASH那样单独的一遍。
+ *
+ * 批量偏移量：每批B = SM4_OCB_BATCH_BLOCKS（32）块，从第Bk+1块开始，批内前B-1块的ntz
+ * 与k无关，所以Offset_{Bk+j} = Offset_{Bk} ^ batch[j-1]（j < B），batch在初始化时预计算；
+ * 最后一块再异或L_{ntz(B(k+1))}。一批偏移量只需B次异或，白化（同时累加校验和）后
+ * 整批交给多块内核，GFNI后端正好走32块交错的内核。
+ */
+
+/* 单条消息最多的整块数 */
+#define SM4_OCB_MAX_BLOCKS (((uint64_t)1 << SM4_OCB_L_COUNT) - 1)
+
+/* b = b·x（128位大端左移一位，溢出时最低字节异或0x87） */
+static void sm4_ocb_double(uint8_t *out, const uint8_t *in) {
+    uint8_t carry = in[0] >> 7;
+    int i;
+
+    for (i = 0; i < SM4_BLOCK_SIZE - 1; i++) {
+        out[i] = (uint8_t)(in[i] << 1 | in[i + 1] >> 7);
+    }
+    out[SM4_BLOCK_SIZE - 1] = (uint8_t)(in[SM4_BLOCK_SIZE - 1] << 1) ^ (0x87 & (0 - carry));
+}
+
+/* 末尾0的个数（i > 0） */
+static unsigned int sm4_ocb_ntz(uint64_t i) {
+    unsigned int n = 0;
+
+    while ((i & 1) == 0) {
+        i >>= 1;
+        n++;
+    }
+    return n;
+}
+
+/* out = a ^ b，按64位字处理 */
+static void sm4_ocb_xor(uint8_t *out, const uint8_t *a, const uint8_t *b, size_t len) {
+    size_t i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        x ^= y;
+        memcpy(out + i, &x, 8);
+    }
+    for (; i < len; i++) {
+        out[i] = a[i] ^ b[i];
+    }
+}
+
+/* sum ^= 连续n块 */
+static void sm4_ocb_fold(uint8_t *sum, const uint8_t *blocks, size_t n) {
+    size_t j;
+
+    for (j = 0; j < n; j++) {
+        sm4_ocb_xor(sum, sum, blocks + j * SM4_BLOCK_SIZE, SM4_BLOCK_SIZE);
+    }
+}
+
+/* 白化n块：buf = in ^ offsets，同时sum ^= in（加密时的校验和与白化合成一遍） */
+static void sm4_ocb_whiten_fold(uint8_t *buf, const uint8_t *in, const uint8_t *offsets, uint8_t *sum, size_t n) {
+    uint64_t s0, s1, x0, x1, o0, o1;
+    size_t j;
+
+    memcpy(&s0, sum, 8);
+    memcpy(&s1, sum + 8, 8);
+    for (j = 0; j < n * SM4_BLOCK_SIZE; j += SM4_BLOCK_SIZE) {
+        memcpy(&x0, in + j, 8);
+        memcpy(&x1, in + j + 8, 8);
+        memcpy(&o0, offsets + j, 8);
+        memcpy(&o1, offsets + j + 8, 8);
+        s0 ^= x0;
+        s1 ^= x1;
+        x0 ^= o0;
+        x1 ^= o1;
+        memcpy(buf + j, &x0, 8);
+        memcpy(buf + j + 8, &x1, 8);
+    }
+    memcpy(sum, &s0, 8);
+    memcpy(sum + 8, &s1, 8);
+}
+
+/* 去白化n块：out = buf ^ offsets，同时sum ^= out（解密时的校验和） */
+static void sm4_ocb_unwhiten_fold(uint8_t *out, const uint8_t *buf, const uint8_t *offsets, uint8_t *sum, size_t n) {
+    uint64_t s0, s1, x0, x1, o0, o1;
+    size_t j;
+
+    memcpy(&s0, sum, 8);
+    memcpy(&s1, sum + 8, 8);
+    for (j = 0; j < n * SM4_BLOCK_SIZE; j += SM4_BLOCK_SIZE) {
+        memcpy(&x0, buf + j, 8);
+        memcpy(&x1, buf + j + 8, 8);
+        memcpy(&o0, offsets + j, 8);
+        memcpy(&o1, offsets + j + 8, 8);
+        x0 ^= o0;
+        x1 ^= o1;
+        s0 ^= x0;
+        s1 ^= x1;
+        memcpy(out + j, &x0, 8);
+        memcpy(out + j + 8, &x1, 8);
+    }
+    memcpy(sum, &s0, 8);
+    memcpy(sum + 8, &s1, 8);
+}
+
+/*
+ * 生成一批n块的偏移量，第一块的序号为index（index - 1是SM4_OCB_BATCH_BLOCKS的倍数）。
+ * offset进入时是上一块的偏移量，返回时是这批最后一块的偏移量。
+ */
+static void sm4_ocb_offsets(const SM4_OCB_Context *ctx, uint8_t *offset, uint64_t index,
+                            uint8_t *offsets, size_t n) {
+    size_t j;
+
+    for (j = 0; j < n && j < SM4_OCB_BATCH_BLOCKS - 1; j++) {
+        sm4_ocb_xor(offsets + j * SM4_BLOCK_SIZE, offset, ctx->batch[j], SM4_BLOCK_SIZE);
+    }
+    if (n == SM4_OCB_BATCH_BLOCKS) {
+        sm4_ocb_xor(offsets + j * SM4_BLOCK_SIZE, offsets + (j - 1) * SM4_BLOCK_SIZE,
+                    ctx->l[sm4_ocb_ntz(index + j)], SM4_BLOCK_SIZE);
+    }
+    memcpy(offset, offsets + (n - 1) * SM4_BLOCK_SIZE, SM4_BLOCK_SIZE);
+}
+
+/* HASH(K, A)：与加密相同的偏移量序列（从0开始），各块加密结果异或 */
+static void sm4_ocb_hash(const SM4_OCB_Context *ctx, const uint8_t *aad, size_t aad_len, uint8_t *sum) {
+    uint8_t offsets[SM4_OCB_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t buf[SM4_OCB_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t offset[SM4_BLOCK_SIZE] = {0};
+    uint64_t index = 1;
+    size_t blocks = aad_len / SM4_BLOCK_SIZE;
+    size_t n, rem;
+
+    memset(sum, 0, SM4_BLOCK_SIZE);
+
+    while (blocks > 0) {
+        n = blocks < SM4_OCB_BATCH_BLOCKS ? blocks : SM4_OCB_BATCH_BLOCKS;
+        sm4_ocb_offsets(ctx, offset, index, offsets, n);
+        sm4_ocb_xor(buf, aad, offsets, n * SM4_BLOCK_SIZE);
+        sm4_encrypt_blocks(&ctx->enc_ctx, buf, buf, n);
+        sm4_ocb_fold(sum, buf, n);
+        aad += n * SM4_BLOCK_SIZE;
+        index += n;
+        blocks -= n;
+    }
+
+    rem = aad_len % SM4_BLOCK_SIZE;
+    if (rem > 0) {
+        sm4_ocb_xor(offset, offset, ctx->l_star, SM4_BLOCK_SIZE);
+        memset(buf, 0, SM4_BLOCK_SIZE);
+        memcpy(buf, aad, rem);
+        buf[rem] = 0x80;
+        sm4_ocb_xor(buf, buf, offset, SM4_BLOCK_SIZE);
+        sm4_encrypt_block(&ctx->enc_ctx, buf, buf);
+        sm4_ocb_xor(sum, sum, buf, SM4_BLOCK_SIZE);
+    }
+}
+
+/* 由随机数和标签长度求Offset_0：Ktop = E(随机数块，低6位清零)，从Stretch中取第bottom位起的128位 */
+static void sm4_ocb_initial_offset(const SM4_OCB_Context *ctx, const uint8_t *nonce, size_t nonce_len,
+                                   size_t tag_len, uint8_t *offset) {
+    uint8_t block[SM4_BLOCK_SIZE] = {0};
+    uint8_t stretch[SM4_BLOCK_SIZE + 8 + 1];
+    unsigned int bottom, shift;
+    size_t i;
+
+    block[0] = (uint8_t)((tag_len * 8 % 128) << 1);
+    block[SM4_BLOCK_SIZE - 1 - nonce_len] |= 1;
+    memcpy(block + SM4_BLOCK_SIZE - nonce_len, nonce, nonce_len);
+    bottom = block[SM4_BLOCK_SIZE - 1] & 0x3F;
+    block[SM4_BLOCK_SIZE - 1] &= 0xC0;
+
+    sm4_encrypt_block(&ctx->enc_ctx, stretch, block);
+    for (i = 0; i < 8; i++) {
+        stretch[SM4_BLOCK_SIZE + i] = stretch[i] ^ stretch[i + 1];
+    }
+    stretch[SM4_BLOCK_SIZE + 8] = 0;
+
+    shift = bottom % 8;
+    for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+        offset[i] = (uint8_t)(stretch[i + bottom / 8] << shift | stretch[i + bottom / 8 + 1] >> (8 - shift));
+    }
+    memset(stretch, 0, sizeof(stretch));
+}
+
+/*
+ * 加密或解密并计算完整的16字节标签。
+ * 加密时校验和取自输入（原地加密时在写出之前），解密时取自输出。
+ */
+static int sm4_ocb_crypt(const SM4_OCB_Context *ctx, const uint8_t *nonce, size_t nonce_len,
+                         const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                         uint8_t *out, uint8_t *full_tag, size_t tag_len, int encrypt) {
+    uint8_t offsets[SM4_OCB_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t buf[SM4_OCB_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t offset[SM4_BLOCK_SIZE];
+    uint8_t checksum[SM4_BLOCK_SIZE] = {0};
+    uint8_t hash[SM4_BLOCK_SIZE];
+    uint64_t index = 1;
+    size_t blocks = len / SM4_BLOCK_SIZE;
+    size_t n, rem;
+
+    if (nonce_len == 0 || nonce_len >= SM4_BLOCK_SIZE || tag_len == 0 || tag_len > SM4_BLOCK_SIZE ||
+        (uint64_t)blocks > SM4_OCB_MAX_BLOCKS || (uint64_t)(aad_len / SM4_BLOCK_SIZE) > SM4_OCB_MAX_BLOCKS) {
+        return -1;
+    }
+
+    sm4_ocb_initial_offset(ctx, nonce, nonce_len, tag_len, offset);
+
+    while (blocks > 0) {
+        n = blocks < SM4_OCB_BATCH_BLOCKS ? blocks : SM4_OCB_BATCH_BLOCKS;
+        sm4_ocb_offsets(ctx, offset, index, offsets, n);
+        if (encrypt) {
+            sm4_ocb_whiten_fold(buf, in, offsets, checksum, n);
+            sm4_encrypt_blocks(&ctx->enc_ctx, buf, buf, n);
+            sm4_ocb_xor(out, buf, offsets, n * SM4_BLOCK_SIZE);
+        } else {
+            sm4_ocb_xor(buf, in, offsets, n * SM4_BLOCK_SIZE);
+            sm4_decrypt_blocks(&ctx->dec_ctx, buf, buf, n);
+            sm4_ocb_unwhiten_fold(out, buf, offsets, checksum, n);
+        }
+        in += n * SM4_BLOCK_SIZE;
+        out += n * SM4_BLOCK_SIZE;
+        index += n;
+        blocks -= n;
+    }
+
+    /* 最后的部分块：与E(Offset_*)异或，校验和加入补10*后的明文 */
+    rem = len % SM4_BLOCK_SIZE;
+    if (rem > 0) {
+        sm4_ocb_xor(offset, offset, ctx->l_star, SM4_BLOCK_SIZE);
+        sm4_encrypt_block(&ctx->enc_ctx, buf, offset);
+        memset(buf + SM4_BLOCK_SIZE, 0, SM4_BLOCK_SIZE);
+        if (encrypt) {
+            memcpy(buf + SM4_BLOCK_SIZE, in, rem);
+            sm4_ocb_xor(out, in, buf, rem);
+        } else {
+            sm4_ocb_xor(out, in, buf, rem);
+            memcpy(buf + SM4_BLOCK_SIZE, out, rem);
+        }
+        buf[SM4_BLOCK_SIZE + rem] = 0x80;
+        sm4_ocb_xor(checksum, checksum, buf + SM4_BLOCK_SIZE, SM4_BLOCK_SIZE);
+    }
+
+    /* 标签 = E(校验和 ^ Offset ^ L_$) ^ HASH(A) */
+    sm4_ocb_xor(checksum, checksum, offset, SM4_BLOCK_SIZE);
+    sm4_ocb_xor(checksum, checksum, ctx->l_dollar, SM4_BLOCK_SIZE);
+    sm4_encrypt_block(&ctx->enc_ctx, full_tag, checksum);
+    sm4_ocb_hash(ctx, aad, aad_len, hash);
+    sm4_ocb_xor(full_tag, full_tag, hash, SM4_BLOCK_SIZE);
+
+    memset(buf, 0, sizeof(buf));
+    memset(checksum, 0, sizeof(checksum));
+    return 0;
+}
+
+/* 设置OCB密钥并预计算偏移量表 */
+int sm4_ocb_init(SM4_OCB_Context *ctx, const uint8_t *key) {
+    uint8_t zero[SM4_BLOCK_SIZE] = {0};
+    size_t i;
+
+    sm4_set_encrypt_key(&ctx->enc_ctx, key);
+    sm4_set_decrypt_key(&ctx->dec_ctx, key);
+
+    sm4_encrypt_block(&ctx->enc_ctx, ctx->l_star, zero);
+    sm4_ocb_double(ctx->l_dollar, ctx->l_star);
+    sm4_ocb_double(ctx->l[0], ctx->l_dollar);
+    for (i = 1; i < SM4_OCB_L_COUNT; i++) {
+        sm4_ocb_double(ctx->l[i], ctx->l[i - 1]);
+    }
+
+    /* batch[j] = L_{ntz(1)} ^ ... ^ L_{ntz(j+1)} */
+    memcpy(ctx->batch[0], ctx->l[0], SM4_BLOCK_SIZE);
+    for (i = 1; i < SM4_OCB_BATCH_BLOCKS - 1; i++) {
+        sm4_ocb_xor(ctx->batch[i], ctx->batch[i - 1], ctx->l[sm4_ocb_ntz(i + 1)], SM4_BLOCK_SIZE);
+    }
+    return 0;
+}
+
+/* OCB加密 */
+int sm4_ocb_encrypt(const SM4_OCB_Context *ctx, const uint8_t *nonce, size_t nonce_len,
+                    const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                    uint8_t *out, uint8_t *tag, size_t tag_len) {
+    uint8_t full_tag[SM4_BLOCK_SIZE];
+
+    if (sm4_ocb_crypt(ctx, nonce, nonce_len, aad, aad_len, in, len, out, full_tag, tag_len, 1) != 0) {
+        return -1;
+    }
+    memcpy(tag, full_tag, tag_len);
+    return 0;
+}
+
+/* OCB解密并验证，标签按字节累积差异比较 */
+int sm4_ocb_decrypt(const SM4_OCB_Context *ctx, const uint8_t *nonce, size_t nonce_len,
+                    const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                    const uint8_t *tag, size_t tag_len, uint8_t *out) {
+    uint8_t full_tag[SM4_BLOCK_SIZE];
+    uint8_t diff = 0;
+    size_t i;
+
+    if (sm4_ocb_crypt(ctx, nonce, nonce_len, aad, aad_len, in, len, out, full_tag, tag_len, 0) != 0) {
+        return -1;
+    }
+    for (i = 0; i < tag_len; i++) {
+        diff |= full_tag[i] ^ tag[i];
+    }
+    if (diff != 0) {
+        memset(out, 0, len);
+        return -1;
+    }
+    return 0;
+}
+
+/* 一步完成OCB加密 */
+int sm4_ocb_encrypt_and_tag(const uint8_t *key, const uint8_t *nonce, size_t nonce_len,
+                            const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                            uint8_t *out, uint8_t *tag, size_t tag_len) {
+    SM4_OCB_Context ctx;
+    int ret;
+
+    sm4_ocb_init(&ctx, key);
+    ret = sm4_ocb_encrypt(&ctx, nonce, nonce_len, aad, aad_len, in, len, out, tag, tag_len);
+    memset(&ctx, 0, sizeof(ctx));
+    return ret;
+}
+
+/* 一步完成OCB解密和验证 */
+int sm4_ocb_decrypt_and_verify(const uint8_t *key, const uint8_t *nonce, size_t nonce_len,
+                               const uint8_t *aad, size_t aad_len, const uint8_t *in, size_t len,
+                               const uint8_t *tag, size_t tag_len, uint8_t *out) {
+    SM4_OCB_Context ctx;
+    int ret;
+
+    sm4_ocb_init(&ctx, key);
+    ret = sm4_ocb_decrypt(&ctx, nonce, nonce_len, aad, aad_len, in, len, tag, tag_len, out);
+    memset(&ctx, 0, sizeof(ctx));
+    return ret;
+}
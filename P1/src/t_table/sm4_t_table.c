@@ -1,29 +1,9 @@
-#include "sm4.h"
+#include "sm4_internal.h"
 #include <string.h>
 
-/* SM4 S盒 */
-static const uint8_t SM4_SBOX[256] = {
-    0xd6, 0x90, 0xe9, 0xfe, 0xcc, 0xe1, 0x3d, 0xb7, 0x16, 0xb6, 0x14, 0xc2, 0x28, 0xfb, 0x2c, 0x05,
-    0x2b, 0x67, 0x9a, 0x76, 0x2a, 0xbe, 0x04, 0xc3, 0xaa, 0x44, 0x13, 0x26, 0x49, 0x86, 0x06, 0x99,
-    0x9c, 0x42, 0x50, 0xf4, 0x91, 0xef, 0x98, 0x7a, 0x33, 0x54, 0x0b, 0x43, 0xed, 0xcf, 0xac, 0x62,
-    0xe4, 0xb3, 0x1c, 0xa9, 0xc9, 0x08, 0xe8, 0x95, 0x80, 0xdf, 0x94, 0xfa, 0x75, 0x8f, 0x3f, 0xa6,
-    0x47, 0x07, 0xa7, 0xfc, 0xf3, 0x73, 0x17, 0xba, 0x83, 0x59, 0x3c, 0x19, 0xe6, 0x85, 0x4f, 0xa8,
-    0x68, 0x6b, 0x81, 0xb2, 0x71, 0x64, 0xda, 0x8b, 0xf8, 0xeb, 0x0f, 0x4b, 0x70, 0x56, 0x9d, 0x35,
-    0x1e, 0x24, 0x0e, 0x5e, 0x63, 0x58, 0xd1, 0xa2, 0x25, 0x22, 0x7c, 0x3b, 0x01, 0x21, 0x78, 0x87,
-    0xd4, 0x00, 0x46, 0x57, 0x9f, 0xd3, 0x27, 0x52, 0x4c, 0x36, 0x02, 0xe7, 0xa0, 0xc4, 0xc8, 0x9e,
-    0xea, 0xbf, 0x8a, 0xd2, 0x40, 0xc7, 0x38, 0xb5, 0xa3, 0xf7, 0xf2, 0xce, 0xf9, 0x61, 0x15, 0xa1,
-    0xe0, 0xae, 0x5d, 0xa4, 0x9b, 0x34, 0x1a, 0x55, 0xad, 0x93, 0x32, 0x30, 0xf5, 0x8c, 0xb1, 0xe3,
-    0x1d, 0xf6, 0xe2, 0x2e, 0x82, 0x66, 0xca, 0x60, 0xc0, 0x29, 0x23, 0xab, 0x0d, 0x53, 0x4e, 0x6f,
-    0xd5, 0xdb, 0x37, 0x45, 0xde, 0xfd, 0x8e, 0x2f, 0x03, 0xff, 0x6a, 0x72, 0x6d, 0x6c, 0x5b, 0x51,
-    0x8d, 0x1b, 0xaf, 0x92, 0xbb, 0xdd, 0xbc, 0x7f, 0x11, 0xd9, 0x5c, 0x41, 0x1f, 0x10, 0x5a, 0xd8,
-    0x0a, 0xc1, 0x31, 0x88, 0xa5, 0xcd, 0x7b, 0xbd, 0x2d, 0x74, 0xd0, 0x12, 0xb8, 0xe5, 0xb4, 0xb0,
-    0x89, 0x69, 0x97, 0x4a, 0x0c, 0x96, 0x77, 0x7e, 0x65, 0xb9, 0xf1, 0x09, 0xc5, 0x6e, 0xc6, 0x84,
-    0x18, 0xf0, 0x7d, 0xec, 0x3a, 0xdc, 0x4d, 0x20, 0x79, 0xee, 0x5f, 0x3e, 0xd7, 0xcb, 0x39, 0x48
-};
-
 /* 系统参数 */
 static const uint32_t SYSTEM_PARAMETER[4] = {
-    0x00070e15, 0x1c232a31, 0x383f464d, 0x545b6269
+    0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc
 };
 
 /* 固定参数 */
@@ -38,10 +18,82 @@ static const uint32_t FIXED_PARAMETER[32] = {
     0x10171e25, 0x2c333a41, 0x484f565d, 0x646b7279
 };
 
-/* T表 - 预计算S盒和线性变换的组合 */
-static uint32_t T_TABLE[256];
-static uint32_t T_PRIME_TABLE[256];
-static int T_TABLE_INITIALIZED = 0;
+/*
+ * T表 - 预计算S盒和线性变换的组合，编译期常量，放在只读段中。
+ * T_TABLE[i] = L(SBOX[i] << 24)，T_PRIME_TABLE[i] = L'(SBOX[i] << 24)，
+ * SBOX为标准S盒（与基本实现相同），L(a) = a ^ (a <<< 2) ^ (a <<< 10) ^ (a <<< 18) ^ (a <<< 24)，
+ * L'(a) = a ^ (a <<< 13) ^ (a <<< 23)。
+ * 没有运行时初始化，多个线程可以同时使用同一个SM4_Context。
+ */
+static const uint32_t T_TABLE[256] = {
+    0x8ed55b5b, 0xd0924242, 0x4deaa7a7, 0x06fdfbfb, 0xfccf3333, 0x65e28787, 0xc93df4f4, 0x6bb5dede,
+    0x4e165858, 0x6eb4dada, 0x44145050, 0xcac10b0b, 0x8828a0a0, 0x17f8efef, 0x9c2cb0b0, 0x11051414,
+    0x872bacac, 0xfb669d9d, 0xf2986a6a, 0xae77d9d9, 0x822aa8a8, 0x46bcfafa, 0x14041010, 0xcfc00f0f,
+    0x02a8aaaa, 0x54451111, 0x5f134c4c, 0xbe269898, 0x6d482525, 0x9e841a1a, 0x1e061818, 0xfd9b6666,
+    0xec9e7272, 0x4a430909, 0x10514141, 0x24f7d3d3, 0xd5934646, 0x53ecbfbf, 0xf89a6262, 0x927be9e9,
+    0xff33cccc, 0x04555151, 0x270b2c2c, 0x4f420d0d, 0x59eeb7b7, 0xf3cc3f3f, 0x1caeb2b2, 0xea638989,
+    0x74e79393, 0x7fb1cece, 0x6c1c7070, 0x0daba6a6, 0xedca2727, 0x28082020, 0x48eba3a3, 0xc1975656,
+    0x80820202, 0xa3dc7f7f, 0xc4965252, 0x12f9ebeb, 0xa174d5d5, 0xb38d3e3e, 0xc33ffcfc, 0x3ea49a9a,
+    0x5b461d1d, 0x1b071c1c, 0x3ba59e9e, 0x0cfff3f3, 0x3ff0cfcf, 0xbf72cdcd, 0x4b175c5c, 0x52b8eaea,
+    0x8f810e0e, 0x3d586565, 0xcc3cf0f0, 0x7d196464, 0x7ee59b9b, 0x91871616, 0x734e3d3d, 0x08aaa2a2,
+    0xc869a1a1, 0xc76aadad, 0x85830606, 0x7ab0caca, 0xb570c5c5, 0xf4659191, 0xb2d96b6b, 0xa7892e2e,
+    0x18fbe3e3, 0x47e8afaf, 0x330f3c3c, 0x674a2d2d, 0xb071c1c1, 0x0e575959, 0xe99f7676, 0xe135d4d4,
+    0x661e7878, 0xb4249090, 0x360e3838, 0x265f7979, 0xef628d8d, 0x38596161, 0x95d24747, 0x2aa08a8a,
+    0xb1259494, 0xaa228888, 0x8c7df1f1, 0xd73becec, 0x05010404, 0xa5218484, 0x9879e1e1, 0x9b851e1e,
+    0x84d75353, 0x00000000, 0x5e471919, 0x0b565d5d, 0xe39d7e7e, 0x9fd04f4f, 0xbb279c9c, 0x1a534949,
+    0x7c4d3131, 0xee36d8d8, 0x0a020808, 0x7be49f9f, 0x20a28282, 0xd4c71313, 0xe8cb2323, 0xe69c7a7a,
+    0x42e9abab, 0x43bdfefe, 0xa2882a2a, 0x9ad14b4b, 0x40410101, 0xdbc41f1f, 0xd838e0e0, 0x61b7d6d6,
+    0x2fa18e8e, 0x2bf4dfdf, 0x3af1cbcb, 0xf6cd3b3b, 0x1dfae7e7, 0xe5608585, 0x41155454, 0x25a38686,
+    0x60e38383, 0x16acbaba, 0x295c7575, 0x34a69292, 0xf7996e6e, 0xe434d0d0, 0x721a6868, 0x01545555,
+    0x19afb6b6, 0xdf914e4e, 0xfa32c8c8, 0xf030c0c0, 0x21f6d7d7, 0xbc8e3232, 0x75b3c6c6, 0x6fe08f8f,
+    0x691d7474, 0x2ef5dbdb, 0x6ae18b8b, 0x962eb8b8, 0x8a800a0a, 0xfe679999, 0xe2c92b2b, 0xe0618181,
+    0xc0c30303, 0x8d29a4a4, 0xaf238c8c, 0x07a9aeae, 0x390d3434, 0x1f524d4d, 0x764f3939, 0xd36ebdbd,
+    0x81d65757, 0xb7d86f6f, 0xeb37dcdc, 0x51441515, 0xa6dd7b7b, 0x09fef7f7, 0xb68c3a3a, 0x932fbcbc,
+    0x0f030c0c, 0x03fcffff, 0xc26ba9a9, 0xba73c9c9, 0xd96cb5b5, 0xdc6db1b1, 0x375a6d6d, 0x15504545,
+    0xb98f3636, 0x771b6c6c, 0x13adbebe, 0xda904a4a, 0x57b9eeee, 0xa9de7777, 0x4cbef2f2, 0x837efdfd,
+    0x55114444, 0xbdda6767, 0x2c5d7171, 0x45400505, 0x631f7c7c, 0x50104040, 0x325b6969, 0xb8db6363,
+    0x220a2828, 0xc5c20707, 0xf531c4c4, 0xa88a2222, 0x31a79696, 0xf9ce3737, 0x977aeded, 0x49bff6f6,
+    0x992db4b4, 0xa475d1d1, 0x90d34343, 0x5a124848, 0x58bae2e2, 0x71e69797, 0x64b6d2d2, 0x70b2c2c2,
+    0xad8b2626, 0xcd68a5a5, 0xcb955e5e, 0x624b2929, 0x3c0c3030, 0xce945a5a, 0xab76dddd, 0x867ff9f9,
+    0xf1649595, 0x5dbbe6e6, 0x35f2c7c7, 0x2d092424, 0xd1c61717, 0xd66fb9b9, 0xdec51b1b, 0x94861212,
+    0x78186060, 0x30f3c3c3, 0x897cf5f5, 0x5cefb3b3, 0xd23ae8e8, 0xacdf7373, 0x794c3535, 0xa0208080,
+    0x9d78e5e5, 0x56edbbbb, 0x235e7d7d, 0xc63ef8f8, 0x8bd45f5f, 0xe7c82f2f, 0xdd39e4e4, 0x68492121
+};
+
+static const uint32_t T_PRIME_TABLE[256] = {
+    0xd66b1ac0, 0x90481200, 0xe9749d20, 0xfe7f1fc0, 0xcc661980, 0xe1709c20, 0x3d1e87a0, 0xb75b96e0,
+    0x160b02c0, 0xb65b16c0, 0x140a0280, 0xc2611840, 0x28140500, 0xfb7d9f60, 0x2c160580, 0x050280a0,
+    0x2b158560, 0x67338ce0, 0x9a4d1340, 0x763b0ec0, 0x2a150540, 0xbe5f17c0, 0x04020080, 0xc3619860,
+    0xaa551540, 0x44220880, 0x13098260, 0x261304c0, 0x49248920, 0x864310c0, 0x060300c0, 0x994c9320,
+    0x9c4e1380, 0x42210840, 0x50280a00, 0xf47a1e80, 0x91489220, 0xef779de0, 0x984c1300, 0x7a3d0f40,
+    0x33198660, 0x542a0a80, 0x0b058160, 0x43218860, 0xed769da0, 0xcf6799e0, 0xac561580, 0x62310c40,
+    0xe4721c80, 0xb3599660, 0x1c0e0380, 0xa9549520, 0xc9649920, 0x08040100, 0xe8741d00, 0x954a92a0,
+    0x80401000, 0xdf6f9be0, 0x944a1280, 0xfa7d1f40, 0x753a8ea0, 0x8f4791e0, 0x3f1f87e0, 0xa65314c0,
+    0x472388e0, 0x070380e0, 0xa75394e0, 0xfc7e1f80, 0xf3799e60, 0x73398e60, 0x170b82e0, 0xba5d1740,
+    0x83419060, 0x592c8b20, 0x3c1e0780, 0x190c8320, 0xe6731cc0, 0x854290a0, 0x4f2789e0, 0xa8541500,
+    0x68340d00, 0x6b358d60, 0x81409020, 0xb2591640, 0x71388e20, 0x64320c80, 0xda6d1b40, 0x8b459160,
+    0xf87c1f00, 0xeb759d60, 0x0f0781e0, 0x4b258960, 0x70380e00, 0x562b0ac0, 0x9d4e93a0, 0x351a86a0,
+    0x1e0f03c0, 0x24120480, 0x0e0701c0, 0x5e2f0bc0, 0x63318c60, 0x582c0b00, 0xd1689a20, 0xa2511440,
+    0x251284a0, 0x22110440, 0x7c3e0f80, 0x3b1d8760, 0x01008020, 0x21108420, 0x783c0f00, 0x874390e0,
+    0xd46a1a80, 0x00000000, 0x462308c0, 0x572b8ae0, 0x9f4f93e0, 0xd3699a60, 0x271384e0, 0x52290a40,
+    0x4c260980, 0x361b06c0, 0x02010040, 0xe7739ce0, 0xa0501400, 0xc4621880, 0xc8641900, 0x9e4f13c0,
+    0xea751d40, 0xbf5f97e0, 0x8a451140, 0xd2691a40, 0x40200800, 0xc76398e0, 0x381c0700, 0xb55a96a0,
+    0xa3519460, 0xf77b9ee0, 0xf2791e40, 0xce6719c0, 0xf97c9f20, 0x61308c20, 0x150a82a0, 0xa1509420,
+    0xe0701c00, 0xae5715c0, 0x5d2e8ba0, 0xa4521480, 0x9b4d9360, 0x341a0680, 0x1a0d0340, 0x552a8aa0,
+    0xad5695a0, 0x93499260, 0x32190640, 0x30180600, 0xf57a9ea0, 0x8c461180, 0xb1589620, 0xe3719c60,
+    0x1d0e83a0, 0xf67b1ec0, 0xe2711c40, 0x2e1705c0, 0x82411040, 0x66330cc0, 0xca651940, 0x60300c00,
+    0xc0601800, 0x29148520, 0x23118460, 0xab559560, 0x0d0681a0, 0x53298a60, 0x4e2709c0, 0x6f378de0,
+    0xd56a9aa0, 0xdb6d9b60, 0x371b86e0, 0x452288a0, 0xde6f1bc0, 0xfd7e9fa0, 0x8e4711c0, 0x2f1785e0,
+    0x03018060, 0xff7f9fe0, 0x6a350d40, 0x72390e40, 0x6d368da0, 0x6c360d80, 0x5b2d8b60, 0x51288a20,
+    0x8d4691a0, 0x1b0d8360, 0xaf5795e0, 0x92491240, 0xbb5d9760, 0xdd6e9ba0, 0xbc5e1780, 0x7f3f8fe0,
+    0x11088220, 0xd96c9b20, 0x5c2e0b80, 0x41208820, 0x1f0f83e0, 0x10080200, 0x5a2d0b40, 0xd86c1b00,
+    0x0a050140, 0xc1609820, 0x31188620, 0x88441100, 0xa55294a0, 0xcd6699a0, 0x7b3d8f60, 0xbd5e97a0,
+    0x2d1685a0, 0x743a0e80, 0xd0681a00, 0x12090240, 0xb85c1700, 0xe5729ca0, 0xb45a1680, 0xb0581600,
+    0x89449120, 0x69348d20, 0x974b92e0, 0x4a250940, 0x0c060180, 0x964b12c0, 0x773b8ee0, 0x7e3f0fc0,
+    0x65328ca0, 0xb95c9720, 0xf1789e20, 0x09048120, 0xc56298a0, 0x6e370dc0, 0xc66318c0, 0x84421080,
+    0x180c0300, 0xf0781e00, 0x7d3e8fa0, 0xec761d80, 0x3a1d0740, 0xdc6e1b80, 0x4d2689a0, 0x20100400,
+    0x793c8f20, 0xee771dc0, 0x5f2f8be0, 0x3e1f07c0, 0xd76b9ae0, 0xcb659960, 0x391c8720, 0x48240900
+};
 
 /* 循环左移 */
 static inline uint32_t rotl32(uint32_t x, int n) {
@@ -61,34 +113,6 @@ static inline void store_u32_be(uint32_t v, uint8_t *b) {
     b[3] = (uint8_t)v;
 }
 
-/* 线性变换L */
-static uint32_t sm4_l_transform(uint32_t a) {
-    return a ^ rotl32(a, 2) ^ rotl32(a, 10) ^ rotl32(a, 18) ^ rotl32(a, 24);
-}
-
-/* 线性变换L' */
-static uint32_t sm4_l_prime_transform(uint32_t a) {
-    return a ^ rotl32(a, 13) ^ rotl32(a, 23);
-}
-
-/* 初始化T表 */
-static void init_t_tables(void) {
-    int i;
-    uint32_t t;
-    
-    if (T_TABLE_INITIALIZED) {
-        return;
-    }
-    
-    for (i = 0; i < 256; i++) {
-        t = (uint32_t)SM4_SBOX[i] << 24;
-        T_TABLE[i] = sm4_l_transform(t);
-        T_PRIME_TABLE[i] = sm4_l_prime_transform(t);
-    }
-    
-    T_TABLE_INITIALIZED = 1;
-}
-
 /* 使用T表的合成变换T */
 static uint32_t sm4_t_transform_table(uint32_t a) {
     uint8_t a0 = (uint8_t)(a >> 24);
@@ -97,9 +121,9 @@ static uint32_t sm4_t_transform_table(uint32_t a) {
     uint8_t a3 = (uint8_t)a;
     
     return T_TABLE[a0] ^ 
-           rotl32(T_TABLE[a1], 8) ^ 
+           rotl32(T_TABLE[a1], 24) ^ 
            rotl32(T_TABLE[a2], 16) ^ 
-           rotl32(T_TABLE[a3], 24);
+           rotl32(T_TABLE[a3], 8);
 }
 
 /* 使用T表的合成变换T' */
@@ -110,9 +134,9 @@ static uint32_t sm4_t_prime_transform_table(uint32_t a) {
     uint8_t a3 = (uint8_t)a;
     
     return T_PRIME_TABLE[a0] ^ 
-           rotl32(T_PRIME_TABLE[a1], 8) ^ 
+           rotl32(T_PRIME_TABLE[a1], 24) ^ 
            rotl32(T_PRIME_TABLE[a2], 16) ^ 
-           rotl32(T_PRIME_TABLE[a3], 24);
+           rotl32(T_PRIME_TABLE[a3], 8);
 }
 
 /* 密钥扩展 */
@@ -121,9 +145,6 @@ static void sm4_set_key(SM4_Context *ctx, const uint8_t *key, int is_encrypt) {
     uint32_t K[36]; // 中间密钥
     int i;
     
-    /* 确保T表已初始化 */
-    init_t_tables();
-    
     /* 将密钥转换为字 */
     MK[0] = load_u32_be(key);
     MK[1] = load_u32_be(key + 4);
@@ -153,23 +174,20 @@ static void sm4_set_key(SM4_Context *ctx, const uint8_t *key, int is_encrypt) {
     }
 }
 
-void sm4_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
+static void sm4_t_table_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
     sm4_set_key(ctx, key, 1);
 }
 
-void sm4_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
+static void sm4_t_table_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
     sm4_set_key(ctx, key, 0);
 }
 
-/* 加密/解密单个块 */
-void sm4_encrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+/* 加密/解密单个块（解密与加密相同，只是轮密钥顺序相反） */
+static void sm4_t_table_crypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
     uint32_t X[4];
     uint32_t temp;
     int i;
     
-    /* 确保T表已初始化 */
-    init_t_tables();
-    
     /* 将输入块转换为字 */
     X[0] = load_u32_be(in);
     X[1] = load_u32_be(in + 4);
@@ -197,101 +215,29 @@ void sm4_encrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in)
     store_u32_be(X[0], out + 12);
 }
 
-/* 解密单个块（与加密相同，只是轮密钥顺序相反） */
-void sm4_decrypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
-    sm4_encrypt_block(ctx, out, in);
-}
-
-/* 加密多个块（ECB模式） */
-void sm4_encrypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
-    size_t i;
-    for (i = 0; i < blocks; i++) {
-        sm4_encrypt_block(ctx, out, in);
-        in += SM4_BLOCK_SIZE;
-        out += SM4_BLOCK_SIZE;
-    }
-}
-
-/* 解密多个块（ECB模式） */
-void sm4_decrypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+/* 加密/解密多个块 */
+static void sm4_t_table_crypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
     size_t i;
     for (i = 0; i < blocks; i++) {
-        sm4_decrypt_block(ctx, out, in);
+        sm4_t_table_crypt_block(ctx, out, in);
         in += SM4_BLOCK_SIZE;
         out += SM4_BLOCK_SIZE;
     }
 }
 
-/* ECB模式加密 */
-int sm4_ecb_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
-    
-    sm4_encrypt_blocks(ctx, out, in, len / SM4_BLOCK_SIZE);
-    return 0;
-}
-
-/* ECB模式解密 */
-int sm4_ecb_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len) {
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
-    
-    sm4_decrypt_blocks(ctx, out, in, len / SM4_BLOCK_SIZE);
-    return 0;
+/* T表实现不依赖任何扩展指令 */
+static int sm4_t_table_is_supported(const SM4_CPU_Features *features) {
+    (void)features;
+    return 1;
 }
 
-/* CBC模式加密 */
-int sm4_cbc_encrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv) {
-    size_t i, j;
-    uint8_t tmp[SM4_BLOCK_SIZE];
-    
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
-    
-    for (i = 0; i < len; i += SM4_BLOCK_SIZE) {
-        /* 明文与IV异或 */
-        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
-            tmp[j] = in[i + j] ^ iv[j];
-        }
-        
-        /* 加密 */
-        sm4_encrypt_block(ctx, out + i, tmp);
-        
-        /* 更新IV */
-        memcpy(iv, out + i, SM4_BLOCK_SIZE);
-    }
-    
-    return 0;
-}
-
-/* CBC模式解密 */
-int sm4_cbc_decrypt(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t len, uint8_t *iv) {
-    size_t i, j;
-    uint8_t tmp[SM4_BLOCK_SIZE];
-    uint8_t next_iv[SM4_BLOCK_SIZE];
-    
-    if (len % SM4_BLOCK_SIZE != 0) {
-        return -1; /* 输入长度必须是块大小的倍数 */
-    }
-    
-    for (i = 0; i < len; i += SM4_BLOCK_SIZE) {
-        /* 保存下一个IV */
-        memcpy(next_iv, in + i, SM4_BLOCK_SIZE);
-        
-        /* 解密 */
-        sm4_decrypt_block(ctx, tmp, in + i);
-        
-        /* 与IV异或 */
-        for (j = 0; j < SM4_BLOCK_SIZE; j++) {
-            out[i + j] = tmp[j] ^ iv[j];
-        }
-        
-        /* 更新IV */
-        memcpy(iv, next_iv, SM4_BLOCK_SIZE);
-    }
-    
-    return 0;
-}
\ No newline at end of file
+const SM4_Implementation sm4_t_table_impl = {
+    "t_table",
+    sm4_t_table_is_supported,
+    sm4_t_table_set_encrypt_key,
+    sm4_t_table_set_decrypt_key,
+    sm4_t_table_crypt_block,
+    sm4_t_table_crypt_blocks,
+    NULL,
+    NULL
+};
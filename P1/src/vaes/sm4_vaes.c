@@ -0,0 +1,65 @@
+#if defined(HAVE_VAES) && HAVE_VAES
+#define SM4_VAES_YMM_KERNEL
+#endif
+
+#include "sm4_vaes_common.h"
+
+static void sm4_vaes_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    sm4_vaes_set_key(ctx, key, 1);
+}
+
+static void sm4_vaes_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    sm4_vaes_set_key(ctx, key, 0);
+}
+
+/* 加密/解密多个块：每次16块（两个ymm交错），剩余的按8块处理 */
+static void sm4_vaes_crypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+#if defined(HAVE_VAES) && HAVE_VAES
+    while (blocks >= 2 * SM4_VAES_YMM_LANES) {
+        sm4_vaes_crypt16(ctx, out, in);
+        in += 2 * SM4_VAES_YMM_LANES * SM4_BLOCK_SIZE;
+        out += 2 * SM4_VAES_YMM_LANES * SM4_BLOCK_SIZE;
+        blocks -= 2 * SM4_VAES_YMM_LANES;
+    }
+    
+    if (blocks >= SM4_VAES_YMM_LANES) {
+        sm4_vaes_crypt8(ctx, out, in);
+        in += SM4_VAES_YMM_LANES * SM4_BLOCK_SIZE;
+        out += SM4_VAES_YMM_LANES * SM4_BLOCK_SIZE;
+        blocks -= SM4_VAES_YMM_LANES;
+    }
+    
+    if (blocks > 0) {
+        sm4_vaes_crypt_tail8(ctx, out, in, blocks);
+    }
+#else
+    /* 未编译VAES支持时本后端不会被选中 */
+    sm4_t_table_impl.crypt_blocks(ctx, out, in, blocks);
+#endif
+}
+
+/* 加密/解密单个块 */
+static void sm4_vaes_crypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    sm4_vaes_crypt_blocks(ctx, out, in, 1);
+}
+
+/* 需要编译期开启VAES且CPU支持VAES和AVX2 */
+static int sm4_vaes_is_supported(const SM4_CPU_Features *features) {
+#if defined(HAVE_VAES) && HAVE_VAES
+    return features->has_vaes && features->has_avx2;
+#else
+    (void)features;
+    return 0;
+#endif
+}
+
+const SM4_Implementation sm4_vaes_impl = {
+    "vaes",
+    sm4_vaes_is_supported,
+    sm4_vaes_set_encrypt_key,
+    sm4_vaes_set_decrypt_key,
+    sm4_vaes_crypt_block,
+    sm4_vaes_crypt_blocks,
+    NULL,
+    NULL
+};
@@ -0,0 +1,204 @@
+#if defined(HAVE_VAES_AVX512) && HAVE_VAES_AVX512
+#define SM4_VAES_YMM_KERNEL
+#endif
+
+#include "sm4_vaes_common.h"
+
+#if defined(HAVE_VAES_AVX512) && HAVE_VAES_AVX512
+
+/* 一个zmm寄存器并行处理的块数 */
+#define SM4_VAES_ZMM_LANES 16
+
+/* 把128位字节表广播到zmm的四个通道 */
+static inline __m512i sm4_vaes_table512(const uint8_t table[16]) {
+    return _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)table));
+}
+
+/* 用半字节查表计算GF(2)上的仿射变换 */
+static inline __m512i sm4_vaes_affine512(__m512i x, __m512i lo_table, __m512i hi_table) {
+    const __m512i mask = _mm512_set1_epi8(0x0f);
+    __m512i lo = _mm512_and_si512(x, mask);
+    __m512i hi = _mm512_and_si512(_mm512_srli_epi32(x, 4), mask);
+    
+    return _mm512_xor_si512(_mm512_shuffle_epi8(lo_table, lo), _mm512_shuffle_epi8(hi_table, hi));
+}
+
+/* 合成变换T：64个字节同时过S盒，再做线性变换L */
+static inline __m512i sm4_vaes_t512(__m512i x) {
+    __m512i y, t, r;
+    
+    x = sm4_vaes_affine512(x, sm4_vaes_table512(SM4_VAES_PRE_LO), sm4_vaes_table512(SM4_VAES_PRE_HI));
+    x = _mm512_aesenclast_epi128(x, _mm512_setzero_si512());
+    x = sm4_vaes_affine512(x, sm4_vaes_table512(SM4_VAES_POST_LO), sm4_vaes_table512(SM4_VAES_POST_HI));
+    
+    y = _mm512_shuffle_epi8(x, sm4_vaes_table512(SM4_VAES_INV_SR));
+    t = _mm512_xor_si512(y, _mm512_shuffle_epi8(x, sm4_vaes_table512(SM4_VAES_ROL8)));
+    t = _mm512_xor_si512(t, _mm512_shuffle_epi8(x, sm4_vaes_table512(SM4_VAES_ROL16)));
+    r = _mm512_xor_si512(y, _mm512_shuffle_epi8(x, sm4_vaes_table512(SM4_VAES_ROL24)));
+    return _mm512_xor_si512(r, _mm512_rol_epi32(t, 2));
+}
+
+/* 每个128位通道内的4x4的32位矩阵转置（自逆） */
+static inline void sm4_vaes_transpose512(__m512i *x0, __m512i *x1, __m512i *x2, __m512i *x3) {
+    __m512i t0 = _mm512_unpacklo_epi32(*x0, *x1);
+    __m512i t1 = _mm512_unpacklo_epi32(*x2, *x3);
+    __m512i t2 = _mm512_unpackhi_epi32(*x0, *x1);
+    __m512i t3 = _mm512_unpackhi_epi32(*x2, *x3);
+    
+    *x0 = _mm512_unpacklo_epi64(t0, t1);
+    *x1 = _mm512_unpackhi_epi64(t0, t1);
+    *x2 = _mm512_unpacklo_epi64(t2, t3);
+    *x3 = _mm512_unpackhi_epi64(t2, t3);
+}
+
+/* 载入16个块并转置，第k个128位通道保存块k、4+k、8+k、12+k（与ymm版本同理） */
+static inline void sm4_vaes_load16(__m512i x[4], const uint8_t *in) {
+    const __m512i bswap = sm4_vaes_table512(SM4_VAES_BSWAP32);
+    int j;
+    
+    for (j = 0; j < 4; j++) {
+        x[j] = _mm512_shuffle_epi8(_mm512_loadu_si512((const void *)(in + j * 4 * SM4_BLOCK_SIZE)), bswap);
+    }
+    sm4_vaes_transpose512(&x[0], &x[1], &x[2], &x[3]);
+}
+
+/* 反序变换后转置回16个块并写出 */
+static inline void sm4_vaes_store16(uint8_t *out, __m512i x[4]) {
+    const __m512i bswap = sm4_vaes_table512(SM4_VAES_BSWAP32);
+    int j;
+    
+    sm4_vaes_transpose512(&x[3], &x[2], &x[1], &x[0]);
+    for (j = 0; j < 4; j++) {
+        _mm512_storeu_si512((void *)(out + j * 4 * SM4_BLOCK_SIZE), _mm512_shuffle_epi8(x[3 - j], bswap));
+    }
+}
+
+/* 一轮：x[a] ^= T(x[b] ^ x[c] ^ x[d] ^ rk) */
+#define SM4_VAES_ROUND512(x, a, b, c, d, rk) \
+    (x)[a] = _mm512_xor_si512((x)[a], sm4_vaes_t512(_mm512_xor_si512(_mm512_ternarylogic_epi32((x)[b], (x)[c], (x)[d], 0x96), (rk))))
+
+/* 16个块并行加密/解密 */
+static void sm4_vaes_crypt16_avx512(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    __m512i x[4];
+    __m512i rk;
+    int i;
+    
+    sm4_vaes_load16(x, in);
+    
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        rk = _mm512_set1_epi32((int)ctx->rk[i]);
+        SM4_VAES_ROUND512(x, 0, 1, 2, 3, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 1]);
+        SM4_VAES_ROUND512(x, 1, 2, 3, 0, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 2]);
+        SM4_VAES_ROUND512(x, 2, 3, 0, 1, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 3]);
+        SM4_VAES_ROUND512(x, 3, 0, 1, 2, rk);
+    }
+    
+    sm4_vaes_store16(out, x);
+}
+
+/* 32个块并行加密/解密：两组16块交错执行 */
+static void sm4_vaes_crypt32_avx512(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    __m512i x[4], y[4];
+    __m512i rk;
+    int i;
+    
+    sm4_vaes_load16(x, in);
+    sm4_vaes_load16(y, in + SM4_VAES_ZMM_LANES * SM4_BLOCK_SIZE);
+    
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        rk = _mm512_set1_epi32((int)ctx->rk[i]);
+        SM4_VAES_ROUND512(x, 0, 1, 2, 3, rk);
+        SM4_VAES_ROUND512(y, 0, 1, 2, 3, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 1]);
+        SM4_VAES_ROUND512(x, 1, 2, 3, 0, rk);
+        SM4_VAES_ROUND512(y, 1, 2, 3, 0, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 2]);
+        SM4_VAES_ROUND512(x, 2, 3, 0, 1, rk);
+        SM4_VAES_ROUND512(y, 2, 3, 0, 1, rk);
+        rk = _mm512_set1_epi32((int)ctx->rk[i + 3]);
+        SM4_VAES_ROUND512(x, 3, 0, 1, 2, rk);
+        SM4_VAES_ROUND512(y, 3, 0, 1, 2, rk);
+    }
+    
+    sm4_vaes_store16(out, x);
+    sm4_vaes_store16(out + SM4_VAES_ZMM_LANES * SM4_BLOCK_SIZE, y);
+}
+
+/* 9~15块的尾部：补齐到16块后处理 */
+static void sm4_vaes_crypt_tail16_avx512(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+    uint8_t buf[SM4_VAES_ZMM_LANES * SM4_BLOCK_SIZE] = {0};
+    
+    memcpy(buf, in, blocks * SM4_BLOCK_SIZE);
+    sm4_vaes_crypt16_avx512(ctx, buf, buf);
+    memcpy(out, buf, blocks * SM4_BLOCK_SIZE);
+}
+
+#endif /* HAVE_VAES_AVX512 */
+
+static void sm4_vaes_avx512_set_encrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    sm4_vaes_set_key(ctx, key, 1);
+}
+
+static void sm4_vaes_avx512_set_decrypt_key(SM4_Context *ctx, const uint8_t *key) {
+    sm4_vaes_set_key(ctx, key, 0);
+}
+
+/* 加密/解密多个块：每次32块（两个zmm交错），尾部按16块或ymm的8块处理 */
+static void sm4_vaes_avx512_crypt_blocks(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+#if defined(HAVE_VAES_AVX512) && HAVE_VAES_AVX512
+    while (blocks >= 2 * SM4_VAES_ZMM_LANES) {
+        sm4_vaes_crypt32_avx512(ctx, out, in);
+        in += 2 * SM4_VAES_ZMM_LANES * SM4_BLOCK_SIZE;
+        out += 2 * SM4_VAES_ZMM_LANES * SM4_BLOCK_SIZE;
+        blocks -= 2 * SM4_VAES_ZMM_LANES;
+    }
+    
+    if (blocks >= SM4_VAES_ZMM_LANES) {
+        sm4_vaes_crypt16_avx512(ctx, out, in);
+        in += SM4_VAES_ZMM_LANES * SM4_BLOCK_SIZE;
+        out += SM4_VAES_ZMM_LANES * SM4_BLOCK_SIZE;
+        blocks -= SM4_VAES_ZMM_LANES;
+    }
+    
+    /* 短尾部（包括单块）用ymm内核，延迟相同但补齐的数据更少 */
+    if (blocks > SM4_VAES_YMM_LANES) {
+        sm4_vaes_crypt_tail16_avx512(ctx, out, in, blocks);
+    } else if (blocks == SM4_VAES_YMM_LANES) {
+        sm4_vaes_crypt8(ctx, out, in);
+    } else if (blocks > 0) {
+        sm4_vaes_crypt_tail8(ctx, out, in, blocks);
+    }
+#else
+    /* 未编译AVX-512 VAES支持时本后端不会被选中 */
+    sm4_t_table_impl.crypt_blocks(ctx, out, in, blocks);
+#endif
+}
+
+/* 加密/解密单个块 */
+static void sm4_vaes_avx512_crypt_block(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    sm4_vaes_avx512_crypt_blocks(ctx, out, in, 1);
+}
+
+/* 需要编译期开启AVX-512 VAES且CPU支持VAES、AVX-512F和AVX-512BW */
+static int sm4_vaes_avx512_is_supported(const SM4_CPU_Features *features) {
+#if defined(HAVE_VAES_AVX512) && HAVE_VAES_AVX512
+    return features->has_vaes && features->has_avx512f && features->has_avx512bw;
+#else
+    (void)features;
+    return 0;
+#endif
+}
+
+const SM4_Implementation sm4_vaes_avx512_impl = {
+    "vaes_avx512",
+    sm4_vaes_avx512_is_supported,
+    sm4_vaes_avx512_set_encrypt_key,
+    sm4_vaes_avx512_set_decrypt_key,
+    sm4_vaes_avx512_crypt_block,
+    sm4_vaes_avx512_crypt_blocks,
+    NULL,
+    NULL
+};
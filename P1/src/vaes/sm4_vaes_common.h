@@ -0,0 +1,273 @@
+#ifndef SM4_VAES_COMMON_H
+#define SM4_VAES_COMMON_H
+
+/*
+ * VAES后端（sm4_vaes.c / sm4_vaes_avx512.c）共用的部分：标量密钥扩展，
+ * 以及256位（ymm）内核。两个源文件用不同的-m选项编译，所以共用代码都是
+ * static inline，各自展开一份。
+ *
+ * 算法与AES-NI后端相同：S_sm4(x) = POST(AESENCLAST(PRE(x), 0))，
+ * PRE/POST用半字节查表计算，ShiftRows合并进线性变换L的字节移位表。
+ * VAES把AESENCLAST扩展到ymm/zmm的每个128位通道，pshufb和unpack也都
+ * 按128位通道独立工作，因此每个通道内就是AES-NI后端的4块转置布局，
+ * 一个ymm处理8块，一个zmm处理16块。
+ */
+
+#include "sm4_internal.h"
+#include <string.h>
+
+#if defined(SM4_VAES_YMM_KERNEL)
+#include <immintrin.h>
+#endif
+
+/* SM4 S盒 */
+static const uint8_t SM4_SBOX[256] = {
+    0xd6, 0x90, 0xe9, 0xfe, 0xcc, 0xe1, 0x3d, 0xb7, 0x16, 0xb6, 0x14, 0xc2, 0x28, 0xfb, 0x2c, 0x05,
+    0x2b, 0x67, 0x9a, 0x76, 0x2a, 0xbe, 0x04, 0xc3, 0xaa, 0x44, 0x13, 0x26, 0x49, 0x86, 0x06, 0x99,
+    0x9c, 0x42, 0x50, 0xf4, 0x91, 0xef, 0x98, 0x7a, 0x33, 0x54, 0x0b, 0x43, 0xed, 0xcf, 0xac, 0x62,
+    0xe4, 0xb3, 0x1c, 0xa9, 0xc9, 0x08, 0xe8, 0x95, 0x80, 0xdf, 0x94, 0xfa, 0x75, 0x8f, 0x3f, 0xa6,
+    0x47, 0x07, 0xa7, 0xfc, 0xf3, 0x73, 0x17, 0xba, 0x83, 0x59, 0x3c, 0x19, 0xe6, 0x85, 0x4f, 0xa8,
+    0x68, 0x6b, 0x81, 0xb2, 0x71, 0x64, 0xda, 0x8b, 0xf8, 0xeb, 0x0f, 0x4b, 0x70, 0x56, 0x9d, 0x35,
+    0x1e, 0x24, 0x0e, 0x5e, 0x63, 0x58, 0xd1, 0xa2, 0x25, 0x22, 0x7c, 0x3b, 0x01, 0x21, 0x78, 0x87,
+    0xd4, 0x00, 0x46, 0x57, 0x9f, 0xd3, 0x27, 0x52, 0x4c, 0x36, 0x02, 0xe7, 0xa0, 0xc4, 0xc8, 0x9e,
+    0xea, 0xbf, 0x8a, 0xd2, 0x40, 0xc7, 0x38, 0xb5, 0xa3, 0xf7, 0xf2, 0xce, 0xf9, 0x61, 0x15, 0xa1,
+    0xe0, 0xae, 0x5d, 0xa4, 0x9b, 0x34, 0x1a, 0x55, 0xad, 0x93, 0x32, 0x30, 0xf5, 0x8c, 0xb1, 0xe3,
+    0x1d, 0xf6, 0xe2, 0x2e, 0x82, 0x66, 0xca, 0x60, 0xc0, 0x29, 0x23, 0xab, 0x0d, 0x53, 0x4e, 0x6f,
+    0xd5, 0xdb, 0x37, 0x45, 0xde, 0xfd, 0x8e, 0x2f, 0x03, 0xff, 0x6a, 0x72, 0x6d, 0x6c, 0x5b, 0x51,
+    0x8d, 0x1b, 0xaf, 0x92, 0xbb, 0xdd, 0xbc, 0x7f, 0x11, 0xd9, 0x5c, 0x41, 0x1f, 0x10, 0x5a, 0xd8,
+    0x0a, 0xc1, 0x31, 0x88, 0xa5, 0xcd, 0x7b, 0xbd, 0x2d, 0x74, 0xd0, 0x12, 0xb8, 0xe5, 0xb4, 0xb0,
+    0x89, 0x69, 0x97, 0x4a, 0x0c, 0x96, 0x77, 0x7e, 0x65, 0xb9, 0xf1, 0x09, 0xc5, 0x6e, 0xc6, 0x84,
+    0x18, 0xf0, 0x7d, 0xec, 0x3a, 0xdc, 0x4d, 0x20, 0x79, 0xee, 0x5f, 0x3e, 0xd7, 0xcb, 0x39, 0x48
+};
+
+/* 系统参数 */
+static const uint32_t SYSTEM_PARAMETER[4] = {
+    0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc
+};
+
+/* 固定参数 */
+static const uint32_t FIXED_PARAMETER[32] = {
+    0x00070e15, 0x1c232a31, 0x383f464d, 0x545b6269,
+    0x70777e85, 0x8c939aa1, 0xa8afb6bd, 0xc4cbd2d9,
+    0xe0e7eef5, 0xfc030a11, 0x181f262d, 0x343b4249,
+    0x50575e65, 0x6c737a81, 0x888f969d, 0xa4abb2b9,
+    0xc0c7ced5, 0xdce3eaf1, 0xf8ff060d, 0x141b2229,
+    0x30373e45, 0x4c535a61, 0x686f767d, 0x848b9299,
+    0xa0a7aeb5, 0xbcc3cad1, 0xd8dfe6ed, 0xf4fb0209,
+    0x10171e25, 0x2c333a41, 0x484f565d, 0x646b7279
+};
+
+/* 循环左移 */
+static inline uint32_t sm4_vaes_rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+/* 字节转换为32位整数（大端序） */
+static inline uint32_t sm4_vaes_load_u32_be(const uint8_t *b) {
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | (uint32_t)b[3];
+}
+
+/* 合成变换T'（密钥扩展用） */
+static inline uint32_t sm4_vaes_t_prime_transform(uint32_t a) {
+    uint32_t b = (uint32_t)SM4_SBOX[(uint8_t)(a >> 24)] << 24 |
+                 (uint32_t)SM4_SBOX[(uint8_t)(a >> 16)] << 16 |
+                 (uint32_t)SM4_SBOX[(uint8_t)(a >> 8)] << 8 |
+                 (uint32_t)SM4_SBOX[(uint8_t)a];
+    
+    return b ^ sm4_vaes_rotl32(b, 13) ^ sm4_vaes_rotl32(b, 23);
+}
+
+/* 密钥扩展 */
+static inline void sm4_vaes_set_key(SM4_Context *ctx, const uint8_t *key, int is_encrypt) {
+    uint32_t K[36]; // 中间密钥
+    int i;
+    
+    for (i = 0; i < 4; i++) {
+        K[i] = sm4_vaes_load_u32_be(key + 4 * i) ^ SYSTEM_PARAMETER[i];
+    }
+    
+    for (i = 0; i < 32; i++) {
+        K[i + 4] = K[i] ^ sm4_vaes_t_prime_transform(K[i + 1] ^ K[i + 2] ^ K[i + 3] ^ FIXED_PARAMETER[i]);
+        ctx->rk[i] = K[i + 4];
+    }
+    
+    /* 解密时轮密钥顺序相反 */
+    if (is_encrypt == 0) {
+        uint32_t temp;
+        for (i = 0; i < 16; i++) {
+            temp = ctx->rk[i];
+            ctx->rk[i] = ctx->rk[31 - i];
+            ctx->rk[31 - i] = temp;
+        }
+    }
+}
+
+#if defined(SM4_VAES_YMM_KERNEL)
+
+/* 每128位通道的字节表，推导见AES-NI后端（sm4_aesni.c） */
+static const uint8_t SM4_VAES_PRE_LO[16] = {
+    0x3e, 0xb2, 0x0e, 0x82, 0xbb, 0x37, 0x8b, 0x07, 0xa1, 0x2d, 0x91, 0x1d, 0x24, 0xa8, 0x14, 0x98
+};
+static const uint8_t SM4_VAES_PRE_HI[16] = {
+    0x00, 0xdc, 0x2e, 0xf2, 0xc5, 0x19, 0xeb, 0x37, 0x08, 0xd4, 0x26, 0xfa, 0xcd, 0x11, 0xe3, 0x3f
+};
+static const uint8_t SM4_VAES_POST_LO[16] = {
+    0x6c, 0xd4, 0xa6, 0x1e, 0x52, 0xea, 0x98, 0x20, 0x0b, 0xb3, 0xc1, 0x79, 0x35, 0x8d, 0xff, 0x47
+};
+static const uint8_t SM4_VAES_POST_HI[16] = {
+    0x00, 0xe0, 0x50, 0xb0, 0x9d, 0x7d, 0xcd, 0x2d, 0xc0, 0x20, 0x90, 0x70, 0x5d, 0xbd, 0x0d, 0xed
+};
+static const uint8_t SM4_VAES_INV_SR[16] = {
+    0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03
+};
+static const uint8_t SM4_VAES_ROL8[16] = {
+    0x07, 0x00, 0x0d, 0x0a, 0x0b, 0x04, 0x01, 0x0e, 0x0f, 0x08, 0x05, 0x02, 0x03, 0x0c, 0x09, 0x06
+};
+static const uint8_t SM4_VAES_ROL16[16] = {
+    0x0a, 0x07, 0x00, 0x0d, 0x0e, 0x0b, 0x04, 0x01, 0x02, 0x0f, 0x08, 0x05, 0x06, 0x03, 0x0c, 0x09
+};
+static const uint8_t SM4_VAES_ROL24[16] = {
+    0x0d, 0x0a, 0x07, 0x00, 0x01, 0x0e, 0x0b, 0x04, 0x05, 0x02, 0x0f, 0x08, 0x09, 0x06, 0x03, 0x0c
+};
+static const uint8_t SM4_VAES_BSWAP32[16] = {
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+
+/* 一个ymm寄存器并行处理的块数 */
+#define SM4_VAES_YMM_LANES 8
+
+/* 把128位字节表广播到ymm的两个通道 */
+static inline __m256i sm4_vaes_table256(const uint8_t table[16]) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table));
+}
+
+/* 用半字节查表计算GF(2)上的仿射变换 */
+static inline __m256i sm4_vaes_affine256(__m256i x, __m256i lo_table, __m256i hi_table) {
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(x, mask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi32(x, 4), mask);
+    
+    return _mm256_xor_si256(_mm256_shuffle_epi8(lo_table, lo), _mm256_shuffle_epi8(hi_table, hi));
+}
+
+/* 合成变换T：32个字节同时过S盒，再做线性变换L */
+static inline __m256i sm4_vaes_t256(__m256i x) {
+    __m256i y, t, r;
+    
+    x = sm4_vaes_affine256(x, sm4_vaes_table256(SM4_VAES_PRE_LO), sm4_vaes_table256(SM4_VAES_PRE_HI));
+    x = _mm256_aesenclast_epi128(x, _mm256_setzero_si256());
+    x = sm4_vaes_affine256(x, sm4_vaes_table256(SM4_VAES_POST_LO), sm4_vaes_table256(SM4_VAES_POST_HI));
+    
+    y = _mm256_shuffle_epi8(x, sm4_vaes_table256(SM4_VAES_INV_SR));
+    t = _mm256_xor_si256(y, _mm256_shuffle_epi8(x, sm4_vaes_table256(SM4_VAES_ROL8)));
+    t = _mm256_xor_si256(t, _mm256_shuffle_epi8(x, sm4_vaes_table256(SM4_VAES_ROL16)));
+    r = _mm256_xor_si256(y, _mm256_shuffle_epi8(x, sm4_vaes_table256(SM4_VAES_ROL24)));
+    r = _mm256_xor_si256(r, _mm256_slli_epi32(t, 2));
+    return _mm256_xor_si256(r, _mm256_srli_epi32(t, 30));
+}
+
+/* 每个128位通道内的4x4的32位矩阵转置（自逆） */
+static inline void sm4_vaes_transpose256(__m256i *x0, __m256i *x1, __m256i *x2, __m256i *x3) {
+    __m256i t0 = _mm256_unpacklo_epi32(*x0, *x1);
+    __m256i t1 = _mm256_unpacklo_epi32(*x2, *x3);
+    __m256i t2 = _mm256_unpackhi_epi32(*x0, *x1);
+    __m256i t3 = _mm256_unpackhi_epi32(*x2, *x3);
+    
+    *x0 = _mm256_unpacklo_epi64(t0, t1);
+    *x1 = _mm256_unpackhi_epi64(t0, t1);
+    *x2 = _mm256_unpacklo_epi64(t2, t3);
+    *x3 = _mm256_unpackhi_epi64(t2, t3);
+}
+
+/*
+ * 载入8个块并转置，x[j]保存8个块的第j个字。
+ * 第j次载入的两个块分别落在两个通道，通道内转置后低通道是块0/2/4/6，
+ * 高通道是块1/3/5/7；写出时做同样的操作，块顺序自然还原。
+ */
+static inline void sm4_vaes_load8(__m256i x[4], const uint8_t *in) {
+    const __m256i bswap = sm4_vaes_table256(SM4_VAES_BSWAP32);
+    int j;
+    
+    for (j = 0; j < 4; j++) {
+        x[j] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(in + j * 2 * SM4_BLOCK_SIZE)), bswap);
+    }
+    sm4_vaes_transpose256(&x[0], &x[1], &x[2], &x[3]);
+}
+
+/* 反序变换后转置回8个块并写出 */
+static inline void sm4_vaes_store8(uint8_t *out, __m256i x[4]) {
+    const __m256i bswap = sm4_vaes_table256(SM4_VAES_BSWAP32);
+    int j;
+    
+    sm4_vaes_transpose256(&x[3], &x[2], &x[1], &x[0]);
+    for (j = 0; j < 4; j++) {
+        _mm256_storeu_si256((__m256i *)(out + j * 2 * SM4_BLOCK_SIZE), _mm256_shuffle_epi8(x[3 - j], bswap));
+    }
+}
+
+/* 一轮：x[a] ^= T(x[b] ^ x[c] ^ x[d] ^ rk) */
+#define SM4_VAES_ROUND256(x, a, b, c, d, rk) \
+    (x)[a] = _mm256_xor_si256((x)[a], sm4_vaes_t256(_mm256_xor_si256(_mm256_xor_si256((x)[b], (x)[c]), _mm256_xor_si256((x)[d], (rk)))))
+
+/* 8个块并行加密/解密 */
+static inline void sm4_vaes_crypt8(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    __m256i x[4];
+    __m256i rk;
+    int i;
+    
+    sm4_vaes_load8(x, in);
+    
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        rk = _mm256_set1_epi32((int)ctx->rk[i]);
+        SM4_VAES_ROUND256(x, 0, 1, 2, 3, rk);
+        rk = _mm256_set1_epi32((int)ctx->rk[i + 1]);
+        SM4_VAES_ROUND256(x, 1, 2, 3, 0, rk);
+        rk = _mm256_set1_epi32((int)ctx->rk[i + 2]);
+        SM4_VAES_ROUND256(x, 2, 3, 0, 1, rk);
+        rk = _mm256_set1_epi32((int)ctx->rk[i + 3]);
+        SM4_VAES_ROUND256(x, 3, 0, 1, 2, rk);
+    }
+    
+    sm4_vaes_store8(out, x);
+}
+
+/* 16个块并行加密/解密：两组8块交错执行，掩盖VAESENCLAST和pshufb的延迟 */
+static inline void sm4_vaes_crypt16(const SM4_Context *ctx, uint8_t *out, const uint8_t *in) {
+    __m256i x[4], y[4];
+    __m256i rk;
+    int i;
+    
+    sm4_vaes_load8(x, in);
+    sm4_vaes_load8(y, in + SM4_VAES_YMM_LANES * SM4_BLOCK_SIZE);
+    
+    for (i = 0; i < SM4_ROUNDS; i += 4) {
+        rk = _mm256_set1_epi32((int)ctx->rk[i]);
+        SM4_VAES_ROUND256(x, 0, 1, 2, 3, rk);
+        SM4_VAES_ROUND256(y, 0, 1, 2, 3, rk);
+        rk = _mm256_set1_epi32((int)ctx->rk[i + 1]);
+        SM4_VAES_ROUND256(x, 1, 2, 3, 0, rk);
+        SM4_VAES_ROUND256(y, 1, 2, 3, 0, rk);
+        rk = _mm256_set1_epi32((int)ctx->rk[i + 2]);
+        SM4_VAES_ROUND256(x, 2, 3, 0, 1, rk);
+        SM4_VAES_ROUND256(y, 2, 3, 0, 1, rk);
+        rk = _mm256_set1_epi32((int)ctx->rk[i + 3]);
+        SM4_VAES_ROUND256(x, 3, 0, 1, 2, rk);
+        SM4_VAES_ROUND256(y, 3, 0, 1, 2, rk);
+    }
+    
+    sm4_vaes_store8(out, x);
+    sm4_vaes_store8(out + SM4_VAES_YMM_LANES * SM4_BLOCK_SIZE, y);
+}
+
+/* 不足8块的尾部：补齐到8块后处理 */
+static inline void sm4_vaes_crypt_tail8(const SM4_Context *ctx, uint8_t *out, const uint8_t *in, size_t blocks) {
+    uint8_t buf[SM4_VAES_YMM_LANES * SM4_BLOCK_SIZE] = {0};
+    
+    memcpy(buf, in, blocks * SM4_BLOCK_SIZE);
+    sm4_vaes_crypt8(ctx, buf, buf);
+    memcpy(out, buf, blocks * SM4_BLOCK_SIZE);
+}
+
+#endif /* SM4_VAES_YMM_KERNEL */
+
+#endif /* SM4_VAES_COMMON_H */
@@ -0,0 +1,315 @@
+#include "sm4_xts_tweak.h"
+#include <string.h>
+
+/*
+ * SM4-XTS（IEEE P1619）
+ *
+ * 每个数据单元（扇区）的初始调整值T = E_K2(序号)，第j块
+ * C[j] = E_K1(P[j] ^ T·α^j) ^ T·α^j。块与块之间没有链式依赖，
+ * 每批16块先由调整值后端生成调整值并白化输入，再整批交给当前SM4后端的多块内核。
+ * 长度不是16的倍数时最后两块用密文挪用处理。
+ */
+
+/* 按优先级从高到低排列的调整值生成实现 */
+static const SM4_XTS_Tweak_Implementation *const SM4_XTS_TWEAK_IMPLEMENTATIONS[] = {
+    &sm4_xts_tweak_avx512_impl,
+    &sm4_xts_tweak_generic_impl
+};
+
+#define SM4_XTS_TWEAK_IMPLEMENTATION_COUNT \
+    (sizeof(SM4_XTS_TWEAK_IMPLEMENTATIONS) / sizeof(SM4_XTS_TWEAK_IMPLEMENTATIONS[0]))
+
+/* 小端64位读写 */
+static uint64_t sm4_xts_load64(const uint8_t *p) {
+    uint64_t v = 0;
+    int i;
+
+    for (i = 7; i >= 0; i--) {
+        v = v << 8 | p[i];
+    }
+    return v;
+}
+
+static void sm4_xts_store64(uint8_t *p, uint64_t v) {
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+/* T = T·α：128位小端整数左移一位，溢出时低字节异或0x87 */
+static void sm4_xts_mul_alpha(uint8_t *tweak) {
+    uint64_t lo = sm4_xts_load64(tweak);
+    uint64_t hi = sm4_xts_load64(tweak + 8);
+    uint64_t carry = hi >> 63;
+
+    sm4_xts_store64(tweak + 8, hi << 1 | lo >> 63);
+    sm4_xts_store64(tweak, lo << 1 ^ (0x87 & (0 - carry)));
+}
+
+/* out = a ^ b，按64位字处理 */
+static void sm4_xts_xor(uint8_t *out, const uint8_t *a, const uint8_t *b, size_t len) {
+    size_t i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        x ^= y;
+        memcpy(out + i, &x, 8);
+    }
+    for (; i < len; i++) {
+        out[i] = a[i] ^ b[i];
+    }
+}
+
+/* 通用实现：调整值放在两个64位字中逐个相乘 */
+static void sm4_xts_generic_whiten(uint8_t *tweak, uint8_t *tweaks, uint8_t *buf, const uint8_t *in, size_t blocks) {
+    uint64_t lo = sm4_xts_load64(tweak);
+    uint64_t hi = sm4_xts_load64(tweak + 8);
+    uint64_t carry;
+    size_t j;
+
+    for (j = 0; j < blocks; j++) {
+        sm4_xts_store64(tweaks + j * SM4_BLOCK_SIZE, lo);
+        sm4_xts_store64(tweaks + j * SM4_BLOCK_SIZE + 8, hi);
+
+        carry = hi >> 63;
+        hi = hi << 1 | lo >> 63;
+        lo = lo << 1 ^ (0x87 & (0 - carry));
+    }
+
+    sm4_xts_store64(tweak, lo);
+    sm4_xts_store64(tweak + 8, hi);
+    sm4_xts_xor(buf, in, tweaks, blocks * SM4_BLOCK_SIZE);
+}
+
+static int sm4_xts_generic_is_supported(const SM4_CPU_Features *features) {
+    (void)features;
+    return 1;
+}
+
+const SM4_XTS_Tweak_Implementation sm4_xts_tweak_generic_impl = {
+    "generic",
+    sm4_xts_generic_is_supported,
+    sm4_xts_generic_whiten
+};
+
+/* 已知答案自检：每种批大小的调整值和白化结果都必须与通用实现一致 */
+static int sm4_xts_tweak_selftest(const SM4_XTS_Tweak_Implementation *impl) {
+    uint8_t in[SM4_XTS_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t tweaks[SM4_XTS_BATCH_BLOCKS * SM4_BLOCK_SIZE], ref_tweaks[SM4_XTS_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t buf[SM4_XTS_BATCH_BLOCKS * SM4_BLOCK_SIZE], ref_buf[SM4_XTS_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t tweak[SM4_BLOCK_SIZE], ref_tweak[SM4_BLOCK_SIZE];
+    size_t i, blocks;
+
+    for (i = 0; i < sizeof(in); i++) {
+        in[i] = (uint8_t)(i * 29 + 7);
+    }
+    /* 最高位置1，第一步就要约减 */
+    for (i = 0; i < SM4_BLOCK_SIZE; i++) {
+        tweak[i] = (uint8_t)(i * 53 + 0x91);
+    }
+    memcpy(ref_tweak, tweak, SM4_BLOCK_SIZE);
+
+    for (blocks = 1; blocks <= SM4_XTS_BATCH_BLOCKS; blocks++) {
+        sm4_xts_generic_whiten(ref_tweak, ref_tweaks, ref_buf, in, blocks);
+        impl->whiten(tweak, tweaks, buf, in, blocks);
+        if (memcmp(tweak, ref_tweak, SM4_BLOCK_SIZE) != 0 ||
+            memcmp(tweaks, ref_tweaks, blocks * SM4_BLOCK_SIZE) != 0 ||
+            memcmp(buf, ref_buf, blocks * SM4_BLOCK_SIZE) != 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static const SM4_XTS_Tweak_Implementation *sm4_xts_select_tweak(void) {
+    SM4_CPU_Features features = sm4_get_cpu_features();
+    size_t i;
+
+    for (i = 0; i < SM4_XTS_TWEAK_IMPLEMENTATION_COUNT; i++) {
+        if (SM4_XTS_TWEAK_IMPLEMENTATIONS[i]->is_supported(&features) &&
+            sm4_xts_tweak_selftest(SM4_XTS_TWEAK_IMPLEMENTATIONS[i])) {
+            return SM4_XTS_TWEAK_IMPLEMENTATIONS[i];
+        }
+    }
+
+    return &sm4_xts_tweak_generic_impl;
+}
+
+/* 调度结果，只在加载时（或首次调用时）写入一次 */
+static const SM4_XTS_Tweak_Implementation *active_tweak = NULL;
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((constructor))
+static void sm4_xts_dispatch_init(void) {
+    active_tweak = sm4_xts_select_tweak();
+}
+#endif
+
+static const SM4_XTS_Tweak_Implementation *sm4_xts_get_tweak(void) {
+    if (active_tweak == NULL) {
+        active_tweak = sm4_xts_select_tweak();
+    }
+    return active_tweak;
+}
+
+const char *sm4_xts_get_tweak_implementation(void) {
+    return sm4_xts_get_tweak()->name;
+}
+
+/* 初始化XTS上下文 */
+int sm4_xts_init(SM4_XTS_Context *ctx, const uint8_t *key) {
+    if (memcmp(key, key + SM4_KEY_SIZE, SM4_KEY_SIZE) == 0) {
+        return -1; /* 两个密钥必须不同 */
+    }
+
+    sm4_set_encrypt_key(&ctx->enc_ctx, key);
+    sm4_set_decrypt_key(&ctx->dec_ctx, key);
+    sm4_set_encrypt_key(&ctx->tweak_ctx, key + SM4_KEY_SIZE);
+    return 0;
+}
+
+/*
+ * 处理blocks个整块：白化、多块内核、再次白化。加解密共用轮函数，方向由cipher的轮密钥决定。
+ * tweak返回时前进blocks步。
+ */
+static void sm4_xts_crypt_blocks(const SM4_XTS_Tweak_Implementation *impl, const SM4_Context *cipher,
+                                 uint8_t *tweak, uint8_t *out, const uint8_t *in, size_t blocks) {
+    uint8_t tweaks[SM4_XTS_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    uint8_t buf[SM4_XTS_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    size_t n;
+
+    while (blocks > 0) {
+        n = blocks < SM4_XTS_BATCH_BLOCKS ? blocks : SM4_XTS_BATCH_BLOCKS;
+
+        impl->whiten(tweak, tweaks, buf, in, n);
+        sm4_encrypt_blocks(cipher, buf, buf, n);
+        sm4_xts_xor(out, buf, tweaks, n * SM4_BLOCK_SIZE);
+
+        in += n * SM4_BLOCK_SIZE;
+        out += n * SM4_BLOCK_SIZE;
+        blocks -= n;
+    }
+}
+
+/*
+ * 处理一个数据单元，tweak为已加密的初始调整值（会被修改）。
+ *
+ * 密文挪用：设共m个整块、尾部r字节。加密时第m-1块先按普通方式得到CC，
+ * CC的前r字节成为最后的部分块，尾部明文补上CC的后16-r字节后用下一个调整值加密，
+ * 放在第m-1块的位置。解密时两个调整值的使用顺序相反。
+ */
+static int sm4_xts_crypt_unit(const SM4_XTS_Context *ctx, uint8_t *out, const uint8_t *in, size_t len,
+                              uint8_t *tweak, int encrypt) {
+    const SM4_XTS_Tweak_Implementation *impl = sm4_xts_get_tweak();
+    const SM4_Context *cipher = encrypt ? &ctx->enc_ctx : &ctx->dec_ctx;
+    uint8_t prev_tweak[SM4_BLOCK_SIZE];
+    uint8_t cc[SM4_BLOCK_SIZE];
+    uint8_t pp[SM4_BLOCK_SIZE];
+    size_t blocks = len / SM4_BLOCK_SIZE;
+    size_t r = len % SM4_BLOCK_SIZE;
+
+    if (len < SM4_BLOCK_SIZE) {
+        return -1; /* 数据单元至少一个整块 */
+    }
+
+    if (r == 0) {
+        sm4_xts_crypt_blocks(impl, cipher, tweak, out, in, blocks);
+        return 0;
+    }
+
+    /* 最后一个整块和部分块一起处理 */
+    sm4_xts_crypt_blocks(impl, cipher, tweak, out, in, blocks - 1);
+    in += (blocks - 1) * SM4_BLOCK_SIZE;
+    out += (blocks - 1) * SM4_BLOCK_SIZE;
+
+    if (encrypt) {
+        sm4_xts_crypt_blocks(impl, cipher, tweak, cc, in, 1);
+        memcpy(pp, in + SM4_BLOCK_SIZE, r);      // 原地加密时先取出尾部明文
+        memcpy(pp + r, cc + r, SM4_BLOCK_SIZE - r);
+        memcpy(out + SM4_BLOCK_SIZE, cc, r);
+        sm4_xts_crypt_blocks(impl, cipher, tweak, out, pp, 1);
+    } else {
+        /* 先用后一个调整值解密第m-1块，再用前一个解密补齐后的最后一块 */
+        memcpy(prev_tweak, tweak, SM4_BLOCK_SIZE);
+        sm4_xts_mul_alpha(tweak);
+        sm4_xts_crypt_blocks(impl, cipher, tweak, pp, in, 1);
+        memcpy(cc, in + SM4_BLOCK_SIZE, r);      // 原地解密时先取出尾部密文
+        memcpy(cc + r, pp + r, SM4_BLOCK_SIZE - r);
+        memcpy(out + SM4_BLOCK_SIZE, pp, r);
+        sm4_xts_crypt_blocks(impl, cipher, prev_tweak, out, cc, 1);
+    }
+
+    return 0;
+}
+
+/* XTS加密 */
+int sm4_xts_encrypt(const SM4_XTS_Context *ctx, uint8_t *out, const uint8_t *in, size_t len,
+                    const uint8_t *tweak) {
+    uint8_t t[SM4_BLOCK_SIZE];
+
+    sm4_encrypt_block(&ctx->tweak_ctx, t, tweak);
+    return sm4_xts_crypt_unit(ctx, out, in, len, t, 1);
+}
+
+/* XTS解密（调整值仍用调整值密钥加密得到） */
+int sm4_xts_decrypt(const SM4_XTS_Context *ctx, uint8_t *out, const uint8_t *in, size_t len,
+                    const uint8_t *tweak) {
+    uint8_t t[SM4_BLOCK_SIZE];
+
+    sm4_encrypt_block(&ctx->tweak_ctx, t, tweak);
+    return sm4_xts_crypt_unit(ctx, out, in, len, t, 0);
+}
+
+/*
+ * 批量处理扇区：每16个扇区的初始调整值（扇区号，128位小端）拼成一次多块调用加密，
+ * 再逐个扇区处理。
+ */
+static int sm4_xts_crypt_sectors(const SM4_XTS_Context *ctx, uint8_t *out, const uint8_t *in,
+                                 size_t sector_size, size_t sectors, uint64_t first_sector, int encrypt) {
+    uint8_t tweaks[SM4_XTS_BATCH_BLOCKS * SM4_BLOCK_SIZE];
+    uint64_t sector;
+    size_t base, n, i;
+
+    if (sector_size < SM4_BLOCK_SIZE) {
+        return -1;
+    }
+
+    for (base = 0; base < sectors; base += n) {
+        n = sectors - base;
+        if (n > SM4_XTS_BATCH_BLOCKS) {
+            n = SM4_XTS_BATCH_BLOCKS;
+        }
+
+        for (i = 0; i < n; i++) {
+            sector = first_sector + base + i;
+            sm4_xts_store64(tweaks + i * SM4_BLOCK_SIZE, sector);
+            sm4_xts_store64(tweaks + i * SM4_BLOCK_SIZE + 8, sector < first_sector); /* 64位回绕时进位 */
+        }
+        sm4_encrypt_blocks(&ctx->tweak_ctx, tweaks, tweaks, n);
+
+        for (i = 0; i < n; i++) {
+            sm4_xts_crypt_unit(ctx, out, in, sector_size, tweaks + i * SM4_BLOCK_SIZE, encrypt);
+            in += sector_size;
+            out += sector_size;
+        }
+    }
+
+    return 0;
+}
+
+/* 批量加密扇区 */
+int sm4_xts_encrypt_sectors(const SM4_XTS_Context *ctx, uint8_t *out, const uint8_t *in,
+                            size_t sector_size, size_t sectors, uint64_t first_sector) {
+    return sm4_xts_crypt_sectors(ctx, out, in, sector_size, sectors, first_sector, 1);
+}
+
+/* 批量解密扇区 */
+int sm4_xts_decrypt_sectors(const SM4_XTS_Context *ctx, uint8_t *out, const uint8_t *in,
+                            size_t sector_size, size_t sectors, uint64_t first_sector) {
+    return sm4_xts_crypt_sectors(ctx, out, in, sector_size, sectors, first_sector, 0);
+}
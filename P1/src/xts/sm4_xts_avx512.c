@@ -0,0 +1,81 @@
+#include "sm4_xts_tweak.h"
+
+#if defined(HAVE_AVX512F) && HAVE_AVX512F
+
+#include <immintrin.h>
+#include <string.h>
+
+/*
+ * 每个zmm放4个相邻的调整值，下一组4个等于每个通道乘α^4：
+ * 128位左移4位，移出的4位c按约减多项式折回低位，即c ^ c<<1 ^ c<<2 ^ c<<7（0x87），
+ * 4位的约减不会再溢出，不需要无进位乘法。一批16块用4个zmm，
+ * 第5个zmm的通道0就是下一批的起点。
+ */
+static inline __m512i sm4_xts_mul_alpha4(__m512i v) {
+    __m512i s = _mm512_slli_epi64(v, 4);
+    /* 每个64位字移出的高4位，再交换通道内的高低64位：低字得到整个128位的溢出，高字得到低字的进位 */
+    __m512i c = _mm512_shuffle_epi32(_mm512_srli_epi64(v, 60), _MM_PERM_BADC);
+    __m512i r = _mm512_xor_si512(_mm512_xor_si512(c, _mm512_slli_epi64(c, 1)),
+                                 _mm512_xor_si512(_mm512_slli_epi64(c, 2), _mm512_slli_epi64(c, 7)));
+
+    return _mm512_xor_si512(s, _mm512_mask_blend_epi64(0xAA, r, c));
+}
+
+static void sm4_xts_avx512_whiten(uint8_t *tweak, uint8_t *tweaks, uint8_t *buf, const uint8_t *in, size_t blocks) {
+    uint64_t t[8];
+    uint64_t carry;
+    __m512i v, d;
+    __mmask8 mask;
+    size_t g, n;
+    int j;
+
+    /* 第一组的4个调整值用标量计算（本机为小端） */
+    memcpy(t, tweak, SM4_BLOCK_SIZE);
+    for (j = 2; j < 8; j += 2) {
+        carry = t[j - 1] >> 63;
+        t[j + 1] = t[j - 1] << 1 | t[j - 2] >> 63;
+        t[j] = t[j - 2] << 1 ^ (0x87 & (0 - carry));
+    }
+    v = _mm512_loadu_si512((const void *)t);
+
+    for (g = 0; g < blocks; g += 4) {
+        n = blocks - g;
+        mask = n >= 4 ? 0xFF : (__mmask8)((1u << (2 * n)) - 1);
+
+        d = _mm512_maskz_loadu_epi64(mask, (const void *)(in + g * SM4_BLOCK_SIZE));
+        _mm512_storeu_si512((void *)(tweaks + g * SM4_BLOCK_SIZE), v);
+        _mm512_storeu_si512((void *)(buf + g * SM4_BLOCK_SIZE), _mm512_xor_si512(d, v));
+        v = sm4_xts_mul_alpha4(v);
+    }
+
+    /* 下一个调整值：批内的第blocks个，或者下一组的通道0 */
+    if (blocks % 4 == 0) {
+        _mm_storeu_si128((__m128i *)tweak, _mm512_castsi512_si128(v));
+    } else {
+        memcpy(tweak, tweaks + blocks * SM4_BLOCK_SIZE, SM4_BLOCK_SIZE);
+    }
+}
+
+#else
+
+/* 编译器不支持AVX-512时转发到通用实现（is_supported返回0，不会被选中） */
+static void sm4_xts_avx512_whiten(uint8_t *tweak, uint8_t *tweaks, uint8_t *buf, const uint8_t *in, size_t blocks) {
+    sm4_xts_tweak_generic_impl.whiten(tweak, tweaks, buf, in, blocks);
+}
+
+#endif /* HAVE_AVX512F */
+
+static int sm4_xts_avx512_is_supported(const SM4_CPU_Features *features) {
+#if defined(HAVE_AVX512F) && HAVE_AVX512F
+    return features->has_avx512f;
+#else
+    (void)features;
+    return 0;
+#endif
+}
+
+const SM4_XTS_Tweak_Implementation sm4_xts_tweak_avx512_impl = {
+    "avx512",
+    sm4_xts_avx512_is_supported,
+    sm4_xts_avx512_whiten
+};
@@ -0,0 +1,46 @@
+#ifndef SM4_XTS_TWEAK_H
+#define SM4_XTS_TWEAK_H
+
+#include "sm4_xts.h"
+#include "sm4_cpu_features.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* XTS每批交给多块内核的块数，也是一次生成的调整值个数 */
+#define SM4_XTS_BATCH_BLOCKS 16
+
+/*
+ * 调整值生成后端。第j块的调整值为T·α^j（GF(2^128)，小端，约减多项式x^128+x^7+x^2+x+1），
+ * 相邻调整值之间是串行依赖，向量实现一次算出一批并顺便完成输入白化。
+ */
+typedef struct {
+    const char *name;  // 实现名称
+
+    /**
+     * @brief 判断当前CPU（以及编译配置）是否可以运行该实现
+     * @param features CPU特性
+     * @return 非0可用，0不可用
+     */
+    int (*is_supported)(const SM4_CPU_Features *features);
+
+    /**
+     * @brief 生成blocks个调整值并白化输入：tweaks[j] = T·α^j，buf[j] = in[j] ^ tweaks[j]
+     * @param tweak 16字节当前调整值T，返回时前进为T·α^blocks
+     * @param tweaks 输出调整值，至少容纳SM4_XTS_BATCH_BLOCKS块
+     * @param buf 输出白化后的输入，至少容纳SM4_XTS_BATCH_BLOCKS块
+     * @param in 输入数据
+     * @param blocks 块数量（1..SM4_XTS_BATCH_BLOCKS）
+     */
+    void (*whiten)(uint8_t *tweak, uint8_t *tweaks, uint8_t *buf, const uint8_t *in, size_t blocks);
+} SM4_XTS_Tweak_Implementation;
+
+extern const SM4_XTS_Tweak_Implementation sm4_xts_tweak_generic_impl;
+extern const SM4_XTS_Tweak_Implementation sm4_xts_tweak_avx512_impl;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SM4_XTS_TWEAK_H */
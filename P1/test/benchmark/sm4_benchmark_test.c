@@ -6,304 +6,490 @@
 #include <string.h>
 #include <time.h>
 
-/* 测量执行时间 */
-static double measure_time(void (*func)(void), int iterations) {
-    clock_t start, end;
-    double cpu_time_used;
-    
-    start = clock();
-    for (int i = 0; i < iterations; i++) {
-        func();
-    }
-    end = clock();
-    
-    cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
-    return cpu_time_used;
-}
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+/*
+ * SM4性能测试框架
+ *
+ * 对每个后端（sm4_force_implementation()切换）和每种模式，按消息长度从16 B到64 MiB
+ * 扫描。每个测点先标定迭代次数使一次采样不短于最短时间（同时作为预热），再丢弃一次
+ * 采样，然后取N次采样的中位数。时间用clock_gettime(CLOCK_MONOTONIC)，周期用TSC
+ * （TSC按标称频率计数，睿频时与核心周期不完全相同）。结果可输出为文本表格、CSV或JSON，
+ * 便于保存后比较。
+ *
+ * 测量前先检查每个后端各模式的输出与基本实现一致，不一致时不报告该后端的数据并返回失败。
+ */
+
+/* 所有后端，按调度优先级从低到高 */
+static const char *const BENCH_IMPLS[] = {
+    "basic", "t_table", "bitslice", "bitslice_avx2", "aesni", "vaes", "vaes_avx512", "gfni"
+};
+
+#define BENCH_IMPL_COUNT (sizeof(BENCH_IMPLS) / sizeof(BENCH_IMPLS[0]))
 
 /* 测试数据 */
-static uint8_t key[16] = {
+static const uint8_t BENCH_KEY[16] = {
     0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
     0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10
 };
 
-static uint8_t plaintext[16] = {
-    0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
-    0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10
+static const uint8_t BENCH_IV[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
 };
 
-static uint8_t ciphertext[16];
-static uint8_t decrypted[16];
-
-/* 全局上下文 */
-static SM4_Context basic_encrypt_ctx;
-static SM4_Context basic_decrypt_ctx;
-static SM4_Context t_table_encrypt_ctx;
-static SM4_Context t_table_decrypt_ctx;
-static SM4_Context aesni_encrypt_ctx;
-static SM4_Context aesni_decrypt_ctx;
-static SM4_Context modern_encrypt_ctx;
-static SM4_Context modern_decrypt_ctx;
-
-/* 测试函数 - 基本实现 */
-static void test_basic_encrypt(void) {
-    sm4_encrypt_block(&basic_encrypt_ctx, ciphertext, plaintext);
+/* 一次测量使用的上下文和缓冲区 */
+typedef struct {
+    SM4_Context enc_ctx;
+    SM4_Context dec_ctx;
+    SM4_CTR_Context ctr_ctx;
+    SM4_GCM_Context gcm_ctx;
+    uint8_t *in;
+    uint8_t *out;
+} Bench_State;
+
+/* 一种被测模式：处理len字节（len是16的倍数） */
+typedef struct {
+    const char *name;
+    void (*run)(Bench_State *st, size_t len);
+} Bench_Mode;
+
+static void bench_ecb(Bench_State *st, size_t len) {
+    sm4_ecb_encrypt(&st->enc_ctx, st->out, st->in, len);
 }
 
-static void test_basic_decrypt(void) {
-    sm4_decrypt_block(&basic_decrypt_ctx, decrypted, ciphertext);
+static void bench_cbc_enc(Bench_State *st, size_t len) {
+    uint8_t iv[16];
+
+    memcpy(iv, BENCH_IV, sizeof(iv));
+    sm4_cbc_encrypt(&st->enc_ctx, st->out, st->in, len, iv);
 }
 
-/* 测试函数 - T表实现 */
-static void test_t_table_encrypt(void) {
-    sm4_encrypt_block(&t_table_encrypt_ctx, ciphertext, plaintext);
+static void bench_cbc_dec(Bench_State *st, size_t len) {
+    uint8_t iv[16];
+
+    memcpy(iv, BENCH_IV, sizeof(iv));
+    sm4_cbc_decrypt(&st->dec_ctx, st->out, st->in, len, iv);
 }
 
-static void test_t_table_decrypt(void) {
-    sm4_decrypt_block(&t_table_decrypt_ctx, decrypted, ciphertext);
+static void bench_ctr(Bench_State *st, size_t len) {
+    sm4_ctr_seek(&st->ctr_ctx, 0);
+    sm4_ctr_encrypt(&st->ctr_ctx, st->out, st->in, len);
 }
 
-/* 测试函数 - AESNI实现 */
-static void test_aesni_encrypt(void) {
-    sm4_encrypt_block(&aesni_encrypt_ctx, ciphertext, plaintext);
+/* GCM按每条消息计算：初始化（密钥扩展、H预计算、IV）+ 加密 + 标签 */
+static void bench_gcm(Bench_State *st, size_t len) {
+    uint8_t tag[16];
+
+    sm4_gcm_init(&st->gcm_ctx, BENCH_KEY, BENCH_IV, 12);
+    sm4_gcm_encrypt(&st->gcm_ctx, st->out, st->in, len);
+    sm4_gcm_finish(&st->gcm_ctx, tag, sizeof(tag));
+}
+
+static const Bench_Mode BENCH_MODES[] = {
+    {"ecb", bench_ecb},
+    {"cbc_enc", bench_cbc_enc},
+    {"cbc_dec", bench_cbc_dec},
+    {"ctr", bench_ctr},
+    {"gcm", bench_gcm}
+};
+
+#define BENCH_MODE_COUNT (sizeof(BENCH_MODES) / sizeof(BENCH_MODES[0]))
+
+/* 输出格式 */
+typedef enum {
+    BENCH_FORMAT_TEXT,
+    BENCH_FORMAT_CSV,
+    BENCH_FORMAT_JSON
+} Bench_Format;
+
+/* 命令行选项 */
+typedef struct {
+    const char *impls;      // 逗号分隔的后端列表，NULL表示全部可用后端
+    const char *modes;      // 逗号分隔的模式列表，NULL表示全部
+    size_t min_size;
+    size_t max_size;
+    size_t reps;            // 每个测点的采样次数（取中位数）
+    double min_time_ns;     // 一次采样的最短时间
+    Bench_Format format;
+    const char *output;     // 输出文件，NULL表示标准输出
+} Bench_Options;
+
+/* 一个测点的结果 */
+typedef struct {
+    const char *impl;
+    const char *mode;
+    size_t size;
+    size_t iterations;      // 每次采样的迭代次数
+    double ns_per_byte;     // 中位数
+    double cycles_per_byte; // 中位数（没有TSC时为0）
+    double mb_per_s;        // 由ns_per_byte换算
+} Bench_Result;
+
+/* 单调时钟（纳秒） */
+static double bench_now_ns(void) {
+    struct timespec ts;
+
+#if defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* TSC计数 */
+static unsigned long long bench_cycles(void) {
+#if BENCH_HAVE_TSC
+    return (unsigned long long)__rdtsc();
+#else
+    return 0;
+#endif
 }
 
-static void test_aesni_decrypt(void) {
-    sm4_decrypt_block(&aesni_decrypt_ctx, decrypted, ciphertext);
+/* 一次采样：连续运行iterations次 */
+static void bench_sample(const Bench_Mode *mode, Bench_State *st, size_t len, size_t iterations,
+                         double *ns, double *cycles) {
+    unsigned long long c0, c1;
+    double t0, t1;
+    size_t i;
+
+    t0 = bench_now_ns();
+    c0 = bench_cycles();
+    for (i = 0; i < iterations; i++) {
+        mode->run(st, len);
+    }
+    c1 = bench_cycles();
+    t1 = bench_now_ns();
+
+    *ns = t1 - t0;
+    *cycles = (double)(c1 - c0);
 }
 
-/* 测试函数 - 现代指令集实现 */
-static void test_modern_encrypt(void) {
-    sm4_encrypt_block(&modern_encrypt_ctx, ciphertext, plaintext);
+static int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
 }
 
-static void test_modern_decrypt(void) {
-    sm4_decrypt_block(&modern_decrypt_ctx, decrypted, ciphertext);
+/* 中位数（会对数组排序） */
+static double bench_median(double *v, size_t n) {
+    qsort(v, n, sizeof(double), bench_compare_double);
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
 }
 
-/* 性能测试 */
-static int benchmark_implementations(void) {
-    int iterations = 1000000;
-    double time_used;
-    SM4_CPU_Features features;
-    
-    /* 检测CPU特性 */
-    features = sm4_get_cpu_features();
-    
-    /* 初始化上下文 */
-    sm4_set_encrypt_key(&basic_encrypt_ctx, key);
-    sm4_set_decrypt_key(&basic_decrypt_ctx, key);
-    
-    sm4_set_encrypt_key(&t_table_encrypt_ctx, key);
-    sm4_set_decrypt_key(&t_table_decrypt_ctx, key);
-    
-    sm4_set_encrypt_key(&aesni_encrypt_ctx, key);
-    sm4_set_decrypt_key(&aesni_decrypt_ctx, key);
-    
-    sm4_set_encrypt_key(&modern_encrypt_ctx, key);
-    sm4_set_decrypt_key(&modern_decrypt_ctx, key);
-    
-    /* 性能测试 */
-    printf("执行性能测试...\n\n");
-    
-    /* 基本实现 */
-    printf("基本实现 (%d 次迭代):\n", iterations);
-    
-    time_used = measure_time(test_basic_encrypt, iterations);
-    printf("  加密: %.6f 秒 (%.2f MB/s)\n", 
-           time_used, 
-           (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
-    
-    time_used = measure_time(test_basic_decrypt, iterations);
-    printf("  解密: %.6f 秒 (%.2f MB/s)\n", 
-           time_used, 
-           (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
-    
-    /* T表实现 */
-    printf("\nT表实现 (%d 次迭代):\n", iterations);
-    
-    time_used = measure_time(test_t_table_encrypt, iterations);
-    printf("  加密: %.6f 秒 (%.2f MB/s)\n", 
-           time_used, 
-           (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
-    
-    time_used = measure_time(test_t_table_decrypt, iterations);
-    printf("  解密: %.6f 秒 (%.2f MB/s)\n", 
-           time_used, 
-           (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
-    
-    /* AESNI实现 */
-    if (features.has_aesni) {
-        printf("\nAESNI实现 (%d 次迭代):\n", iterations);
-        
-        time_used = measure_time(test_aesni_encrypt, iterations);
-        printf("  加密: %.6f 秒 (%.2f MB/s)\n", 
-               time_used, 
-               (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
-        
-        time_used = measure_time(test_aesni_decrypt, iterations);
-        printf("  解密: %.6f 秒 (%.2f MB/s)\n", 
-               time_used, 
-               (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
+/* 测量一个测点：标定迭代次数（兼作预热），丢弃一次采样，再取reps次采样的中位数 */
+static void bench_measure(const Bench_Mode *mode, Bench_State *st, size_t len, const Bench_Options *opt,
+                          Bench_Result *res) {
+    double ns_samples[64];
+    double cycle_samples[64];
+    double ns, cycles;
+    size_t iterations = 1;
+    size_t r;
+
+    for (;;) {
+        bench_sample(mode, st, len, iterations, &ns, &cycles);
+        if (ns >= opt->min_time_ns) {
+            break;
+        }
+        /* 按已测时间估算，至少翻倍，留20%余量 */
+        if (ns * 2 > opt->min_time_ns || ns <= 0) {
+            iterations *= 2;
+        } else {
+            iterations = (size_t)((double)iterations * opt->min_time_ns * 1.2 / ns) + 1;
+        }
     }
-    
-    /* 现代指令集实现 */
-    if (features.has_gfni) {
-        printf("\n现代指令集实现 (%d 次迭代):\n", iterations);
-        
-        time_used = measure_time(test_modern_encrypt, iterations);
-        printf("  加密: %.6f 秒 (%.2f MB/s)\n", 
-               time_used, 
-               (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
-        
-        time_used = measure_time(test_modern_decrypt, iterations);
-        printf("  解密: %.6f 秒 (%.2f MB/s)\n", 
-               time_used, 
-               (iterations * 16.0) / (time_used * 1024.0 * 1024.0));
+
+    bench_sample(mode, st, len, iterations, &ns, &cycles);
+    for (r = 0; r < opt->reps; r++) {
+        bench_sample(mode, st, len, iterations, &ns, &cycles);
+        ns_samples[r] = ns / ((double)iterations * (double)len);
+        cycle_samples[r] = cycles / ((double)iterations * (double)len);
     }
-    
-    return 0;
+
+    res->iterations = iterations;
+    res->ns_per_byte = bench_median(ns_samples, opt->reps);
+    res->cycles_per_byte = BENCH_HAVE_TSC ? bench_median(cycle_samples, opt->reps) : 0.0;
+    res->mb_per_s = 1e3 / res->ns_per_byte;
 }
 
-/* 验证不同实现的一致性 */
-static int verify_implementations(void) {
-    uint8_t basic_output[16];
-    uint8_t t_table_output[16];
-    uint8_t aesni_output[16];
-    uint8_t modern_output[16];
-    SM4_CPU_Features features;
-    int passed = 1;
-    
-    /* 检测CPU特性 */
-    features = sm4_get_cpu_features();
-    
-    printf("验证不同实现的一致性...\n\n");
-    
-    /* 初始化上下文 */
-    sm4_set_encrypt_key(&basic_encrypt_ctx, key);
-    sm4_set_encrypt_key(&t_table_encrypt_ctx, key);
-    sm4_set_encrypt_key(&aesni_encrypt_ctx, key);
-    sm4_set_encrypt_key(&modern_encrypt_ctx, key);
-    
-    /* 加密测试 */
-    sm4_encrypt_block(&basic_encrypt_ctx, basic_output, plaintext);
-    sm4_encrypt_block(&t_table_encrypt_ctx, t_table_output, plaintext);
-    
-    printf("基本实现与T表实现比较: ");
-    if (memcmp(basic_output, t_table_output, 16) != 0) {
-        printf("不一致!\n");
-        passed = 0;
-    } else {
-        printf("一致\n");
+/* 按当前后端设置上下文 */
+static void bench_setup(Bench_State *st) {
+    sm4_set_encrypt_key(&st->enc_ctx, BENCH_KEY);
+    sm4_set_decrypt_key(&st->dec_ctx, BENCH_KEY);
+    sm4_ctr_init(&st->ctr_ctx, BENCH_KEY, BENCH_IV);
+}
+
+/* 逗号分隔的列表中是否包含name，list为NULL时视为包含 */
+static int bench_selected(const char *list, const char *name) {
+    size_t n = strlen(name);
+    const char *p = list;
+
+    if (list == NULL) {
+        return 1;
     }
-    
-    if (features.has_aesni) {
-        sm4_encrypt_block(&aesni_encrypt_ctx, aesni_output, plaintext);
-        
-        printf("基本实现与AESNI实现比较: ");
-        if (memcmp(basic_output, aesni_output, 16) != 0) {
-            printf("不一致!\n");
-            passed = 0;
-        } else {
-            printf("一致\n");
+    while ((p = strstr(p, name)) != NULL) {
+        if ((p == list || p[-1] == ',') && (p[n] == '\0' || p[n] == ',')) {
+            return 1;
         }
+        p += n;
     }
-    
-    if (features.has_gfni) {
-        sm4_encrypt_block(&modern_encrypt_ctx, modern_output, plaintext);
-        
-        printf("基本实现与现代指令集实现比较: ");
-        if (memcmp(basic_output, modern_output, 16) != 0) {
-            printf("不一致!\n");
-            passed = 0;
+    return 0;
+}
+
+/* 验证长度：跨越多个批次且不是批大小的整数倍 */
+#define BENCH_VERIFY_LEN (16 * 67)
+
+/* 当前后端各模式的输出必须与基本实现一致 */
+static int bench_verify(const char *impl, Bench_State *st, uint8_t expected[][BENCH_VERIFY_LEN]) {
+    size_t m;
+    int ok = 1;
+
+    bench_setup(st);
+    for (m = 0; m < BENCH_MODE_COUNT; m++) {
+        BENCH_MODES[m].run(st, BENCH_VERIFY_LEN);
+        if (memcmp(st->out, expected[m], BENCH_VERIFY_LEN) != 0) {
+            fprintf(stderr, "%s: %s输出与基本实现不一致!\n", impl, BENCH_MODES[m].name);
+            ok = 0;
+        }
+    }
+    return ok;
+}
+
+/* 解析长度，支持K/M/G后缀 */
+static size_t bench_parse_size(const char *s) {
+    char *end;
+    unsigned long long v = strtoull(s, &end, 10);
+
+    switch (*end) {
+    case 'K': case 'k': v <<= 10; break;
+    case 'M': case 'm': v <<= 20; break;
+    case 'G': case 'g': v <<= 30; break;
+    default: break;
+    }
+    return (size_t)v;
+}
+
+static void bench_usage(const char *prog) {
+    printf("用法: %s [选项]\n", prog);
+    printf("  --impl LIST        逗号分隔的后端（默认全部可用后端）\n");
+    printf("  --mode LIST        逗号分隔的模式：ecb,cbc_enc,cbc_dec,ctr,gcm（默认全部）\n");
+    printf("  --min-size N       最小消息长度（默认16，可用K/M后缀）\n");
+    printf("  --max-size N       最大消息长度（默认64M），长度按4倍递增\n");
+    printf("  --reps N           每个测点的采样次数，取中位数（默认5，最多64）\n");
+    printf("  --min-time-ms N    一次采样的最短时间（默认20）\n");
+    printf("  --format FMT       输出格式：text、csv或json（默认text）\n");
+    printf("  --output FILE      输出到文件（默认标准输出）\n");
+    printf("  --quick            快速检查：16 B..64 KiB，1次采样，每次1 ms\n");
+}
+
+/* 解析命令行，返回0成功，1表示已打印帮助，-1参数错误 */
+static int bench_parse_args(int argc, char *argv[], Bench_Options *opt) {
+    int i;
+
+    opt->impls = NULL;
+    opt->modes = NULL;
+    opt->min_size = 16;
+    opt->max_size = (size_t)64 << 20;
+    opt->reps = 5;
+    opt->min_time_ns = 20e6;
+    opt->format = BENCH_FORMAT_TEXT;
+    opt->output = NULL;
+
+    for (i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            bench_usage(argv[0]);
+            return 1;
+        } else if (strcmp(arg, "--quick") == 0) {
+            opt->max_size = (size_t)64 << 10;
+            opt->reps = 1;
+            opt->min_time_ns = 1e6;
+            continue;
+        }
+
+        if (val == NULL) {
+            fprintf(stderr, "选项%s缺少参数\n", arg);
+            return -1;
+        }
+        i++;
+        if (strcmp(arg, "--impl") == 0) {
+            opt->impls = val;
+        } else if (strcmp(arg, "--mode") == 0) {
+            opt->modes = val;
+        } else if (strcmp(arg, "--min-size") == 0) {
+            opt->min_size = bench_parse_size(val);
+        } else if (strcmp(arg, "--max-size") == 0) {
+            opt->max_size = bench_parse_size(val);
+        } else if (strcmp(arg, "--reps") == 0) {
+            opt->reps = (size_t)strtoul(val, NULL, 10);
+        } else if (strcmp(arg, "--min-time-ms") == 0) {
+            opt->min_time_ns = strtod(val, NULL) * 1e6;
+        } else if (strcmp(arg, "--format") == 0) {
+            if (strcmp(val, "text") == 0) {
+                opt->format = BENCH_FORMAT_TEXT;
+            } else if (strcmp(val, "csv") == 0) {
+                opt->format = BENCH_FORMAT_CSV;
+            } else if (strcmp(val, "json") == 0) {
+                opt->format = BENCH_FORMAT_JSON;
+            } else {
+                fprintf(stderr, "未知的输出格式: %s\n", val);
+                return -1;
+            }
+        } else if (strcmp(arg, "--output") == 0) {
+            opt->output = val;
         } else {
-            printf("一致\n");
+            fprintf(stderr, "未知选项: %s\n", arg);
+            return -1;
         }
     }
-    
-    /* 初始化解密上下文 */
-    sm4_set_decrypt_key(&basic_decrypt_ctx, key);
-    sm4_set_decrypt_key(&t_table_decrypt_ctx, key);
-    sm4_set_decrypt_key(&aesni_decrypt_ctx, key);
-    sm4_set_decrypt_key(&modern_decrypt_ctx, key);
-    
-    /* 解密测试 */
-    sm4_decrypt_block(&basic_decrypt_ctx, basic_output, basic_output);
-    sm4_decrypt_block(&t_table_decrypt_ctx, t_table_output, t_table_output);
-    
-    printf("\n解密后与原始明文比较:\n");
-    
-    printf("基本实现: ");
-    if (memcmp(basic_output, plaintext, 16) != 0) {
-        printf("不一致!\n");
-        passed = 0;
+
+    /* 长度取16的倍数 */
+    opt->min_size = opt->min_size < 16 ? 16 : opt->min_size / 16 * 16;
+    opt->max_size = opt->max_size / 16 * 16;
+    if (opt->reps == 0 || opt->reps > 64 || opt->max_size < opt->min_size) {
+        fprintf(stderr, "参数不合法\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* 输出开头：环境信息 */
+static void bench_print_header(FILE *fp, const Bench_Options *opt) {
+    SM4_CPU_Features f = sm4_get_cpu_features();
+
+    if (opt->format == BENCH_FORMAT_JSON) {
+        fprintf(fp, "{\n  \"best_implementation\": \"%s\",\n", sm4_get_best_implementation());
+        fprintf(fp, "  \"ghash_implementation\": \"%s\",\n", sm4_gcm_get_ghash_implementation());
+        fprintf(fp, "  \"cpu\": {\"aesni\": %d, \"avx2\": %d, \"avx512f\": %d, \"gfni\": %d, \"vaes\": %d, "
+                "\"vpclmulqdq\": %d},\n", f.has_aesni, f.has_avx2, f.has_avx512f, f.has_gfni, f.has_vaes,
+                f.has_vpclmulqdq);
+        fprintf(fp, "  \"timer\": \"%s\",\n  \"reps\": %zu,\n  \"results\": [", BENCH_HAVE_TSC ? "tsc" : "clock_gettime",
+                opt->reps);
+    } else if (opt->format == BENCH_FORMAT_CSV) {
+        fprintf(fp, "impl,mode,size,iterations,ns_per_byte,cycles_per_byte,mb_per_s\n");
     } else {
-        printf("一致\n");
+        fprintf(fp, "最佳SM4实现: %s，GHASH实现: %s，计时: %s，每个测点取%zu次采样的中位数\n",
+                sm4_get_best_implementation(), sm4_gcm_get_ghash_implementation(),
+                BENCH_HAVE_TSC ? "TSC + clock_gettime" : "clock_gettime", opt->reps);
+        fprintf(fp, "%-14s %-8s %10s %12s %12s %10s\n", "impl", "mode", "size", "cycles/B", "ns/B", "MB/s");
     }
-    
-    printf("T表实现: ");
-    if (memcmp(t_table_output, plaintext, 16) != 0) {
-        printf("不一致!\n");
-        passed = 0;
+}
+
+static void bench_print_result(FILE *fp, const Bench_Options *opt, const Bench_Result *res, int first) {
+    if (opt->format == BENCH_FORMAT_JSON) {
+        fprintf(fp, "%s\n    {\"impl\": \"%s\", \"mode\": \"%s\", \"size\": %zu, \"iterations\": %zu, "
+                "\"ns_per_byte\": %.4f, \"cycles_per_byte\": %.4f, \"mb_per_s\": %.2f}",
+                first ? "" : ",", res->impl, res->mode, res->size, res->iterations,
+                res->ns_per_byte, res->cycles_per_byte, res->mb_per_s);
+    } else if (opt->format == BENCH_FORMAT_CSV) {
+        fprintf(fp, "%s,%s,%zu,%zu,%.4f,%.4f,%.2f\n", res->impl, res->mode, res->size, res->iterations,
+                res->ns_per_byte, res->cycles_per_byte, res->mb_per_s);
     } else {
-        printf("一致\n");
+        fprintf(fp, "%-14s %-8s %10zu %12.2f %12.3f %10.1f\n", res->impl, res->mode, res->size,
+                res->cycles_per_byte, res->ns_per_byte, res->mb_per_s);
     }
-    
-    if (features.has_aesni) {
-        sm4_decrypt_block(&aesni_decrypt_ctx, aesni_output, aesni_output);
-        
-        printf("AESNI实现: ");
-        if (memcmp(aesni_output, plaintext, 16) != 0) {
-            printf("不一致!\n");
-            passed = 0;
-        } else {
-            printf("一致\n");
+    fflush(fp);
+}
+
+int main(int argc, char *argv[]) {
+    static uint8_t expected[BENCH_MODE_COUNT][BENCH_VERIFY_LEN];
+    Bench_Options opt;
+    Bench_State st;
+    Bench_Result res;
+    FILE *fp = stdout;
+    size_t alloc_len, i, m, len;
+    int first = 1;
+    int passed = 1;
+    int ret;
+
+    ret = bench_parse_args(argc, argv, &opt);
+    if (ret != 0) {
+        return ret > 0 ? 0 : 2;
+    }
+
+    alloc_len = opt.max_size > BENCH_VERIFY_LEN ? opt.max_size : BENCH_VERIFY_LEN;
+    st.in = (uint8_t *)malloc(alloc_len);
+    st.out = (uint8_t *)malloc(alloc_len);
+    if (st.in == NULL || st.out == NULL) {
+        fprintf(stderr, "内存不足\n");
+        free(st.in);
+        free(st.out);
+        return 2;
+    }
+    for (i = 0; i < alloc_len; i++) {
+        st.in[i] = (uint8_t)(i * 13 + 5);
+    }
+
+    if (opt.output != NULL) {
+        fp = fopen(opt.output, "w");
+        if (fp == NULL) {
+            fprintf(stderr, "无法打开输出文件: %s\n", opt.output);
+            free(st.in);
+            free(st.out);
+            return 2;
         }
     }
-    
-    if (features.has_gfni) {
-        sm4_decrypt_block(&modern_decrypt_ctx, modern_output, modern_output);
-        
-        printf("现代指令集实现: ");
-        if (memcmp(modern_output, plaintext, 16) != 0) {
-            printf("不一致!\n");
+
+    /* 基本实现的参考输出 */
+    sm4_force_implementation("basic");
+    bench_setup(&st);
+    for (m = 0; m < BENCH_MODE_COUNT; m++) {
+        BENCH_MODES[m].run(&st, BENCH_VERIFY_LEN);
+        memcpy(expected[m], st.out, BENCH_VERIFY_LEN);
+    }
+
+    sm4_force_implementation(NULL);
+    bench_print_header(fp, &opt);
+
+    for (i = 0; i < BENCH_IMPL_COUNT; i++) {
+        if (!bench_selected(opt.impls, BENCH_IMPLS[i])) {
+            continue;
+        }
+        if (sm4_force_implementation(BENCH_IMPLS[i]) != 0) {
+            fprintf(stderr, "%s: 当前主机不可用，跳过\n", BENCH_IMPLS[i]);
+            continue;
+        }
+        if (!bench_verify(BENCH_IMPLS[i], &st, expected)) {
             passed = 0;
-        } else {
-            printf("一致\n");
+            continue;
+        }
+
+        for (m = 0; m < BENCH_MODE_COUNT; m++) {
+            if (!bench_selected(opt.modes, BENCH_MODES[m].name)) {
+                continue;
+            }
+            for (len = opt.min_size; len <= opt.max_size; len *= 4) {
+                res.impl = BENCH_IMPLS[i];
+                res.mode = BENCH_MODES[m].name;
+                res.size = len;
+                bench_measure(&BENCH_MODES[m], &st, len, &opt, &res);
+                bench_print_result(fp, &opt, &res, first);
+                first = 0;
+            }
         }
     }
-    
-    return passed;
-}
+    sm4_force_implementation(NULL);
 
-int main(int argc, char *argv[]) {
-    int passed = 1;
-    SM4_CPU_Features features;
-    
-    /* 检测CPU特性 */
-    features = sm4_get_cpu_features();
-    printf("CPU特性检测:\n");
-    printf("  SSE2: %s\n", features.has_sse2 ? "支持" : "不支持");
-    printf("  AES-NI: %s\n", features.has_aesni ? "支持" : "不支持");
-    printf("  AVX: %s\n", features.has_avx ? "支持" : "不支持");
-    printf("  AVX2: %s\n", features.has_avx2 ? "支持" : "不支持");
-    printf("  AVX-512F: %s\n", features.has_avx512f ? "支持" : "不支持");
-    printf("  GFNI: %s\n", features.has_gfni ? "支持" : "不支持");
-    printf("  VAES: %s\n", features.has_vaes ? "支持" : "不支持");
-    printf("  VPCLMULQDQ: %s\n", features.has_vpclmulqdq ? "支持" : "不支持");
-    
-    printf("\n最佳SM4实现: %s\n\n", sm4_get_best_implementation());
-    
-    /* 验证不同实现的一致性 */
-    if (!verify_implementations()) {
-        passed = 0;
+    if (opt.format == BENCH_FORMAT_JSON) {
+        fprintf(fp, "\n  ]\n}\n");
     }
-    
-    /* 性能测试 */
-    benchmark_implementations();
-    
-    /* 输出总结果 */
-    printf("\n测试结果: %s\n", passed ? "全部通过" : "部分失败");
-    
+    if (fp != stdout) {
+        fclose(fp);
+    }
+
+    free(st.in);
+    free(st.out);
     return passed ? 0 : 1;
-}
\ No newline at end of file
+}
@@ -1,9 +1,21 @@
 #include "sm4.h"
 #include "sm4_gcm.h"
+#include "sm4_xts.h"
+#include "sm4_ccm.h"
+#include "sm4_cmac.h"
+#include "sm4_mb.h"
+#include "sm4_ocb.h"
+#include "sm4_aio.h"
+#include "sm4_container.h"
+#include "sm4_pool.h"
 #include "sm4_cpu_features.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
 
 /* 测试向量 */
 static const struct {
@@ -21,7 +33,7 @@ static const struct {
         /* 测试向量2 */
         {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F},
         {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-        {0x59, 0x52, 0x98, 0xC7, 0xC6, 0xFD, 0x27, 0x1F, 0x04, 0x02, 0xF8, 0x04, 0xC3, 0x3D, 0x3F, 0x66}
+        {0x1E, 0x96, 0x34, 0xB7, 0x70, 0xF9, 0xAE, 0xBA, 0xA9, 0x34, 0x4F, 0x5A, 0xFF, 0x9F, 0x82, 0xA3}
     }
 };
 
@@ -29,23 +41,111 @@ static const struct {
 static const struct {
     uint8_t key[16];
     uint8_t iv[12];
-    uint8_t aad[16];
-    uint8_t plaintext[16];
-    uint8_t ciphertext[16];
+    uint8_t aad[20];
+    uint8_t plaintext[64];
+    uint8_t ciphertext[64];
     uint8_t tag[16];
 } gcm_test_vectors[] = {
     {
-        /* 简化的测试向量 */
+        /* RFC 8998 附录A.1 */
+        {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10},
+        {0x00, 0x00, 0x12, 0x34, 0x56, 0x78, 0x00, 0x00, 0x00, 0x00, 0xAB, 0xCD},
+        {0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF,
+         0xAB, 0xAD, 0xDA, 0xD2},
+        {0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xBB, 0xBB, 0xBB, 0xBB, 0xBB, 0xBB, 0xBB, 0xBB,
+         0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xDD, 0xDD, 0xDD, 0xDD, 0xDD, 0xDD, 0xDD, 0xDD,
+         0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+         0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA},
+        {0x17, 0xF3, 0x99, 0xF0, 0x8C, 0x67, 0xD5, 0xEE, 0x19, 0xD0, 0xDC, 0x99, 0x69, 0xC4, 0xBB, 0x7D,
+         0x5F, 0xD4, 0x6F, 0xD3, 0x75, 0x64, 0x89, 0x06, 0x91, 0x57, 0xB2, 0x82, 0xBB, 0x20, 0x07, 0x35,
+         0xD8, 0x27, 0x10, 0xCA, 0x5C, 0x22, 0xF0, 0xCC, 0xFA, 0x7C, 0xBF, 0x93, 0xD4, 0x96, 0xAC, 0x15,
+         0xA5, 0x68, 0x34, 0xCB, 0xCF, 0x98, 0xC3, 0x97, 0xB4, 0x02, 0x4A, 0x26, 0x91, 0x23, 0x3B, 0x8D},
+        {0x83, 0xDE, 0x35, 0x41, 0xE4, 0xC2, 0xB5, 0x81, 0x77, 0xE0, 0x65, 0xA9, 0xBF, 0x7B, 0x62, 0xEC}
+    }
+};
+
+/* CTR测试向量 - draft-ribose-cfrg-sm4 A.2.5.1，明文与GCM测试向量相同 */
+static const struct {
+    uint8_t key[16];
+    uint8_t iv[16];
+    uint8_t ciphertext[64];
+} ctr_test_vectors[] = {
+    {
+        {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10},
         {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F},
-        {0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD, 0xDE, 0xCA, 0xF8, 0x88},
-        {0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF},
-        {0xD9, 0x31, 0x32, 0x25, 0xF8, 0x84, 0x06, 0xE5, 0xA5, 0x59, 0x09, 0xC5, 0xAF, 0xF5, 0x26, 0x9A},
-        {0x2A, 0x3D, 0xE8, 0x20, 0x5E, 0x15, 0x3A, 0x08, 0xA2, 0xAA, 0xFB, 0x62, 0xD6, 0x5D, 0xCC, 0x52},
-        {0x9A, 0x2D, 0x5B, 0xF3, 0x06, 0xA1, 0xE8, 0x76, 0x28, 0x3F, 0xC7, 0x7B, 0x05, 0x55, 0xB9, 0x7A}
+        {0xAC, 0x32, 0x36, 0xCB, 0x97, 0x0C, 0xC2, 0x07, 0x91, 0x36, 0x4C, 0x39, 0x5A, 0x13, 0x42, 0xD1,
+         0xA3, 0xCB, 0xC1, 0x87, 0x8C, 0x6F, 0x30, 0xCD, 0x07, 0x4C, 0xCE, 0x38, 0x5C, 0xDD, 0x70, 0xC7,
+         0xF2, 0x34, 0xBC, 0x0E, 0x24, 0xC1, 0x19, 0x80, 0xFD, 0x12, 0x86, 0x31, 0x0C, 0xE3, 0x7B, 0x92,
+         0x2A, 0x46, 0xB8, 0x94, 0xBE, 0xE4, 0xFE, 0xB7, 0x9A, 0x38, 0x22, 0x94, 0x0C, 0x93, 0x54, 0x05}
     }
 };
 
 /* 打印十六进制数据 */
+/* XTS测试向量（IEEE P1619调整值，最后一块为部分块） */
+static const struct {
+    uint8_t key[32];
+    uint8_t tweak[16];
+    uint8_t plaintext[56];
+    uint8_t ciphertext[56];
+} xts_test_vectors[] = {
+    {
+        {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C,
+         0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F},
+        {0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF},
+        {0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+         0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+         0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+         0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17},
+        {0xE9, 0x53, 0x82, 0x51, 0xC7, 0x1D, 0x7B, 0x80, 0xBB, 0xE4, 0x48, 0x3F, 0xEF, 0x49, 0x7B, 0xD1,
+         0xB3, 0xDB, 0x1A, 0x3E, 0x60, 0x40, 0x8C, 0x57, 0x5D, 0x63, 0xFF, 0x7D, 0xB3, 0x9F, 0x83, 0x26,
+         0x08, 0x69, 0xF9, 0xE2, 0x58, 0x5F, 0xEC, 0x9F, 0x0B, 0x86, 0x3B, 0xF8, 0xFD, 0x78, 0x4B, 0x86,
+         0x27, 0xD1, 0x6C, 0x0D, 0xB6, 0xD2, 0xCF, 0xC7}
+    }
+};
+
+/* CCM测试向量（RFC 8998 附录A.2，密钥、随机数、AAD和明文与GCM向量相同） */
+static const struct {
+    uint8_t ciphertext[64];
+    uint8_t tag[16];
+} ccm_test_vectors[] = {
+    {
+        {0x48, 0xAF, 0x93, 0x50, 0x1F, 0xA6, 0x2A, 0xDB, 0xCD, 0x41, 0x4C, 0xCE, 0x60, 0x34, 0xD8, 0x95,
+         0xDD, 0xA1, 0xBF, 0x8F, 0x13, 0x2F, 0x04, 0x20, 0x98, 0x66, 0x15, 0x72, 0xE7, 0x48, 0x30, 0x94,
+         0xFD, 0x12, 0xE5, 0x18, 0xCE, 0x06, 0x2C, 0x98, 0xAC, 0xEE, 0x28, 0xD9, 0x5D, 0xF4, 0x41, 0x6B,
+         0xED, 0x31, 0xA2, 0xF0, 0x44, 0x76, 0xC1, 0x8B, 0xB4, 0x0C, 0x84, 0xA7, 0x4B, 0x97, 0xDC, 0x5B},
+        {0x16, 0x84, 0x2D, 0x4F, 0xA1, 0x86, 0xF5, 0x6A, 0xB3, 0x32, 0x56, 0x97, 0x1F, 0xA1, 0x10, 0xF4}
+    }
+};
+
+/* OCB测试向量（密钥同GCM向量，随机数BBAA99887766554433221101，AAD和明文都是0, 1, 2, ...，按RFC 7253附录A的格式） */
+static const struct {
+    size_t len;
+    uint8_t ciphertext[40];
+    uint8_t tag[16];
+} ocb_test_vectors[] = {
+    {0, {0},
+     {0xFA, 0x22, 0x4E, 0x4B, 0xAD, 0x13, 0x50, 0x14, 0x7F, 0xF8, 0x76, 0x3E, 0xFA, 0x8B, 0xED, 0x4A}},
+    {8, {0x6F, 0x4A, 0x13, 0xB7, 0x6B, 0x5C, 0x68, 0xD3},
+     {0x5C, 0x53, 0x22, 0xD3, 0xF5, 0xAA, 0xA1, 0x0F, 0xB8, 0x11, 0xB3, 0x41, 0x05, 0xD5, 0x6D, 0x73}},
+    {16, {0xCD, 0x5F, 0xDA, 0x9F, 0xC2, 0x3F, 0x8A, 0xB7, 0x96, 0xE8, 0x03, 0x09, 0xE5, 0xDD, 0x64, 0x38},
+     {0xBE, 0x55, 0x5E, 0x29, 0xA4, 0x81, 0xDE, 0x2B, 0x92, 0x7F, 0xC3, 0x04, 0xFD, 0x4A, 0xBF, 0x08}},
+    {40, {0xCD, 0x5F, 0xDA, 0x9F, 0xC2, 0x3F, 0x8A, 0xB7, 0x96, 0xE8, 0x03, 0x09, 0xE5, 0xDD, 0x64, 0x38,
+          0xD1, 0xCC, 0x96, 0xAC, 0xD8, 0x32, 0x2F, 0xB2, 0x00, 0x63, 0x48, 0x06, 0x0D, 0xB0, 0x61, 0x55,
+          0xFA, 0x83, 0x11, 0x20, 0xA3, 0x72, 0x8F, 0x95},
+     {0xED, 0xDE, 0xA4, 0xE3, 0x76, 0x30, 0xC4, 0x9F, 0xF8, 0x07, 0xF9, 0x51, 0xBE, 0xA3, 0x94, 0xFA}}
+};
+
+/* CMAC测试向量（密钥同GCM向量，消息为0, 1, 2, ...） */
+static const struct {
+    size_t len;
+    uint8_t mac[16];
+} cmac_test_vectors[] = {
+    {0, {0x29, 0xE1, 0x54, 0x32, 0x2E, 0x5C, 0x7B, 0xD8, 0xEE, 0x6A, 0x25, 0xBA, 0x54, 0x9B, 0x24, 0xBC}},
+    {16, {0x21, 0x53, 0xE9, 0xAA, 0x9D, 0xB6, 0x82, 0x53, 0xD0, 0x67, 0x75, 0xC0, 0x34, 0x83, 0xB3, 0xCC}},
+    {40, {0x34, 0x55, 0x6C, 0x65, 0xE5, 0x1B, 0x9A, 0xD7, 0x47, 0x14, 0x08, 0x43, 0xD1, 0xC2, 0x03, 0x6C}},
+    {64, {0xC7, 0x98, 0x9B, 0x59, 0x3D, 0x5C, 0xBA, 0x8D, 0x9C, 0xB2, 0xCE, 0xDC, 0x51, 0x5B, 0x4E, 0x88}}
+};
+
 static void print_hex(const char *label, const uint8_t *data, size_t len) {
     printf("%s: ", label);
     for (size_t i = 0; i < len; i++) {
@@ -62,6 +162,11 @@ static int test_sm4_basic(void) {
     
     printf("测试基本SM4实现...\n");
     
+    if (sm4_force_implementation("basic") != 0) {
+        printf("无法切换到基本实现!\n");
+        return 0;
+    }
+    
     for (size_t i = 0; i < sizeof(sm4_test_vectors) / sizeof(sm4_test_vectors[0]); i++) {
         printf("\n测试向量 %zu:\n", i + 1);
         
@@ -95,6 +200,7 @@ static int test_sm4_basic(void) {
         }
     }
     
+    sm4_force_implementation(NULL);
     return passed;
 }
 
@@ -106,6 +212,11 @@ static int test_sm4_t_table(void) {
     
     printf("\n测试T表SM4实现...\n");
     
+    if (sm4_force_implementation("t_table") != 0) {
+        printf("无法切换到T表实现!\n");
+        return 0;
+    }
+    
     for (size_t i = 0; i < sizeof(sm4_test_vectors) / sizeof(sm4_test_vectors[0]); i++) {
         printf("\n测试向量 %zu:\n", i + 1);
         
@@ -132,14 +243,145 @@ static int test_sm4_t_table(void) {
         }
     }
     
+    sm4_force_implementation(NULL);
+    return passed;
+}
+
+/* 测试运行时调度：每个可用后端都必须与基本实现逐块一致 */
+static int test_sm4_dispatch(void) {
+    static const char *impl_names[] = {"basic", "t_table", "bitslice", "bitslice_avx2", "aesni", "vaes", "vaes_avx512", "gfni"};
+    SM4_Context ctx;
+    uint8_t input[37 * 16];
+    uint8_t expected[37 * 16];
+    uint8_t output[37 * 16];
+    uint8_t gcm_expected[37 * 16 - 7];
+    uint8_t gcm_output[37 * 16 - 7];
+    static uint8_t gcm_long_input[133 * 16 + 9];
+    static uint8_t gcm_long_expected[133 * 16 + 9];
+    static uint8_t gcm_long_output[133 * 16 + 9];
+    uint8_t tag_expected[16];
+    uint8_t long_tag_expected[16];
+    uint8_t tag[16];
+    uint8_t cbc_expected[37 * 16];
+    uint8_t iv[16];
+    int passed = 1;
+    
+    printf("\n测试运行时调度...\n");
+    printf("当前实现: %s\n", sm4_get_current_implementation());
+    
+    for (size_t i = 0; i < sizeof(input); i++) {
+        input[i] = (uint8_t)(i * 13 + 5);
+    }
+    
+    sm4_force_implementation("basic");
+    sm4_set_encrypt_key(&ctx, sm4_test_vectors[0].key);
+    sm4_encrypt_blocks(&ctx, expected, input, sizeof(input) / 16);
+    memcpy(iv, ctr_test_vectors[0].iv, sizeof(iv));
+    sm4_cbc_encrypt(&ctx, cbc_expected, input, sizeof(input), iv);
+    
+    /* GCM长消息跨越多个密钥流批次，且以不完整块结尾 */
+    sm4_gcm_encrypt_and_tag(sm4_test_vectors[0].key, gcm_test_vectors[0].iv, sizeof(gcm_test_vectors[0].iv),
+                            NULL, 0, input, sizeof(gcm_expected), gcm_expected, tag_expected, sizeof(tag_expected));
+    
+    /* 更长的GCM消息：缝合内核连续处理多步（加密时GHASH流水线跨步），再走尾部 */
+    for (size_t i = 0; i < sizeof(gcm_long_input); i++) {
+        gcm_long_input[i] = (uint8_t)(i * 7 + 3);
+    }
+    sm4_gcm_encrypt_and_tag(sm4_test_vectors[0].key, gcm_test_vectors[0].iv, sizeof(gcm_test_vectors[0].iv),
+                            input, 20, gcm_long_input, sizeof(gcm_long_input), gcm_long_expected,
+                            long_tag_expected, sizeof(long_tag_expected));
+    
+    for (size_t i = 0; i < sizeof(impl_names) / sizeof(impl_names[0]); i++) {
+        if (sm4_force_implementation(impl_names[i]) != 0) {
+            printf("%s: 当前主机不可用（CPU不支持或未通过自检），跳过\n", impl_names[i]);
+            continue;
+        }
+        
+        sm4_set_encrypt_key(&ctx, sm4_test_vectors[0].key);
+        sm4_encrypt_blocks(&ctx, output, input, sizeof(input) / 16);
+        if (memcmp(output, expected, sizeof(output)) != 0) {
+            printf("%s: 多块加密与基本实现不一致!\n", impl_names[i]);
+            passed = 0;
+            continue;
+        }
+        
+        /* 批量密钥扩展（输入当作19个密钥），与逐个扩展一致 */
+        {
+            SM4_Context batch[19];
+            SM4_Context single;
+            
+            sm4_set_encrypt_keys_batch(batch, input, 19);
+            for (size_t k = 0; k < 19; k++) {
+                sm4_set_encrypt_key(&single, input + k * 16);
+                if (memcmp(batch[k].rk, single.rk, sizeof(single.rk)) != 0) {
+                    printf("%s: 批量密钥扩展与逐个扩展不一致!\n", impl_names[i]);
+                    passed = 0;
+                    break;
+                }
+            }
+        }
+        
+        sm4_set_decrypt_key(&ctx, sm4_test_vectors[0].key);
+        sm4_decrypt_blocks(&ctx, output, expected, sizeof(expected) / 16);
+        if (memcmp(output, input, sizeof(output)) != 0) {
+            printf("%s: 多块解密失败!\n", impl_names[i]);
+            passed = 0;
+            continue;
+        }
+        
+        /* CBC原地解密，跨越多个批次 */
+        memcpy(output, cbc_expected, sizeof(output));
+        memcpy(iv, ctr_test_vectors[0].iv, sizeof(iv));
+        sm4_cbc_decrypt(&ctx, output, output, sizeof(output), iv);
+        if (memcmp(output, input, sizeof(output)) != 0) {
+            printf("%s: CBC解密失败!\n", impl_names[i]);
+            passed = 0;
+            continue;
+        }
+        
+        sm4_gcm_encrypt_and_tag(sm4_test_vectors[0].key, gcm_test_vectors[0].iv, sizeof(gcm_test_vectors[0].iv),
+                                NULL, 0, input, sizeof(gcm_output), gcm_output, tag, sizeof(tag));
+        if (memcmp(gcm_output, gcm_expected, sizeof(gcm_output)) != 0 || memcmp(tag, tag_expected, sizeof(tag)) != 0) {
+            printf("%s: GCM长消息结果与基本实现不一致!\n", impl_names[i]);
+            passed = 0;
+            continue;
+        }
+        
+        sm4_gcm_encrypt_and_tag(sm4_test_vectors[0].key, gcm_test_vectors[0].iv, sizeof(gcm_test_vectors[0].iv),
+                                input, 20, gcm_long_input, sizeof(gcm_long_input), gcm_long_output, tag, sizeof(tag));
+        if (memcmp(gcm_long_output, gcm_long_expected, sizeof(gcm_long_output)) != 0 ||
+            memcmp(tag, long_tag_expected, sizeof(tag)) != 0 ||
+            sm4_gcm_decrypt_and_verify(sm4_test_vectors[0].key, gcm_test_vectors[0].iv, sizeof(gcm_test_vectors[0].iv),
+                                       input, 20, gcm_long_output, sizeof(gcm_long_output), tag, sizeof(tag),
+                                       gcm_long_output) != 0 ||
+            memcmp(gcm_long_output, gcm_long_input, sizeof(gcm_long_output)) != 0) {
+            printf("%s: GCM多步消息或原地解密失败!\n", impl_names[i]);
+            passed = 0;
+            continue;
+        }
+        
+        printf("%s: 测试通过!\n", impl_names[i]);
+    }
+    
+    if (sm4_force_implementation("no_such_impl") == 0) {
+        printf("未知实现名称未被拒绝!\n");
+        passed = 0;
+    }
+    
+    sm4_force_implementation(NULL);
+    if (strcmp(sm4_get_current_implementation(), sm4_get_best_implementation()) != 0) {
+        printf("恢复自动选择失败!\n");
+        passed = 0;
+    }
+    
     return passed;
 }
 
 /* 测试SM4-GCM实现 */
 static int test_sm4_gcm(void) {
-    uint8_t ciphertext[16];
+    uint8_t ciphertext[64];
     uint8_t tag[16];
-    uint8_t decrypted[16];
+    uint8_t decrypted[64];
     int passed = 1;
     
     printf("\n测试SM4-GCM实现...\n");
@@ -158,15 +400,16 @@ static int test_sm4_gcm(void) {
         
         print_hex("密钥", gcm_test_vectors[i].key, 16);
         print_hex("IV", gcm_test_vectors[i].iv, 12);
-        print_hex("AAD", gcm_test_vectors[i].aad, 16);
-        print_hex("明文", gcm_test_vectors[i].plaintext, 16);
-        print_hex("期望密文", gcm_test_vectors[i].ciphertext, 16);
-        print_hex("实际密文", ciphertext, 16);
+        print_hex("AAD", gcm_test_vectors[i].aad, sizeof(gcm_test_vectors[i].aad));
+        print_hex("明文", gcm_test_vectors[i].plaintext, sizeof(gcm_test_vectors[i].plaintext));
+        print_hex("期望密文", gcm_test_vectors[i].ciphertext, sizeof(ciphertext));
+        print_hex("实际密文", ciphertext, sizeof(ciphertext));
         print_hex("期望标签", gcm_test_vectors[i].tag, 16);
         print_hex("实际标签", tag, 16);
         
         /* 验证密文和标签 */
-        if (memcmp(ciphertext, gcm_test_vectors[i].ciphertext, 16) != 0) {
+        if (memcmp(ciphertext, gcm_test_vectors[i].ciphertext, sizeof(ciphertext)) != 0 ||
+            memcmp(tag, gcm_test_vectors[i].tag, sizeof(tag)) != 0) {
             printf("GCM加密测试失败!\n");
             passed = 0;
         } else {
@@ -183,9 +426,9 @@ static int test_sm4_gcm(void) {
             decrypted
         );
         
-        print_hex("解密结果", decrypted, 16);
+        print_hex("解密结果", decrypted, sizeof(decrypted));
         
-        if (result != 0 || memcmp(decrypted, gcm_test_vectors[i].plaintext, 16) != 0) {
+        if (result != 0 || memcmp(decrypted, gcm_test_vectors[i].plaintext, sizeof(decrypted)) != 0) {
             printf("GCM解密和验证测试失败!\n");
             passed = 0;
         } else {
@@ -193,37 +436,1535 @@ static int test_sm4_gcm(void) {
         }
     }
     
+    /*
+     * 长消息和非96位IV：AAD和密文都跨越多个8块聚合，参考标签由逐位实现的GHASH独立计算。
+     * 每个可用的GHASH实现都要得到同样的结果。
+     */
+    {
+        static const char *ghash_names[] = {"generic", "table4", "table8", "pclmul", "vpclmul"};
+        static const uint8_t expected_tag[16] = {
+            0x58, 0xEC, 0x06, 0x52, 0x29, 0xFA, 0x10, 0x70, 0x3D, 0xDC, 0x53, 0x09, 0xB9, 0xD8, 0xA1, 0xC5
+        };
+        uint8_t iv[60];
+        uint8_t aad[300];
+        uint8_t input[1000];
+        uint8_t output[1000];
+        uint8_t restored[1000];
+        size_t j;
+        
+        for (j = 0; j < sizeof(iv); j++) {
+            iv[j] = (uint8_t)(j * 17 + 5);
+        }
+        for (j = 0; j < sizeof(aad); j++) {
+            aad[j] = (uint8_t)(j * 3 + 1);
+        }
+        for (j = 0; j < sizeof(input); j++) {
+            input[j] = (uint8_t)(j * 11 + 2);
+        }
+        
+        printf("\n当前GHASH实现: %s\n", sm4_gcm_get_ghash_implementation());
+        
+        for (size_t i = 0; i < sizeof(ghash_names) / sizeof(ghash_names[0]); i++) {
+            if (sm4_gcm_force_ghash_implementation(ghash_names[i]) != 0) {
+                printf("GHASH %s: 当前主机或构建配置不可用，跳过\n", ghash_names[i]);
+                continue;
+            }
+            
+            sm4_gcm_encrypt_and_tag(gcm_test_vectors[0].key, iv, sizeof(iv), aad, sizeof(aad),
+                                    input, sizeof(input), output, tag, sizeof(tag));
+            if (memcmp(tag, expected_tag, sizeof(tag)) != 0 ||
+                sm4_gcm_decrypt_and_verify(gcm_test_vectors[0].key, iv, sizeof(iv), aad, sizeof(aad),
+                                           output, sizeof(output), tag, sizeof(tag), restored) != 0 ||
+                memcmp(restored, input, sizeof(input)) != 0) {
+                print_hex("长消息标签", tag, sizeof(tag));
+                printf("GHASH %s: GCM长消息测试失败!\n", ghash_names[i]);
+                passed = 0;
+            } else {
+                printf("GHASH %s: GCM长消息测试通过!\n", ghash_names[i]);
+            }
+        }
+        
+        if (sm4_gcm_force_ghash_implementation("no_such_ghash") == 0) {
+            printf("未知GHASH实现名称未被拒绝!\n");
+            passed = 0;
+        }
+        sm4_gcm_force_ghash_implementation(NULL);
+    }
+    
+    /* 流式接口：AAD和密文分成任意长度的多次调用，结果必须与一次处理相同 */
+    {
+        static const size_t pieces[] = {1, 15, 16, 17, 3, 31, 100, 513, 0, 48, 7};
+        SM4_GCM_Context ctx;
+        uint8_t iv[12];
+        uint8_t aad[77];
+        uint8_t input[2000];
+        uint8_t expected[2000];
+        uint8_t output[2000];
+        uint8_t expected_tag[16];
+        size_t off, k, n;
+        
+        memcpy(iv, gcm_test_vectors[0].iv, sizeof(iv));
+        for (off = 0; off < sizeof(aad); off++) {
+            aad[off] = (uint8_t)(off * 5 + 9);
+        }
+        for (off = 0; off < sizeof(input); off++) {
+            input[off] = (uint8_t)(off * 3 + 7);
+        }
+        sm4_gcm_encrypt_and_tag(gcm_test_vectors[0].key, iv, sizeof(iv), aad, sizeof(aad),
+                                input, sizeof(input), expected, expected_tag, sizeof(expected_tag));
+        
+        /* 分段加密 */
+        sm4_gcm_init(&ctx, gcm_test_vectors[0].key, iv, sizeof(iv));
+        sm4_gcm_aad(&ctx, aad, 10);
+        sm4_gcm_aad(&ctx, aad + 10, 0);
+        sm4_gcm_aad(&ctx, aad + 10, 23);
+        sm4_gcm_aad(&ctx, aad + 33, sizeof(aad) - 33);
+        for (off = 0, k = 0; off < sizeof(input); off += n, k++) {
+            n = pieces[k % (sizeof(pieces) / sizeof(pieces[0]))];
+            if (n > sizeof(input) - off) {
+                n = sizeof(input) - off;
+            }
+            sm4_gcm_encrypt(&ctx, output + off, input + off, n);
+        }
+        if (sm4_gcm_aad(&ctx, aad, 1) == 0) {
+            printf("开始加密后追加AAD未被拒绝!\n");
+            passed = 0;
+        }
+        sm4_gcm_finish(&ctx, tag, sizeof(tag));
+        if (memcmp(output, expected, sizeof(output)) != 0 || memcmp(tag, expected_tag, sizeof(tag)) != 0) {
+            printf("GCM分段加密结果与一次加密不一致!\n");
+            passed = 0;
+        }
+        
+        /* 分段原地解密 */
+        sm4_gcm_init(&ctx, gcm_test_vectors[0].key, iv, sizeof(iv));
+        sm4_gcm_aad(&ctx, aad, 40);
+        sm4_gcm_aad(&ctx, aad + 40, sizeof(aad) - 40);
+        for (off = 0, k = 3; off < sizeof(output); off += n, k++) {
+            n = pieces[k % (sizeof(pieces) / sizeof(pieces[0]))] * 3;
+            if (n > sizeof(output) - off) {
+                n = sizeof(output) - off;
+            }
+            sm4_gcm_decrypt(&ctx, output + off, output + off, n);
+        }
+        sm4_gcm_finish(&ctx, tag, sizeof(tag));
+        if (memcmp(output, input, sizeof(output)) != 0 || memcmp(tag, expected_tag, sizeof(tag)) != 0) {
+            printf("GCM分段解密失败!\n");
+            passed = 0;
+        }
+        
+        /* 只有AAD、且以不完整块结束（GMAC） */
+        sm4_gcm_encrypt_and_tag(gcm_test_vectors[0].key, iv, sizeof(iv), aad, sizeof(aad),
+                                NULL, 0, NULL, expected_tag, sizeof(expected_tag));
+        sm4_gcm_init(&ctx, gcm_test_vectors[0].key, iv, sizeof(iv));
+        sm4_gcm_aad(&ctx, aad, 5);
+        sm4_gcm_aad(&ctx, aad + 5, sizeof(aad) - 5);
+        sm4_gcm_finish(&ctx, tag, sizeof(tag));
+        if (memcmp(tag, expected_tag, sizeof(tag)) != 0) {
+            printf("GCM分段AAD结果与一次处理不一致!\n");
+            passed = 0;
+        }
+        
+        if (passed) {
+            printf("GCM流式接口测试通过!\n");
+        }
+    }
+    
+    /* 多线程GCM：分成多段并行，密文和标签必须与单线程逐位相同 */
+    {
+        static uint8_t input[3 * 256 * 1024 + 100005];
+        static uint8_t expected[sizeof(input)];
+        static uint8_t output[sizeof(input)];
+        static const size_t thread_counts[] = {0, 1, 2, 3, 7};
+        uint8_t expected_tag[16];
+        uint8_t aad[29];
+        size_t j;
+        
+        for (j = 0; j < sizeof(input); j++) {
+            input[j] = (uint8_t)(j * 31 + (j >> 11));
+        }
+        for (j = 0; j < sizeof(aad); j++) {
+            aad[j] = (uint8_t)(j + 100);
+        }
+        sm4_gcm_encrypt_and_tag(gcm_test_vectors[0].key, gcm_test_vectors[0].iv, sizeof(gcm_test_vectors[0].iv),
+                                aad, sizeof(aad), input, sizeof(input), expected, expected_tag, sizeof(expected_tag));
+        
+        for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+            sm4_gcm_encrypt_parallel(gcm_test_vectors[0].key, gcm_test_vectors[0].iv, sizeof(gcm_test_vectors[0].iv),
+                                     aad, sizeof(aad), input, sizeof(input), output, tag, sizeof(tag),
+                                     thread_counts[i]);
+            if (memcmp(output, expected, sizeof(output)) != 0 || memcmp(tag, expected_tag, sizeof(tag)) != 0 ||
+                sm4_gcm_decrypt_parallel(gcm_test_vectors[0].key, gcm_test_vectors[0].iv,
+                                         sizeof(gcm_test_vectors[0].iv), aad, sizeof(aad), output, sizeof(output),
+                                         tag, sizeof(tag), output, thread_counts[i]) != 0 ||
+                memcmp(output, input, sizeof(output)) != 0) {
+                printf("GCM多线程（%zu线程）结果与单线程不一致!\n", thread_counts[i]);
+                passed = 0;
+            }
+        }
+        
+        /* 篡改密文必须验证失败并清零输出 */
+        memcpy(output, expected, sizeof(output));
+        output[sizeof(output) / 2] ^= 1;
+        if (sm4_gcm_decrypt_parallel(gcm_test_vectors[0].key, gcm_test_vectors[0].iv, sizeof(gcm_test_vectors[0].iv),
+                                     aad, sizeof(aad), output, sizeof(output), expected_tag, sizeof(expected_tag),
+                                     output, 4) == 0 || output[0] != 0) {
+            printf("GCM多线程解密未检测到篡改!\n");
+            passed = 0;
+        } else {
+            printf("GCM多线程测试通过!\n");
+        }
+    }
+    
+    /* 密钥缓存：结果与sm4_gcm_init()相同，按最近最少使用淘汰 */
+    {
+        SM4_GCM_Key_Cache *cache = sm4_gcm_key_cache_create(2);
+        SM4_GCM_Context ctx;
+        uint8_t keys[3][16];
+        uint8_t expected_tag[16];
+        uint8_t expected[64];
+        uint8_t output[64];
+        uint64_t hits, misses;
+        static const int order[] = {0, 1, 0, 2, 1, 0, 1};
+        static const int expect_hit[] = {0, 0, 1, 0, 0, 0, 1};
+        int ok = cache != NULL;
+        
+        for (size_t k = 0; k < 3; k++) {
+            memcpy(keys[k], gcm_test_vectors[0].key, 16);
+            keys[k][15] ^= (uint8_t)k;
+        }
+        
+        /* 容量为2：0 1 0命中，2淘汰1，1淘汰0，0淘汰2，最后1命中 */
+        for (size_t k = 0; ok && k < sizeof(order) / sizeof(order[0]); k++) {
+            uint64_t before;
+            
+            sm4_gcm_encrypt_and_tag(keys[order[k]], gcm_test_vectors[0].iv, 12, NULL, 0,
+                                    gcm_test_vectors[0].plaintext, sizeof(output), expected, expected_tag, 16);
+            sm4_gcm_key_cache_stats(cache, &before, NULL);
+            sm4_gcm_init_cached(cache, &ctx, keys[order[k]], gcm_test_vectors[0].iv, 12);
+            sm4_gcm_encrypt(&ctx, output, gcm_test_vectors[0].plaintext, sizeof(output));
+            sm4_gcm_finish(&ctx, tag, sizeof(tag));
+            sm4_gcm_key_cache_stats(cache, &hits, NULL);
+            if (memcmp(output, expected, sizeof(output)) != 0 || memcmp(tag, expected_tag, 16) != 0 ||
+                (int)(hits - before) != expect_hit[k]) {
+                ok = 0;
+            }
+        }
+        
+        /* 预热后两个密钥都命中 */
+        if (ok) {
+            sm4_gcm_key_cache_preload(cache, keys[0], 2);
+            sm4_gcm_key_cache_stats(cache, &hits, &misses);
+            sm4_gcm_init_cached(cache, &ctx, keys[0], gcm_test_vectors[0].iv, 12);
+            sm4_gcm_init_cached(cache, &ctx, keys[1], gcm_test_vectors[0].iv, 12);
+            sm4_gcm_encrypt(&ctx, output, gcm_test_vectors[0].plaintext, sizeof(output));
+            sm4_gcm_finish(&ctx, tag, sizeof(tag));
+            sm4_gcm_encrypt_and_tag(keys[1], gcm_test_vectors[0].iv, 12, NULL, 0,
+                                    gcm_test_vectors[0].plaintext, sizeof(output), expected, expected_tag, 16);
+            uint64_t hits2, misses2;
+            sm4_gcm_key_cache_stats(cache, &hits2, &misses2);
+            ok = hits2 == hits + 2 && misses2 == misses &&
+                 memcmp(output, expected, sizeof(output)) == 0 && memcmp(tag, expected_tag, 16) == 0;
+        }
+        
+        sm4_gcm_key_cache_destroy(cache);
+        if (!ok) {
+            printf("GCM密钥缓存测试失败!\n");
+            passed = 0;
+        } else {
+            printf("GCM密钥缓存测试通过!\n");
+        }
+    }
+    
     return passed;
 }
 
-int main(int argc, char *argv[]) {
+/* 测试SM4-CTR实现 */
+static int test_sm4_ctr(void) {
+    static const size_t pieces[] = {1, 15, 17, 3, 16, 64, 5, 200, 31, 33};
+    SM4_CTR_Context ctx;
+    uint8_t output[64];
+    uint8_t input[1000];
+    uint8_t expected[1000];
+    uint8_t streamed[1000];
+    uint8_t block[16];
+    size_t pos, i;
     int passed = 1;
-    SM4_CPU_Features features;
     
-    /* 检测CPU特性 */
-    features = sm4_get_cpu_features();
-    printf("CPU特性检测:\n");
-    printf("  SSE2: %s\n", features.has_sse2 ? "支持" : "不支持");
-    printf("  AES-NI: %s\n", features.has_aesni ? "支持" : "不支持");
-    printf("  AVX: %s\n", features.has_avx ? "支持" : "不支持");
-    printf("  AVX2: %s\n", features.has_avx2 ? "支持" : "不支持");
-    printf("  AVX-512F: %s\n", features.has_avx512f ? "支持" : "不支持");
-    printf("  GFNI: %s\n", features.has_gfni ? "支持" : "不支持");
-    printf("  VAES: %s\n", features.has_vaes ? "支持" : "不支持");
-    printf("  VPCLMULQDQ: %s\n", features.has_vpclmulqdq ? "支持" : "不支持");
+    printf("\n测试SM4-CTR实现...\n");
     
-    printf("\n最佳SM4实现: %s\n\n", sm4_get_best_implementation());
+    /* 标准向量 */
+    sm4_ctr_init(&ctx, ctr_test_vectors[0].key, ctr_test_vectors[0].iv);
+    sm4_ctr_encrypt(&ctx, output, gcm_test_vectors[0].plaintext, sizeof(output));
+    print_hex("期望密文", ctr_test_vectors[0].ciphertext, sizeof(output));
+    print_hex("实际密文", output, sizeof(output));
+    if (memcmp(output, ctr_test_vectors[0].ciphertext, sizeof(output)) != 0) {
+        printf("CTR加密测试失败!\n");
+        passed = 0;
+    }
     
-    /* 运行测试 */
-    if (!test_sm4_basic()) {
+    sm4_ctr_init(&ctx, ctr_test_vectors[0].key, ctr_test_vectors[0].iv);
+    sm4_ctr_decrypt(&ctx, output, output, sizeof(output));
+    if (memcmp(output, gcm_test_vectors[0].plaintext, sizeof(output)) != 0) {
+        printf("CTR解密测试失败!\n");
         passed = 0;
     }
     
-    if (!test_sm4_t_table()) {
+    /* 任意长度分段调用的结果必须与一次调用相同 */
+    for (i = 0; i < sizeof(input); i++) {
+        input[i] = (uint8_t)(i * 31 + 7);
+    }
+    sm4_ctr_init(&ctx, ctr_test_vectors[0].key, ctr_test_vectors[0].iv);
+    sm4_ctr_encrypt(&ctx, expected, input, sizeof(input));
+    
+    sm4_ctr_init(&ctx, ctr_test_vectors[0].key, ctr_test_vectors[0].iv);
+    for (pos = 0, i = 0; pos < sizeof(input); i++) {
+        size_t n = pieces[i % (sizeof(pieces) / sizeof(pieces[0]))];
+        if (n > sizeof(input) - pos) {
+            n = sizeof(input) - pos;
+        }
+        sm4_ctr_encrypt(&ctx, streamed + pos, input + pos, n);
+        pos += n;
+    }
+    if (memcmp(streamed, expected, sizeof(expected)) != 0) {
+        printf("CTR分段加密结果与一次加密不一致!\n");
         passed = 0;
     }
     
-    if (!test_sm4_gcm()) {
+    /* 随机访问：从任意偏移开始解密 */
+    sm4_ctr_seek(&ctx, 333);
+    sm4_ctr_decrypt(&ctx, streamed, expected + 333, 100);
+    if (memcmp(streamed, input + 333, 100) != 0) {
+        printf("CTR定位后解密失败!\n");
+        passed = 0;
+    }
+    
+    /* 计数器低64位溢出时向高64位进位 */
+    {
+        uint8_t iv[16] = {0};
+        uint8_t zero[32] = {0};
+        SM4_Context cipher;
+        
+        memset(iv + 8, 0xFF, 8);
+        sm4_ctr_init(&ctx, ctr_test_vectors[0].key, iv);
+        sm4_ctr_encrypt(&ctx, output, zero, sizeof(zero));
+        
+        memset(iv, 0, sizeof(iv));
+        iv[7] = 1;
+        sm4_set_encrypt_key(&cipher, ctr_test_vectors[0].key);
+        sm4_encrypt_block(&cipher, block, iv);
+        if (memcmp(output + 16, block, 16) != 0) {
+            printf("CTR计数器进位错误!\n");
+            passed = 0;
+        }
+    }
+    
+    printf("CTR测试%s!\n", passed ? "通过" : "失败");
+    return passed;
+}
+
+/* 测试SM4-CBC实现 */
+static int test_sm4_cbc(void) {
+    static const size_t stream_len[] = {16 * 21, 0, 16, 16 * 40, 16 * 3, 16 * 17, 16 * 40, 16 * 5,
+                                        16 * 2, 16 * 33, 16, 16 * 9, 16 * 12, 16 * 40, 16 * 4, 16 * 7,
+                                        16 * 18, 16 * 6};
+    enum { STREAMS = sizeof(stream_len) / sizeof(stream_len[0]), MAX_LEN = 16 * 40 };
+    SM4_Context enc_ctx, dec_ctx;
+    uint8_t input[MAX_LEN];
+    uint8_t expected[MAX_LEN];
+    uint8_t output[MAX_LEN];
+    uint8_t block[16];
+    uint8_t iv[16];
+    uint8_t multi_out[STREAMS][MAX_LEN];
+    uint8_t multi_iv[STREAMS][16];
+    uint8_t *outs[STREAMS];
+    const uint8_t *ins[STREAMS];
+    uint8_t *ivs[STREAMS];
+    size_t i, j;
+    int passed = 1;
+    
+    printf("\n测试SM4-CBC实现...\n");
+    
+    for (i = 0; i < sizeof(input); i++) {
+        input[i] = (uint8_t)(i * 29 + 3);
+    }
+    sm4_set_encrypt_key(&enc_ctx, sm4_test_vectors[0].key);
+    sm4_set_decrypt_key(&dec_ctx, sm4_test_vectors[0].key);
+    
+    /* 按定义逐块计算参考结果：C[i] = E(P[i] ^ C[i-1]) */
+    memcpy(iv, ctr_test_vectors[0].iv, sizeof(iv));
+    for (i = 0; i < sizeof(input); i += 16) {
+        for (j = 0; j < 16; j++) {
+            block[j] = input[i + j] ^ iv[j];
+        }
+        sm4_encrypt_block(&enc_ctx, expected + i, block);
+        memcpy(iv, expected + i, sizeof(iv));
+    }
+    
+    memcpy(iv, ctr_test_vectors[0].iv, sizeof(iv));
+    sm4_cbc_encrypt(&enc_ctx, output, input, sizeof(input), iv);
+    if (memcmp(output, expected, sizeof(output)) != 0) {
+        printf("CBC加密测试失败!\n");
+        passed = 0;
+    }
+    
+    /* 分两次解密（不在批边界上切开），IV在两次调用之间衔接 */
+    memcpy(iv, ctr_test_vectors[0].iv, sizeof(iv));
+    sm4_cbc_decrypt(&dec_ctx, output, expected, 16 * 19, iv);
+    sm4_cbc_decrypt(&dec_ctx, output + 16 * 19, expected + 16 * 19, sizeof(expected) - 16 * 19, iv);
+    if (memcmp(output, input, sizeof(output)) != 0 || memcmp(iv, expected + sizeof(expected) - 16, 16) != 0) {
+        printf("CBC解密测试失败!\n");
+        passed = 0;
+    }
+    
+    /* 多流加密：每个流使用不同的IV，结果必须与逐个流加密相同 */
+    for (i = 0; i < STREAMS; i++) {
+        memcpy(multi_out[i], input, stream_len[i]);
+        for (j = 0; j < 16; j++) {
+            multi_iv[i][j] = (uint8_t)(i * 16 + j);
+        }
+        outs[i] = multi_out[i];
+        ins[i] = multi_out[i]; /* 原地加密 */
+        ivs[i] = multi_iv[i];
+    }
+    sm4_cbc_encrypt_multi(&enc_ctx, outs, ins, stream_len, ivs, STREAMS);
+    
+    for (i = 0; i < STREAMS; i++) {
+        for (j = 0; j < 16; j++) {
+            iv[j] = (uint8_t)(i * 16 + j);
+        }
+        sm4_cbc_encrypt(&enc_ctx, output, input, stream_len[i], iv);
+        if (memcmp(multi_out[i], output, stream_len[i]) != 0 || memcmp(multi_iv[i], iv, 16) != 0) {
+            printf("多流CBC加密第%zu个流与单流结果不一致!\n", i);
+            passed = 0;
+        }
+    }
+    
+    if (sm4_cbc_decrypt(&dec_ctx, output, expected, 15, iv) == 0) {
+        printf("CBC未拒绝非整块长度!\n");
+        passed = 0;
+    }
+    
+    printf("CBC测试%s!\n", passed ? "通过" : "失败");
+    return passed;
+}
+
+/* 逐块计算的XTS参考实现（只处理整块），用于检查批处理路径 */
+static void xts_reference_encrypt(const uint8_t *key, const uint8_t *tweak, uint8_t *out,
+                                  const uint8_t *in, size_t blocks) {
+    SM4_Context data_ctx, tweak_ctx;
+    uint8_t t[16], block[16];
+    size_t i, j;
+    int carry;
+    
+    sm4_set_encrypt_key(&data_ctx, key);
+    sm4_set_encrypt_key(&tweak_ctx, key + 16);
+    sm4_encrypt_block(&tweak_ctx, t, tweak);
+    
+    for (i = 0; i < blocks; i++) {
+        for (j = 0; j < 16; j++) {
+            block[j] = in[i * 16 + j] ^ t[j];
+        }
+        sm4_encrypt_block(&data_ctx, block, block);
+        for (j = 0; j < 16; j++) {
+            out[i * 16 + j] = block[j] ^ t[j];
+        }
+        
+        /* t = t·α（小端） */
+        carry = t[15] >> 7;
+        for (j = 15; j > 0; j--) {
+            t[j] = (uint8_t)(t[j] << 1 | t[j - 1] >> 7);
+        }
+        t[0] = (uint8_t)(t[0] << 1) ^ (carry ? 0x87 : 0);
+    }
+}
+
+/* 测试SM4-XTS实现 */
+static int test_sm4_xts(void) {
+    enum { SECTOR = 512, SECTORS = 19, MAX_LEN = 16 * 40 + 15 };
+    static uint8_t sectors[SECTORS * SECTOR];
+    static uint8_t sectors_out[SECTORS * SECTOR];
+    SM4_XTS_Context ctx;
+    uint8_t input[MAX_LEN];
+    uint8_t expected[MAX_LEN];
+    uint8_t output[MAX_LEN];
+    uint8_t tweak[16];
+    uint8_t key[32];
+    size_t len, i;
+    int passed = 1;
+    
+    printf("\n测试SM4-XTS实现...\n");
+    printf("调整值生成实现: %s\n", sm4_xts_get_tweak_implementation());
+    
+    /* 标准向量（含密文挪用） */
+    sm4_xts_init(&ctx, xts_test_vectors[0].key);
+    sm4_xts_encrypt(&ctx, output, xts_test_vectors[0].plaintext, 56, xts_test_vectors[0].tweak);
+    print_hex("期望密文", xts_test_vectors[0].ciphertext, 56);
+    print_hex("实际密文", output, 56);
+    if (memcmp(output, xts_test_vectors[0].ciphertext, 56) != 0) {
+        printf("XTS加密测试失败!\n");
+        passed = 0;
+    }
+    sm4_xts_decrypt(&ctx, output, output, 56, xts_test_vectors[0].tweak);
+    if (memcmp(output, xts_test_vectors[0].plaintext, 56) != 0) {
+        printf("XTS解密测试失败!\n");
+        passed = 0;
+    }
+    
+    /* 整块长度与逐块参考实现一致；任意长度（含部分块）原地加解密可以还原 */
+    for (i = 0; i < sizeof(input); i++) {
+        input[i] = (uint8_t)(i * 17 + 5);
+    }
+    for (len = 16; len <= MAX_LEN; len++) {
+        memcpy(output, input, len);
+        sm4_xts_encrypt(&ctx, output, output, len, xts_test_vectors[0].tweak);
+        if (len % 16 == 0) {
+            xts_reference_encrypt(xts_test_vectors[0].key, xts_test_vectors[0].tweak, expected, input, len / 16);
+            if (memcmp(output, expected, len) != 0) {
+                printf("XTS %zu字节与逐块参考实现不一致!\n", len);
+                passed = 0;
+                break;
+            }
+        }
+        sm4_xts_decrypt(&ctx, output, output, len, xts_test_vectors[0].tweak);
+        if (memcmp(output, input, len) != 0) {
+            printf("XTS %zu字节加解密往返失败!\n", len);
+            passed = 0;
+            break;
+        }
+    }
+    
+    /* 批量扇区接口与逐个扇区调用相同，扇区号为小端调整值 */
+    for (i = 0; i < sizeof(sectors); i++) {
+        sectors[i] = (uint8_t)(i * 7 + (i >> 9));
+    }
+    sm4_xts_encrypt_sectors(&ctx, sectors_out, sectors, SECTOR, SECTORS, 0xFFFFFFFFFFFFFFF8ULL);
+    for (i = 0; i < SECTORS; i++) {
+        uint64_t sector = 0xFFFFFFFFFFFFFFF8ULL + i;
+        size_t b;
+        
+        for (b = 0; b < 8; b++) {
+            tweak[b] = (uint8_t)(sector >> (8 * b));
+            tweak[8 + b] = 0;
+        }
+        tweak[8] = sector < 0xFFFFFFFFFFFFFFF8ULL;  /* 扇区号跨过2^64 */
+        sm4_xts_encrypt(&ctx, output, sectors + i * SECTOR, SECTOR, tweak);
+        if (memcmp(output, sectors_out + i * SECTOR, SECTOR) != 0) {
+            printf("XTS扇区%zu批量加密结果不一致!\n", i);
+            passed = 0;
+            break;
+        }
+    }
+    sm4_xts_decrypt_sectors(&ctx, sectors_out, sectors_out, SECTOR, SECTORS, 0xFFFFFFFFFFFFFFF8ULL);
+    if (memcmp(sectors_out, sectors, sizeof(sectors)) != 0) {
+        printf("XTS批量扇区解密失败!\n");
+        passed = 0;
+    }
+    
+    /* 参数检查：不足一块、两个密钥相同 */
+    if (sm4_xts_encrypt(&ctx, output, input, 15, xts_test_vectors[0].tweak) == 0) {
+        printf("XTS未拒绝不足一块的数据!\n");
+        passed = 0;
+    }
+    memcpy(key, xts_test_vectors[0].key, 16);
+    memcpy(key + 16, xts_test_vectors[0].key, 16);
+    if (sm4_xts_init(&ctx, key) == 0) {
+        printf("XTS未拒绝相同的两个密钥!\n");
+        passed = 0;
+    }
+    
+    printf("XTS测试%s!\n", passed ? "通过" : "失败");
+    return passed;
+}
+
+/* 测试SM4-CCM和SM4-CMAC实现 */
+static int test_sm4_ccm(void) {
+    enum { FRAMES = 21 };
+    static const size_t pieces[] = {1, 15, 16, 17, 3, 32};
+    SM4_CCM_Context ccm;
+    SM4_CMAC_Context cmac;
+    SM4_CCM_Message msgs[FRAMES];
+    const uint8_t *data[FRAMES];
+    uint8_t *macs[FRAMES];
+    size_t lens[FRAMES];
+    uint8_t input[FRAMES * 40];
+    uint8_t frames[FRAMES * 40];
+    uint8_t tags[FRAMES][16];
+    uint8_t mac_out[FRAMES][16];
+    uint8_t nonces[FRAMES][13];
+    int results[FRAMES];
+    uint8_t output[64];
+    uint8_t tag[16];
+    uint8_t mac[16];
+    size_t i, pos;
+    int passed = 1;
+    
+    printf("\n测试SM4-CCM/CMAC实现...\n");
+    
+    for (i = 0; i < sizeof(input); i++) {
+        input[i] = (uint8_t)i;
+    }
+    
+    /* CCM标准向量 */
+    sm4_ccm_encrypt_and_tag(gcm_test_vectors[0].key, gcm_test_vectors[0].iv, 12, gcm_test_vectors[0].aad, 20,
+                            gcm_test_vectors[0].plaintext, 64, output, tag, 16);
+    print_hex("期望密文", ccm_test_vectors[0].ciphertext, 64);
+    print_hex("实际密文", output, 64);
+    print_hex("期望标签", ccm_test_vectors[0].tag, 16);
+    print_hex("实际标签", tag, 16);
+    if (memcmp(output, ccm_test_vectors[0].ciphertext, 64) != 0 || memcmp(tag, ccm_test_vectors[0].tag, 16) != 0) {
+        printf("CCM加密测试失败!\n");
+        passed = 0;
+    }
+    if (sm4_ccm_decrypt_and_verify(gcm_test_vectors[0].key, gcm_test_vectors[0].iv, 12, gcm_test_vectors[0].aad, 20,
+                                   output, 64, tag, 16, output) != 0 ||
+        memcmp(output, gcm_test_vectors[0].plaintext, 64) != 0) {
+        printf("CCM解密测试失败!\n");
+        passed = 0;
+    }
+    
+    /* CMAC标准向量：一步接口和分段调用 */
+    for (i = 0; i < sizeof(cmac_test_vectors) / sizeof(cmac_test_vectors[0]); i++) {
+        size_t len = cmac_test_vectors[i].len;
+        size_t n, k;
+        
+        sm4_cmac(gcm_test_vectors[0].key, input, len, mac, 16);
+        if (memcmp(mac, cmac_test_vectors[i].mac, 16) != 0) {
+            printf("CMAC %zu字节测试失败!\n", len);
+            passed = 0;
+        }
+        
+        sm4_cmac_init(&cmac, gcm_test_vectors[0].key);
+        for (pos = 0, k = 0; pos < len; pos += n, k++) {
+            n = pieces[k % (sizeof(pieces) / sizeof(pieces[0]))];
+            if (n > len - pos) {
+                n = len - pos;
+            }
+            sm4_cmac_update(&cmac, input + pos, n);
+        }
+        sm4_cmac_finish(&cmac, mac, 16);
+        if (memcmp(mac, cmac_test_vectors[i].mac, 16) != 0) {
+            printf("CMAC %zu字节分段计算失败!\n", len);
+            passed = 0;
+        }
+    }
+    
+    /* 多消息接口与逐条调用相同：长度、随机数长度、AAD和标签长度各不相同，超过一组16条 */
+    sm4_ccm_init(&ccm, gcm_test_vectors[0].key);
+    sm4_cmac_init(&cmac, gcm_test_vectors[0].key);
+    for (i = 0; i < FRAMES; i++) {
+        memset(nonces[i], (int)i, sizeof(nonces[i]));
+        msgs[i].nonce = nonces[i];
+        msgs[i].nonce_len = 7 + i % 7;
+        msgs[i].aad = input + i;
+        msgs[i].aad_len = (i * 5) % 23;
+        msgs[i].in = input + i * 40;
+        msgs[i].len = (i * 13) % 41;
+        msgs[i].out = frames + i * 40;
+        msgs[i].tag = tags[i];
+        msgs[i].tag_len = 4 + 2 * (i % 7);
+        
+        data[i] = input + i * 40;
+        lens[i] = (i * 11) % 41;
+        macs[i] = mac_out[i];
+    }
+    
+    if (sm4_ccm_encrypt_multi(&ccm, msgs, FRAMES) != 0 ||
+        sm4_cmac_multi(&cmac, data, lens, macs, 16, FRAMES) != 0) {
+        printf("CCM/CMAC多消息接口返回错误!\n");
+        passed = 0;
+    }
+    for (i = 0; i < FRAMES; i++) {
+        sm4_ccm_encrypt(&ccm, msgs[i].nonce, msgs[i].nonce_len, msgs[i].aad, msgs[i].aad_len,
+                        msgs[i].in, msgs[i].len, output, tag, msgs[i].tag_len);
+        if (memcmp(output, msgs[i].out, msgs[i].len) != 0 || memcmp(tag, tags[i], msgs[i].tag_len) != 0) {
+            printf("CCM第%zu条消息批量加密结果不一致!\n", i);
+            passed = 0;
+        }
+        sm4_cmac(gcm_test_vectors[0].key, data[i], lens[i], mac, 16);
+        if (memcmp(mac, mac_out[i], 16) != 0) {
+            printf("CMAC第%zu条消息批量计算结果不一致!\n", i);
+            passed = 0;
+        }
+    }
+    
+    /* 批量原地解密，篡改一条的标签只影响这一条 */
+    tags[3][0] ^= 1;
+    for (i = 0; i < FRAMES; i++) {
+        msgs[i].in = msgs[i].out;
+    }
+    if (sm4_ccm_decrypt_multi(&ccm, msgs, FRAMES, results) == 0) {
+        printf("CCM批量解密未检测到篡改!\n");
+        passed = 0;
+    }
+    for (i = 0; i < FRAMES; i++) {
+        int bad;
+        
+        if (i == 3) {
+            bad = results[i] == 0 || frames[i * 40] != 0;
+        } else {
+            bad = results[i] != 0 || memcmp(frames + i * 40, input + i * 40, msgs[i].len) != 0;
+        }
+        if (bad) {
+            printf("CCM第%zu条消息批量解密结果错误!\n", i);
+            passed = 0;
+        }
+    }
+    
+    /* AAD不短于0xFF00字节时长度编码为0xFFFE加4字节（与Python参考实现对照） */
+    {
+        static uint8_t long_aad[0xFF00];
+        static const uint8_t expected_ct[20] = {0x98, 0xC0, 0x08, 0x03, 0x03, 0x93, 0x44, 0xDF, 0xE2, 0x41,
+                                                0xCF, 0xFC, 0xD0, 0xA8, 0x15, 0x59, 0x22, 0xAD, 0x33, 0x31};
+        static const uint8_t expected_tag[8] = {0x54, 0x11, 0x68, 0x15, 0xFB, 0x1D, 0x7B, 0x09};
+        uint8_t nonce[13];
+        
+        for (i = 0; i < sizeof(long_aad); i++) {
+            long_aad[i] = (uint8_t)i;
+        }
+        memset(nonce, 0x42, sizeof(nonce));
+        sm4_ccm_encrypt(&ccm, nonce, 13, long_aad, sizeof(long_aad), input, 20, output, tag, 8);
+        if (memcmp(output, expected_ct, 20) != 0 || memcmp(tag, expected_tag, 8) != 0) {
+            printf("CCM长AAD测试失败!\n");
+            passed = 0;
+        }
+    }
+    
+    /* 参数检查：随机数长度、标签长度 */
+    if (sm4_ccm_encrypt(&ccm, nonces[0], 6, NULL, 0, input, 16, output, tag, 16) == 0 ||
+        sm4_ccm_encrypt(&ccm, nonces[0], 12, NULL, 0, input, 16, output, tag, 5) == 0 ||
+        sm4_cmac_finish(&cmac, mac, 17) == 0) {
+        printf("CCM/CMAC未拒绝不合法的参数!\n");
+        passed = 0;
+    }
+    
+    printf("CCM/CMAC测试%s!\n", passed ? "通过" : "失败");
+    return passed;
+}
+
+/* 测试SM4-OCB实现 */
+static int test_sm4_ocb(void) {
+    static const uint8_t nonce[12] = {0xBB, 0xAA, 0x99, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11, 0x01};
+    /* 661字节明文跨越多批（用到L_4、L_5）并以部分块结尾，300字节AAD同样；期望值为标签和密文的CMAC */
+    static const uint8_t long_tag[12] = {0x90, 0x69, 0x59, 0x8A, 0x49, 0x3F, 0xBF, 0xA9, 0xD8, 0xDC, 0xC6, 0x53};
+    static const uint8_t long_ct_mac[16] = {0xF1, 0x3E, 0xF0, 0x21, 0x03, 0x8E, 0xD7, 0x19,
+                                            0x8C, 0x39, 0x67, 0xF4, 0xE1, 0x04, 0xE2, 0x9A};
+    /* 1字节随机数（0x01）、8字节标签、512字节明文 */
+    static const uint8_t short_nonce_tag[8] = {0x39, 0x9C, 0x9F, 0x53, 0xD7, 0xA0, 0xC4, 0xAE};
+    static const uint8_t short_nonce_ct_mac[16] = {0xFB, 0x81, 0x60, 0x3A, 0x3D, 0xBC, 0xBD, 0xC0,
+                                                   0xD6, 0xA3, 0x7C, 0x25, 0xC3, 0xFA, 0xFE, 0x0B};
+    SM4_OCB_Context ocb;
+    uint8_t input[661];
+    uint8_t aad[300];
+    uint8_t output[661];
+    uint8_t decrypted[661];
+    uint8_t long_nonce[15];
+    uint8_t tag[16];
+    uint8_t mac[16];
+    size_t i, len;
+    int passed = 1;
+    
+    printf("\n测试SM4-OCB实现...\n");
+    
+    sm4_ocb_init(&ocb, gcm_test_vectors[0].key);
+    
+    for (i = 0; i < sizeof(ocb_test_vectors) / sizeof(ocb_test_vectors[0]); i++) {
+        len = ocb_test_vectors[i].len;
+        for (size_t j = 0; j < len; j++) {
+            input[j] = (uint8_t)j;
+        }
+        sm4_ocb_encrypt(&ocb, nonce, sizeof(nonce), input, len, input, len, output, tag, 16);
+        if (memcmp(output, ocb_test_vectors[i].ciphertext, len) != 0 || memcmp(tag, ocb_test_vectors[i].tag, 16) != 0) {
+            printf("OCB向量%zu（%zu字节）加密测试失败!\n", i, len);
+            print_hex("期望标签", ocb_test_vectors[i].tag, 16);
+            print_hex("实际标签", tag, 16);
+            passed = 0;
+        }
+        if (sm4_ocb_decrypt(&ocb, nonce, sizeof(nonce), input, len, output, len, tag, 16, decrypted) != 0 ||
+            memcmp(decrypted, input, len) != 0) {
+            printf("OCB向量%zu（%zu字节）解密测试失败!\n", i, len);
+            passed = 0;
+        }
+    }
+    
+    /* 长消息：多批偏移量、部分块，原地加密和解密 */
+    for (i = 0; i < sizeof(input); i++) {
+        input[i] = (uint8_t)(i * 13 + 5);
+    }
+    for (i = 0; i < sizeof(aad); i++) {
+        aad[i] = (uint8_t)(i * 7 + 1);
+    }
+    for (i = 0; i < sizeof(long_nonce); i++) {
+        long_nonce[i] = (uint8_t)(i + 1);
+    }
+    memcpy(output, input, sizeof(output));
+    sm4_ocb_encrypt(&ocb, long_nonce, sizeof(long_nonce), aad, sizeof(aad), output, sizeof(output), output, tag, 12);
+    sm4_cmac(gcm_test_vectors[0].key, output, sizeof(output), mac, 16);
+    if (memcmp(tag, long_tag, 12) != 0 || memcmp(mac, long_ct_mac, 16) != 0) {
+        printf("OCB长消息加密测试失败!\n");
+        passed = 0;
+    }
+    if (sm4_ocb_decrypt_and_verify(gcm_test_vectors[0].key, long_nonce, sizeof(long_nonce), aad, sizeof(aad),
+                                   output, sizeof(output), tag, 12, output) != 0 ||
+        memcmp(output, input, sizeof(output)) != 0) {
+        printf("OCB长消息原地解密测试失败!\n");
+        passed = 0;
+    }
+    
+    sm4_ocb_encrypt_and_tag(gcm_test_vectors[0].key, long_nonce, 1, NULL, 0, input, 512, output, tag, 8);
+    sm4_cmac(gcm_test_vectors[0].key, output, 512, mac, 16);
+    if (memcmp(tag, short_nonce_tag, 8) != 0 || memcmp(mac, short_nonce_ct_mac, 16) != 0) {
+        printf("OCB短随机数测试失败!\n");
+        passed = 0;
+    }
+    
+    /* 各种长度往返，篡改密文、AAD或标签都必须验证失败且输出被清零 */
+    for (len = 0; len <= 300; len += 23) {
+        sm4_ocb_encrypt(&ocb, nonce, sizeof(nonce), aad, len % 50, input, len, output, tag, 16);
+        if (sm4_ocb_decrypt(&ocb, nonce, sizeof(nonce), aad, len % 50, output, len, tag, 16, decrypted) != 0 ||
+            memcmp(decrypted, input, len) != 0) {
+            printf("OCB %zu字节往返测试失败!\n", len);
+            passed = 0;
+        }
+        if (len > 0) {
+            output[len / 2] ^= 0x04;
+            if (sm4_ocb_decrypt(&ocb, nonce, sizeof(nonce), aad, len % 50, output, len, tag, 16, decrypted) == 0 ||
+                decrypted[len / 2] != 0) {
+                printf("OCB未检测出%zu字节消息的篡改!\n", len);
+                passed = 0;
+            }
+            output[len / 2] ^= 0x04;
+        }
+        tag[15] ^= 0x80;
+        if (sm4_ocb_decrypt(&ocb, nonce, sizeof(nonce), aad, len % 50, output, len, tag, 16, decrypted) == 0) {
+            printf("OCB未检测出标签篡改!\n");
+            passed = 0;
+        }
+    }
+    
+    /* 参数检查：随机数长度、标签长度 */
+    if (sm4_ocb_encrypt(&ocb, nonce, 0, NULL, 0, input, 16, output, tag, 16) == 0 ||
+        sm4_ocb_encrypt(&ocb, long_nonce, 16, NULL, 0, input, 16, output, tag, 16) == 0 ||
+        sm4_ocb_encrypt(&ocb, nonce, 12, NULL, 0, input, 16, output, tag, 0) == 0 ||
+        sm4_ocb_encrypt(&ocb, nonce, 12, NULL, 0, input, 16, output, tag, 17) == 0) {
+        printf("OCB未拒绝不合法的参数!\n");
+        passed = 0;
+    }
+    
+    printf("OCB测试%s!\n", passed ? "通过" : "失败");
+    return passed;
+}
+
+/* 测试多缓冲作业管理器 */
+static int test_sm4_mb(void) {
+    static const char *impl_names[] = {"t_table", "aesni", "gfni"};
+    enum { JOBS = 37, MAX_LEN = 16 * 33 };
+    static uint8_t input[JOBS][MAX_LEN];
+    static uint8_t expected[JOBS][MAX_LEN];
+    static uint8_t output[JOBS][MAX_LEN];
+    SM4_Context enc_keys[JOBS], dec_keys[JOBS];
+    SM4_CTR_Context ctr;
+    SM4_MB_Mgr mgr;
+    SM4_MB_Job jobs[JOBS];
+    SM4_MB_Job bad, empty, *done;
+    uint8_t key[16];
+    uint8_t ivs[JOBS][16];
+    uint8_t iv[16];
+    int seen[JOBS];
+    size_t i, j, len;
+    int passed = 1;
+    
+    printf("\n测试多缓冲作业管理器...\n");
+    
+    /* 每个作业有自己的密钥、IV、模式和长度；CTR长度不是整块，偶数号ECB作业做解密 */
+    for (i = 0; i < JOBS; i++) {
+        for (j = 0; j < 16; j++) {
+            key[j] = (uint8_t)(i * 31 + j * 7 + 1);
+            ivs[i][j] = (uint8_t)(i * 17 + j);
+        }
+        sm4_set_encrypt_key(&enc_keys[i], key);
+        sm4_set_decrypt_key(&dec_keys[i], key);
+        for (j = 0; j < MAX_LEN; j++) {
+            input[i][j] = (uint8_t)(i * 5 + j * 3);
+        }
+        
+        memset(&jobs[i], 0, sizeof(jobs[i]));
+        jobs[i].mode = (SM4_MB_Mode)(i % 4);
+        len = 16 * (1 + (i * 7) % 33);
+        if (jobs[i].mode == SM4_MB_CTR) {
+            len = 1 + (i * 41) % MAX_LEN;
+        }
+        jobs[i].len = len;
+        jobs[i].iv = ivs[i];
+        jobs[i].key = &enc_keys[i];
+        memcpy(iv, ivs[i], sizeof(iv));
+        switch (jobs[i].mode) {
+        case SM4_MB_ECB:
+            if (i % 8 == 0) {
+                jobs[i].key = &dec_keys[i];
+                sm4_ecb_decrypt(&dec_keys[i], expected[i], input[i], len);
+            } else {
+                sm4_ecb_encrypt(&enc_keys[i], expected[i], input[i], len);
+            }
+            break;
+        case SM4_MB_CBC_ENCRYPT:
+            sm4_cbc_encrypt(&enc_keys[i], expected[i], input[i], len, iv);
+            break;
+        case SM4_MB_CBC_DECRYPT:
+            jobs[i].key = &dec_keys[i];
+            sm4_cbc_decrypt(&dec_keys[i], expected[i], input[i], len, iv);
+            break;
+        default:
+            for (j = 0; j < 16; j++) {
+                key[j] = (uint8_t)(i * 31 + j * 7 + 1);
+            }
+            sm4_ctr_init(&ctr, key, ivs[i]);
+            sm4_ctr_encrypt(&ctr, expected[i], input[i], len);
+            break;
+        }
+    }
+    /* 计数器低64位回绕，进位到高64位 */
+    memset(ivs[3] + 8, 0xFF, 8);
+    for (j = 0; j < 16; j++) {
+        key[j] = (uint8_t)(3 * 31 + j * 7 + 1);
+    }
+    sm4_ctr_init(&ctr, key, ivs[3]);
+    sm4_ctr_encrypt(&ctr, expected[3], input[3], jobs[3].len);
+    
+    for (i = 0; i < sizeof(impl_names) / sizeof(impl_names[0]); i++) {
+        if (sm4_force_implementation(impl_names[i]) != 0) {
+            printf("%s: 当前主机不可用，跳过\n", impl_names[i]);
+            continue;
+        }
+        
+        /* 奇数号作业原地处理 */
+        memset(seen, 0, sizeof(seen));
+        memset(output, 0, sizeof(output));
+        sm4_mb_mgr_init(&mgr);
+        for (j = 0; j < JOBS; j++) {
+            if (j % 2) {
+                memcpy(output[j], input[j], jobs[j].len);
+                jobs[j].in = output[j];
+            } else {
+                jobs[j].in = input[j];
+            }
+            jobs[j].out = output[j];
+            jobs[j].user_data = &seen[j];
+            done = sm4_mb_submit(&mgr, &jobs[j]);
+            if (done != NULL) {
+                (*(int *)done->user_data)++;
+            }
+        }
+        while ((done = sm4_mb_flush(&mgr)) != NULL) {
+            (*(int *)done->user_data)++;
+        }
+        
+        for (j = 0; j < JOBS; j++) {
+            if (seen[j] != 1 || jobs[j].status != SM4_MB_STATUS_COMPLETED ||
+                memcmp(output[j], expected[j], jobs[j].len) != 0) {
+                printf("%s: 第%zu个作业（模式%d，%zu字节）结果不正确!\n", impl_names[i], j, (int)jobs[j].mode, jobs[j].len);
+                passed = 0;
+            }
+        }
+    }
+    sm4_force_implementation(NULL);
+    
+    /* 参数不合法和长度为0的作业不进入通道，直接返回 */
+    sm4_mb_mgr_init(&mgr);
+    bad = jobs[1];
+    bad.len = 15;
+    empty = jobs[2];
+    empty.len = 0;
+    if (sm4_mb_submit(&mgr, &bad) != &bad || bad.status != SM4_MB_STATUS_INVALID_ARGS ||
+        sm4_mb_submit(&mgr, &empty) != &empty || empty.status != SM4_MB_STATUS_COMPLETED ||
+        sm4_mb_flush(&mgr) != NULL || sm4_mb_get_completed(&mgr) != NULL) {
+        printf("多缓冲管理器参数检查失败!\n");
+        passed = 0;
+    }
+    
+    printf("多缓冲测试%s!\n", passed ? "通过" : "失败");
+    return passed;
+}
+
+/* 测试异步批量加密引擎 */
+#if !defined(_WIN32)
+static int test_sm4_aio(void) {
+    static const unsigned int flags[] = {0, SM4_AIO_FLAG_NO_URING};
+    enum { REQS = 24, MAX_LEN = 70000, DEPTH = 8 };
+    static uint8_t plain[REQS][MAX_LEN];
+    static uint8_t expected[REQS][MAX_LEN];
+    static uint8_t actual[MAX_LEN];
+    SM4_AIO_Request reqs[REQS], bad, *done;
+    SM4_AIO_Engine *engine;
+    SM4_CTR_Context ctr;
+    uint8_t keys[REQS][16], ivs[REQS][16], tags[REQS][16];
+    uint64_t offs[REQS], total = 0;
+    char in_path[] = "/tmp/sm4_aio_in_XXXXXX";
+    char out_path[] = "/tmp/sm4_aio_out_XXXXXX";
+    int in_fd, out_fd, seen[REQS];
+    size_t f, i, j, len;
+    int passed = 1, ret;
+    
+    printf("\n测试异步批量加密引擎...\n");
+    
+    in_fd = mkstemp(in_path);
+    out_fd = mkstemp(out_path);
+    if (in_fd < 0 || out_fd < 0) {
+        printf("无法创建临时文件，跳过\n");
+        return 1;
+    }
+    unlink(in_path);
+    unlink(out_path);
+    
+    /* 请求依次是GCM加密、GCM解密、CTR；长度覆盖0、不足一块和跨多个4 KiB页 */
+    for (i = 0; i < REQS; i++) {
+        len = (i * 7919 + i * i * 131) % MAX_LEN;
+        if (i == 4) {
+            len = 0;
+        }
+        for (j = 0; j < 16; j++) {
+            keys[i][j] = (uint8_t)(i * 13 + j);
+            ivs[i][j] = (uint8_t)(i * 29 + j * 3);
+        }
+        for (j = 0; j < len; j++) {
+            plain[i][j] = (uint8_t)(i + j * 7);
+        }
+        
+        memset(&reqs[i], 0, sizeof(reqs[i]));
+        reqs[i].op = (SM4_AIO_Op)(i % 3);
+        reqs[i].key = keys[i];
+        reqs[i].iv = ivs[i];
+        reqs[i].iv_len = 12;
+        reqs[i].aad = ivs[i];
+        reqs[i].aad_len = i % 5;
+        reqs[i].in_fd = in_fd;
+        reqs[i].out_fd = out_fd;
+        reqs[i].in_off = total;
+        reqs[i].out_off = total;
+        reqs[i].len = len;
+        reqs[i].user_data = &seen[i];
+        offs[i] = total;
+        total += len + 1;
+        
+        switch (reqs[i].op) {
+        case SM4_AIO_GCM_ENCRYPT:
+            sm4_gcm_encrypt_and_tag(keys[i], ivs[i], 12, ivs[i], i % 5, plain[i], len, expected[i], tags[i], 16);
+            pwrite(in_fd, plain[i], len, (off_t)offs[i]);
+            break;
+        case SM4_AIO_CTR:
+            sm4_ctr_init(&ctr, keys[i], ivs[i]);
+            sm4_ctr_encrypt(&ctr, expected[i], plain[i], len);
+            pwrite(in_fd, plain[i], len, (off_t)offs[i]);
+            break;
+        default:
+            /* 输入是密文，期望输出明文；第8个请求的标签被篡改，应当验证失败且不写出 */
+            sm4_gcm_encrypt_and_tag(keys[i], ivs[i], 12, ivs[i], i % 5, plain[i], len, actual, tags[i], 16);
+            pwrite(in_fd, actual, len, (off_t)offs[i]);
+            memcpy(expected[i], plain[i], len);
+            memcpy(reqs[i].tag, tags[i], 16);
+            if (i == 7) {
+                reqs[i].tag[0] ^= 1;
+            }
+            break;
+        }
+    }
+    
+    for (f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+        engine = sm4_aio_create(DEPTH, flags[f]);
+        if (engine == NULL) {
+            printf("创建引擎失败!\n");
+            passed = 0;
+            continue;
+        }
+        printf("I/O后端: %s\n", sm4_aio_get_backend(engine));
+        if (ftruncate(out_fd, 0) != 0) {
+            passed = 0;
+        }
+        memset(seen, 0, sizeof(seen));
+        
+        /* 队列满时先取回已完成的请求 */
+        for (i = 0; i < REQS; i++) {
+            while ((ret = sm4_aio_submit(engine, &reqs[i])) == -EBUSY) {
+                done = sm4_aio_poll(engine, 1);
+                if (done != NULL) {
+                    (*(int *)done->user_data)++;
+                }
+            }
+            if (ret != 0) {
+                printf("第%zu个请求提交失败!\n", i);
+                passed = 0;
+            }
+        }
+        while ((done = sm4_aio_poll(engine, 1)) != NULL) {
+            (*(int *)done->user_data)++;
+        }
+        if (sm4_aio_inflight(engine) != 0) {
+            passed = 0;
+        }
+        
+        for (i = 0; i < REQS; i++) {
+            len = reqs[i].len;
+            memset(actual, 0, len);
+            if (pread(out_fd, actual, len, (off_t)offs[i]) != (ssize_t)len) {
+                memset(actual, 0xEE, len);
+            }
+            if (i == 7) {
+                /* 验证失败：结果为-EBADMSG，输出区域没有被写入（文件中是空洞） */
+                for (j = 0; j < len && actual[j] == 0; j++) {
+                }
+                if (seen[i] != 1 || reqs[i].result != -EBADMSG || j != len) {
+                    printf("%s: 篡改的标签没有被拒绝!\n", sm4_aio_get_backend(engine));
+                    passed = 0;
+                }
+                continue;
+            }
+            if (seen[i] != 1 || reqs[i].result != 0 || memcmp(actual, expected[i], len) != 0 ||
+                (reqs[i].op == SM4_AIO_GCM_ENCRYPT && memcmp(reqs[i].tag, tags[i], 16) != 0)) {
+                printf("%s: 第%zu个请求（操作%d，%zu字节）结果不正确!\n",
+                       sm4_aio_get_backend(engine), i, (int)reqs[i].op, len);
+                passed = 0;
+            }
+        }
+        
+        /* 输入比请求短时返回-EIO；参数不合法时不进入引擎 */
+        bad = reqs[1];
+        bad.in_off = total;
+        if (sm4_aio_submit(engine, &bad) != 0 || sm4_aio_poll(engine, 1) != &bad || bad.result != -EIO) {
+            printf("%s: 输入不足没有报告-EIO!\n", sm4_aio_get_backend(engine));
+            passed = 0;
+        }
+        bad = reqs[1];
+        bad.key = NULL;
+        if (sm4_aio_submit(engine, &bad) != -EINVAL || sm4_aio_poll(engine, 0) != NULL) {
+            printf("%s: 参数检查失败!\n", sm4_aio_get_backend(engine));
+            passed = 0;
+        }
+        
+        sm4_aio_destroy(engine);
+    }
+    
+    close(in_fd);
+    close(out_fd);
+    
+    printf("异步加密测试%s!\n", passed ? "通过" : "失败");
+    return passed;
+}
+#endif
+
+/* 测试分段认证容器 */
+#if !defined(_WIN32)
+static int test_sm4_container(void) {
+    static const struct {
+        uint64_t offset;
+        size_t len;
+    } ranges[] = {
+        {0, 0}, {0, 1}, {1, 10}, {65530, 20}, {65536 * 2, 65536 * 2},
+        {65536, 65536 * 4 + 100}, {65536 * 5 + 1000, 234}, {0, 65536 * 5 + 1234},
+    };
+    enum { LEN = 65536 * 5 + 1234 };
+    static uint8_t plain[LEN], box[LEN + 256], out[LEN], segment[65536];
+    uint8_t key[16], prefix[8], nonce[12], tag[16], bad_key[16];
+    char path[] = "/tmp/sm4_container_XXXXXX";
+    SM4_Container_Info info;
+    uint64_t box_len;
+    size_t i, j;
+    int fd, ret, passed = 1;
+    
+    printf("\n测试分段认证容器...\n");
+    
+    for (i = 0; i < 16; i++) {
+        key[i] = (uint8_t)(i * 17 + 3);
+        bad_key[i] = key[i];
+    }
+    bad_key[15] ^= 0x80;
+    for (i = 0; i < 8; i++) {
+        prefix[i] = (uint8_t)(0xA0 + i);
+    }
+    for (i = 0; i < LEN; i++) {
+        plain[i] = (uint8_t)(i * 31 + (i >> 8));
+    }
+    
+    box_len = sm4_container_size(LEN, SM4_CONTAINER_DEFAULT_SEGMENT);
+    if (box_len != SM4_CONTAINER_HEADER_SIZE + LEN + 6 * 16 + SM4_CONTAINER_TRAILER_SIZE ||
+        sm4_container_size(LEN, 1000) != 0 ||
+        sm4_container_encrypt(key, prefix, SM4_CONTAINER_DEFAULT_SEGMENT, plain, LEN, box) != 0) {
+        printf("容器长度或加密失败!\n");
+        return 0;
+    }
+    
+    /* 第2段就是随机数为“前缀 || 2”、附加数据为文件头的一条GCM消息 */
+    memcpy(nonce, prefix, 8);
+    nonce[8] = 0;
+    nonce[9] = 0;
+    nonce[10] = 0;
+    nonce[11] = 2;
+    sm4_gcm_encrypt_and_tag(key, nonce, 12, box, SM4_CONTAINER_HEADER_SIZE,
+                            plain + 2 * 65536, 65536, segment, tag, 16);
+    if (memcmp(segment, box + SM4_CONTAINER_HEADER_SIZE + 2 * 65536, 65536) != 0 ||
+        memcmp(tag, box + SM4_CONTAINER_HEADER_SIZE + LEN + 2 * 16, 16) != 0) {
+        printf("段密文或标签与GCM不一致!\n");
+        passed = 0;
+    }
+    
+    fd = mkstemp(path);
+    if (fd < 0) {
+        printf("无法创建临时文件，跳过\n");
+        return passed;
+    }
+    unlink(path);
+    if (pwrite(fd, box, (size_t)box_len, 0) != (ssize_t)box_len) {
+        close(fd);
+        return 0;
+    }
+    
+    if (sm4_container_open(fd, &info) != 0 || info.segment_size != SM4_CONTAINER_DEFAULT_SEGMENT ||
+        info.plaintext_len != LEN || info.segment_count != 6 || info.container_len != box_len ||
+        memcmp(info.nonce_prefix, prefix, 8) != 0) {
+        printf("解析容器失败!\n");
+        passed = 0;
+    }
+    
+    for (i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        memset(out, 0xEE, sizeof(out));
+        ret = sm4_container_read_range(fd, key, ranges[i].offset, ranges[i].len, out);
+        if (ret != 0 || memcmp(out, plain + ranges[i].offset, ranges[i].len) != 0 ||
+            (ranges[i].len < LEN && out[ranges[i].len] != 0xEE)) {
+            printf("读取范围[%llu, +%zu)失败（%d）!\n",
+                   (unsigned long long)ranges[i].offset, ranges[i].len, ret);
+            passed = 0;
+        }
+    }
+    if (sm4_container_read_range(fd, key, LEN - 10, 11, out) != -EINVAL ||
+        sm4_container_read_range(fd, key, LEN + 1, 0, out) != -EINVAL) {
+        printf("越界范围没有被拒绝!\n");
+        passed = 0;
+    }
+    if (sm4_container_read_range(fd, bad_key, 0, 16, out) != -EBADMSG) {
+        printf("错误密钥没有被拒绝!\n");
+        passed = 0;
+    }
+    
+    /* 篡改第3段：不涉及它的范围仍然可读，涉及它的范围验证失败且输出被清零 */
+    box[SM4_CONTAINER_HEADER_SIZE + 3 * 65536 + 5] ^= 1;
+    pwrite(fd, box + SM4_CONTAINER_HEADER_SIZE + 3 * 65536 + 5, 1, SM4_CONTAINER_HEADER_SIZE + 3 * 65536 + 5);
+    if (sm4_container_read_range(fd, key, 65536, 65536, out) != 0 ||
+        memcmp(out, plain + 65536, 65536) != 0) {
+        printf("篡改影响了其他段!\n");
+        passed = 0;
+    }
+    memset(out, 0xEE, sizeof(out));
+    ret = sm4_container_read_range(fd, key, 65536 * 2 + 7, 65536 * 2, out);
+    for (j = 0; j < 65536 * 2 && out[j] == 0; j++) {
+    }
+    if (ret != -EBADMSG || j != 65536 * 2) {
+        printf("篡改的段没有被拒绝!\n");
+        passed = 0;
+    }
+    
+    /* 文件被截断 */
+    if (ftruncate(fd, (off_t)box_len - 1) != 0 || sm4_container_open(fd, &info) != -EIO) {
+        printf("截断的容器没有被拒绝!\n");
+        passed = 0;
+    }
+    
+    /* 空明文：一个空段，标签认证文件头 */
+    box_len = sm4_container_size(0, SM4_CONTAINER_DEFAULT_SEGMENT);
+    sm4_container_encrypt(key, prefix, SM4_CONTAINER_DEFAULT_SEGMENT, NULL, 0, box);
+    if (box_len != SM4_CONTAINER_HEADER_SIZE + 16 + SM4_CONTAINER_TRAILER_SIZE ||
+        ftruncate(fd, 0) != 0 || pwrite(fd, box, (size_t)box_len, 0) != (ssize_t)box_len ||
+        sm4_container_open(fd, &info) != 0 || info.segment_count != 1 ||
+        sm4_container_read_range(fd, key, 0, 0, out) != 0) {
+        printf("空容器处理失败!\n");
+        passed = 0;
+    }
+    
+    close(fd);
+    
+    printf("分段容器测试%s!\n", passed ? "通过" : "失败");
+    return passed;
+}
+#endif
+
+/* 测试上下文池 */
+static int test_sm4_pool(void) {
+    enum { CAPACITY = 8 };
+    SM4_Ctx_Pool *pool;
+    SM4_Ctx_Pool_Stats stats;
+    SM4_GCM_Context *gcm, *held[CAPACITY + 1], stack_ctx;
+    SM4_Context *enc, *dec, ref;
+    uint8_t key[16], key2[16], iv[12], msg[100], ct[100], ref_ct[100], tag[16], ref_tag[16];
+    uint8_t block[16], out[16], back[16];
+    size_t i, round;
+    int passed = 1;
+    
+    printf("\n测试上下文池...\n");
+    
+    for (i = 0; i < 16; i++) {
+        key[i] = (uint8_t)(i * 7 + 1);
+        key2[i] = (uint8_t)(i * 5 + 2);
+        block[i] = (uint8_t)(i * 3);
+    }
+    for (i = 0; i < 12; i++) {
+        iv[i] = (uint8_t)(0xC0 + i);
+    }
+    for (i = 0; i < sizeof(msg); i++) {
+        msg[i] = (uint8_t)(i * 11);
+    }
+    sm4_gcm_encrypt_and_tag(key, iv, 12, iv, 12, msg, sizeof(msg), ref_ct, ref_tag, 16);
+    
+    pool = sm4_ctx_pool_create(CAPACITY);
+    if (pool == NULL) {
+        printf("创建上下文池失败!\n");
+        return 0;
+    }
+    
+    /* 第一次取出需要扩展密钥，归还后再用同一密钥取出复用密钥材料；两次结果都与一步式接口相同 */
+    for (round = 0; round < 2; round++) {
+        gcm = sm4_ctx_pool_acquire_gcm(pool, key, iv, 12);
+        if (gcm == NULL || (uintptr_t)gcm % 64 != 0) {
+            printf("GCM上下文为空或没有按缓存行对齐!\n");
+            passed = 0;
+            break;
+        }
+        sm4_gcm_aad(gcm, iv, 12);
+        sm4_gcm_encrypt(gcm, ct, msg, sizeof(msg));
+        sm4_gcm_finish(gcm, tag, 16);
+        if (memcmp(ct, ref_ct, sizeof(ct)) != 0 || memcmp(tag, ref_tag, 16) != 0) {
+            printf("第%zu次取出的GCM上下文结果不正确!\n", round + 1);
+            passed = 0;
+        }
+        sm4_ctx_pool_release(pool, gcm);
+    }
+    sm4_ctx_pool_stats(pool, &stats);
+    if (stats.hits != 1 || stats.misses != 1 || stats.in_use != 0 || stats.capacity != CAPACITY) {
+        printf("密钥材料没有被复用!\n");
+        passed = 0;
+    }
+    
+    /* 另一个密钥不能命中 */
+    gcm = sm4_ctx_pool_acquire_gcm(pool, key2, iv, 12);
+    sm4_gcm_encrypt(gcm, ct, msg, sizeof(msg));
+    if (memcmp(ct, ref_ct, sizeof(ct)) == 0) {
+        printf("不同密钥得到了相同的密文!\n");
+        passed = 0;
+    }
+    sm4_ctx_pool_release(pool, gcm);
+    
+    /* SM4上下文：加密和解密方向分别设置 */
+    enc = sm4_ctx_pool_acquire_sm4(pool, key, SM4_POOL_ENCRYPT);
+    dec = sm4_ctx_pool_acquire_sm4(pool, key, SM4_POOL_DECRYPT);
+    sm4_set_encrypt_key(&ref, key);
+    sm4_encrypt_block(&ref, ct, block);
+    if (enc == NULL || dec == NULL || (uintptr_t)enc % 64 != 0) {
+        printf("取出SM4上下文失败!\n");
+        passed = 0;
+    } else {
+        sm4_encrypt_block(enc, out, block);
+        sm4_decrypt_block(dec, back, out);
+        if (memcmp(out, ct, 16) != 0 || memcmp(back, block, 16) != 0) {
+            printf("SM4上下文结果不正确!\n");
+            passed = 0;
+        }
+    }
+    sm4_ctx_pool_release(pool, enc);
+    sm4_ctx_pool_release(pool, dec);
+    
+    /* 用尽后返回NULL，其他分片的空闲上下文可以被取走；不属于池的指针被忽略 */
+    for (i = 0; i < CAPACITY + 1; i++) {
+        held[i] = sm4_ctx_pool_acquire_gcm(pool, key, iv, 12);
+    }
+    sm4_ctx_pool_stats(pool, &stats);
+    if (held[CAPACITY - 1] == NULL || held[CAPACITY] != NULL || stats.in_use != CAPACITY) {
+        printf("上下文池用尽处理不正确!\n");
+        passed = 0;
+    }
+    sm4_ctx_pool_release(pool, &stack_ctx);
+    sm4_ctx_pool_release(pool, (uint8_t *)held[0] + 16);
+    for (i = 0; i < CAPACITY; i++) {
+        sm4_ctx_pool_release(pool, held[i]);
+    }
+    sm4_ctx_pool_release(pool, held[0]);
+    sm4_ctx_pool_stats(pool, &stats);
+    if (stats.in_use != 0) {
+        printf("归还后仍有上下文在使用!\n");
+        passed = 0;
+    }
+    
+    sm4_ctx_pool_destroy(pool);
+    
+    printf("上下文池测试%s!\n", passed ? "通过" : "失败");
+    return passed;
+}
+
+/* 测试GCM密钥流预取 */
+#if !defined(_WIN32)
+static int test_sm4_gcm_prefetch(void) {
+    enum { MESSAGES = 200, MAX_LEN = 256, DEPTH = 16 };
+    SM4_GCM_Context ctx;
+    uint8_t key[16], iv_base[12], iv[12], expected_iv[12], aad[20];
+    uint8_t msg[400], ct[400], ref_ct[400], tag[16], ref_tag[16];
+    uint64_t seq, hits, misses;
+    size_t i, m, len, first;
+    int passed = 1;
+    
+    printf("\n测试GCM密钥流预取...\n");
+    
+    for (i = 0; i < 16; i++) {
+        key[i] = (uint8_t)(0x31 * i + 7);
+    }
+    for (i = 0; i < 12; i++) {
+        iv_base[i] = (uint8_t)(0x90 + i);
+    }
+    for (i = 0; i < sizeof(aad); i++) {
+        aad[i] = (uint8_t)(i * 9);
+    }
+    
+    sm4_gcm_init(&ctx, key, iv_base, 12);
+    if (sm4_gcm_prefetch_enable(&ctx, iv_base, 5, MAX_LEN, DEPTH) != 0 ||
+        sm4_gcm_prefetch_enable(&ctx, iv_base, 5, MAX_LEN, DEPTH) == 0) {
+        printf("打开预取失败!\n");
+        sm4_gcm_prefetch_disable(&ctx);
+        return 0;
+    }
+    usleep(20000);
+    
+    /* 长度覆盖0、不足一块和超过预取长度；分两次调用，第一段长度不是16的倍数 */
+    for (m = 0; m < MESSAGES; m++) {
+        len = (m * 37) % sizeof(msg);
+        first = m % 23 < len ? m % 23 : len;
+        for (i = 0; i < len; i++) {
+            msg[i] = (uint8_t)(m + i * 5);
+        }
+        
+        if (sm4_gcm_prefetch_next(&ctx, iv, &seq) != 0 || seq != 5 + m) {
+            passed = 0;
+            break;
+        }
+        memcpy(expected_iv, iv_base, 12);
+        for (i = 0; i < 8; i++) {
+            expected_iv[11 - i] ^= (uint8_t)(seq >> (8 * i));
+        }
+        sm4_gcm_encrypt_and_tag(key, expected_iv, 12, aad, m % sizeof(aad), msg, len, ref_ct, ref_tag, 16);
+        
+        sm4_gcm_aad(&ctx, aad, m % sizeof(aad));
+        if (m % 2 == 0) {
+            sm4_gcm_encrypt(&ctx, ct, msg, first);
+            sm4_gcm_encrypt(&ctx, ct + first, msg + first, len - first);
+            sm4_gcm_finish(&ctx, tag, 16);
+            if (memcmp(ct, ref_ct, len) != 0) {
+                passed = 0;
+            }
+        } else {
+            /* 原地解密 */
+            memcpy(ct, ref_ct, len);
+            sm4_gcm_decrypt(&ctx, ct, ct, first);
+            sm4_gcm_decrypt(&ctx, ct + first, ct + first, len - first);
+            sm4_gcm_finish(&ctx, tag, 16);
+            if (memcmp(ct, msg, len) != 0) {
+                passed = 0;
+            }
+        }
+        if (memcmp(iv, expected_iv, 12) != 0 || memcmp(tag, ref_tag, 16) != 0) {
+            passed = 0;
+        }
+        if (!passed) {
+            printf("第%zu条消息（%zu字节）结果不正确!\n", m, len);
+            break;
+        }
+    }
+    
+    sm4_gcm_prefetch_stats(&ctx, &hits, &misses);
+    printf("命中: %llu，未命中: %llu\n", (unsigned long long)hits, (unsigned long long)misses);
+    if (hits + misses != MESSAGES || hits == 0) {
+        printf("预取没有生效!\n");
+        passed = 0;
+    }
+    
+    sm4_gcm_prefetch_disable(&ctx);
+    if (ctx.prefetch != NULL || sm4_gcm_prefetch_next(&ctx, iv, &seq) == 0) {
+        printf("关闭预取失败!\n");
+        passed = 0;
+    }
+    
+    printf("GCM密钥流预取测试%s!\n", passed ? "通过" : "失败");
+    return passed;
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    int passed = 1;
+    SM4_CPU_Features features;
+    
+    /* 检测CPU特性 */
+    features = sm4_get_cpu_features();
+    printf("CPU特性检测:\n");
+    printf("  SSE2: %s\n", features.has_sse2 ? "支持" : "不支持");
+    printf("  AES-NI: %s\n", features.has_aesni ? "支持" : "不支持");
+    printf("  AVX: %s\n", features.has_avx ? "支持" : "不支持");
+    printf("  AVX2: %s\n", features.has_avx2 ? "支持" : "不支持");
+    printf("  AVX-512F: %s\n", features.has_avx512f ? "支持" : "不支持");
+    printf("  GFNI: %s\n", features.has_gfni ? "支持" : "不支持");
+    printf("  VAES: %s\n", features.has_vaes ? "支持" : "不支持");
+    printf("  VPCLMULQDQ: %s\n", features.has_vpclmulqdq ? "支持" : "不支持");
+    
+    printf("\n最佳SM4实现: %s\n\n", sm4_get_best_implementation());
+    
+    /* 运行测试 */
+    if (!test_sm4_basic()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_t_table()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_dispatch()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_cbc()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_ctr()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_gcm()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_xts()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_ccm()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_ocb()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_mb()) {
+        passed = 0;
+    }
+    
+#if !defined(_WIN32)
+    if (!test_sm4_aio()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_container()) {
+        passed = 0;
+    }
+    
+    if (!test_sm4_gcm_prefetch()) {
+        passed = 0;
+    }
+#endif
+    
+    if (!test_sm4_pool()) {
         passed = 0;
     }
     